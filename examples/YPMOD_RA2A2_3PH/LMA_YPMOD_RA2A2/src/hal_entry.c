@@ -4,6 +4,7 @@
 #include "Storage.h"
 #include "hal_data.h"
 #include "stdio.h"
+#include "string.h"
 
 FSP_CPP_HEADER
 void R_BSP_WarmStart(bsp_warm_start_event_t event);
@@ -14,10 +15,14 @@ FSP_CPP_FOOTER
 #define PHASE3_CALIB_ID (2U)
 #define GLOBAL_CALIB_ID (3U)
 #define ENERGY_LOG_ID (4U)
+#define TARIFF_SCHEDULE_ID (5U)
+#define TARIFF_ENERGY_ID (6U)
 
 /* Configuration required for configuring the library 4500 ws/imp = 800 imp/kwh (3,600,000 = [ws/imp] * [kwh/imp])*/
 static LMA_Config config = {.gcalib = {.fs = 0.0f, .deg_per_sample = 0.0f},
                             .update_interval = 25,
+                            .adc_bits = 24U,
+                            .rtc_rate = 2U,
                             .fline_tol_low = 25.00f,
                             .fline_tol_high = 75.00f,
                             .meter_constant = 4500.00f,
@@ -70,6 +75,26 @@ static LMA_SystemEnergy system_energy = {
                 .apparent_on = false},
 };
 
+/* Time of use schedule to load at startup - day (T1) from 07:00, night (T0) from 23:00, every day of the year*/
+static LMA_TariffSchedule default_tariff_schedule = {
+    .season_start = {LMA_TARIFF_DATE(1, 1)},
+    .week_profile = {{0, 0, 0, 0, 0, 0, 0}},
+    .day_profile = {{LMA_TARIFF_SWITCH(7, 0, 1), LMA_TARIFF_SWITCH(23, 0, 0)}},
+    .switch_count = {2},
+    .season_count = 1};
+
+/* Time of use tariff - system active import on each tariff*/
+static LMA_Tariff tariff;
+
+/* Time of use energy - the counter and accumulator of each tariff register, as stored in VEEPROM*/
+typedef struct Tariff_energy_str
+{
+  uint64_t counter[LMA_TARIFF_COUNT];
+  float accumulator_ws[LMA_TARIFF_COUNT];
+} Tariff_energy;
+
+static Tariff_energy tariff_energy;
+
 /* Now define our phase pointing to our data structure*/
 static LMA_Phase phase1;
 static LMA_Phase phase2;
@@ -78,6 +103,14 @@ static LMA_Phase phase3;
 /* Benchmarking*/
 static benchmark_t benchmark;
 
+/** @brief Reads SysTick, run free at the core clock as the benchmark timer*/
+static uint32_t Benchmark_timer_read(void);
+/** @brief SysTick counts between two readings (24 bit down counter)*/
+static uint32_t Benchmark_timer_elapsed(uint32_t start, uint32_t end);
+
+static const benchmark_timer_t benchmark_timer = {.p_read = &Benchmark_timer_read,
+                                                  .p_elapsed = &Benchmark_timer_elapsed};
+
 /** @brief Modifies ADC phase shift registers based on phase errors in calibration data
  * Must be called after loading calibration data to phases.
  */
@@ -88,6 +121,12 @@ static void Reset_adc_phase(void);
 /** @brief Stores calibration data of all phases and global system*/
 static void Store_calibration_data(void);
 
+/** @brief Copies the counter and accumulator of each tariff register (consistent with the ADC interrupt)*/
+static void Tariff_energy_get(Tariff_energy *const p_energy);
+
+/** @brief Converts a date and time (2000 to 2099) to seconds since 2000-01-01 00:00:00 for LMA_ClockSet*/
+static uint32_t Clock_seconds(uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second);
+
 /** @brief Perform CPU Load test and display results*/
 static void Cpu_load(char *p_args);
 /** @brief Calibrate chip and store & display results*/
@@ -100,15 +139,26 @@ static void Energy_log(char *p_args);
 static void Energy_clear(char *p_args);
 /** @brief Display measurement results*/
 static void Display_measurements(char *p_args);
+/** @brief Stores a day/night time of use schedule in VEEPROM and follows it from the next minute*/
+static void Tariff_schedule(char *p_args);
+/** @brief Sets the clock (local time) which the time of use schedule follows*/
+static void Clock_set(char *p_args);
 /** @brief Dumps dataflash contents to terminal*/
 static void Mem_dump(char *p_args);
 /** @brief Direct call to NVIC_SystemReset*/
 static void System_reset(char *p_args);
+#if LMA_TRACE_ENABLE
+/** @brief Dumps the ISR timing distributions collected by LMA (args: "clear" resets them)*/
+static void Trace_dump(char *p_args);
+#endif
 
 /* Menuing*/
 Menu main_menu = {.p_name = "Main Menu"};
-Menu_option cpu_load_option = {
-    .p_cmd = "cpu", .p_help = "Performs CPU Load Test", .option_type = ACTION, .option.action = &Cpu_load};
+Menu_option cpu_load_option = {.p_cmd = "cpu",
+                               .p_help = "Performs CPU Load Test, reporting the load of each ISR and the main loop\r\n"
+                                         "\t\t\t Arguments: periods - number of 500ms periods to run over (default 10)",
+                               .option_type = ACTION,
+                               .option.action = &Cpu_load};
 
 Menu_option calib_option = {.p_cmd = "calib",
                             .p_help = "Calibrates device, stores in lib and VEEPROM\r\n"
@@ -142,15 +192,39 @@ Menu_option display_option = {.p_cmd = "display",
                               .option_type = ACTION,
                               .option.action = &Display_measurements};
 
+Menu_option tariff_option = {.p_cmd = "tariff",
+                             .p_help = "Stores a time of use schedule in VEEPROM - day (T1) and night (T0), every day\r\n"
+                                       "\t\t\t Arguments (space seperated): day_hour day_minute night_hour night_minute\r\n"
+                                       "\t\t\t e.g., tariff 7 0 23 0 (no arguments stores the default schedule)",
+                             .option_type = ACTION,
+                             .option.action = &Tariff_schedule};
+
+Menu_option clock_option = {.p_cmd = "clock",
+                            .p_help = "Sets the clock (local time) of the time of use schedule\r\n"
+                                      "\t\t\t Arguments (space seperated): year month day hour minute second\r\n"
+                                      "\t\t\t e.g., clock 2025 10 22 14 30 0 (no arguments displays the clock)",
+                            .option_type = ACTION,
+                            .option.action = &Clock_set};
+
 Menu_option memdump_option = {
     .p_cmd = "memdump", .p_help = "Dumps dataflash contents to terminal", .option_type = ACTION, .option.action = &Mem_dump};
 
 Menu_option reset_option = {
     .p_cmd = "reset", .p_help = "Immediately calls NVIC_SystemReset()", .option_type = ACTION, .option.action = &System_reset};
 
+#if LMA_TRACE_ENABLE
+Menu_option trace_option = {.p_cmd = "trace",
+                            .p_help = "Dumps LMA ISR timing histograms [core clock cycles]\r\n"
+                                      "\t\t\t Arguments: clear - resets the histograms after dumping",
+                            .option_type = ACTION,
+                            .option.action = &Trace_dump};
+#endif
+
 static LMA_PhaseCalibration veeprom_phase_calib;
 static LMA_GlobalCalibration veeprom_global_calib;
 static LMA_SystemEnergy veeprom_sys_energy;
+static LMA_TariffSchedule veeprom_tariff_schedule;
+static Tariff_energy veeprom_tariff_energy;
 
 void hal_entry(void)
 {
@@ -166,11 +240,19 @@ void hal_entry(void)
   Menu_register_option(&main_menu, &energy_log_option);
   Menu_register_option(&main_menu, &energy_clear_option);
   Menu_register_option(&main_menu, &display_option);
+  Menu_register_option(&main_menu, &tariff_option);
+  Menu_register_option(&main_menu, &clock_option);
   Menu_register_option(&main_menu, &memdump_option);
   Menu_register_option(&main_menu, &reset_option);
+#if LMA_TRACE_ENABLE
+  Menu_register_option(&main_menu, &trace_option);
+#endif
 
-  /* Init benchmarking system*/
-  Benchmark_init(&benchmark, 5);
+  /* Init benchmarking system - SysTick free running without interrupt, 50 TMR ticks (500ms) per period*/
+  SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+  SysTick->VAL = 0UL;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+  Benchmark_init(&benchmark, &benchmark_timer, 50);
 
   /* Clear Screen & Home cursor*/
   Menu_printf("\033[2J");
@@ -180,6 +262,12 @@ void hal_entry(void)
   /* Initialise the framework*/
   LMA_Init(&config);
 
+#if LMA_TRACE_ENABLE
+  /* Count callbacks which overrun their interrupt period*/
+  LMA_TraceBudgetSet(LMA_TRACE_ADC, (uint32_t)(SystemCoreClock / default_global_calib.fs));
+  LMA_TraceBudgetSet(LMA_TRACE_TMR, SystemCoreClock / 100UL);
+#endif
+
   /* Prepare*/
   Storage_startup();
 
@@ -207,6 +295,29 @@ void hal_entry(void)
     LMA_EnergySet(&system_energy);
   }
 
+  /* Load Time of Use Schedule*/
+  if (Storage_read(TARIFF_SCHEDULE_ID, (uint8_t *)&veeprom_tariff_schedule))
+  {
+    Menu_printf("Tariff Schedule found in VEEPROM!\r\n");
+    tariff.p_schedule = &veeprom_tariff_schedule;
+  }
+  else
+  {
+    Menu_printf("Tariff Schedule NOT found in VEEPROM - using defaults!\r\n");
+    tariff.p_schedule = &default_tariff_schedule;
+  }
+
+  /* Load Time of Use Energy*/
+  if (Storage_read(TARIFF_ENERGY_ID, (uint8_t *)&veeprom_tariff_energy))
+  {
+    Menu_printf("Tariff Energy Log found in VEEPROM!\r\n");
+  }
+  else
+  {
+    Menu_printf("Tariff Energy Log NOT found in VEEPROM - using defaults!\r\n");
+    memset(&veeprom_tariff_energy, 0, sizeof(Tariff_energy));
+  }
+
   /* Initialise the phase(s)*/
   LMA_PhaseRegister(&phase1);
   LMA_PhaseRegister(&phase2);
@@ -253,6 +364,17 @@ void hal_entry(void)
   /* Clearup*/
   Storage_shutdown();
 
+  /* Time of use tariff - the clock runs from 2000-01-01 00:00:00 until set with LMA_ClockSet (see Clock_set)*/
+  for (uint32_t t = 0; t < LMA_TARIFF_COUNT; ++t)
+  {
+    tariff.registers[t].p_phase = NULL;
+    tariff.registers[t].quantity = LMA_REGISTER_ACT_IMP;
+    tariff.registers[t].meter_constant = config.meter_constant;
+    tariff.registers[t].counter = veeprom_tariff_energy.counter[t];
+    tariff.registers[t].accumulator_ws = veeprom_tariff_energy.accumulator_ws[t];
+  }
+  LMA_TariffSet(&tariff);
+
   /* Calibrate ADC*/
   Calibrate_adc_phase();
 
@@ -368,15 +490,69 @@ static void Store_calibration_data(void)
   Storage_shutdown();
 }
 
+static void Tariff_energy_get(Tariff_energy *const p_energy)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  /* The counters are 64 bit - copy them with the ADC interrupt held off*/
+  LMA_CRITICAL_SECTION_ENTER();
+  for (uint32_t t = 0; t < LMA_TARIFF_COUNT; ++t)
+  {
+    p_energy->counter[t] = tariff.registers[t].counter;
+    p_energy->accumulator_ws[t] = tariff.registers[t].accumulator_ws;
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+static uint32_t Clock_seconds(uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second)
+{
+  /* Days before each month of a common year*/
+  static const uint16_t month_days[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  uint32_t years = year - 2000UL;
+  uint32_t days = (years * 365UL) + ((years + 3UL) / 4UL) + month_days[month - 1UL] + (day - 1UL);
+
+  /* Every fourth year from 2000 is a leap year up to 2099*/
+  if ((0UL == (year % 4UL)) && (month > 2UL))
+  {
+    ++days;
+  }
+
+  return (((((days * 24UL) + hour) * 60UL) + minute) * 60UL) + second;
+}
+
 static void Cpu_load(char *p_args)
 {
-  (void)(p_args);
-  Menu_printf("\r\nRunning CPU Load Test...");
-  Benchmark_run(&benchmark);
+  static const char *const context_names[BENCHMARK_CONTEXTS] = {"Main", "ADC", "TMR", "RTC"};
+  uint32_t periods = 0;
+
+  sscanf(p_args, "%lu", &periods);
+  if (0 == periods)
+  {
+    periods = 10;
+  }
+
+  Menu_printf("\r\nRunning CPU Load Test over %lu x 500ms...", periods);
+  Benchmark_run(&benchmark, periods);
   Menu_printf("Done!\r\n");
+
+  for (uint32_t c = 0; c < (uint32_t)BENCHMARK_CONTEXTS; ++c)
+  {
+    Menu_printf("\t%s: Average %.2f [%%], Peak %.2f [%%]\r\n", context_names[c], benchmark.load[c].average,
+                benchmark.load[c].peak);
+  }
   Menu_printf("CPU Peak Load: %.2f [%%]", benchmark.cpu_utilisation_pk);
 }
 
+static uint32_t Benchmark_timer_read(void)
+{
+  return SysTick->VAL;
+}
+
+static uint32_t Benchmark_timer_elapsed(uint32_t start, uint32_t end)
+{
+  return (start - end) & SysTick_VAL_CURRENT_Msk;
+}
+
 static void Calibrate(char *p_args)
 {
   float l_vrms, l_irms, l_fline = 0.0f;
@@ -394,39 +570,39 @@ static void Calibrate(char *p_args)
   Reset_adc_phase();
   Menu_printf("Done!\r\n");
 
-  LMA_PhaseCalibArgs ca;
+  LMA_Phase *const phases[3] = {&phase1, &phase2, &phase3};
+  LMA_PhaseCalibArgs ca[3];
+  LMA_CalibState states[3];
+  LMA_CalibJob job = {.p_args = ca, .p_states = states, .count = 3, .p_callback = NULL};
   LMA_GlobalCalibArgs gca;
 
-  Menu_printf("\r\nCalibrating Phase 1...");
-  ca.p_phase = &phase1;
-  ca.vrms_tgt = l_vrms;
-  ca.irms_tgt = l_irms;
-  ca.line_cycles = l_line_cycles;
-  ca.line_cycles_stability = l_line_cycles_stability;
-  LMA_PhaseCalibrate(&ca);
-  Menu_printf("Done!\r\n");
-  Menu_printf("Irms Coefficient: %.4f\r\n", phase1.calib.irms_coeff);
-  Menu_printf("Vrms Coefficient: %.4f\r\n", phase1.calib.vrms_coeff);
-  Menu_printf("Power Coefficient: %.4f\r\n", phase1.calib.p_coeff);
-  Menu_printf("V-I Phase Error: %.4f\r\n", phase1.calib.vi_phase_correction);
-
-  Menu_printf("\r\nCalibrating Second Phase...");
-  ca.p_phase = &phase2;
-  LMA_PhaseCalibrate(&ca);
-  Menu_printf("Done!\r\n");
-  Menu_printf("Irms Coefficient: %.4f\r\n", phase2.calib.irms_coeff);
-  Menu_printf("Vrms Coefficient: %.4f\r\n", phase2.calib.vrms_coeff);
-  Menu_printf("Power Coefficient: %.4f\r\n", phase2.calib.p_coeff);
-  Menu_printf("V-I Phase Error: %.4f\r\n", phase2.calib.vi_phase_correction);
-
-  Menu_printf("\r\nCalibrating Third Phase...");
-  ca.p_phase = &phase3;
-  LMA_PhaseCalibrate(&ca);
+  /* The phases calibrate together - one pass of line_cycles_stability + line_cycles rather than one per phase*/
+  Menu_printf("\r\nCalibrating Phases...");
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    ca[i].p_phase = phases[i];
+    ca[i].vrms_tgt = l_vrms;
+    ca[i].irms_tgt = l_irms;
+    ca[i].line_cycles = l_line_cycles;
+    ca[i].line_cycles_stability = l_line_cycles_stability;
+  }
+  if (LMA_PhaseCalibrateStart(&job))
+  {
+    while (0 != job.remaining)
+    {
+      LMA_PORT_WAIT();
+    }
+  }
   Menu_printf("Done!\r\n");
-  Menu_printf("Irms Coefficient: %.4f\r\n", phase3.calib.irms_coeff);
-  Menu_printf("Vrms Coefficient: %.4f\r\n", phase3.calib.vrms_coeff);
-  Menu_printf("Power Coefficient: %.4f\r\n", phase3.calib.p_coeff);
-  Menu_printf("V-I Phase Error: %.4f\r\n", phase3.calib.vi_phase_correction);
+
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    Menu_printf("\r\nPhase %lu:\r\n", i + 1);
+    Menu_printf("Irms Coefficient: %.4f\r\n", phases[i]->calib.irms_coeff);
+    Menu_printf("Vrms Coefficient: %.4f\r\n", phases[i]->calib.vrms_coeff);
+    Menu_printf("Power Coefficient: %.4f\r\n", phases[i]->calib.p_coeff);
+    Menu_printf("V-I Phase Error: %.4f\r\n", phases[i]->calib.vi_phase_correction);
+  }
 
   Menu_printf("\r\nCalibrating Global Parameters (fs)...");
   gca.rtc_period = 1.0f;
@@ -475,6 +651,7 @@ static void Energy_log(char *p_args)
 
   Menu_printf("\r\nRetrieving energy log...");
   LMA_EnergyGet(&system_energy);
+  Tariff_energy_get(&tariff_energy);
   Menu_printf("Done!\r\n");
 
   Menu_printf("\r\nWriting log to VEEPROM...");
@@ -483,6 +660,7 @@ static void Energy_log(char *p_args)
   Storage_startup();
 
   Storage_write(ENERGY_LOG_ID, (uint8_t *)&system_energy, sizeof(LMA_SystemEnergy));
+  Storage_write(TARIFF_ENERGY_ID, (uint8_t *)&tariff_energy, sizeof(Tariff_energy));
 
   /* Clearup*/
   Storage_shutdown();
@@ -502,6 +680,14 @@ static void Energy_clear(char *p_args)
   Menu_printf("\r\nClearing energy log...");
   memset(&(system_energy.energy), 0, sizeof(LMA_Energy));
   LMA_EnergySet(&system_energy);
+
+  /* LMA is stopped - the tariff registers restart from zero without being set again*/
+  memset(&tariff_energy, 0, sizeof(Tariff_energy));
+  for (uint32_t t = 0; t < LMA_TARIFF_COUNT; ++t)
+  {
+    tariff.registers[t].counter = tariff_energy.counter[t];
+    tariff.registers[t].accumulator_ws = tariff_energy.accumulator_ws[t];
+  }
   Menu_printf("Done!\r\n");
 
   err = RM_VEE_FLASH_Open(&g_vee0_ctrl, &g_vee0_cfg);
@@ -516,6 +702,7 @@ static void Energy_clear(char *p_args)
   Storage_startup();
 
   Storage_write(ENERGY_LOG_ID, (uint8_t *)&system_energy, sizeof(LMA_SystemEnergy));
+  Storage_write(TARIFF_ENERGY_ID, (uint8_t *)&tariff_energy, sizeof(Tariff_energy));
 
   /* Clearup*/
   Storage_shutdown();
@@ -537,7 +724,8 @@ static void Display_measurements(char *p_args)
   static LMA_Measurements measurements3;
   static LMA_ConsumptionData energy_consumed;
 
-  /* Get current snapshot of measurements*/
+  /* Idle until a window newer than the last display (at most a second of 10ms TMR periods), then get its measurements*/
+  (void)LMA_MeasurementsWait(&phase1, 100U);
   LMA_MeasurementsGet(&phase1, &measurements1);
 
   Menu_printf("\r\n- Phase 1\r\n");
@@ -584,6 +772,91 @@ static void Display_measurements(char *p_args)
   Menu_printf("\tReactive Export (C): %.4f [VARh]\r\n", energy_consumed.c_exp_energy_wh);
   Menu_printf("\tReactive Import (L): %.4f [VARh]\r\n", energy_consumed.l_imp_energy_wh);
   Menu_printf("\tReactive Export (L): %.4f [VARh]\r\n", energy_consumed.l_exp_energy_wh);
+
+  Menu_printf("\r\n- Time of Use (T%u active)\r\n", (unsigned)tariff.active);
+  for (uint32_t t = 0; t < LMA_TARIFF_COUNT; ++t)
+  {
+    Menu_printf("\tT%u: %.4f [Wh]\r\n", (unsigned)t, LMA_RegisterWhGet(&(tariff.registers[t])));
+  }
+}
+
+static void Tariff_schedule(char *p_args)
+{
+  static LMA_TariffSchedule schedule;
+  uint32_t day_hour, day_minute, night_hour, night_minute = 0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  schedule = default_tariff_schedule;
+
+  if (4 == sscanf(p_args, "%lu %lu %lu %lu", &day_hour, &day_minute, &night_hour, &night_minute))
+  {
+    if ((day_hour > 23UL) || (day_minute > 59UL) || (night_hour > 23UL) || (night_minute > 59UL))
+    {
+      Menu_printf("\r\nInvalid switch time(s) - schedule unchanged!\r\n");
+      return;
+    }
+
+    /* Switch points in ascending order of the day*/
+    if (((day_hour * 60UL) + day_minute) < ((night_hour * 60UL) + night_minute))
+    {
+      schedule.day_profile[0][0] = LMA_TARIFF_SWITCH(day_hour, day_minute, 1U);
+      schedule.day_profile[0][1] = LMA_TARIFF_SWITCH(night_hour, night_minute, 0U);
+    }
+    else
+    {
+      schedule.day_profile[0][0] = LMA_TARIFF_SWITCH(night_hour, night_minute, 0U);
+      schedule.day_profile[0][1] = LMA_TARIFF_SWITCH(day_hour, day_minute, 1U);
+    }
+
+    Menu_printf("\r\nDay (T1) from %02lu:%02lu, Night (T0) from %02lu:%02lu", day_hour, day_minute, night_hour,
+                night_minute);
+  }
+  else
+  {
+    Menu_printf("\r\nDefault schedule");
+  }
+
+  Menu_printf("\r\nWriting schedule to VEEPROM...");
+
+  /* Prepare*/
+  Storage_startup();
+
+  Storage_write(TARIFF_SCHEDULE_ID, (uint8_t *)&schedule, sizeof(LMA_TariffSchedule));
+
+  /* Clearup*/
+  Storage_shutdown();
+
+  /* LMA_CB_RTC looks the schedule up on the next minute boundary - the registers keep counting*/
+  LMA_CRITICAL_SECTION_ENTER();
+  veeprom_tariff_schedule = schedule;
+  tariff.p_schedule = &veeprom_tariff_schedule;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  Menu_printf("Done!\r\n");
+}
+
+static void Clock_set(char *p_args)
+{
+  uint32_t year, month, day, hour, minute, second = 0;
+
+  if (6 != sscanf(p_args, "%lu %lu %lu %lu %lu %lu", &year, &month, &day, &hour, &minute, &second))
+  {
+    Menu_printf("\r\nClock: %lu [s since 2000-01-01 00:00:00], T%u active\r\n", (unsigned long)LMA_ClockGet(),
+                (unsigned)tariff.active);
+    return;
+  }
+
+  if ((year < 2000UL) || (year > 2099UL) || (month < 1UL) || (month > 12UL) || (day < 1UL) || (day > 31UL) ||
+      (hour > 23UL) || (minute > 59UL) || (second > 59UL))
+  {
+    Menu_printf("\r\nInvalid date/time - clock unchanged!\r\n");
+    return;
+  }
+
+  LMA_ClockSet(Clock_seconds(year, month, day, hour, minute, second));
+
+  Menu_printf("\r\nClock set to %04lu-%02lu-%02lu %02lu:%02lu:%02lu, T%u active\r\n", year, month, day, hour, minute,
+              second, (unsigned)tariff.active);
 }
 
 static void Mem_dump(char *p_args)
@@ -608,6 +881,41 @@ static void System_reset(char *p_args)
   NVIC_SystemReset();
 }
 
+#if LMA_TRACE_ENABLE
+static void Trace_dump(char *p_args)
+{
+  static const char *const names[LMA_TRACE_COUNT] = {"LMA_CB_ADC", "LMA_CB_TMR", "LMA_CB_RTC", "LMA_AccPhaseRun",
+                                                     "LMA_AccPhaseLoad"};
+  static LMA_TraceStats stats;
+
+  Menu_printf("\r\nLMA Trace [cycles @ %lu Hz]:\r\n", (unsigned long)SystemCoreClock);
+
+  for (uint32_t id = 0; id < (uint32_t)LMA_TRACE_COUNT; ++id)
+  {
+    LMA_TraceGet((LMA_TraceId)id, &stats);
+
+    Menu_printf("- %s\r\n", names[id]);
+    Menu_printf("\tCount: %lu, Min: %lu, Max: %lu, Overruns: %lu (budget %lu)\r\n", (unsigned long)stats.count,
+                (unsigned long)stats.min, (unsigned long)stats.max, (unsigned long)stats.overruns,
+                (unsigned long)stats.budget);
+
+    for (uint32_t b = 0; b < LMA_TRACE_BUCKETS; ++b)
+    {
+      if (0 != stats.buckets[b])
+      {
+        Menu_printf("\t>= %8lu: %lu\r\n", (0 == b) ? 0UL : (1UL << (b - 1)), (unsigned long)stats.buckets[b]);
+      }
+    }
+  }
+
+  if ((NULL != p_args) && (0 == strncmp(p_args, "clear", 5)))
+  {
+    LMA_TraceReset();
+    Menu_printf("Trace cleared!\r\n");
+  }
+}
+#endif
+
 /** @brief phase shifts voltage signal
  * @details
  * - 50Hz signal is 20ms.
@@ -654,7 +962,7 @@ void DSADC_Callback(adc_callback_args_t *p_args)
 {
   (void)p_args;
 
-  Benchmark_work_begin(&benchmark);
+  Benchmark_work_begin(&benchmark, BENCHMARK_ADC);
   phase1.inputs.v_sample = (spl_t)R_SDADC_B->SDADCR4;
   phase1.inputs.i_sample = (spl_t)R_SDADC_B->SDADCR0;
   phase1.inputs.v90_sample = PhaseShift90(phase1.inputs.v_sample);
@@ -675,7 +983,7 @@ void TMR_Callback(timer_callback_args_t *p_args)
 {
   (void)p_args;
 
-  Benchmark_work_begin(&benchmark);
+  Benchmark_work_begin(&benchmark, BENCHMARK_TMR);
   LMA_CB_TMR();
   Benchmark_work_end(&benchmark);
 
@@ -701,7 +1009,9 @@ void RTC_Callback(rtc_callback_args_t *p_args)
   /* Periodic interrupt event */
   case RTC_EVENT_PERIODIC_IRQ:
   {
+    Benchmark_work_begin(&benchmark, BENCHMARK_RTC);
     LMA_CB_RTC();
+    Benchmark_work_end(&benchmark);
     break;
   }
   default:
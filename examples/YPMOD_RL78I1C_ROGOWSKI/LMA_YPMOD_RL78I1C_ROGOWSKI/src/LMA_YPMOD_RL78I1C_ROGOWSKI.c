@@ -9,6 +9,7 @@
 /*                                                                     */
 /***********************************************************************/
 
+#include "Benchmark.h"
 #include "LMA_Core.h"
 #include "Menu.h"
 #include "Storage.h"
@@ -24,6 +25,7 @@
 /* Configuration required for configuring the library 4500 ws/imp = 800 imp/kwh (3,600,000 = [ws/imp] * [kwh/imp])*/
 static LMA_Config config = {.gcalib = {.fs = 0.0f, .deg_per_sample = 0.0f},
                             .update_interval = 30,
+                            .adc_bits = 24U,
                             .fline_tol_low = 25.00f,
                             .fline_tol_high = 75.00f,
                             .meter_constant = 4500.00f,
@@ -83,6 +85,25 @@ static LMA_SystemEnergy system_energy = {
 LMA_Phase phase;
 LMA_Neutral neutral;
 
+/* Rogowski coil front end - run by LMA_CB_ADC on the phase current: integrate, block the DC drift of the integrator (corner
+ * ~19Hz) and delay 6 samples to line the current up with the voltage*/
+#define ROGOWSKI_DC_BLOCK_COEFF LMA_FILTER_Q(63493.0f / 65535.0f, 16)
+#define ROGOWSKI_DELAY (6U)
+static LMA_FilterStage rogowski_stages[3];
+static spl_t rogowski_delay_line[ROGOWSKI_DELAY + 1U];
+static LMA_FilterChain rogowski_filter;
+
+/* Benchmarking - accounted from the ISRs*/
+benchmark_t benchmark;
+
+/** @brief Reads the TAU0 channel 0 counter (the TMR) as the benchmark timer*/
+static uint32_t Benchmark_timer_read(void);
+/** @brief TAU0 channel 0 counts between two readings (down counter reloading from TDR00)*/
+static uint32_t Benchmark_timer_elapsed(uint32_t start, uint32_t end);
+
+static const benchmark_timer_t benchmark_timer = {.p_read = &Benchmark_timer_read,
+                                                  .p_elapsed = &Benchmark_timer_elapsed};
+
 /** @brief Modifies ADC phase shift registers based on phase errors in calibration data
  * Must be called after loading calibration data to phases.
  */
@@ -112,8 +133,11 @@ static void System_reset(char *p_args);
 
 /* Menuing*/
 Menu main_menu = {.p_name = "Main Menu"};
-Menu_option cpu_load_option = {
-    .p_cmd = "cpu", .p_help = "Currently Unsupported", .option_type = ACTION, .option.action = &Cpu_load};
+Menu_option cpu_load_option = {.p_cmd = "cpu",
+                               .p_help = "Performs CPU Load Test, reporting the load of each ISR and the main loop\r\n"
+                                         "\t\t\t Arguments: periods - number of 500ms periods to run over (default 10)",
+                               .option_type = ACTION,
+                               .option.action = &Cpu_load};
 
 Menu_option calib_option = {.p_cmd = "calib",
                             .p_help = "Calibrates device, stores in lib and VEEPROM\r\n"
@@ -182,6 +206,9 @@ void main(void)
   /* Initialise the framework*/
   LMA_Init(&config);
 
+  /* Init benchmarking system - 50 TMR ticks (500ms) per period*/
+  Benchmark_init(&benchmark, &benchmark_timer, 50);
+
   /* Init EEL*/
   Storage_init();
 
@@ -213,6 +240,13 @@ void main(void)
   /* Initialise the phase(s)*/
   LMA_PhaseRegister(&phase);
 
+  /* Integrate the Rogowski coil*/
+  LMA_FilterIntegratorInit(&(rogowski_stages[0]));
+  LMA_FilterDcBlockInit(&(rogowski_stages[1]), ROGOWSKI_DC_BLOCK_COEFF, 16U);
+  LMA_FilterDelayInit(&(rogowski_stages[2]), rogowski_delay_line, ROGOWSKI_DELAY);
+  LMA_FilterChainInit(&rogowski_filter, rogowski_stages, 3U);
+  LMA_PhaseFilterRegister(&phase, NULL, NULL, &rogowski_filter);
+
   /* Initialise Neutral*/
   LMA_NeutralRegister(&phase, &neutral);
 
@@ -297,8 +331,35 @@ static void Store_calibration_data(void)
 
 static void Cpu_load(char *p_args)
 {
-  (void)(p_args);
-  Menu_printf("\r\nCurrently Unsupported!");
+  static const char *const context_names[BENCHMARK_CONTEXTS] = {"Main", "ADC", "TMR", "RTC"};
+  uint32_t periods = 0;
+
+  sscanf(p_args, "%lu", &periods);
+  if (0 == periods)
+  {
+    periods = 10;
+  }
+
+  Menu_printf("\r\nRunning CPU Load Test over %lu x 500ms...", periods);
+  Benchmark_run(&benchmark, periods);
+  Menu_printf("Done!\r\n");
+
+  for (uint32_t c = 0; c < (uint32_t)BENCHMARK_CONTEXTS; ++c)
+  {
+    Menu_printf("\t%s: Average %.2f [%%], Peak %.2f [%%]\r\n", context_names[c], benchmark.load[c].average,
+                benchmark.load[c].peak);
+  }
+  Menu_printf("CPU Peak Load: %.2f [%%]", benchmark.cpu_utilisation_pk);
+}
+
+static uint32_t Benchmark_timer_read(void)
+{
+  return (uint32_t)TCR00;
+}
+
+static uint32_t Benchmark_timer_elapsed(uint32_t start, uint32_t end)
+{
+  return (start >= end) ? (start - end) : ((start + (uint32_t)TDR00 + 1UL) - end);
 }
 
 static void Calibrate(char *p_args)
@@ -444,7 +505,8 @@ static void Display_measurements(char *p_args)
   static LMA_Measurements measurements;
   static LMA_ConsumptionData energy_consumed;
 
-  /* Get current snapshot of measurements*/
+  /* Idle until a window newer than the last display (at most a second of 10ms TMR periods), then get its measurements*/
+  (void)LMA_MeasurementsWait(&phase, 100U);
   LMA_MeasurementsGet(&phase, &measurements);
 
   Menu_printf("\r\n- Phase\r\n");
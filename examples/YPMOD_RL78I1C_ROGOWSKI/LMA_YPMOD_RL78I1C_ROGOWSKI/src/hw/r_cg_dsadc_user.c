@@ -42,8 +42,8 @@ Pragma directive
 #pragma interrupt r_dsadc_interrupt(vect=INTDSAD)
 
 /* Start user code for pragma. Do not edit comment generated here */
+#include "Benchmark.h"
 #include "LMA_Core.h"
-#include "Trap_integrator.h"
 #include <stdbool.h>
 /* End user code. Do not edit comment generated here */
 
@@ -53,10 +53,7 @@ Global variables and functions
 /* Start user code for global. Do not edit comment generated here */
 extern LMA_Phase phase;
 extern LMA_Neutral neutral;
-
-#define PHASE_DELAY (7)
-spl_t spls[PHASE_DELAY] = {0,};
-uint8_t phase_delay_index = 0;
+extern benchmark_t benchmark;
 
 /** @brief phase shifts voltage signal
  * @details
@@ -111,6 +108,7 @@ static spl_t PhaseShift90(spl_t new_voltage)
 static void __near r_dsadc_interrupt(void)
 {
     /* Start user code. Do not edit comment generated here */
+	Benchmark_work_begin(&benchmark, BENCHMARK_ADC);
 
 	/* CT Current - neutral*/
 	*((uint16_t *)&neutral.inputs.i_sample) = *((uint16_t *)&DSADCR0);
@@ -130,25 +128,11 @@ static void __near r_dsadc_interrupt(void)
 	*(((uint8_t *)&phase.inputs.i_sample) + 2) = *((uint8_t *)(&DSADCR1)+2);
 	*(((int8_t *)&phase.inputs.i_sample) + 3) = (*((int8_t *)(&DSADCR1)+2)) >> 7;
 
-	/* Integrate*/
-	phase.inputs.i_sample = Trap_integrate(&rogowski_integrator, phase.inputs.i_sample);
-
-	/* Phase Delay*/
-	uint8_t next_phase_delay_index = phase_delay_index + 1;
-	spls[phase_delay_index] = phase.inputs.i_sample;
-
-	if(next_phase_delay_index > (PHASE_DELAY-1))
-	{
-		phase_delay_index = 0;
-	}
-	else
-	{
-		phase_delay_index = next_phase_delay_index;
-	}
-
-	phase.inputs.i_sample = spls[phase_delay_index];
+	/* The coil is connected reversed - invert it (the filter chain registered on the phase integrates and delays it)*/
+	phase.inputs.i_sample = -phase.inputs.i_sample;
 
     LMA_CB_ADC();
+	Benchmark_work_end(&benchmark);
 
     /* End user code. Do not edit comment generated here */
 }
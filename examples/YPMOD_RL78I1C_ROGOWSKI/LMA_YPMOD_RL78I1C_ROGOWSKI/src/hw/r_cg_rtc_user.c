@@ -40,6 +40,7 @@ Pragma directive
 ***********************************************************************************************************************/
 #pragma interrupt r_rtc_periodicinterrupt(vect=INTRTCPRD)
 /* Start user code for pragma. Do not edit comment generated here */
+#include "Benchmark.h"
 #include "LMA_Core.h"
 /* End user code. Do not edit comment generated here */
 
@@ -53,6 +54,7 @@ volatile uint32_t g_rtc_binary_rtcic0;
 volatile uint32_t g_rtc_binary_rtcic1;
 volatile uint32_t g_rtc_binary_rtcic2;
 /* Start user code for global. Do not edit comment generated here */
+extern benchmark_t benchmark;
 /* End user code. Do not edit comment generated here */
 
 
@@ -89,7 +91,9 @@ static void __near r_rtc_periodicinterrupt(void)
 static void r_rtc_callback_periodic(void)
 {
     /* Start user code. Do not edit comment generated here */
+	Benchmark_work_begin(&benchmark, BENCHMARK_RTC);
 	LMA_CB_RTC();
+	Benchmark_work_end(&benchmark);
     /* End user code. Do not edit comment generated here */
 }
 
@@ -40,6 +40,7 @@ Pragma directive
 ***********************************************************************************************************************/
 #pragma interrupt r_tau0_channel0_interrupt(vect=INTTM00)
 /* Start user code for pragma. Do not edit comment generated here */
+#include "Benchmark.h"
 #include "LMA_Core.h"
 /* End user code. Do not edit comment generated here */
 
@@ -47,6 +48,7 @@ Pragma directive
 Global variables and functions
 ***********************************************************************************************************************/
 /* Start user code for global. Do not edit comment generated here */
+extern benchmark_t benchmark;
 /* End user code. Do not edit comment generated here */
 
 /***********************************************************************************************************************
@@ -58,8 +60,13 @@ Global variables and functions
 static void __near r_tau0_channel0_interrupt(void)
 {
     /* Start user code. Do not edit comment generated here */
+	Benchmark_work_begin(&benchmark, BENCHMARK_TMR);
 	EI();
 	LMA_CB_TMR();
+	Benchmark_work_end(&benchmark);
+
+	/* The TMR is used as the benchmarking tick*/
+	Benchmark_cb_period(&benchmark);
     /* End user code. Do not edit comment generated here */
 }
 
@@ -0,0 +1,183 @@
+/*
+ * Benchmark.c
+ *
+ *  Created on: 28 Jan 2025
+ *      Author: a5126135
+ */
+
+#include "Benchmark.h"
+#include "LMA_Port.h"
+#include <string.h>
+
+/** @brief macros used to red current interrupt state - taken from the LMA port of the target*/
+#define BM_CRITICAL_SECTION_PREPARE() LMA_CRITICAL_SECTION_PREPARE()
+/** @brief macro used to disable interrupts*/
+#define BM_CRITICAL_SECTION_ENTER() LMA_CRITICAL_SECTION_ENTER()
+/** @brief macro used to restore interrupt state*/
+#define BM_CRITICAL_SECTION_EXIT() LMA_CRITICAL_SECTION_EXIT()
+
+/** @brief charges the time since the last switch to the current context - must be called with interrupts disabled*/
+static void Benchmark_switch(benchmark_t *bm)
+{
+  const uint32_t now = bm->worker.timer.p_read();
+  const benchmark_context_t current =
+      (0U == bm->worker.depth) ? BENCHMARK_MAIN : bm->worker.stack[bm->worker.depth - 1U];
+
+  bm->worker.time[current] += bm->worker.timer.p_elapsed(bm->worker.last_count, now);
+  bm->worker.last_count = now;
+}
+
+static void Benchmark_compute(benchmark_t *bm)
+{
+  uint32_t total = 0;
+
+  for (uint32_t c = 0; c < (uint32_t)BENCHMARK_CONTEXTS; ++c)
+  {
+    total += bm->worker.time[c];
+  }
+
+  if (0U == total)
+  {
+    return;
+  }
+
+  for (uint32_t c = 0; c < (uint32_t)BENCHMARK_CONTEXTS; ++c)
+  {
+    benchmark_load_t *const p_load = &(bm->load[c]);
+
+    p_load->last = 100.00f * ((float)bm->worker.time[c] / (float)total);
+    p_load->average += (p_load->last - p_load->average) / (float)(bm->worker.periods + 1U);
+
+    if (p_load->last > p_load->peak)
+    {
+      p_load->peak = p_load->last;
+    }
+  }
+
+  bm->cpu_utilisation = 100.00f - bm->load[BENCHMARK_MAIN].last;
+
+  if (bm->cpu_utilisation > bm->cpu_utilisation_pk)
+  {
+    bm->cpu_utilisation_pk = bm->cpu_utilisation;
+  }
+
+  ++bm->worker.periods;
+}
+
+void Benchmark_init(benchmark_t *bm, const benchmark_timer_t *p_timer, uint32_t ticks)
+{
+  memset(bm, 0, sizeof(benchmark_t));
+  bm->worker.timer = *p_timer;
+  bm->worker.tick_count_reload = ticks;
+  bm->worker.bm_running = false;
+}
+
+void Benchmark_start(benchmark_t *bm, uint32_t periods)
+{
+  BM_CRITICAL_SECTION_PREPARE();
+  BM_CRITICAL_SECTION_ENTER();
+
+  memset(bm->worker.time, 0, sizeof(bm->worker.time));
+  memset(bm->load, 0, sizeof(bm->load));
+  bm->cpu_utilisation = 0.0f;
+  bm->cpu_utilisation_pk = 0.0f;
+
+  bm->worker.tick_count = bm->worker.tick_count_reload;
+  bm->worker.periods_remaining = periods;
+  bm->worker.periods = 0;
+  bm->worker.last_count = bm->worker.timer.p_read();
+  bm->worker.bm_running = true;
+
+  BM_CRITICAL_SECTION_EXIT();
+}
+
+void Benchmark_stop(benchmark_t *bm)
+{
+  BM_CRITICAL_SECTION_PREPARE();
+  BM_CRITICAL_SECTION_ENTER();
+  bm->worker.bm_running = false;
+  BM_CRITICAL_SECTION_EXIT();
+}
+
+bool Benchmark_running(benchmark_t *bm)
+{
+  return bm->worker.bm_running;
+}
+
+void Benchmark_run(benchmark_t *bm, uint32_t periods)
+{
+  Benchmark_start(bm, (0U == periods) ? 1U : periods);
+
+  while (Benchmark_running(bm))
+  {
+    LMA_PORT_WAIT();
+  }
+}
+
+void Benchmark_work_begin(benchmark_t *bm, benchmark_context_t context)
+{
+  BM_CRITICAL_SECTION_PREPARE();
+  BM_CRITICAL_SECTION_ENTER();
+
+  if (true == bm->worker.bm_running)
+  {
+    Benchmark_switch(bm);
+  }
+
+  /* Contexts are tracked even when not running, so starting from within an ISR stays balanced*/
+  if (bm->worker.depth < BENCHMARK_MAX_NESTING)
+  {
+    bm->worker.stack[bm->worker.depth] = context;
+  }
+  ++bm->worker.depth;
+
+  BM_CRITICAL_SECTION_EXIT();
+}
+
+void Benchmark_work_end(benchmark_t *bm)
+{
+  BM_CRITICAL_SECTION_PREPARE();
+  BM_CRITICAL_SECTION_ENTER();
+
+  if (true == bm->worker.bm_running)
+  {
+    Benchmark_switch(bm);
+  }
+
+  if (0U != bm->worker.depth)
+  {
+    --bm->worker.depth;
+  }
+
+  BM_CRITICAL_SECTION_EXIT();
+}
+
+void Benchmark_cb_period(benchmark_t *bm)
+{
+  BM_CRITICAL_SECTION_PREPARE();
+  BM_CRITICAL_SECTION_ENTER();
+
+  if (true == bm->worker.bm_running)
+  {
+    --bm->worker.tick_count;
+    if (0U == bm->worker.tick_count)
+    {
+      Benchmark_switch(bm);
+      Benchmark_compute(bm);
+
+      memset(bm->worker.time, 0, sizeof(bm->worker.time));
+      bm->worker.tick_count = bm->worker.tick_count_reload;
+
+      if (0U != bm->worker.periods_remaining)
+      {
+        --bm->worker.periods_remaining;
+        if (0U == bm->worker.periods_remaining)
+        {
+          bm->worker.bm_running = false;
+        }
+      }
+    }
+  }
+
+  BM_CRITICAL_SECTION_EXIT();
+}
@@ -0,0 +1,116 @@
+/*
+ * Benchmark.h
+ *
+ *  Created on: 28 Jan 2025
+ *      Author: a5126135
+ */
+
+#ifndef BENCHMARK_BENCHMARK_H_
+#define BENCHMARK_BENCHMARK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief maximum depth of nested contexts (interrupts interrupting interrupts)*/
+#define BENCHMARK_MAX_NESTING (4U)
+
+/** @brief execution contexts the benchmark accounts time to*/
+typedef enum benchmark_context_t
+{
+  BENCHMARK_MAIN = 0, /**< main loop - everything outside the contexts below*/
+  BENCHMARK_ADC,      /**< ADC ISR (LMA_CB_ADC)*/
+  BENCHMARK_TMR,      /**< TMR ISR (LMA_CB_TMR)*/
+  BENCHMARK_RTC,      /**< RTC ISR (LMA_CB_RTC)*/
+  BENCHMARK_CONTEXTS  /**< number of contexts*/
+} benchmark_context_t;
+
+/** @brief timer backend used to measure time
+ * @details Any free running counter will do (core cycle counter, free running timer, host clock) - only differences between
+ * readings are used, so the count rate only needs to be constant.
+ */
+typedef struct benchmark_timer_t
+{
+  uint32_t (*p_read)(void);                            /**< reads the counter*/
+  uint32_t (*p_elapsed)(uint32_t start, uint32_t end); /**< counts between two readings (handles direction and wrap)*/
+} benchmark_timer_t;
+
+/** @brief load of one context in percent of the benchmarking period*/
+typedef struct benchmark_load_t
+{
+  float last;    /**< load over the last completed period*/
+  float average; /**< average load over all periods since the benchmark started*/
+  float peak;    /**< highest load of any period since the benchmark started*/
+} benchmark_load_t;
+
+/** @brief benchmarking object*/
+typedef struct benchmark_t
+{
+  /** @brief worker struct*/
+  struct worker
+  {
+    benchmark_timer_t timer;                          /**< timer backend*/
+    uint32_t last_count;                              /**< counter reading at the last context switch*/
+    uint32_t time[BENCHMARK_CONTEXTS];                /**< counts spent in each context this period*/
+    benchmark_context_t stack[BENCHMARK_MAX_NESTING]; /**< contexts currently entered (innermost last)*/
+    uint32_t depth;                                   /**< number of contexts currently entered*/
+    uint32_t tick_count;                              /**< ticks remaining in this period*/
+    uint32_t tick_count_reload;                       /**< ticks per period*/
+    uint32_t periods_remaining;                       /**< periods left to run (0 = run until stopped)*/
+    uint32_t periods;                                 /**< periods completed since the benchmark started*/
+    volatile bool bm_running;                         /**< benchmark is accounting time*/
+  } worker;
+  benchmark_load_t load[BENCHMARK_CONTEXTS]; /**< load of each context*/
+  float cpu_utilisation;                     /**< interrupt load (all contexts but main) over the last period*/
+  float cpu_utilisation_pk;                  /**< peak interrupt load since the benchmark started*/
+} benchmark_t;
+
+/** @brief intiialises the benchmarker
+ * @param bm - pointer to benchmark worker.
+ * @param p_timer - timer backend to measure time with (copied).
+ * @param ticks - number of ticks (Benchmark_cb_period calls) in each period.
+ */
+void Benchmark_init(benchmark_t *bm, const benchmark_timer_t *p_timer, uint32_t ticks);
+
+/** @brief starts the benchmark - returns immediately
+ * @details Clears the loads and starts accounting time to the contexts.
+ * @param bm - pointer to benchmark worker.
+ * @param periods - number of periods to run for (0 = run until Benchmark_stop).
+ */
+void Benchmark_start(benchmark_t *bm, uint32_t periods);
+
+/** @brief stops the benchmark - the loads of completed periods are kept
+ * @param bm - pointer to benchmark worker.
+ */
+void Benchmark_stop(benchmark_t *bm);
+
+/** @brief checks whether the benchmark is still running
+ * @param bm - pointer to benchmark worker.
+ * @return true if running.
+ */
+bool Benchmark_running(benchmark_t *bm);
+
+/** @brief runs the benchmark - blocks until complete
+ * @param bm - pointer to benchmark worker.
+ * @param periods - number of periods to run for.
+ */
+void Benchmark_run(benchmark_t *bm, uint32_t periods);
+
+/** @brief Marks the start of a context - typically the first thing in an ISR.
+ * @param bm - pointer to benchmark worker.
+ * @param context - context being entered.
+ */
+void Benchmark_work_begin(benchmark_t *bm, benchmark_context_t context);
+
+/** @brief Marks the end of the most recently entered context - typically the last thing in an ISR.
+ * @param bm - pointer to benchmark worker.
+ */
+void Benchmark_work_end(benchmark_t *bm);
+
+/** @brief times benchmarking periods - placed at a p0int which marks the elapsing of a benchmarking tick.
+ * One period is reload ticks, over which the load of each context is computed.
+ * Tupically placed in a timer ISR.
+ * @param bm - pointer to benchmark worker.
+ */
+void Benchmark_cb_period(benchmark_t *bm);
+
+#endif /* BENCHMARK_BENCHMARK_H_ */
@@ -0,0 +1,834 @@
+extern "C"
+{
+#include "LMA_Core.h"
+#include "Trap_integrator.h"
+  extern void (*p_wait_hook)(void);
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** @brief sampling frequency used for the benchmark signals*/
+#define BENCH_FS (3906.25)
+
+/** @brief samples in the signal tables - 4s is a whole number of samples and 50Hz line cycles*/
+#define BENCH_TABLE_SAMPLES (15625U)
+
+/** @brief iterations used to time the getter functions*/
+#define BENCH_GETTER_ITERATIONS (1000000U)
+
+/** @brief samples per call when timing LMA_FilterBlock*/
+#define BENCH_FILTER_BLOCK (64U)
+
+/** @brief DC block coefficient matching the HPF of Trap_integrate (63493 / 65535)*/
+#define BENCH_DC_BLOCK_COEFF LMA_FILTER_Q(63493.0f / 65535.0f, 16)
+
+/** @brief one benchmark configuration*/
+typedef struct BenchCase
+{
+  std::string name; /**< unique name - used to match against the baseline*/
+  size_t phases;    /**< number of phases registered*/
+  bool neutral;     /**< register a neutral on the first phase*/
+  bool hook;        /**< register a computation hook on every phase*/
+  bool rogowski;    /**< currents are Rogowski coil outputs run through Trap_integrate in the ADC context*/
+  bool filter;      /**< currents are Rogowski coil outputs run through an LMA filter chain registered on each phase*/
+  bool computed;    /**< register a computed neutral (vector sum of the phase currents)*/
+  bool system;      /**< register the system measurements (symmetrical components)*/
+  bool coherent;    /**< every phase follows the window of the first (LMA_Config.coherent_windows)*/
+  bool registers;   /**< set an energy register table - active and reactive import and export on every phase*/
+  bool tariff;      /**< set a time of use tariff - the system active import on the tariff of a one tariff schedule*/
+  bool demand;      /**< set a demand table - sliding P, Q and S demands of every phase and of the system*/
+  bool capture;     /**< set a waveform capture - 40 cycles of every phase, nothing triggering it*/
+} BenchCase;
+
+/** @brief timings of one benchmark configuration (ns)*/
+typedef struct BenchResult
+{
+  double adc_ns_per_sample;   /**< LMA_CB_ADC per sample (all phases)*/
+  double tmr_ns_per_window;   /**< LMA_CB_TMR calls which processed a measurement window*/
+  double tmr_ns_per_call;     /**< LMA_CB_TMR calls which had nothing to process*/
+  double measurements_get_ns; /**< LMA_MeasurementsGet*/
+  double consumption_get_ns;  /**< LMA_ConsumptionDataGet*/
+} BenchResult;
+
+/** @brief one filter timing - a way of running a filter over the coil signal*/
+typedef struct BenchFilter
+{
+  std::string name;     /**< unique name - used to match against the baseline*/
+  double ns_per_sample; /**< time per input sample*/
+} BenchFilter;
+
+/** @brief signals and phases under test*/
+typedef struct BenchState
+{
+  std::vector<LMA_Phase> phases;               /**< phases registered with LMA*/
+  LMA_Neutral neutral;                         /**< neutral (if registered)*/
+  LMA_ComputedNeutral computed;                /**< computed neutral (if registered)*/
+  LMA_SystemMeasurements system;               /**< system measurements (if registered)*/
+  std::vector<LMA_Register> registers;         /**< energy registers (if set)*/
+  LMA_TariffSchedule schedule;                 /**< time of use schedule (if set)*/
+  LMA_Tariff tariff;                           /**< time of use tariff (if set)*/
+  std::vector<LMA_Demand> demands;             /**< demand registers (if set)*/
+  LMA_Capture capture;                         /**< waveform capture (if set)*/
+  std::vector<LMA_PhaseInputs> capture_frames; /**< ring of the waveform capture (if set)*/
+  LMA_CaptureEvent capture_event;              /**< event of the waveform capture (if set)*/
+  std::vector<std::vector<spl_t>> v_table;     /**< voltage samples per phase*/
+  std::vector<std::vector<spl_t>> v90_table;   /**< 90 degree shifted voltage samples per phase*/
+  std::vector<std::vector<spl_t>> i_table;     /**< current (or coil output) samples per phase*/
+  std::vector<Trap_integrator> integrators;    /**< integrator per phase (rogowski cases)*/
+  std::vector<LMA_FilterStage> stages;         /**< integrator and DC block per phase (filter cases)*/
+  std::vector<LMA_FilterChain> filters;        /**< current filter chain per phase (filter cases)*/
+  bool rogowski;                               /**< integrate the current samples*/
+  size_t index;                                /**< next sample in the tables*/
+} BenchState;
+
+/** @brief state stepped by the LMA wait hook*/
+static BenchState *p_bench_state = nullptr;
+
+/** @brief sink to stop the getter loops being optimised away*/
+static volatile float bench_sink = 0.0f;
+
+/** @brief Computation hook under test - a small compensation similar in cost to a real one.*/
+static float Bench_hook(float *i, float *v, float *f)
+{
+  *i *= 1.0001f;
+  *v *= 0.9999f;
+  return 1.0f + ((*f - 50.0f) * 0.0001f);
+}
+
+/** @brief Loads the next sample of every phase and runs the ADC callback.
+ * @param[inout] p_state - signals and phases under test.
+ */
+static inline void Bench_adc(BenchState *const p_state)
+{
+  const size_t index = p_state->index;
+
+  for (size_t p = 0; p < p_state->phases.size(); ++p)
+  {
+    p_state->phases[p].inputs.v_sample = p_state->v_table[p][index];
+    p_state->phases[p].inputs.v90_sample = p_state->v90_table[p][index];
+    p_state->phases[p].inputs.i_sample = p_state->rogowski
+                                             ? Trap_integrate(&(p_state->integrators[p]), p_state->i_table[p][index])
+                                             : p_state->i_table[p][index];
+  }
+  p_state->neutral.inputs.i_sample = p_state->i_table[0][index];
+
+  p_state->index = (index + 1 < BENCH_TABLE_SAMPLES) ? (index + 1) : 0;
+
+  LMA_CB_ADC();
+}
+
+/** @brief Wait hook installed in the port - feeds samples while LMA_Start settles.*/
+static void Bench_wait_hook(void)
+{
+  Bench_adc(p_bench_state);
+}
+
+/** @brief Fills a signal table.
+ * @param[out] p_table - destination.
+ * @param[in] rms - RMS value.
+ * @param[in] phase_deg - phase in degrees.
+ * @param[in] scale - conversion from signal value to ADC code.
+ */
+static void Bench_table(std::vector<spl_t> *p_table, double rms, double phase_deg, double scale)
+{
+  const double pi = 3.14159265358979323846;
+
+  p_table->resize(BENCH_TABLE_SAMPLES);
+  for (size_t n = 0; n < BENCH_TABLE_SAMPLES; ++n)
+  {
+    const double angle = (2.0 * pi * 50.0 * static_cast<double>(n) / BENCH_FS) + (phase_deg * pi / 180.0);
+    (*p_table)[n] = static_cast<spl_t>(std::lround(rms * std::sqrt(2.0) * std::sin(angle) * scale));
+  }
+}
+
+/** @brief Runs one benchmark configuration.
+ * @param[in] bench_case - configuration to run.
+ * @param[in] seconds - simulated time to measure over.
+ * @return the timings.
+ */
+static BenchResult Bench_run(const BenchCase &bench_case, double seconds)
+{
+  using clock = std::chrono::steady_clock;
+
+  BenchState state;
+  LMA_Config config;
+  LMA_SystemEnergy energy;
+  LMA_PhaseCalibration phase_calib;
+  LMA_NeutralCalibration neutral_calib;
+  BenchResult result;
+
+  const double v_scale = 0.0012623 * (1 << 23) / 0.5;
+  const double i_scale = 8.0 * 0.0004 * (1 << 23) / 0.5;
+
+  std::memset(&config, 0, sizeof(config));
+  std::memset(&energy, 0, sizeof(energy));
+  std::memset(&(state.neutral), 0, sizeof(state.neutral));
+
+  config.gcalib.fs = static_cast<float>(BENCH_FS);
+  config.gcalib.deg_per_sample = 4.608f;
+  config.update_interval = 25;
+  config.fline_tol_low = 25.0f;
+  config.fline_tol_high = 75.0f;
+  config.meter_constant = 4500.0f;
+  config.no_load_i = 0.01f;
+  config.no_load_p = 2.0f;
+  config.v_sag = 230.0f * 0.25f;
+  config.v_swell = 230.0f * 1.25f;
+  config.coherent_windows = bench_case.coherent;
+
+  phase_calib.vrms_coeff = 21177.2051f;
+  phase_calib.irms_coeff = 53685.3828f;
+  phase_calib.vi_phase_correction = 0.0f;
+  phase_calib.p_coeff = 1136906368.0f;
+  neutral_calib.irms_coeff = 53685.3828f;
+
+  energy.impulse.led_on_count = static_cast<uint32_t>(0.01 * BENCH_FS);
+
+  state.phases.resize(bench_case.phases);
+  state.v_table.resize(bench_case.phases);
+  state.v90_table.resize(bench_case.phases);
+  state.i_table.resize(bench_case.phases);
+  state.integrators.resize(bench_case.phases);
+  state.stages.resize(2U * bench_case.phases);
+  state.filters.resize(bench_case.phases);
+  state.rogowski = bench_case.rogowski;
+  state.index = 0;
+
+  for (size_t p = 0; p < bench_case.phases; ++p)
+  {
+    const double phase_deg = -120.0 * static_cast<double>(p);
+    std::memset(&(state.phases[p]), 0, sizeof(LMA_Phase));
+    Bench_table(&(state.v_table[p]), 230.0, phase_deg, v_scale);
+    Bench_table(&(state.v90_table[p]), 230.0, phase_deg - 90.0, v_scale);
+    if (bench_case.rogowski)
+    {
+      /* Coil output - the reversed derivative of the current scaled by the sampling period*/
+      Bench_table(&(state.i_table[p]), 5.0 * (2.0 * 3.14159265358979323846 * 50.0 / BENCH_FS), phase_deg - 30.0 - 90.0,
+                  i_scale);
+      Trap_reset(&(state.integrators[p]));
+    }
+    else if (bench_case.filter)
+    {
+      /* The filter chain does not invert - the coil is connected the right way round*/
+      Bench_table(&(state.i_table[p]), 5.0 * (2.0 * 3.14159265358979323846 * 50.0 / BENCH_FS), phase_deg - 30.0 + 90.0,
+                  i_scale);
+      LMA_FilterIntegratorInit(&(state.stages[2U * p]));
+      LMA_FilterDcBlockInit(&(state.stages[(2U * p) + 1U]), BENCH_DC_BLOCK_COEFF, 16U);
+      LMA_FilterChainInit(&(state.filters[p]), &(state.stages[2U * p]), 2U);
+    }
+    else
+    {
+      Bench_table(&(state.i_table[p]), 5.0, phase_deg - 30.0, i_scale);
+    }
+  }
+
+  LMA_Init(&config);
+  LMA_EnergySet(&energy);
+  for (size_t p = 0; p < bench_case.phases; ++p)
+  {
+    LMA_PhaseRegister(&(state.phases[p]));
+    LMA_PhaseLoadCalibration(&(state.phases[p]), &phase_calib);
+    if (bench_case.hook)
+    {
+      LMA_ComputationHookRegister(&(state.phases[p]), Bench_hook);
+    }
+    if (bench_case.filter)
+    {
+      LMA_PhaseFilterRegister(&(state.phases[p]), NULL, NULL, &(state.filters[p]));
+    }
+  }
+
+  if (bench_case.neutral)
+  {
+    LMA_NeutralRegister(&(state.phases[0]), &(state.neutral));
+    LMA_NeutralLoadCalibration(&(state.neutral), &neutral_calib);
+  }
+
+  if (bench_case.computed)
+  {
+    LMA_ComputedNeutralRegister(&(state.computed));
+  }
+
+  if (bench_case.system)
+  {
+    LMA_SystemMeasurementsRegister(&(state.system));
+  }
+
+  if (bench_case.registers)
+  {
+    static const LMA_RegisterQuantity quantities[] = {LMA_REGISTER_ACT_IMP, LMA_REGISTER_ACT_EXP, LMA_REGISTER_REACT_IMP,
+                                                      LMA_REGISTER_REACT_EXP};
+    for (LMA_Phase &phase : state.phases)
+    {
+      for (LMA_RegisterQuantity quantity : quantities)
+      {
+        LMA_Register energy_register{};
+        energy_register.p_phase = &phase;
+        energy_register.quantity = quantity;
+        energy_register.meter_constant = config.meter_constant;
+        state.registers.push_back(energy_register);
+      }
+    }
+    LMA_RegistersSet(state.registers.data(), static_cast<uint32_t>(state.registers.size()));
+  }
+
+  if (bench_case.tariff)
+  {
+    state.schedule = {};
+    state.schedule.season_count = 1;
+    state.schedule.season_start[0] = LMA_TARIFF_DATE(1, 1);
+    state.schedule.switch_count[0] = 1;
+    state.schedule.day_profile[0][0] = LMA_TARIFF_SWITCH(0, 0, 0);
+    state.tariff = {};
+    state.tariff.p_schedule = &(state.schedule);
+    for (LMA_Register &tariff_register : state.tariff.registers)
+    {
+      tariff_register.quantity = LMA_REGISTER_ACT_IMP;
+      tariff_register.meter_constant = config.meter_constant;
+    }
+    LMA_TariffSet(&(state.tariff));
+  }
+
+  if (bench_case.demand)
+  {
+    state.demands.clear();
+    for (size_t n = 0; n <= state.phases.size(); ++n)
+    {
+      for (const LMA_RegisterQuantity quantity : {LMA_REGISTER_ACT_IMP, LMA_REGISTER_REACT_IMP, LMA_REGISTER_APP_IMP})
+      {
+        LMA_Demand demand{};
+        demand.p_phase = (n < state.phases.size()) ? &(state.phases[n]) : nullptr;
+        demand.quantity = quantity;
+        demand.subinterval = 60;
+        demand.subintervals = LMA_DEMAND_SUBINTERVALS;
+        state.demands.push_back(demand);
+      }
+    }
+    LMA_DemandsSet(state.demands.data(), static_cast<uint32_t>(state.demands.size()));
+  }
+
+  if (bench_case.capture)
+  {
+    state.capture = {};
+    state.capture.frames = static_cast<uint32_t>(40.0 * BENCH_FS / 50.0);
+    state.capture.post_frames = state.capture.frames / 4U;
+    state.capture.event_count = 1;
+    state.capture.trigger_mask = LMA_VOLTAGE_SAG | LMA_VOLTAGE_SWELL | LMA_OVERCURRENT;
+    state.capture_frames.resize(state.capture.frames * state.phases.size());
+    state.capture.p_buffers = state.capture_frames.data();
+    state.capture.p_events = &(state.capture_event);
+    LMA_CaptureSet(&(state.capture));
+  }
+
+  p_bench_state = &state;
+  p_wait_hook = Bench_wait_hook;
+  LMA_Start();
+
+  /* Interleave the callbacks as on target - a TMR callback every 10ms of samples*/
+  const uint64_t samples = static_cast<uint64_t>(seconds * BENCH_FS);
+  const double tmr_period = BENCH_FS / 100.0;
+  double tmr_elapsed = 0.0;
+  clock::duration adc_time(0);
+  clock::duration tmr_window_time(0);
+  clock::duration tmr_idle_time(0);
+  uint64_t windows = 0;
+  uint64_t idle_calls = 0;
+  uint64_t sample = 0;
+
+  while (sample < samples)
+  {
+    const uint64_t burst = std::min<uint64_t>(samples - sample, static_cast<uint64_t>(tmr_period - tmr_elapsed) + 1);
+
+    const auto adc_start = clock::now();
+    for (uint64_t n = 0; n < burst; ++n)
+    {
+      Bench_adc(&state);
+    }
+    adc_time += clock::now() - adc_start;
+
+    sample += burst;
+    tmr_elapsed += static_cast<double>(burst);
+
+    if (tmr_elapsed >= tmr_period)
+    {
+      const bool window = state.phases[0].sigs.accumulators_ready;
+
+      tmr_elapsed -= tmr_period;
+
+      const auto tmr_start = clock::now();
+      LMA_CB_TMR();
+      const auto tmr_time = clock::now() - tmr_start;
+
+      if (window)
+      {
+        tmr_window_time += tmr_time;
+        ++windows;
+      }
+      else
+      {
+        tmr_idle_time += tmr_time;
+        ++idle_calls;
+      }
+    }
+  }
+
+  /* Getters - the foreground side of the API*/
+  LMA_Measurements measurements;
+  LMA_ConsumptionData consumption;
+  LMA_SystemEnergy energy_snapshot;
+
+  LMA_EnergyGet(&energy_snapshot);
+
+  const auto meas_start = clock::now();
+  for (uint32_t n = 0; n < BENCH_GETTER_ITERATIONS; ++n)
+  {
+    LMA_MeasurementsGet(&(state.phases[n % bench_case.phases]), &measurements);
+    bench_sink = measurements.p;
+  }
+  const auto meas_end = clock::now();
+
+  for (uint32_t n = 0; n < BENCH_GETTER_ITERATIONS; ++n)
+  {
+    LMA_ConsumptionDataGet(&energy_snapshot, &consumption);
+    bench_sink = consumption.act_imp_energy_wh;
+  }
+  const auto cons_end = clock::now();
+
+  LMA_Stop();
+  p_wait_hook = nullptr;
+  p_bench_state = nullptr;
+  LMA_Deinit();
+
+  const auto ns = [](clock::duration d) { return std::chrono::duration<double, std::nano>(d).count(); };
+
+  result.adc_ns_per_sample = ns(adc_time) / static_cast<double>(samples);
+  result.tmr_ns_per_window = (0 != windows) ? ns(tmr_window_time) / static_cast<double>(windows) : 0.0;
+  result.tmr_ns_per_call = (0 != idle_calls) ? ns(tmr_idle_time) / static_cast<double>(idle_calls) : 0.0;
+  result.measurements_get_ns = ns(meas_end - meas_start) / BENCH_GETTER_ITERATIONS;
+  result.consumption_get_ns = ns(cons_end - meas_end) / BENCH_GETTER_ITERATIONS;
+
+  return result;
+}
+
+/** @brief Times the filters on the coil output of a 5A current.
+ * @details Trap_integrate (the RL78 Rogowski integrator) against the equivalent LMA chain - an integrator and DC block - run a
+ * sample at a time and a block at a time, then each stage type on its own in blocks.
+ * @param[in] seconds - simulated time to filter per timing.
+ * @return the timings.
+ */
+static std::vector<BenchFilter> Bench_filters(double seconds)
+{
+  using clock = std::chrono::steady_clock;
+
+  const double i_scale = 8.0 * 0.0004 * (1 << 23) / 0.5;
+  const uint64_t samples = static_cast<uint64_t>(seconds * BENCH_FS);
+  std::vector<spl_t> coil;
+  std::vector<spl_t> out(BENCH_FILTER_BLOCK);
+  std::vector<spl_t> line(16U);
+  std::vector<BenchFilter> filters;
+  Trap_integrator integrator;
+  LMA_FilterStage stages[2];
+  LMA_FilterChain chain;
+  spl_t sink = 0;
+
+  Bench_table(&coil, 5.0 * (2.0 * 3.14159265358979323846 * 50.0 / BENCH_FS), 90.0, i_scale);
+
+  /* Runs body over the samples and records the time per sample*/
+  const auto time = [&](const char *p_name, const auto &body) {
+    const auto start = clock::now();
+    body();
+    const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    filters.push_back({p_name, ns / static_cast<double>(samples)});
+  };
+
+  /* Runs the chain over the samples a block at a time*/
+  const auto run_blocks = [&]() {
+    for (uint64_t n = 0; n < samples; n += BENCH_FILTER_BLOCK)
+    {
+      const size_t start = static_cast<size_t>(n % (BENCH_TABLE_SAMPLES - BENCH_FILTER_BLOCK));
+      const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(BENCH_FILTER_BLOCK, samples - n));
+      const uint32_t produced = LMA_FilterBlock(&chain, &(coil[start]), out.data(), count);
+      sink += (0U != produced) ? out[produced - 1U] : 0;
+    }
+  };
+
+  Trap_reset(&integrator);
+  time("trap_integrate", [&]() {
+    for (uint64_t n = 0; n < samples; ++n)
+    {
+      sink += Trap_integrate(&integrator, coil[n % BENCH_TABLE_SAMPLES]);
+    }
+  });
+
+  LMA_FilterIntegratorInit(&(stages[0]));
+  LMA_FilterDcBlockInit(&(stages[1]), BENCH_DC_BLOCK_COEFF, 16U);
+  LMA_FilterChainInit(&chain, stages, 2U);
+  time("lma_sample", [&]() {
+    for (uint64_t n = 0; n < samples; ++n)
+    {
+      spl_t x = coil[n % BENCH_TABLE_SAMPLES];
+      (void)LMA_FilterSample(&chain, &x);
+      sink += x;
+    }
+  });
+
+  LMA_FilterReset(&chain);
+  time("lma_block", run_blocks);
+
+  /* Each stage type on its own*/
+  LMA_FilterIntegratorInit(&(stages[0]));
+  LMA_FilterChainInit(&chain, stages, 1U);
+  time("integrator", run_blocks);
+
+  LMA_FilterDcBlockInit(&(stages[0]), BENCH_DC_BLOCK_COEFF, 16U);
+  LMA_FilterChainInit(&chain, stages, 1U);
+  time("dc_block", run_blocks);
+
+  LMA_FilterDelayInit(&(stages[0]), line.data(), 7U);
+  LMA_FilterChainInit(&chain, stages, 1U);
+  time("delay", run_blocks);
+
+  LMA_FilterFracDelayInit(&(stages[0]), line.data(), 7U, LMA_FILTER_Q(0.3f, 16), 16U);
+  LMA_FilterChainInit(&chain, stages, 1U);
+  time("frac_delay", run_blocks);
+
+  LMA_FilterDecimateInit(&(stages[0]), 4, 2U);
+  LMA_FilterChainInit(&chain, stages, 1U);
+  time("decimate", run_blocks);
+
+  bench_sink = static_cast<float>(sink);
+  return filters;
+}
+
+/** @brief Metric names in the order they are reported.*/
+static const char *const metric_names[] = {"adc_ns_per_sample", "tmr_ns_per_window", "tmr_ns_per_call",
+                                           "measurements_get_ns", "consumption_get_ns"};
+
+/** @brief Metric values in the order of metric_names.*/
+static std::vector<double> Bench_metrics(const BenchResult &result)
+{
+  return {result.adc_ns_per_sample, result.tmr_ns_per_window, result.tmr_ns_per_call, result.measurements_get_ns,
+          result.consumption_get_ns};
+}
+
+/** @brief Formats the results as JSON.*/
+static std::string Bench_json(const std::vector<BenchCase> &cases, const std::vector<BenchResult> &results,
+                              const std::vector<BenchFilter> &filters, double seconds)
+{
+  std::ostringstream json;
+
+  json << std::fixed << std::setprecision(3) << "{\n  \"benchmark\": \"LMA-bench\",\n  \"fs\": " << BENCH_FS
+       << ",\n  \"seconds\": " << seconds << ",\n  \"cases\": [\n";
+
+  for (size_t c = 0; c < cases.size(); ++c)
+  {
+    const std::vector<double> metrics = Bench_metrics(results[c]);
+
+    json << "    {\"name\": \"" << cases[c].name << "\", \"phases\": " << cases[c].phases
+         << ", \"neutral\": " << (cases[c].neutral ? "true" : "false") << ", \"hook\": " << (cases[c].hook ? "true" : "false")
+         << ", \"rogowski\": " << (cases[c].rogowski ? "true" : "false") << ", \"filter\": "
+         << (cases[c].filter ? "true" : "false") << ", \"computed\": " << (cases[c].computed ? "true" : "false")
+         << ", \"system\": " << (cases[c].system ? "true" : "false") << ", \"coherent\": "
+         << (cases[c].coherent ? "true" : "false") << ", \"registers\": " << (cases[c].registers ? "true" : "false")
+         << ", \"tariff\": " << (cases[c].tariff ? "true" : "false") << ", \"demand\": "
+         << (cases[c].demand ? "true" : "false") << ", \"capture\": " << (cases[c].capture ? "true" : "false");
+    for (size_t m = 0; m < metrics.size(); ++m)
+    {
+      json << ", \"" << metric_names[m] << "\": " << metrics[m];
+    }
+    json << "}" << ((c + 1 < cases.size()) ? "," : "") << "\n";
+  }
+
+  json << "  ],\n  \"filters\": [\n";
+
+  for (size_t f = 0; f < filters.size(); ++f)
+  {
+    json << "    {\"name\": \"" << filters[f].name << "\", \"ns_per_sample\": " << filters[f].ns_per_sample << "}"
+         << ((f + 1 < filters.size()) ? "," : "") << "\n";
+  }
+
+  json << "  ]\n}\n";
+  return json.str();
+}
+
+/** @brief Compares one entry against the baseline.
+ * @param[in] baseline - JSON text of the baseline.
+ * @param[in] name - name of the entry.
+ * @param[in] names - names of the metrics.
+ * @param[in] metrics - measured value of each metric.
+ * @param[in] tolerance - allowed slowdown in percent.
+ * @return true if no metric regressed by more than the tolerance.
+ */
+static bool Bench_compare_entry(const std::string &baseline, const std::string &name, const std::vector<std::string> &names,
+                                const std::vector<double> &metrics, double tolerance)
+{
+  /* Each entry is written on one line as a flat object*/
+  const std::regex entry_regex("\\{\"name\": \"" + name + "\"[^}]*\\}");
+  std::smatch entry_match;
+  bool pass = true;
+
+  if (!std::regex_search(baseline, entry_match, entry_regex))
+  {
+    std::cout << "\t\t" << std::left << std::setw(18) << name << "not in baseline\n";
+    return true;
+  }
+
+  const std::string entry = entry_match.str();
+
+  for (size_t m = 0; m < metrics.size(); ++m)
+  {
+    const std::regex metric_regex("\"" + names[m] + "\": ([0-9.eE+-]+)");
+    std::smatch metric_match;
+
+    if (!std::regex_search(entry, metric_match, metric_regex))
+    {
+      continue;
+    }
+
+    const double base = std::stod(metric_match[1].str());
+    const double change = (base > 0.0) ? (100.0 * (metrics[m] - base) / base) : 0.0;
+    const bool regressed = change > tolerance;
+
+    pass = pass && !regressed;
+    std::cout << std::fixed << std::setprecision(1) << "\t\t" << std::left << std::setw(18) << name << std::setw(22)
+              << names[m] << std::right << std::setw(10) << base << " -> " << std::setw(10) << metrics[m] << " [ns] "
+              << std::showpos << std::setw(7) << change << std::noshowpos << "%" << (regressed ? "  REGRESSION" : "") << "\n";
+  }
+
+  return pass;
+}
+
+/** @brief Compares the results against a baseline written by a previous run.
+ * @param[in] baseline - JSON text of the baseline.
+ * @param[in] cases - configurations that were run.
+ * @param[in] results - timings of each configuration.
+ * @param[in] filters - filter timings.
+ * @param[in] tolerance - allowed slowdown in percent.
+ * @return true if no metric regressed by more than the tolerance.
+ */
+static bool Bench_compare(const std::string &baseline, const std::vector<BenchCase> &cases,
+                          const std::vector<BenchResult> &results, const std::vector<BenchFilter> &filters, double tolerance)
+{
+  const std::vector<std::string> names(std::begin(metric_names), std::end(metric_names));
+  bool pass = true;
+
+  std::cout << "\n\tComparison against baseline (tolerance " << tolerance << "%)\n";
+
+  for (size_t c = 0; c < cases.size(); ++c)
+  {
+    pass = Bench_compare_entry(baseline, cases[c].name, names, Bench_metrics(results[c]), tolerance) && pass;
+  }
+
+  for (const BenchFilter &filter : filters)
+  {
+    pass = Bench_compare_entry(baseline, filter.name, {"ns_per_sample"}, {filter.ns_per_sample}, tolerance) && pass;
+  }
+
+  return pass;
+}
+
+/** @brief Prints the command line usage.
+ * @param[in] p_name - name of the executable.
+ */
+static void Print_usage(const char *p_name)
+{
+  std::cout << "Usage: " << p_name << " [options]\n"
+            << "  --seconds <s>        simulated time per case (default 60)\n"
+            << "  --phases <n>         phase count of the N phase cases (default 6)\n"
+            << "  --repeat <n>         runs per case - the fastest is reported (default 3)\n"
+            << "  --json <file>        write the results as JSON\n"
+            << "  --baseline <file>    compare against a JSON file written by --json\n"
+            << "  --tolerance <pct>    allowed slowdown against the baseline (default 10)\n"
+            << "  --help               show this message\n";
+}
+
+int main(int argc, const char *argv[])
+{
+  double seconds = 60.0;
+  size_t n_phases = 6;
+  unsigned repeat = 3;
+  double tolerance = 10.0;
+  std::string json_path;
+  std::string baseline_path;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = (i + 1) < argc;
+
+    if ("--seconds" == arg && has_value)
+    {
+      seconds = std::stod(argv[++i]);
+    }
+    else if ("--phases" == arg && has_value)
+    {
+      n_phases = std::max<size_t>(1, std::stoul(argv[++i]));
+    }
+    else if ("--repeat" == arg && has_value)
+    {
+      repeat = std::max(1U, static_cast<unsigned>(std::stoul(argv[++i])));
+    }
+    else if ("--json" == arg && has_value)
+    {
+      json_path = argv[++i];
+    }
+    else if ("--baseline" == arg && has_value)
+    {
+      baseline_path = argv[++i];
+    }
+    else if ("--tolerance" == arg && has_value)
+    {
+      tolerance = std::stod(argv[++i]);
+    }
+    else if ("--help" == arg)
+    {
+      Print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    else
+    {
+      std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+      Print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* 1, 2, 3 and N phases - each bare, with a neutral, and with a computation hook*/
+  std::vector<BenchCase> cases;
+  for (const size_t phases : {static_cast<size_t>(1), static_cast<size_t>(2), static_cast<size_t>(3), n_phases})
+  {
+    const std::string prefix = std::to_string(phases) + "ph";
+    if (std::any_of(cases.begin(), cases.end(), [&](const BenchCase &c) { return c.phases == phases; }))
+    {
+      continue;
+    }
+    cases.push_back({prefix, phases, false, false, false, false, false, false, false, false, false, false, false});
+    cases.push_back(
+        {prefix + "_neutral", phases, true, false, false, false, false, false, false, false, false, false, false});
+    cases.push_back({prefix + "_hook", phases, false, true, false, false, false, false, false, false, false, false, false});
+    cases.push_back(
+        {prefix + "_neutral_hook", phases, true, true, false, false, false, false, false, false, false, false, false});
+  }
+
+  /* The RL78 Rogowski board (CT neutral) - the integrator cost is the difference to 1ph_neutral*/
+  cases.push_back({"1ph_rogowski", 1, true, false, true, false, false, false, false, false, false, false, false});
+
+  /* The same with the integrator and DC block as an LMA filter chain run by LMA_CB_ADC*/
+  cases.push_back({"1ph_filter", 1, true, false, false, true, false, false, false, false, false, false, false});
+
+  /* Computed neutral and tamper checks - the cost is the difference to 3ph*/
+  cases.push_back({"3ph_computed", 3, false, false, false, false, true, false, false, false, false, false, false});
+
+  /* Symmetrical components - the cost is the difference to 3ph in TMR*/
+  cases.push_back({"3ph_system", 3, false, false, false, false, false, true, false, false, false, false, false});
+
+  /* Coherent windows - one zero cross detector rather than one per phase, compare ADC to 3ph*/
+  cases.push_back({"3ph_coherent", 3, false, false, false, false, false, false, true, false, false, false, false});
+
+  /* Energy registers - four on each phase, compare ADC to 3ph*/
+  cases.push_back({"3ph_registers", 3, false, false, false, false, false, false, false, true, false, false, false});
+
+  /* Time of use tariff - the active tariff register, compare ADC to 3ph*/
+  cases.push_back({"3ph_tariff", 3, false, false, false, false, false, false, false, false, true, false, false});
+
+  /* Demand - sliding P, Q and S on every phase and the system, compare TMR to 3ph*/
+  cases.push_back({"3ph_demand", 3, false, false, false, false, false, false, false, false, false, true, false});
+
+  /* Waveform capture - a store of every phase per sample, compare ADC to 3ph*/
+  cases.push_back({"3ph_capture", 3, false, false, false, false, false, false, false, false, false, false, true});
+
+  std::vector<BenchResult> results;
+
+  std::cout << "\n\tLMA-bench (" << seconds << " [s] simulated per case, best of " << repeat << ")\n"
+            << "\t\t" << std::left << std::setw(18) << "case" << std::right << std::setw(14) << "ADC [ns/spl]"
+            << std::setw(16) << "TMR [ns/win]" << std::setw(16) << "TMR [ns/call]" << std::setw(14) << "MeasGet [ns]"
+            << std::setw(14) << "ConsGet [ns]"
+            << "\n";
+
+  for (const BenchCase &bench_case : cases)
+  {
+    BenchResult best = Bench_run(bench_case, seconds);
+
+    for (unsigned r = 1; r < repeat; ++r)
+    {
+      const BenchResult run = Bench_run(bench_case, seconds);
+      best.adc_ns_per_sample = std::min(best.adc_ns_per_sample, run.adc_ns_per_sample);
+      best.tmr_ns_per_window = std::min(best.tmr_ns_per_window, run.tmr_ns_per_window);
+      best.tmr_ns_per_call = std::min(best.tmr_ns_per_call, run.tmr_ns_per_call);
+      best.measurements_get_ns = std::min(best.measurements_get_ns, run.measurements_get_ns);
+      best.consumption_get_ns = std::min(best.consumption_get_ns, run.consumption_get_ns);
+    }
+
+    results.push_back(best);
+    std::cout << std::fixed << std::setprecision(1) << "\t\t" << std::left << std::setw(18) << bench_case.name << std::right
+              << std::setw(14) << best.adc_ns_per_sample << std::setw(16) << best.tmr_ns_per_window << std::setw(16)
+              << best.tmr_ns_per_call << std::setw(14) << best.measurements_get_ns << std::setw(14)
+              << best.consumption_get_ns << "\n";
+  }
+
+  /* Filters on their own - best of the repeats*/
+  std::vector<BenchFilter> filters = Bench_filters(seconds);
+
+  for (unsigned r = 1; r < repeat; ++r)
+  {
+    const std::vector<BenchFilter> run = Bench_filters(seconds);
+    for (size_t f = 0; f < filters.size(); ++f)
+    {
+      filters[f].ns_per_sample = std::min(filters[f].ns_per_sample, run[f].ns_per_sample);
+    }
+  }
+
+  std::cout << "\n\tFilters (" << BENCH_FILTER_BLOCK << " sample blocks unless per sample)\n"
+            << "\t\t" << std::left << std::setw(18) << "filter" << std::right << std::setw(14) << "[ns/spl]"
+            << "\n";
+  for (const BenchFilter &filter : filters)
+  {
+    std::cout << std::fixed << std::setprecision(1) << "\t\t" << std::left << std::setw(18) << filter.name << std::right
+              << std::setw(14) << filter.ns_per_sample << "\n";
+  }
+
+  const std::string json = Bench_json(cases, results, filters, seconds);
+
+  if (!json_path.empty())
+  {
+    std::ofstream out(json_path);
+    out << json;
+    if (!out)
+    {
+      std::cerr << "Unable to write " << json_path << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!baseline_path.empty())
+  {
+    std::ifstream in(baseline_path);
+    std::stringstream baseline;
+    baseline << in.rdbuf();
+
+    if (!in)
+    {
+      std::cerr << "Unable to read baseline " << baseline_path << "\n";
+      return EXIT_FAILURE;
+    }
+
+    if (!Bench_compare(baseline.str(), cases, results, filters, tolerance))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+}
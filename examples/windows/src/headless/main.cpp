@@ -0,0 +1,743 @@
+#include "capture.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/** @brief Prints the command line usage.
+ * @param[in] p_name - name of the executable.
+ */
+static void Print_usage(const char *p_name)
+{
+  std::cout << "Usage: " << p_name << " [options]\n"
+            << "  --duration <s>    simulated time in seconds (default 10)\n"
+            << "  --samples <n>     simulated time in ADC samples (overrides --duration)\n"
+            << "  --fs <Hz>         sampling frequency (default 3906.25)\n"
+            << "  --fline <Hz>      line frequency (default 50)\n"
+            << "  --vrms <V>        RMS voltage (default 230)\n"
+            << "  --irms <A>        RMS current (default 5)\n"
+            << "  --ps <deg>        phase shift of current relative to voltage (default 0)\n"
+            << "  --calibrate       calibrate phase and sampling frequency before measuring\n"
+            << "  --cal-async <n:n> calibrate phases n (1 based) together while the others keep metering\n"
+            << "  --realtime        pace the virtual clock to the wall clock\n"
+            << "  --live            show the live measurement output\n"
+            << "  --capture <file>  replay a capture file instead of generating waveforms (whole capture by default)\n"
+            << "  --record <file>   record the simulated ADC frames to a capture file\n"
+            << "  --compress        delta + Rice code the recorded capture\n"
+            << "  --codec-bench     benchmark the capture codec on the waveform (or --capture) instead of simulating\n"
+            << "  --cpu             report the host CPU load of each callback context and the main loop\n"
+            << "  --scenario <type> generate a single, wye, delta or split phase supply (default single)\n"
+            << "  --unbalance <pct> current unbalance - the second phase carries less and the third more by pct\n"
+            << "  --phase <spec>    override a phase of the scenario - n:V:A:deg[:angle] with n 1 based (repeatable)\n"
+            << "  --harmonic <spec> add a harmonic to every phase of the scenario - h:v%:i% (repeatable)\n"
+            << "  --noise <codes>   add gaussian noise of the given RMS (ADC codes) to every channel of the scenario\n"
+            << "  --offset <codes>  add a DC offset (ADC codes) to every channel of the scenario\n"
+            << "  --step <s:x>      scale every current of the scenario by x from s seconds on (a load step)\n"
+            << "  --voltage <s:x..> scale every voltage of the scenario by each x in turn for s seconds (cycled)\n"
+            << "  --window-min <n>  adapt the computation window between n and 25 line cycles to the load\n"
+            << "  --earth <pct>     return pct of the load current of the scenario through earth rather than the neutral\n"
+            << "  --residual <A>    raise the residual current alarm above this computed neutral current\n"
+            << "  --v90             generate an exact 90 degree shifted voltage rather than shift it in the driver\n"
+            << "  --coherent        end the window of every phase with the first phase (one zero cross detector)\n"
+            << "  --sequence        time the phase angles and compute the symmetrical components (three phase scenario)\n"
+            << "  --profile <min>   record a load profile of min minute intervals to an emulated 64 KB data flash\n"
+            << "  --flash <file>    file of the emulated data flash - kept between runs (default LMA-profile.bin)\n"
+            << "  --history         keep an hour of seconds, a day of minutes and 30 days of hours of min/mean/max history\n"
+            << "  --events          log the status events of every phase (sags, swells, no load, frequency errors...)\n"
+            << "  --waveforms <n>   hold n captures of 40 cycles around a sag, swell or overcurrent - LMA-event-<n>.cap\n"
+            << "  --rogowski        sense the phase current with a Rogowski coil and Trap_integrate (single phase waveform)\n"
+            << "  --help            show this message\n";
+}
+
+/** @brief Names of the status bits (LMA_Status), lowest first*/
+static const char *const status_names[LMA_EVENT_STATUS_BITS] = {
+    "NO ACTIVE LOAD", "NO REACTIVE LOAD", "NO APPARENT LOAD", "SAG",        "SWELL",
+    "RESIDUAL CURRENT", "NEUTRAL MISMATCH", "OVERCURRENT",      "FREQUENCY ERROR"};
+
+/** @brief Lists the names of status bits.
+ * @param[in] status - status bits.
+ * @return the names, comma separated.
+ */
+static std::string Status_text(uint32_t status)
+{
+  std::string text;
+
+  for (uint32_t bit = 0; bit < LMA_EVENT_STATUS_BITS; ++bit)
+  {
+    if (0 != (status & (1U << bit)))
+    {
+      text += (text.empty() ? "" : ", ") + std::string(status_names[bit]);
+    }
+  }
+
+  return text.empty() ? "OK" : text;
+}
+
+/** @brief Splits a colon separated list of numbers.
+ * @param[in] arg - the list, e.g. "3:5:20".
+ * @return the numbers.
+ */
+static std::vector<double> Split_values(const std::string &arg)
+{
+  std::vector<double> values;
+  size_t start = 0;
+
+  while (start <= arg.size())
+  {
+    const size_t end = std::min(arg.find(':', start), arg.size());
+    values.push_back(std::stod(arg.substr(start, end - start)));
+    start = end + 1;
+  }
+
+  return values;
+}
+
+/** @brief Benchmarks the capture codec.
+ * @details Reads the frames of the source into memory, then times encoding and decoding them and checks the round trip.
+ * @param[in] params - simulation parameters selecting the source and duration.
+ * @return EXIT_SUCCESS if the frames decoded back unchanged.
+ */
+static int Codec_benchmark(const SimulationParams &params)
+{
+  std::unique_ptr<SampleSource> p_source;
+  std::vector<double> v_plot;
+  std::vector<double> i_plot;
+
+  if (!params.capture_path.empty())
+  {
+    p_source = CaptureSourceOpen(params.capture_path.c_str());
+    if (nullptr == p_source)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    p_source = std::make_unique<WaveformSource>(params.fs, params.fline, params.vrms, params.irms, params.ps, 0, &v_plot,
+                                                &i_plot);
+  }
+
+  const size_t frame_size = p_source->FrameSize();
+  uint64_t frames = (0.0 != params.duration) ? static_cast<uint64_t>(params.duration * p_source->Fs()) : params.sample_count;
+  if (0 != p_source->Frames() && p_source->Frames() < frames)
+  {
+    frames = p_source->Frames();
+  }
+
+  std::vector<spl_t> input;
+  input.reserve(static_cast<size_t>(frames) * frame_size);
+  while (input.size() < frames * frame_size)
+  {
+    const spl_t *p_frames;
+    const size_t want = static_cast<size_t>(frames - (input.size() / frame_size));
+    const size_t count = p_source->Read(&p_frames, std::min<size_t>(want, CAPTURE_CODEC_BLOCK_FRAMES));
+    if (0 == count)
+    {
+      break;
+    }
+    input.insert(input.end(), p_frames, p_frames + (count * frame_size));
+  }
+  frames = input.size() / frame_size;
+
+  CaptureCodec encoder(frame_size);
+  CaptureCodec decoder(frame_size);
+  std::vector<uint8_t> encoded;
+  std::vector<spl_t> output(input.size());
+
+  encoded.reserve(input.size() * sizeof(spl_t));
+
+  const auto encode_start = std::chrono::steady_clock::now();
+  for (uint64_t n = 0; n < frames; n += CAPTURE_CODEC_BLOCK_FRAMES)
+  {
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(CAPTURE_CODEC_BLOCK_FRAMES, frames - n));
+    encoder.Encode(input.data() + (n * frame_size), count, &encoded);
+  }
+  const auto encode_end = std::chrono::steady_clock::now();
+
+  size_t offset = 0;
+  uint64_t decoded_frames = 0;
+  while (offset < encoded.size())
+  {
+    size_t count = 0;
+    const size_t used =
+        decoder.Decode(encoded.data() + offset, encoded.size() - offset, output.data() + (decoded_frames * frame_size), &count);
+    if (0 == used)
+    {
+      break;
+    }
+    offset += used;
+    decoded_frames += count;
+  }
+  const auto decode_end = std::chrono::steady_clock::now();
+
+  const double raw_mb = static_cast<double>(input.size() * sizeof(spl_t)) / 1.0e6;
+  const double encoded_mb = static_cast<double>(encoded.size()) / 1.0e6;
+  const double encode_s = std::chrono::duration<double>(encode_end - encode_start).count();
+  const double decode_s = std::chrono::duration<double>(decode_end - encode_end).count();
+  const bool match = (decoded_frames == frames) && (input == output);
+
+  std::cout << std::fixed << std::setprecision(2) << "\n\tCapture Codec Benchmark (" << frames << " frames x " << frame_size
+            << " channels)\n"
+            << "\t\tRaw:          " << raw_mb << " [MB]\n"
+            << "\t\tEncoded:      " << encoded_mb << " [MB]\n"
+            << "\t\tRatio:        " << ((encoded_mb > 0.0) ? raw_mb / encoded_mb : 0.0) << "\n"
+            << "\t\tBits/sample:  " << ((input.empty()) ? 0.0 : (8.0 * encoded.size()) / input.size()) << "\n"
+            << "\t\tEncode:       " << ((encode_s > 0.0) ? raw_mb / encode_s : 0.0) << " [MB/s]\n"
+            << "\t\tDecode:       " << ((decode_s > 0.0) ? raw_mb / decode_s : 0.0) << " [MB/s]\n"
+            << "\t\tRound trip:   " << (match ? "OK" : "MISMATCH") << "\n"
+            << std::endl;
+
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#if LMA_TRACE_ENABLE
+/** @brief Prints the latency histograms collected by the LMA trace instrumentation.*/
+static void Print_trace(void)
+{
+  static const char *const names[LMA_TRACE_COUNT] = {"LMA_CB_ADC", "LMA_CB_TMR", "LMA_CB_RTC", "LMA_AccPhaseRun",
+                                                     "LMA_AccPhaseLoad"};
+
+  std::cout << "\tTrace (host monotonic clock [ns])\n";
+
+  for (uint32_t id = 0; id < LMA_TRACE_COUNT; ++id)
+  {
+    LMA_TraceStats stats;
+    LMA_TraceGet(static_cast<LMA_TraceId>(id), &stats);
+
+    std::cout << "\t\t" << names[id] << ": count " << stats.count << ", min " << stats.min << ", max " << stats.max
+              << ", overruns " << stats.overruns << "\n";
+
+    for (uint32_t b = 0; b < LMA_TRACE_BUCKETS; ++b)
+    {
+      if (0 != stats.buckets[b])
+      {
+        const uint32_t low = (0 == b) ? 0 : (1U << (b - 1));
+        const double share = (100.0 * stats.buckets[b]) / stats.count;
+        std::cout << "\t\t\t>= " << std::setw(10) << low << " " << std::setw(10) << stats.buckets[b] << " "
+                  << std::fixed << std::setprecision(2) << std::setw(6) << share << "% "
+                  << std::string(static_cast<size_t>(share / 2.0), '#') << "\n";
+      }
+    }
+  }
+
+  std::cout << std::endl;
+}
+#endif
+
+int main(int argc, const char *argv[])
+{
+  SimulationParams params;
+  double duration = 0.0;
+  size_t samples = 0;
+  bool codec_bench = false;
+  std::string scenario_type;
+  double unbalance = 0.0;
+  double noise = 0.0;
+  double offset = 0.0;
+  std::vector<double> step;
+  std::vector<double> voltage;
+  double earth = 0.0;
+  std::vector<std::vector<double>> phase_overrides;
+  std::vector<ScenarioHarmonic> harmonics;
+
+  params.ps = 0.0;
+  params.vrms = 230.0;
+  params.irms = 5.0;
+  params.fs = 3906.25;
+  params.fline = 50.0;
+  params.calibrate = false;
+  params.rogowski = false;
+  params.realtime = false;
+  params.quiet = true;
+  params.record_compressed = false;
+  params.benchmark = false;
+  params.v90 = false;
+  params.window_min = 0;
+  params.residual_i = 0.0;
+  params.coherent = false;
+  params.clock_start = 0;
+  params.p_tariff = nullptr;
+  params.profile_interval = 0;
+  params.profile_sectors = SIM_PROFILE_SECTORS;
+  params.profile_path = "LMA-profile.bin";
+  params.history = false;
+  params.waveform_events = 0;
+  params.waveform_path = "LMA-event";
+  params.events = false;
+  params.calibrate_async = 0;
+  params.stop_simulation = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = (i + 1) < argc;
+
+    if ("--duration" == arg && has_value)
+    {
+      duration = std::stod(argv[++i]);
+    }
+    else if ("--samples" == arg && has_value)
+    {
+      samples = std::stoull(argv[++i]);
+    }
+    else if ("--fs" == arg && has_value)
+    {
+      params.fs = std::stod(argv[++i]);
+    }
+    else if ("--fline" == arg && has_value)
+    {
+      params.fline = std::stod(argv[++i]);
+    }
+    else if ("--vrms" == arg && has_value)
+    {
+      params.vrms = std::stod(argv[++i]);
+    }
+    else if ("--irms" == arg && has_value)
+    {
+      params.irms = std::stod(argv[++i]);
+    }
+    else if ("--ps" == arg && has_value)
+    {
+      params.ps = std::stod(argv[++i]);
+    }
+    else if ("--calibrate" == arg)
+    {
+      params.calibrate = true;
+    }
+    else if ("--realtime" == arg)
+    {
+      params.realtime = true;
+    }
+    else if ("--live" == arg)
+    {
+      params.quiet = false;
+    }
+    else if ("--capture" == arg && has_value)
+    {
+      params.capture_path = argv[++i];
+    }
+    else if ("--record" == arg && has_value)
+    {
+      params.record_path = argv[++i];
+    }
+    else if ("--compress" == arg)
+    {
+      params.record_compressed = true;
+    }
+    else if ("--codec-bench" == arg)
+    {
+      codec_bench = true;
+    }
+    else if ("--cpu" == arg)
+    {
+      params.benchmark = true;
+    }
+    else if ("--scenario" == arg && has_value)
+    {
+      scenario_type = argv[++i];
+    }
+    else if ("--unbalance" == arg && has_value)
+    {
+      unbalance = std::stod(argv[++i]) / 100.0;
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--phase" == arg && has_value)
+    {
+      phase_overrides.push_back(Split_values(argv[++i]));
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--harmonic" == arg && has_value)
+    {
+      const std::vector<double> values = Split_values(argv[++i]);
+      harmonics.push_back({static_cast<uint32_t>(values.at(0)), values.at(1) / 100.0, values.at(2) / 100.0});
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--v90" == arg)
+    {
+      params.v90 = true;
+    }
+    else if ("--coherent" == arg)
+    {
+      params.coherent = true;
+    }
+    else if ("--sequence" == arg)
+    {
+      params.system_measurements = true;
+    }
+    else if ("--profile" == arg && has_value)
+    {
+      params.profile_interval = static_cast<uint32_t>(std::stoul(argv[++i])) * 60U;
+    }
+    else if ("--flash" == arg && has_value)
+    {
+      params.profile_path = argv[++i];
+    }
+    else if ("--history" == arg)
+    {
+      params.history = true;
+    }
+    else if ("--events" == arg)
+    {
+      params.events = true;
+    }
+    else if ("--cal-async" == arg && has_value)
+    {
+      for (const double phase : Split_values(argv[++i]))
+      {
+        params.calibrate_async |= 1U << (static_cast<uint32_t>(phase) - 1U);
+      }
+    }
+    else if ("--waveforms" == arg && has_value)
+    {
+      params.waveform_events = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+    else if ("--rogowski" == arg)
+    {
+      params.rogowski = true;
+    }
+    else if ("--noise" == arg && has_value)
+    {
+      noise = std::stod(argv[++i]);
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--offset" == arg && has_value)
+    {
+      offset = std::stod(argv[++i]);
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--step" == arg && has_value)
+    {
+      step = Split_values(argv[++i]);
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--voltage" == arg && has_value)
+    {
+      voltage = Split_values(argv[++i]);
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+    }
+    else if ("--earth" == arg && has_value)
+    {
+      earth = std::stod(argv[++i]) / 100.0;
+      scenario_type = scenario_type.empty() ? "single" : scenario_type;
+      params.computed_neutral = true;
+    }
+    else if ("--residual" == arg && has_value)
+    {
+      params.residual_i = std::stod(argv[++i]);
+      params.computed_neutral = true;
+    }
+    else if ("--window-min" == arg && has_value)
+    {
+      params.window_min = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+    else if ("--help" == arg)
+    {
+      Print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    else
+    {
+      std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+      Print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!scenario_type.empty())
+  {
+    static const char *const type_names[] = {"single", "wye", "delta", "split"};
+    const auto p_name = std::find(std::begin(type_names), std::end(type_names), scenario_type);
+
+    if (std::end(type_names) == p_name)
+    {
+      std::cerr << "Unknown scenario: " << scenario_type << "\n";
+      return EXIT_FAILURE;
+    }
+
+    params.p_scenario = std::make_shared<Scenario>();
+    ScenarioDefault(params.p_scenario.get(), static_cast<ScenarioType>(p_name - std::begin(type_names)), params.vrms,
+                    params.irms, params.ps, unbalance);
+    params.p_scenario->harmonics = harmonics;
+    params.p_scenario->noise = noise;
+    params.p_scenario->offset = offset;
+    params.p_scenario->earth_fraction = earth;
+    if (!step.empty())
+    {
+      if (step.size() < 2)
+      {
+        std::cerr << "Invalid --step - expected s:x\n";
+        return EXIT_FAILURE;
+      }
+      params.p_scenario->step_time = step[0];
+      params.p_scenario->step_scale = step[1];
+    }
+    if (!voltage.empty())
+    {
+      if (voltage.size() < 2)
+      {
+        std::cerr << "Invalid --voltage - expected s:x[:x...]\n";
+        return EXIT_FAILURE;
+      }
+      params.p_scenario->voltage_interval = voltage[0];
+      params.p_scenario->voltage_profile.assign(voltage.begin() + 1, voltage.end());
+    }
+
+    for (const std::vector<double> &values : phase_overrides)
+    {
+      const size_t n = static_cast<size_t>(values.at(0)) - 1;
+      if (n >= params.p_scenario->phases.size() || values.size() < 4)
+      {
+        std::cerr << "Invalid --phase for a " << scenario_type << " scenario\n";
+        return EXIT_FAILURE;
+      }
+
+      ScenarioPhase &phase = params.p_scenario->phases[n];
+      phase.vrms = values[1];
+      phase.irms = values[2];
+      phase.ps = values[3];
+      phase.v_angle = (values.size() > 4) ? values[4] : phase.v_angle;
+    }
+  }
+
+  /* Duration is converted using the fs of the source, so it also holds for captures*/
+  params.sample_count = (0 != samples) ? samples : SIZE_MAX;
+  params.duration = (0 != samples) ? 0.0 : duration;
+  if (0 == samples && 0.0 == duration && params.capture_path.empty())
+  {
+    params.duration = 10.0;
+  }
+
+  if (codec_bench)
+  {
+    return Codec_benchmark(params);
+  }
+
+  auto results = Simulation(&params);
+
+  if (results->measurements.empty())
+  {
+    std::cerr << "No measurements were produced - try a longer duration\n";
+    return EXIT_FAILURE;
+  }
+
+  const LMA_Measurements &last = results->measurements.back();
+
+  std::cout << std::fixed << std::setprecision(4) << "\n\tFinal Measurements (" << results->measurements.size()
+            << " windows)\n"
+            << "\t\tVrms:    " << last.vrms << " [V]\n"
+            << "\t\tIrms:    " << last.irms << " [A]\n"
+            << "\t\tFline:   " << last.fline << " [Hz]\n"
+            << "\t\tP:       " << last.p << " [W]\n"
+            << "\t\tQ:       " << last.q << " [VAR]\n"
+            << "\t\tS:       " << last.s << " [VA]\n"
+            << "\t\tAct Imp: " << results->final_energy.act_imp_energy_wh << " [Wh]\n"
+            << "\t\tAct Exp: " << results->final_energy.act_exp_energy_wh << " [Wh]\n"
+            << "\t\tApp Imp: " << results->final_energy.app_imp_energy_wh << " [Wh]\n"
+            << "\t\tApp Exp: " << results->final_energy.app_exp_energy_wh << " [Wh]\n"
+            << "\t\tC Imp:   " << results->final_energy.c_imp_energy_wh << " [Wh]\n"
+            << "\t\tC Exp:   " << results->final_energy.c_exp_energy_wh << " [Wh]\n"
+            << "\t\tL Imp:   " << results->final_energy.l_imp_energy_wh << " [Wh]\n"
+            << "\t\tL Exp:   " << results->final_energy.l_exp_energy_wh << " [Wh]\n"
+            << std::endl;
+
+  std::cout << std::fixed << std::setprecision(4) << "\tNeutral: Irms " << last.irms_neutral << " [A] measured";
+  if (params.computed_neutral)
+  {
+    std::cout << ", " << results->irms_computed_neutral << " [A] computed"
+              << ((0 != (results->status & LMA_RESIDUAL_CURRENT)) ? ", RESIDUAL CURRENT" : "")
+              << ((0 != (results->status & LMA_NEUTRAL_MISMATCH)) ? ", NEUTRAL MISMATCH" : "");
+  }
+  std::cout << "\n" << std::endl;
+
+  /* Demand registers in the order the simulation sets them*/
+  static const char *const demand_names[SIM_DEMANDS] = {"P 15 min block:  ", "P 15 min sliding:", "S 30 min block:  "};
+  static const char *const demand_units[SIM_DEMANDS] = {" [W]", " [W]", " [VA]"};
+  std::cout << "\tDemand:\n";
+  for (size_t d = 0; d < results->demand_readings.size(); ++d)
+  {
+    const LMA_DemandReading &reading = results->demand_readings[d];
+    std::cout << "\t\t" << demand_names[d];
+    if (0 == reading.time)
+    {
+      std::cout << " no complete interval\n";
+    }
+    else
+    {
+      std::cout << std::fixed << std::setprecision(2) << " " << reading.demand << demand_units[d] << " to "
+                << SimulationClockText(reading.time) << ", peak " << reading.peak << demand_units[d] << " to "
+                << SimulationClockText(reading.peak_time) << "\n";
+    }
+  }
+  std::cout << std::endl;
+
+  if (0 != params.profile_interval)
+  {
+    /* Record bytes leave out the sector headers*/
+    const ProfileStorageStats &stats = results->profile_stats;
+    const double record_bytes =
+        (0 == results->profile_records)
+            ? 0.0
+            : static_cast<double>(stats.bytes_written - (stats.erases * LMA_PROFILE_HEADER_SIZE)) / results->profile_records;
+    const double region_weeks =
+        (0.0 == record_bytes) ? 0.0
+                              : ((SIM_PROFILE_SECTORS * (SIM_PROFILE_SECTOR_SIZE - LMA_PROFILE_HEADER_SIZE)) / record_bytes) *
+                                    params.profile_interval / (7.0 * 86400.0);
+
+    std::cout << std::fixed << std::setprecision(1) << "\tLoad Profile (" << (params.profile_interval / 60) << " min, "
+              << params.profile_path << "): " << results->profile_records << " records written, "
+              << results->profile.size() << " held, " << record_bytes << " bytes per record - "
+              << region_weeks << " weeks in 64 KB\n";
+    if (!results->profile.empty())
+    {
+      const LMA_ProfileEntry &entry = results->profile.back();
+      std::cout << std::setprecision(2) << "\t\tTo " << SimulationClockText(entry.time) << ": Act Imp "
+                << entry.energy_wh[0] << " [Wh], Act Exp " << entry.energy_wh[1] << " [Wh], React Imp " << entry.energy_wh[2]
+                << " [varh], React Exp " << entry.energy_wh[3] << " [varh], Vrms " << entry.average[0] << " [V], Irms "
+                << entry.average[1] << " [A], P " << entry.average[2] << " [W]\n";
+    }
+    std::cout << std::endl;
+  }
+
+  if (!results->history.empty())
+  {
+    /* Each level rolled up over the slots it holds*/
+    static const char *const level_names[SIM_HISTORY_LEVELS] = {"Seconds:", "Minutes:", "Hours:  "};
+    std::cout << "\tHistory (first phase):\n";
+    for (size_t l = 0; l < results->history.size(); ++l)
+    {
+      const std::vector<LMA_HistorySlot> &slots = results->history[l];
+      LMA_HistoryRange range = {{slots.data(), nullptr}, {static_cast<uint32_t>(slots.size()), 0}};
+      LMA_HistorySlot summary;
+
+      LMA_HistorySummary(&range, &summary);
+      std::cout << "\t\t" << level_names[l] << " " << slots.size() << " slots";
+      if (0 != summary.count)
+      {
+        std::cout << std::fixed << std::setprecision(2) << " from " << SimulationClockText(summary.time) << ", "
+                  << summary.count << " windows: Vrms " << summary.min.vrms << "/" << summary.mean.vrms << "/"
+                  << summary.max.vrms << " [V], Irms " << summary.min.irms << "/" << summary.mean.irms << "/"
+                  << summary.max.irms << " [A], P " << summary.min.p << "/" << summary.mean.p << "/" << summary.max.p
+                  << " [W] (min/mean/max)";
+      }
+      std::cout << "\n";
+    }
+    std::cout << std::endl;
+  }
+
+  if (params.events)
+  {
+    /* Unit of the extreme of each status bit*/
+    static const char *const units[LMA_EVENT_STATUS_BITS] = {"A", "A", "A", "V", "V", "A", "A", "A", "Hz"};
+
+    std::cout << "\tStatus Events: " << results->events.size() << " read, " << results->event_callbacks << " called back, "
+              << results->events_dropped << " dropped\n";
+    for (const LMA_Event &event : results->events)
+    {
+      uint32_t bit = 0;
+      while ((bit + 1U < LMA_EVENT_STATUS_BITS) && (0 == (event.status & (1U << bit))))
+      {
+        ++bit;
+      }
+      std::cout << std::fixed << std::setprecision(2) << "\t\t" << SimulationClockText(event.time) << " phase "
+                << (event.phase_number + 1) << ": " << status_names[bit] << (event.end ? " ended" : " started")
+                << " - " << event.duration << " [s], extreme " << event.extreme << " [" << units[bit] << "]\n";
+    }
+    std::cout << std::endl;
+  }
+
+  if (0 != params.calibrate_async)
+  {
+    std::cout << "\tAsynchronous Calibration: " << results->calib_callbacks << " callbacks\n";
+    for (size_t p = 0, n = 0; p < results->calibrations.size(); ++p)
+    {
+      if (0 != (params.calibrate_async & (1U << p)))
+      {
+        const LMA_PhaseCalibration &calib = results->calibrations[p];
+        const double done = results->calib_done_times.at(n++);
+        std::cout << std::fixed << std::setprecision(4) << "\t\tPhase " << (p + 1) << ": Vrms " << calib.vrms_coeff
+                  << ", Irms " << calib.irms_coeff << ", Power " << calib.p_coeff << ", Phase Correction "
+                  << calib.vi_phase_correction << " - "
+                  << ((0.0 != done) ? ("done in " + std::to_string(done - results->calib_start_time) + " [s]")
+                                    : std::string("not done"))
+                  << "\n";
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  if (0 != params.waveform_events)
+  {
+    const size_t phases = results->last_measurements.size();
+
+    std::cout << "	Waveform Capture: " << results->waveforms.size() << " events\n";
+    for (const SimulationWaveform &waveform : results->waveforms)
+    {
+      std::cout << std::fixed << std::setprecision(3) << "\t\t" << SimulationClockText(waveform.time) << " phase "
+                << (waveform.phase_number + 1) << ": " << Status_text(waveform.status) << ", "
+                << (waveform.frames.size() / phases) << " frames, trigger at frame " << waveform.trigger
+                << ", read at " << waveform.read_time << " s"
+                << (waveform.path.empty() ? "" : (" - " + waveform.path)) << "\n";
+    }
+    std::cout << std::endl;
+  }
+
+  if (results->last_measurements.size() > 1)
+  {
+    for (size_t p = 0; p < results->last_measurements.size(); ++p)
+    {
+      const LMA_Measurements &m = results->last_measurements[p];
+      std::cout << std::fixed << std::setprecision(4) << "\tPhase " << (p + 1) << ": Vrms " << m.vrms << " [V], Irms " << m.irms
+                << " [A], P " << m.p << " [W], Q " << m.q << " [VAR]";
+      if (params.system_measurements && (3 == results->last_measurements.size()))
+      {
+        std::cout << std::setprecision(2) << ", V " << results->system.v_angle[p] << " [deg], I " << results->system.i_angle[p]
+                  << " [deg]";
+      }
+      std::cout << "\n";
+
+      const float *const p_wh = &(results->register_wh[p * SIM_PHASE_REGISTERS]);
+      std::cout << std::setprecision(4) << "\t\tAct Imp " << p_wh[0] << ", Act Exp " << p_wh[1] << ", React Imp " << p_wh[2]
+                << ", React Exp " << p_wh[3] << " [Wh]\n";
+    }
+    std::cout << std::endl;
+  }
+
+  if (params.system_measurements && (3 == results->last_measurements.size()))
+  {
+    const LMA_SequenceComponents &v = results->system.v;
+    const LMA_SequenceComponents &i = results->system.i;
+    std::cout << std::fixed << std::setprecision(4) << "\tSequence:\n"
+              << "\t\tV: positive " << v.positive << ", negative " << v.negative << ", zero " << v.zero
+              << " [V], unbalance " << v.unbalance << " [%]\n"
+              << "\t\tI: positive " << i.positive << ", negative " << i.negative << ", zero " << i.zero
+              << " [A], unbalance " << i.unbalance << " [%]\n"
+              << std::endl;
+  }
+
+  if (params.benchmark)
+  {
+    static const char *const context_names[BENCHMARK_CONTEXTS] = {"Main", "ADC", "TMR", "RTC"};
+
+    std::cout << "\tCPU Load (host, " << results->benchmark.worker.periods << " periods of 500ms simulated)\n";
+    for (uint32_t c = 0; c < BENCHMARK_CONTEXTS; ++c)
+    {
+      std::cout << std::fixed << std::setprecision(2) << "\t\t" << std::left << std::setw(6) << context_names[c]
+                << std::right << "Average " << std::setw(6) << results->benchmark.load[c].average << " [%], Peak "
+                << std::setw(6) << results->benchmark.load[c].peak << " [%]\n";
+    }
+    std::cout << std::endl;
+  }
+
+#if LMA_TRACE_ENABLE
+  Print_trace();
+#endif
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,412 @@
+#include "capture.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+/** @brief Read only memory mapping of a whole file.*/
+class MappedFile
+{
+public:
+  ~MappedFile()
+  {
+#if defined(_WIN32)
+    if (nullptr != p_data)
+    {
+      UnmapViewOfFile(p_data);
+    }
+    if (nullptr != mapping)
+    {
+      CloseHandle(mapping);
+    }
+    if (INVALID_HANDLE_VALUE != file)
+    {
+      CloseHandle(file);
+    }
+#else
+    if (nullptr != p_data)
+    {
+      munmap(const_cast<uint8_t *>(p_data), size);
+    }
+#endif
+  }
+
+  /** @brief Maps the file.
+   * @param[in] p_path - path to the file.
+   * @return true if the file was mapped.
+   */
+  bool Open(const char *p_path)
+  {
+#if defined(_WIN32)
+    file = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (INVALID_HANDLE_VALUE == file)
+    {
+      return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || 0 == file_size.QuadPart)
+    {
+      return false;
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (nullptr == mapping)
+    {
+      return false;
+    }
+
+    p_data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    return nullptr != p_data;
+#else
+    const int fd = open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    struct stat st;
+    if (0 != fstat(fd, &st) || 0 == st.st_size)
+    {
+      close(fd);
+      return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+
+    void *p_map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == p_map)
+    {
+      return false;
+    }
+
+    /* Replay reads front to back - let the kernel read ahead aggressively*/
+    madvise(p_map, size, MADV_SEQUENTIAL);
+    p_data = static_cast<const uint8_t *>(p_map);
+    return true;
+#endif
+  }
+
+  const uint8_t *p_data = nullptr; /**< start of the mapping*/
+  size_t size = 0;                 /**< size of the mapping in bytes*/
+
+private:
+#if defined(_WIN32)
+  HANDLE file = INVALID_HANDLE_VALUE; /**< file handle*/
+  HANDLE mapping = nullptr;           /**< mapping handle*/
+#endif
+};
+
+/** @brief Sample source replaying a memory mapped capture file.*/
+class CaptureSource : public SampleSource
+{
+public:
+  CaptureSource(std::unique_ptr<MappedFile> p_map, const CaptureHeader &header)
+      : p_map(std::move(p_map)), header(header), frame_size(FrameSize()), next_frame(0)
+  {
+  }
+
+  size_t Phases() const override
+  {
+    return header.phases;
+  }
+
+  uint16_t Channels() const override
+  {
+    return header.channels;
+  }
+
+  double Fs() const override
+  {
+    return header.fs;
+  }
+
+  uint64_t Frames() const override
+  {
+    return header.frame_count;
+  }
+
+  size_t Read(const spl_t **pp_frames, size_t max_frames) override
+  {
+    const uint64_t remaining = header.frame_count - next_frame;
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(remaining, max_frames));
+
+    *pp_frames = reinterpret_cast<const spl_t *>(p_map->p_data + header.header_size) + (next_frame * frame_size);
+    next_frame += count;
+
+    return count;
+  }
+
+  void Rewind() override
+  {
+    next_frame = 0;
+  }
+
+private:
+  std::unique_ptr<MappedFile> p_map; /**< mapping of the capture*/
+  CaptureHeader header;              /**< header of the capture*/
+  size_t frame_size;                 /**< samples per frame*/
+  uint64_t next_frame;               /**< index of the next frame to read*/
+};
+
+/** @brief Sample source decoding a memory mapped compressed capture file.*/
+class RiceCaptureSource : public SampleSource
+{
+public:
+  RiceCaptureSource(std::unique_ptr<MappedFile> p_map, const CaptureHeader &header)
+      : p_map(std::move(p_map)), header(header), codec(FrameSize()), frames(CAPTURE_CODEC_BLOCK_FRAMES * FrameSize()),
+        offset(header.header_size), block_frames(0), block_index(0), next_frame(0)
+  {
+  }
+
+  size_t Phases() const override
+  {
+    return header.phases;
+  }
+
+  uint16_t Channels() const override
+  {
+    return header.channels;
+  }
+
+  double Fs() const override
+  {
+    return header.fs;
+  }
+
+  uint64_t Frames() const override
+  {
+    return header.frame_count;
+  }
+
+  size_t Read(const spl_t **pp_frames, size_t max_frames) override
+  {
+    if (block_index >= block_frames)
+    {
+      /* Decode the next block in place of the last*/
+      size_t decoded = 0;
+      const size_t used =
+          (next_frame < header.frame_count)
+              ? codec.Decode(p_map->p_data + offset, p_map->size - static_cast<size_t>(offset), frames.data(), &decoded)
+              : 0;
+
+      if (0 == used)
+      {
+        if (next_frame < header.frame_count)
+        {
+          std::cerr << "Capture is corrupt or truncated after " << next_frame << " frames\n";
+          header.frame_count = next_frame;
+        }
+        return 0;
+      }
+
+      offset += used;
+      block_frames = decoded;
+      block_index = 0;
+    }
+
+    const size_t count = std::min(block_frames - block_index, max_frames);
+    *pp_frames = frames.data() + (block_index * FrameSize());
+    block_index += count;
+    next_frame += count;
+
+    return count;
+  }
+
+  void Rewind() override
+  {
+    codec.Reset();
+    offset = header.header_size;
+    block_frames = 0;
+    block_index = 0;
+    next_frame = 0;
+  }
+
+private:
+  std::unique_ptr<MappedFile> p_map; /**< mapping of the capture*/
+  CaptureHeader header;              /**< header of the capture*/
+  CaptureCodec codec;                /**< block decoder*/
+  std::vector<spl_t> frames;         /**< decoded block*/
+  uint64_t offset;                   /**< file offset of the next block*/
+  size_t block_frames;               /**< frames in the decoded block*/
+  size_t block_index;                /**< index of the next frame in the decoded block*/
+  uint64_t next_frame;               /**< index of the next frame to read*/
+};
+
+std::unique_ptr<SampleSource> CaptureSourceOpen(const char *p_path)
+{
+  auto p_map = std::make_unique<MappedFile>();
+  CaptureHeader header;
+
+  if (!p_map->Open(p_path))
+  {
+    std::cerr << "Unable to map capture: " << p_path << "\n";
+    return nullptr;
+  }
+
+  if (p_map->size < sizeof(CaptureHeader))
+  {
+    std::cerr << "Capture too small for a header: " << p_path << "\n";
+    return nullptr;
+  }
+
+  std::memcpy(&header, p_map->p_data, sizeof(CaptureHeader));
+
+  if (CAPTURE_MAGIC != header.magic || CAPTURE_VERSION != header.version || header.header_size < sizeof(CaptureHeader) ||
+      0 != (header.header_size % sizeof(spl_t)))
+  {
+    std::cerr << "Not a supported capture file: " << p_path << "\n";
+    return nullptr;
+  }
+
+  if (sizeof(spl_t) != header.spl_bytes)
+  {
+    std::cerr << "Capture sample width (" << static_cast<unsigned>(header.spl_bytes) << " bytes) does not match spl_t ("
+              << sizeof(spl_t) << " bytes)\n";
+    return nullptr;
+  }
+
+  if (0 == header.phases || header.fs <= 0.0 || p_map->size < header.header_size)
+  {
+    std::cerr << "Capture header is invalid: " << p_path << "\n";
+    return nullptr;
+  }
+
+  if (CAPTURE_ENCODING_RICE == header.encoding)
+  {
+    return std::make_unique<RiceCaptureSource>(std::move(p_map), header);
+  }
+
+  if (CAPTURE_ENCODING_RAW != header.encoding)
+  {
+    std::cerr << "Unsupported capture encoding: " << header.encoding << "\n";
+    return nullptr;
+  }
+
+  const uint64_t frame_bytes = static_cast<uint64_t>(SampleFrameSize(header.phases, header.channels)) * sizeof(spl_t);
+  if ((p_map->size - header.header_size) / frame_bytes < header.frame_count)
+  {
+    std::cerr << "Capture is truncated - header gives " << header.frame_count << " frames\n";
+    return nullptr;
+  }
+
+  return std::make_unique<CaptureSource>(std::move(p_map), header);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  Close();
+}
+
+bool CaptureWriter::Open(const char *p_path, size_t phases, uint16_t channels, double fs, bool compress)
+{
+  Close();
+
+  p_file = std::fopen(p_path, "wb");
+  if (nullptr == p_file)
+  {
+    return false;
+  }
+
+  header.magic = CAPTURE_MAGIC;
+  header.version = CAPTURE_VERSION;
+  header.header_size = static_cast<uint16_t>(sizeof(CaptureHeader));
+  header.spl_bytes = static_cast<uint8_t>(sizeof(spl_t));
+  header.phases = static_cast<uint8_t>(phases);
+  header.channels = channels;
+  header.encoding = compress ? CAPTURE_ENCODING_RICE : CAPTURE_ENCODING_RAW;
+  header.fs = fs;
+  header.frame_count = 0;
+
+  frame_size = SampleFrameSize(phases, channels);
+  bytes = sizeof(CaptureHeader);
+
+  if (compress)
+  {
+    p_codec = std::make_unique<CaptureCodec>(frame_size);
+    pending.clear();
+    pending.reserve(CAPTURE_CODEC_BLOCK_FRAMES * frame_size);
+  }
+  else
+  {
+    p_codec.reset();
+  }
+
+  return 1 == std::fwrite(&header, sizeof(CaptureHeader), 1, p_file);
+}
+
+bool CaptureWriter::Flush_block()
+{
+  if (pending.empty())
+  {
+    return true;
+  }
+
+  encoded.clear();
+  p_codec->Encode(pending.data(), pending.size() / frame_size, &encoded);
+  pending.clear();
+  bytes += encoded.size();
+
+  return encoded.size() == std::fwrite(encoded.data(), 1, encoded.size(), p_file);
+}
+
+bool CaptureWriter::Write(const spl_t *p_frames, size_t count)
+{
+  if (nullptr == p_file)
+  {
+    return false;
+  }
+
+  header.frame_count += count;
+
+  if (nullptr == p_codec)
+  {
+    bytes += static_cast<uint64_t>(count) * frame_size * sizeof(spl_t);
+    return count == std::fwrite(p_frames, frame_size * sizeof(spl_t), count, p_file);
+  }
+
+  /* Gather whole blocks before encoding*/
+  while (0 != count)
+  {
+    const size_t space = CAPTURE_CODEC_BLOCK_FRAMES - (pending.size() / frame_size);
+    const size_t take = std::min(space, count);
+
+    pending.insert(pending.end(), p_frames, p_frames + (take * frame_size));
+    p_frames += take * frame_size;
+    count -= take;
+
+    if (pending.size() == (CAPTURE_CODEC_BLOCK_FRAMES * frame_size) && !Flush_block())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void CaptureWriter::Close()
+{
+  if (nullptr != p_file)
+  {
+    if (nullptr != p_codec)
+    {
+      Flush_block();
+    }
+
+    /* Complete the header now the frame count is known*/
+    std::fseek(p_file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(CaptureHeader), 1, p_file);
+    std::fclose(p_file);
+    p_file = nullptr;
+  }
+}
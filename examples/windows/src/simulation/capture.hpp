@@ -0,0 +1,96 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "capture_codec.hpp"
+#include "sample_source.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+/** @brief capture file magic - "LMAC" in little endian*/
+#define CAPTURE_MAGIC (0x43414D4CUL)
+
+/** @brief capture file format version*/
+#define CAPTURE_VERSION (1U)
+
+/** @brief capture encoding - frames stored as raw spl_t*/
+#define CAPTURE_ENCODING_RAW (0U)
+
+/** @brief capture encoding - frames stored as CaptureCodec blocks*/
+#define CAPTURE_ENCODING_RICE (1U)
+
+/** @brief Header at the start of a capture file.
+ * @details All fields are little endian. With CAPTURE_ENCODING_RAW the header is followed by frame_count frames, each
+ * holding one spl_bytes wide sample per channel in the SampleSource frame layout. With CAPTURE_ENCODING_RICE the frames are
+ * stored as a sequence of CaptureCodec blocks.
+ */
+typedef struct CaptureHeader
+{
+  uint32_t magic;       /**< CAPTURE_MAGIC*/
+  uint16_t version;     /**< CAPTURE_VERSION*/
+  uint16_t header_size; /**< size of this header in bytes - frames start at this offset*/
+  uint8_t spl_bytes;    /**< width of each sample in bytes (sizeof(spl_t) of the recording build)*/
+  uint8_t phases;       /**< number of phases in each frame*/
+  uint16_t channels;    /**< channel flags (SAMPLE_CHANNEL_x)*/
+  uint32_t encoding;    /**< how the frames are stored (CAPTURE_ENCODING_x)*/
+  double fs;            /**< sampling frequency in Hz*/
+  uint64_t frame_count; /**< number of frames following the header*/
+} CaptureHeader;
+
+static_assert(sizeof(CaptureHeader) == 32, "CaptureHeader must be packed to 32 bytes");
+
+/** @brief Writes frames to a capture file.*/
+class CaptureWriter
+{
+public:
+  ~CaptureWriter();
+
+  /** @brief Creates the capture file and writes a provisional header.
+   * @param[in] p_path - path to the capture.
+   * @param[in] phases - number of phases in each frame.
+   * @param[in] channels - channel flags (SAMPLE_CHANNEL_x).
+   * @param[in] fs - sampling frequency in Hz.
+   * @param[in] compress - store the frames delta + Rice coded (CAPTURE_ENCODING_RICE).
+   * @return true if the file was created.
+   */
+  bool Open(const char *p_path, size_t phases, uint16_t channels, double fs, bool compress = false);
+
+  /** @brief Appends frames to the capture.
+   * @param[in] p_frames - frames to append.
+   * @param[in] count - number of frames.
+   * @return true if the frames were written.
+   */
+  bool Write(const spl_t *p_frames, size_t count);
+
+  /** @brief Completes the header with the frame count and closes the file.*/
+  void Close();
+
+  /** @brief Number of bytes written to the file so far.*/
+  uint64_t Bytes() const
+  {
+    return bytes;
+  }
+
+private:
+  /** @brief Encodes and writes the pending frames as one block.*/
+  bool Flush_block();
+
+  std::FILE *p_file = nullptr;           /**< capture file*/
+  CaptureHeader header;                  /**< header being written*/
+  size_t frame_size = 0;                 /**< samples per frame*/
+  uint64_t bytes = 0;                    /**< bytes written*/
+  std::unique_ptr<CaptureCodec> p_codec; /**< encoder (compressed captures only)*/
+  std::vector<spl_t> pending;            /**< frames waiting for a full block (compressed captures only)*/
+  std::vector<uint8_t> encoded;          /**< encoded block (compressed captures only)*/
+};
+
+/** @brief Opens a capture file as a sample source.
+ * @details The file is memory mapped, so captures of any size replay without being loaded. Raw frames are handed to the
+ * driver straight from the mapping; compressed captures are decoded one block at a time. The capture must have been
+ * recorded with the same spl_t width.
+ * @param[in] p_path - path to the capture.
+ * @return the source, or nullptr if the capture could not be opened (reason printed to stderr).
+ */
+std::unique_ptr<SampleSource> CaptureSourceOpen(const char *p_path);
+
+#endif /* _CAPTURE_H_*/
@@ -0,0 +1,306 @@
+#include "capture_codec.hpp"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+/** @brief Writes bits MSB first into a byte vector.*/
+class BitWriter
+{
+public:
+  explicit BitWriter(std::vector<uint8_t> *p_out) : p_out(p_out), acc(0), bits(0)
+  {
+  }
+
+  /** @brief Appends the low n bits of value (n <= 32).*/
+  void Put(uint32_t value, unsigned n)
+  {
+    acc = (acc << n) | value;
+    bits += n;
+    while (bits >= 8)
+    {
+      bits -= 8;
+      p_out->push_back(static_cast<uint8_t>(acc >> bits));
+    }
+  }
+
+  /** @brief Pads the final byte with zeros.*/
+  void Flush()
+  {
+    if (0 != bits)
+    {
+      p_out->push_back(static_cast<uint8_t>(acc << (8 - bits)));
+      bits = 0;
+    }
+  }
+
+private:
+  std::vector<uint8_t> *p_out; /**< destination*/
+  uint64_t acc;                /**< pending bits (low 'bits' bits are valid)*/
+  unsigned bits;               /**< number of pending bits*/
+};
+
+/** @brief Reads bits MSB first from a byte buffer.*/
+class BitReader
+{
+public:
+  BitReader(const uint8_t *p_data, const uint8_t *p_end)
+      : p_data(p_data), p_end(p_end), acc(0), bits(0), consumed(0), available(static_cast<uint64_t>(p_end - p_data) * 8)
+  {
+  }
+
+  /** @brief Reads n bits (n <= 32).*/
+  uint32_t Get(unsigned n)
+  {
+    Refill();
+    const uint32_t value = (0 == n) ? 0 : static_cast<uint32_t>(acc >> (64 - n));
+    acc <<= n;
+    bits -= n;
+    consumed += n;
+    return value;
+  }
+
+  /** @brief Reads a unary prefix of up to max ones.
+   * @return number of ones - if less than max the terminating zero has also been consumed.
+   */
+  unsigned Ones(unsigned max)
+  {
+    Refill();
+    const unsigned ones = Leading_zeros(~acc);
+    const unsigned length = (ones >= max) ? max : (ones + 1);
+
+    acc <<= length;
+    bits -= length;
+    consumed += length;
+    return (ones >= max) ? max : ones;
+  }
+
+  /** @brief True if more bits were consumed than the buffer held.*/
+  bool Overrun() const
+  {
+    return consumed > available;
+  }
+
+private:
+  /** @brief Tops the accumulator up to at least 57 bits (zeros past the end of the buffer).*/
+  void Refill()
+  {
+    while (bits <= 56)
+    {
+      const uint64_t byte = (p_data < p_end) ? *p_data : 0;
+      ++p_data;
+      acc |= byte << (56 - bits);
+      bits += 8;
+    }
+  }
+
+  /** @brief Number of leading zero bits (64 for zero).*/
+  static unsigned Leading_zeros(uint64_t value)
+  {
+    if (0 == value)
+    {
+      return 64;
+    }
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_clzll(value));
+#endif
+  }
+
+  const uint8_t *p_data; /**< next byte to load*/
+  const uint8_t *p_end;  /**< end of the buffer*/
+  uint64_t acc;          /**< bit buffer, MSB aligned*/
+  unsigned bits;         /**< number of valid bits in acc*/
+  uint64_t consumed;     /**< number of bits read*/
+  uint64_t available;    /**< number of bits in the buffer*/
+};
+
+/** @brief Maps a signed residual onto an unsigned value (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...).*/
+static inline uint32_t Zigzag(uint32_t residual)
+{
+  return (residual << 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(residual >> 31));
+}
+
+/** @brief Inverse of Zigzag.*/
+static inline uint32_t Unzigzag(uint32_t value)
+{
+  return (value >> 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(value & 1U));
+}
+
+/** @brief Prediction of the next sample (modulo 2^32).*/
+static inline uint32_t Predict(unsigned order, uint32_t x1, uint32_t x2)
+{
+  return (2 == order) ? ((2U * x1) - x2) : ((1 == order) ? x1 : 0U);
+}
+
+/** @brief Appends a little endian uint32.*/
+static void Put_u32(std::vector<uint8_t> *p_out, uint32_t value)
+{
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    p_out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+/** @brief Reads a little endian uint32.*/
+static uint32_t Get_u32(const uint8_t *p_data)
+{
+  return static_cast<uint32_t>(p_data[0]) | (static_cast<uint32_t>(p_data[1]) << 8) |
+         (static_cast<uint32_t>(p_data[2]) << 16) | (static_cast<uint32_t>(p_data[3]) << 24);
+}
+
+CaptureCodec::CaptureCodec(size_t channels) : channels(channels), history(channels * 2)
+{
+}
+
+void CaptureCodec::Reset()
+{
+  std::fill(history.begin(), history.end(), 0U);
+}
+
+void CaptureCodec::Encode(const spl_t *p_frames, size_t frames, std::vector<uint8_t> *p_out)
+{
+  const size_t block_start = p_out->size();
+  const size_t params_start = block_start + 8;
+
+  Put_u32(p_out, static_cast<uint32_t>(frames));
+  Put_u32(p_out, 0); /* payload size - patched below*/
+  p_out->resize(params_start + (channels * 2));
+
+  BitWriter writer(p_out);
+
+  for (size_t c = 0; c < channels; ++c)
+  {
+    /* Pick the predictor order with the smallest residuals for this channel*/
+    uint64_t cost[3] = {0, 0, 0};
+    uint32_t x1 = history[c * 2];
+    uint32_t x2 = history[(c * 2) + 1];
+    for (size_t n = 0; n < frames; ++n)
+    {
+      const uint32_t x = static_cast<uint32_t>(p_frames[(n * channels) + c]);
+      for (unsigned order = 0; order < 3; ++order)
+      {
+        cost[order] += Zigzag(x - Predict(order, x1, x2));
+      }
+      x2 = x1;
+      x1 = x;
+    }
+
+    unsigned order = 0;
+    for (unsigned o = 1; o < 3; ++o)
+    {
+      if (cost[o] < cost[order])
+      {
+        order = o;
+      }
+    }
+
+    /* Rice parameter from the mean residual - 2^k close to the mean*/
+    const uint64_t mean = (0 == frames) ? 0 : (cost[order] / frames);
+    unsigned k = 0;
+    while (k < 31 && (static_cast<uint64_t>(1) << (k + 1)) <= mean)
+    {
+      ++k;
+    }
+
+    (*p_out)[params_start + (c * 2)] = static_cast<uint8_t>(order);
+    (*p_out)[params_start + (c * 2) + 1] = static_cast<uint8_t>(k);
+
+    x1 = history[c * 2];
+    x2 = history[(c * 2) + 1];
+    for (size_t n = 0; n < frames; ++n)
+    {
+      const uint32_t x = static_cast<uint32_t>(p_frames[(n * channels) + c]);
+      const uint32_t u = Zigzag(x - Predict(order, x1, x2));
+      const uint32_t q = u >> k;
+
+      if (q < CAPTURE_CODEC_ESCAPE)
+      {
+        /* q ones, a zero, then the low k bits*/
+        writer.Put((1U << (q + 1)) - 2U, q + 1);
+        if (0 != k)
+        {
+          writer.Put(u & ((1U << k) - 1U), k);
+        }
+      }
+      else
+      {
+        /* Escape - a full run of ones then the raw value*/
+        writer.Put((1U << CAPTURE_CODEC_ESCAPE) - 1U, CAPTURE_CODEC_ESCAPE);
+        writer.Put(u, 32);
+      }
+
+      x2 = x1;
+      x1 = x;
+    }
+
+    history[c * 2] = x1;
+    history[(c * 2) + 1] = x2;
+  }
+
+  writer.Flush();
+
+  const uint32_t payload = static_cast<uint32_t>(p_out->size() - (block_start + 8));
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    (*p_out)[block_start + 4 + i] = static_cast<uint8_t>(payload >> (8 * i));
+  }
+}
+
+size_t CaptureCodec::Decode(const uint8_t *p_block, size_t available, spl_t *p_frames, size_t *p_frames_decoded)
+{
+  if (available < 8)
+  {
+    return 0;
+  }
+
+  const uint32_t frames = Get_u32(p_block);
+  const uint32_t payload = Get_u32(p_block + 4);
+
+  if (frames > CAPTURE_CODEC_BLOCK_FRAMES || payload < (channels * 2) || (available - 8) < payload)
+  {
+    return 0;
+  }
+
+  const uint8_t *const p_params = p_block + 8;
+  BitReader reader(p_params + (channels * 2), p_block + 8 + payload);
+
+  for (size_t c = 0; c < channels; ++c)
+  {
+    const unsigned order = p_params[c * 2];
+    const unsigned k = p_params[(c * 2) + 1];
+    uint32_t x1 = history[c * 2];
+    uint32_t x2 = history[(c * 2) + 1];
+
+    if (order > 2 || k > 31)
+    {
+      return 0;
+    }
+
+    for (size_t n = 0; n < frames; ++n)
+    {
+      const unsigned q = reader.Ones(CAPTURE_CODEC_ESCAPE);
+      const uint32_t u = (q < CAPTURE_CODEC_ESCAPE) ? ((static_cast<uint32_t>(q) << k) | reader.Get(k)) : reader.Get(32);
+      const uint32_t x = Predict(order, x1, x2) + Unzigzag(u);
+
+      p_frames[(n * channels) + c] = static_cast<spl_t>(x);
+      x2 = x1;
+      x1 = x;
+    }
+
+    history[c * 2] = x1;
+    history[(c * 2) + 1] = x2;
+  }
+
+  if (reader.Overrun())
+  {
+    return 0;
+  }
+
+  *p_frames_decoded = frames;
+  return 8 + payload;
+}
@@ -0,0 +1,61 @@
+#ifndef _CAPTURE_CODEC_H_
+#define _CAPTURE_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include "LMA_Types.h"
+}
+
+/** @brief number of frames in each compressed block*/
+#define CAPTURE_CODEC_BLOCK_FRAMES (4096U)
+
+/** @brief unary prefix length which escapes to a raw 32 bit residual*/
+#define CAPTURE_CODEC_ESCAPE (24U)
+
+/** @brief Lossless block codec for interleaved spl_t frames.
+ * @details Each block is stored as:
+ * - uint32 frame count
+ * - uint32 payload size in bytes (everything after this field)
+ * - per channel: uint8 predictor order (0 = raw, 1 = delta, 2 = delta of delta), uint8 Rice parameter k
+ * - per channel, all residuals of the block Rice coded MSB first, padded to a whole byte at the end of the block
+ *
+ * Residuals are computed modulo 2^32 and zigzag mapped, so the coding is lossless for any spl_t of up to 32 bits. The
+ * predictor history carries over from block to block, so blocks must be decoded in order.
+ */
+class CaptureCodec
+{
+public:
+  /** @brief Constructs the codec.
+   * @param[in] channels - number of samples in each frame.
+   */
+  explicit CaptureCodec(size_t channels);
+
+  /** @brief Clears the predictor history (start of a stream).*/
+  void Reset();
+
+  /** @brief Encodes a block of frames and appends it to p_out.
+   * @param[in] p_frames - interleaved frames.
+   * @param[in] frames - number of frames (at most CAPTURE_CODEC_BLOCK_FRAMES).
+   * @param[inout] p_out - destination for the encoded block.
+   */
+  void Encode(const spl_t *p_frames, size_t frames, std::vector<uint8_t> *p_out);
+
+  /** @brief Decodes one block.
+   * @param[in] p_block - start of the encoded block.
+   * @param[in] available - number of bytes available from p_block.
+   * @param[out] p_frames - destination for the interleaved frames (CAPTURE_CODEC_BLOCK_FRAMES frames of space).
+   * @param[out] p_frames_decoded - number of frames decoded.
+   * @return number of bytes consumed, 0 if the block is malformed or truncated.
+   */
+  size_t Decode(const uint8_t *p_block, size_t available, spl_t *p_frames, size_t *p_frames_decoded);
+
+private:
+  size_t channels;               /**< samples per frame*/
+  std::vector<uint32_t> history; /**< last two samples of each channel (x[n-1], x[n-2])*/
+};
+
+#endif /* _CAPTURE_CODEC_H_*/
@@ -0,0 +1,110 @@
+#include "profile_storage.hpp"
+#include <vector>
+
+ProfileStorage::~ProfileStorage()
+{
+  Close();
+}
+
+bool ProfileStorage::Open(const char *p_path, uint32_t sector_size, uint32_t sector_count)
+{
+  const long region_size = static_cast<long>(sector_size) * static_cast<long>(sector_count);
+
+  Close();
+  stats = {};
+
+  /* Keep a region of the same size, otherwise start erased*/
+  p_file = std::fopen(p_path, "r+b");
+  if (nullptr != p_file && (0 != std::fseek(p_file, 0, SEEK_END) || region_size != std::ftell(p_file)))
+  {
+    std::fclose(p_file);
+    p_file = nullptr;
+  }
+
+  if (nullptr == p_file)
+  {
+    const std::vector<uint8_t> erased(static_cast<size_t>(region_size), 0xFF);
+
+    p_file = std::fopen(p_path, "w+b");
+    if (nullptr == p_file || erased.size() != std::fwrite(erased.data(), 1, erased.size(), p_file))
+    {
+      Close();
+      return false;
+    }
+  }
+
+  storage.read = Read;
+  storage.write = Write;
+  storage.erase = Erase;
+  storage.p_context = this;
+  storage.sector_size = sector_size;
+  storage.sector_count = sector_count;
+
+  return true;
+}
+
+void ProfileStorage::Close()
+{
+  if (nullptr != p_file)
+  {
+    std::fclose(p_file);
+    p_file = nullptr;
+  }
+}
+
+bool ProfileStorage::In_region(uint32_t address, uint32_t size) const
+{
+  return (nullptr != p_file) &&
+         ((static_cast<uint64_t>(address) + size) <= (static_cast<uint64_t>(storage.sector_size) * storage.sector_count));
+}
+
+bool ProfileStorage::Read(void *p_context, uint32_t address, uint8_t *p_data, uint32_t size)
+{
+  ProfileStorage *const p_this = static_cast<ProfileStorage *>(p_context);
+
+  ++p_this->stats.reads;
+  p_this->stats.bytes_read += size;
+
+  return p_this->In_region(address, size) && (0 == std::fseek(p_this->p_file, static_cast<long>(address), SEEK_SET)) &&
+         (size == std::fread(p_data, 1, size, p_this->p_file));
+}
+
+bool ProfileStorage::Write(void *p_context, uint32_t address, const uint8_t *p_data, uint32_t size)
+{
+  ProfileStorage *const p_this = static_cast<ProfileStorage *>(p_context);
+  std::vector<uint8_t> current(size);
+
+  ++p_this->stats.writes;
+  p_this->stats.bytes_written += size;
+
+  /* Flash is only written where erased*/
+  if (!p_this->In_region(address, size) || (0 != std::fseek(p_this->p_file, static_cast<long>(address), SEEK_SET)) ||
+      (size != std::fread(current.data(), 1, size, p_this->p_file)))
+  {
+    return false;
+  }
+  for (const uint8_t byte : current)
+  {
+    if (0xFF != byte)
+    {
+      return false;
+    }
+  }
+
+  return (0 == std::fseek(p_this->p_file, static_cast<long>(address), SEEK_SET)) &&
+         (size == std::fwrite(p_data, 1, size, p_this->p_file));
+}
+
+bool ProfileStorage::Erase(void *p_context, uint32_t address)
+{
+  ProfileStorage *const p_this = static_cast<ProfileStorage *>(p_context);
+  const uint32_t sector_size = p_this->storage.sector_size;
+  const std::vector<uint8_t> erased(sector_size, 0xFF);
+  const uint32_t sector_address = (address / sector_size) * sector_size;
+
+  ++p_this->stats.erases;
+
+  return p_this->In_region(sector_address, sector_size) &&
+         (0 == std::fseek(p_this->p_file, static_cast<long>(sector_address), SEEK_SET)) &&
+         (sector_size == std::fwrite(erased.data(), 1, sector_size, p_this->p_file));
+}
@@ -0,0 +1,73 @@
+#ifndef _PROFILE_STORAGE_H_
+#define _PROFILE_STORAGE_H_
+
+#include <cstdint>
+#include <cstdio>
+
+extern "C"
+{
+#include "LMA_Types.h"
+}
+
+/** @brief Operations and bytes passed to a ProfileStorage.*/
+typedef struct ProfileStorageStats
+{
+  uint64_t reads;         /**< read calls*/
+  uint64_t writes;        /**< write calls*/
+  uint64_t erases;        /**< sectors erased*/
+  uint64_t bytes_read;    /**< bytes read*/
+  uint64_t bytes_written; /**< bytes written*/
+} ProfileStorageStats;
+
+/** @brief File backed flash region for the load profile recorder (LMA_Profile).
+ * @details Behaves as data flash: erasing a sector sets it to 0xFF and a write fails unless every byte it covers is erased,
+ * so the recorder cannot rely on anything a real part would not do. The region lives in a file, so a profile survives from
+ * one run to the next as it would a reset of the meter.
+ */
+class ProfileStorage
+{
+public:
+  ~ProfileStorage();
+
+  /** @brief Opens the region, creating it erased if the file does not hold a region of this size.
+   * @param[in] p_path - path to the region file.
+   * @param[in] sector_size - bytes of each sector.
+   * @param[in] sector_count - number of sectors.
+   * @return true if the region is open.
+   */
+  bool Open(const char *p_path, uint32_t sector_size, uint32_t sector_count);
+
+  /** @brief Closes the region file.*/
+  void Close();
+
+  /** @brief Storage interface to hand to LMA_ProfileInit - valid while the region is open.*/
+  const LMA_ProfileStorage *Storage() const
+  {
+    return &storage;
+  }
+
+  /** @brief Operations and bytes since the region was opened.*/
+  const ProfileStorageStats &Stats() const
+  {
+    return stats;
+  }
+
+private:
+  /** @brief LMA_ProfileStorage.read*/
+  static bool Read(void *p_context, uint32_t address, uint8_t *p_data, uint32_t size);
+
+  /** @brief LMA_ProfileStorage.write*/
+  static bool Write(void *p_context, uint32_t address, const uint8_t *p_data, uint32_t size);
+
+  /** @brief LMA_ProfileStorage.erase*/
+  static bool Erase(void *p_context, uint32_t address);
+
+  /** @brief Checks an access lies within the region.*/
+  bool In_region(uint32_t address, uint32_t size) const;
+
+  std::FILE *p_file = nullptr;     /**< region file*/
+  LMA_ProfileStorage storage = {}; /**< interface handed to the recorder*/
+  ProfileStorageStats stats = {};  /**< operations so far*/
+};
+
+#endif /* _PROFILE_STORAGE_H_*/
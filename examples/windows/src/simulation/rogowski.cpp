@@ -0,0 +1,114 @@
+#include "rogowski.hpp"
+#include <algorithm>
+#include <cmath>
+
+/** @brief seconds run before fitting the response - many time constants of the HPF*/
+#define ROGOWSKI_SETTLE_SECONDS (1.0)
+
+/** @brief seconds of output fitted*/
+#define ROGOWSKI_FIT_SECONDS (10.0)
+
+static const double pi = 3.14159265358979323846;
+
+std::complex<double> RogowskiDesign(double f, double fs)
+{
+  const double w = 2.0 * pi * f / fs;
+  const std::complex<double> z1 = std::polar(1.0, -w);
+  const std::complex<double> coil(0.0, ROGOWSKI_COIL_SIGN * w);
+  const std::complex<double> trap = (1.0 + z1) / (2.0 * (1.0 - z1));
+  const std::complex<double> hpf = (-ROGOWSKI_HPF_COEFF * (1.0 - z1)) / (1.0 - (ROGOWSKI_HPF_COEFF * z1));
+
+  return coil * trap * hpf;
+}
+
+std::complex<double> RogowskiMeasure(double f, double fs, double amplitude)
+{
+  const double w = 2.0 * pi * f / fs;
+  const size_t settle = static_cast<size_t>(ROGOWSKI_SETTLE_SECONDS * fs);
+  const size_t total = settle + static_cast<size_t>(ROGOWSKI_FIT_SECONDS * fs);
+  Trap_integrator integrator;
+  double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+
+  Trap_reset(&integrator);
+
+  for (size_t n = 0; n < total; ++n)
+  {
+    /* Coil output of amplitude * sin(wn)*/
+    const double angle = w * static_cast<double>(n);
+    const spl_t x = static_cast<spl_t>(std::lround(ROGOWSKI_COIL_SIGN * amplitude * w * std::cos(angle)));
+    const double y = static_cast<double>(Trap_integrate(&integrator, x));
+
+    if (n >= settle)
+    {
+      const double s = std::sin(angle);
+      const double c = std::cos(angle);
+      ss += s * s;
+      cc += c * c;
+      sc += s * c;
+      ys += y * s;
+      yc += y * c;
+    }
+  }
+
+  /* Least squares fit of y = a.sin + b.cos, which is the imaginary part of (a + jb) * e^(jwn)*/
+  const double det = (ss * cc) - (sc * sc);
+  const double a = ((ys * cc) - (yc * sc)) / det;
+  const double b = ((yc * ss) - (ys * sc)) / det;
+
+  return std::complex<double>(a, b) / amplitude;
+}
+
+RogowskiDrift RogowskiMeasureDrift(double fs, spl_t offset, double seconds)
+{
+  const size_t total = static_cast<size_t>(seconds * fs);
+  Trap_integrator integrator;
+  RogowskiDrift drift = {0.0, 0.0};
+
+  Trap_reset(&integrator);
+
+  for (size_t n = 0; n < total; ++n)
+  {
+    drift.settled = static_cast<double>(Trap_integrate(&integrator, offset));
+    drift.peak = std::max(drift.peak, std::fabs(drift.settled));
+  }
+
+  return drift;
+}
+
+RogowskiFrontEnd::RogowskiFrontEnd(double fs, double fcal) : fs(fs), index(0)
+{
+  const double w = 2.0 * pi * fcal / fs;
+  const std::complex<double> design = RogowskiDesign(fcal, fs);
+
+  /* Delay by the whole samples of the phase lead, the taps then make up the rest and the gain exactly at fcal:
+   * c0 + c1.e^(-jw) = e^(jw.delay) / design*/
+  delay = static_cast<size_t>(std::max(0.0, std::floor(std::arg(design) / w)));
+
+  const std::complex<double> target = std::polar(1.0, w * static_cast<double>(delay)) / design;
+  c1 = -target.imag() / std::sin(w);
+  c0 = target.real() - (c1 * std::cos(w));
+
+  buffer.assign(delay + 2, 0);
+  Trap_reset(&integrator);
+}
+
+spl_t RogowskiFrontEnd::Process(spl_t coil_sample)
+{
+  const size_t size = buffer.size();
+
+  index = (index + 1 < size) ? (index + 1) : 0;
+  buffer[index] = Trap_integrate(&integrator, coil_sample);
+
+  const double tap0 = static_cast<double>(buffer[(index + size - delay) % size]);
+  const double tap1 = static_cast<double>(buffer[(index + size - delay - 1) % size]);
+
+  return static_cast<spl_t>(std::lround((c0 * tap0) + (c1 * tap1)));
+}
+
+std::complex<double> RogowskiFrontEnd::Response(double f) const
+{
+  const double w = 2.0 * pi * f / fs;
+  const std::complex<double> taps = c0 + (c1 * std::polar(1.0, -w));
+
+  return RogowskiDesign(f, fs) * std::polar(1.0, -w * static_cast<double>(delay)) * taps;
+}
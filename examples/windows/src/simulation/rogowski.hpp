@@ -0,0 +1,96 @@
+#ifndef _ROGOWSKI_H_
+#define _ROGOWSKI_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include "LMA_Types.h"
+#include "Trap_integrator.h"
+}
+
+/** @brief Coil model - the output of the Rogowski coil in ADC codes of the current it measures.
+ * @details The coil gives -Ts * di/dt: scaled by the sampling period so an ideal integrator restores the current codes, and
+ * connected reversed because the DC-drift HPF of Trap_integrate inverts.
+ */
+#define ROGOWSKI_COIL_SIGN (-1.0)
+
+/** @brief coefficient of the DC-drift HPF in Trap_integrate*/
+#define ROGOWSKI_HPF_COEFF (63493.0 / 65535.0)
+
+/** @brief response of the DC-drift HPF of Trap_integrate to a constant coil offset*/
+typedef struct RogowskiDrift
+{
+  double settled; /**< output once settled (ADC codes)*/
+  double peak;    /**< largest output magnitude seen (ADC codes)*/
+} RogowskiDrift;
+
+/** @brief Response of the coil and Trap_integrate design to a sine, relative to the current it measures.
+ * @details Coil (-jw), trapezoidal integrator (1 + z^-1) / 2(1 - z^-1) and inverting HPF -a(1 - z^-1) / (1 - az^-1) with the
+ * coefficient used by Trap_integrate - i.e. what the integrator should do, in floating point.
+ * @param[in] f - signal frequency in Hz.
+ * @param[in] fs - sampling frequency in Hz.
+ * @return complex gain (1 = the current is restored exactly).
+ */
+std::complex<double> RogowskiDesign(double f, double fs);
+
+/** @brief Measures the response of Trap_integrate to the coil output of a sine.
+ * @details The coil signal is quantised to ADC codes and run through a fresh integrator, the output is then fitted to a sine
+ * and cosine after the HPF has settled.
+ * @param[in] f - signal frequency in Hz.
+ * @param[in] fs - sampling frequency in Hz.
+ * @param[in] amplitude - peak of the measured current in ADC codes.
+ * @return complex gain relative to the current.
+ */
+std::complex<double> RogowskiMeasure(double f, double fs, double amplitude);
+
+/** @brief Measures the output of Trap_integrate for a constant offset on the coil channel (e.g. ADC offset).
+ * @details An ideal integrator ramps without limit - the HPF should hold the output at -a / (1 - a) times the offset (a being
+ * ROGOWSKI_HPF_COEFF).
+ * @param[in] fs - sampling frequency in Hz.
+ * @param[in] offset - offset in ADC codes.
+ * @param[in] seconds - time to run for.
+ * @return settled and peak output.
+ */
+RogowskiDrift RogowskiMeasureDrift(double fs, spl_t offset, double seconds);
+
+/** @brief Rogowski front end - integrates the coil output back to a current sample.
+ * @details Trap_integrate as on the RL78 board, then a two tap FIR after a whole sample delay which undoes the gain and phase
+ * of the design at the calibration frequency (the job of the phase adjust and calibration on the board). Away from the
+ * calibration frequency the residual error of the HPF remains, as it would on target.
+ */
+class RogowskiFrontEnd
+{
+public:
+  /** @brief Constructs the front end.
+   * @param[in] fs - sampling frequency in Hz.
+   * @param[in] fcal - frequency the gain and phase are compensated at in Hz.
+   */
+  RogowskiFrontEnd(double fs, double fcal);
+
+  /** @brief Processes one sample.
+   * @param[in] coil_sample - coil output (ADC).
+   * @return current sample (ADC).
+   */
+  spl_t Process(spl_t coil_sample);
+
+  /** @brief Response of the whole front end (design and compensation) relative to the current.
+   * @param[in] f - signal frequency in Hz.
+   * @return complex gain (1 at the calibration frequency).
+   */
+  std::complex<double> Response(double f) const;
+
+private:
+  Trap_integrator integrator; /**< integrator as on target*/
+  double fs;                  /**< sampling frequency*/
+  double c0;                  /**< weight of the tap delayed by delay samples*/
+  double c1;                  /**< weight of the tap delayed by delay + 1 samples*/
+  size_t delay;               /**< whole sample delay of the first tap*/
+  std::vector<spl_t> buffer;  /**< delay line of integrated samples*/
+  size_t index;               /**< index of the newest sample*/
+};
+
+#endif /* _ROGOWSKI_H_*/
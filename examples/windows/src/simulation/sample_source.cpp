@@ -0,0 +1,63 @@
+#include "sample_source.hpp"
+#include "rogowski.hpp"
+#include <algorithm>
+
+WaveformSource::WaveformSource(double fs, double fline, double vrms, double irms, double ps, size_t plot_samples,
+                               std::vector<double> *p_v_plot, std::vector<double> *p_i_plot, bool v90, bool rogowski)
+    : fs(fs), v90(v90), rogowski(rogowski), voltage_gen(fline, 0.0, vrms, 1, 0.0012623, fs),
+      voltage90_gen(fline, -90.0, vrms, 1, 0.0012623, fs), current_gen(fline, ps, irms, 8, 0.0004, fs),
+      coil_gen(fline, ps + (ROGOWSKI_COIL_SIGN * 90.0), irms * (2.0 * 3.14159265358979323846 * fline / fs), 8, 0.0004, fs),
+      plot_remaining(plot_samples),
+      v_decimator(plot_samples, WAVEFORM_PLOT_POINTS), i_decimator(plot_samples, WAVEFORM_PLOT_POINTS), p_v_plot(p_v_plot),
+      p_i_plot(p_i_plot)
+{
+}
+
+size_t WaveformSource::Read(const spl_t **pp_frames, size_t max_frames)
+{
+  const size_t count = std::min<size_t>(max_frames, WAVEFORM_BLOCK_SIZE);
+
+  voltage_gen.Generate(voltage_block, voltage_values, count);
+  current_gen.Generate(current_block, current_values, count);
+
+  /* The phase current is sensed by the coil, the neutral by a CT as on the RL78 board*/
+  const int32_t *const p_phase_current = rogowski ? coil_block : current_block;
+  if (rogowski)
+  {
+    coil_gen.Generate(coil_block, nullptr, count);
+  }
+
+  if (v90)
+  {
+    voltage90_gen.Generate(voltage90_block, nullptr, count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      frames[(i * 4) + 0] = static_cast<spl_t>(voltage_block[i]);
+      frames[(i * 4) + 1] = static_cast<spl_t>(voltage90_block[i]);
+      frames[(i * 4) + 2] = static_cast<spl_t>(p_phase_current[i]);
+      frames[(i * 4) + 3] = static_cast<spl_t>(current_block[i]);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      frames[(i * 3) + 0] = static_cast<spl_t>(voltage_block[i]);
+      frames[(i * 3) + 1] = static_cast<spl_t>(p_phase_current[i]);
+      frames[(i * 3) + 2] = static_cast<spl_t>(current_block[i]);
+    }
+  }
+
+  /* Keep the samples within the simulated duration for plotting*/
+  const size_t plot_count = std::min(count, plot_remaining);
+  for (size_t i = 0; i < plot_count; ++i)
+  {
+    v_decimator.Add(voltage_values[i], p_v_plot);
+    i_decimator.Add(current_values[i], p_i_plot);
+  }
+  plot_remaining -= plot_count;
+
+  *pp_frames = frames;
+  return count;
+}
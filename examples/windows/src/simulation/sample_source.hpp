@@ -0,0 +1,147 @@
+#ifndef _SAMPLE_SOURCE_H_
+#define _SAMPLE_SOURCE_H_
+
+#include "waveform.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#include "LMA_Types.h"
+}
+
+/** @brief channel flag - each phase carries a 90 degree shifted voltage channel*/
+#define SAMPLE_CHANNEL_V90 (0x0001U)
+
+/** @brief channel flag - each frame ends with a neutral current channel*/
+#define SAMPLE_CHANNEL_NEUTRAL (0x0002U)
+
+/** @brief channel flag - the phase current channels carry a Rogowski coil output (di/dt) to integrate, the neutral is a CT*/
+#define SAMPLE_CHANNEL_DIDT (0x0004U)
+
+/** @brief Number of samples in a frame with the given layout.
+ * @param[in] phases - number of phases in each frame.
+ * @param[in] channels - channel flags (SAMPLE_CHANNEL_x).
+ * @return samples per frame.
+ */
+inline size_t SampleFrameSize(size_t phases, uint16_t channels)
+{
+  return (phases * ((0 != (channels & SAMPLE_CHANNEL_V90)) ? 3 : 2)) + ((0 != (channels & SAMPLE_CHANNEL_NEUTRAL)) ? 1 : 0);
+}
+
+/** @brief Source of ADC frames for the simulation driver.
+ * @details A frame holds one ADC conversion for every channel, laid out as:
+ * - for each phase: v, v90 (if SAMPLE_CHANNEL_V90), i
+ * - then the neutral current (if SAMPLE_CHANNEL_NEUTRAL)
+ *
+ * Frames are handed out in contiguous blocks which remain valid until the next call to Read.
+ */
+class SampleSource
+{
+public:
+  virtual ~SampleSource() = default;
+
+  /** @brief Number of phases in each frame.*/
+  virtual size_t Phases() const = 0;
+
+  /** @brief Channel flags (SAMPLE_CHANNEL_x) describing the frame layout.*/
+  virtual uint16_t Channels() const = 0;
+
+  /** @brief Sampling frequency the frames were produced at.*/
+  virtual double Fs() const = 0;
+
+  /** @brief Number of frames available (0 for an endless source).*/
+  virtual uint64_t Frames() const = 0;
+
+  /** @brief Reads the next block of frames.
+   * @param[out] pp_frames - set to the first sample of the block.
+   * @param[in] max_frames - maximum number of frames to return.
+   * @return number of frames in the block, 0 once the source is exhausted.
+   */
+  virtual size_t Read(const spl_t **pp_frames, size_t max_frames) = 0;
+
+  /** @brief Restarts the source from its first frame.*/
+  virtual void Rewind() = 0;
+
+  /** @brief Number of samples in each frame.*/
+  size_t FrameSize() const
+  {
+    return SampleFrameSize(Phases(), Channels());
+  }
+};
+
+/** @brief Single phase synthetic source built from two waveform generators.
+ * @details Produces v, i and neutral (equal to i) channels, plus an exact 90 degree shifted voltage if requested. The phase
+ * current can be replaced by the output of a Rogowski coil measuring it. The voltage and current values are also decimated
+ * into the supplied plot buffers as they are generated.
+ */
+class WaveformSource : public SampleSource
+{
+public:
+  /** @brief Constructs the source.
+   * @param[in] fs - sampling frequency in Hz.
+   * @param[in] fline - line frequency in Hz.
+   * @param[in] vrms - RMS voltage.
+   * @param[in] irms - RMS current.
+   * @param[in] ps - phase shift of the current relative to the voltage in degrees.
+   * @param[in] plot_samples - number of samples to decimate into the plot buffers.
+   * @param[out] p_v_plot - voltage plot buffer (V).
+   * @param[out] p_i_plot - current plot buffer (A).
+   * @param[in] v90 - generate the 90 degree shifted voltage (SAMPLE_CHANNEL_V90) rather than leave it to the driver.
+   * @param[in] rogowski - generate the phase current as a Rogowski coil output (SAMPLE_CHANNEL_DIDT).
+   */
+  WaveformSource(double fs, double fline, double vrms, double irms, double ps, size_t plot_samples,
+                 std::vector<double> *p_v_plot, std::vector<double> *p_i_plot, bool v90 = false, bool rogowski = false);
+
+  size_t Phases() const override
+  {
+    return 1;
+  }
+
+  uint16_t Channels() const override
+  {
+    return (v90 ? SAMPLE_CHANNEL_V90 : 0) | (rogowski ? SAMPLE_CHANNEL_DIDT : 0) | SAMPLE_CHANNEL_NEUTRAL;
+  }
+
+  double Fs() const override
+  {
+    return fs;
+  }
+
+  uint64_t Frames() const override
+  {
+    return 0;
+  }
+
+  size_t Read(const spl_t **pp_frames, size_t max_frames) override;
+
+  void Rewind() override
+  {
+    /* Endless - nothing to rewind*/
+  }
+
+private:
+  double fs;                                    /**< sampling frequency*/
+  bool v90;                                     /**< frames carry the 90 degree shifted voltage*/
+  bool rogowski;                                /**< frames carry the coil output as the phase current*/
+  WaveformGenerator voltage_gen;                /**< generator for the voltage channel*/
+  WaveformGenerator voltage90_gen;              /**< generator for the 90 degree shifted voltage channel*/
+  WaveformGenerator current_gen;                /**< generator for the current channel*/
+  WaveformGenerator coil_gen;                   /**< generator for the Rogowski coil output (ROGOWSKI_COIL_SIGN * Ts * di/dt)*/
+  int32_t voltage_block[WAVEFORM_BLOCK_SIZE];   /**< block of voltage samples (ADC)*/
+  int32_t voltage90_block[WAVEFORM_BLOCK_SIZE]; /**< block of 90 degree shifted voltage samples (ADC)*/
+  int32_t current_block[WAVEFORM_BLOCK_SIZE];   /**< block of current samples (ADC)*/
+  int32_t coil_block[WAVEFORM_BLOCK_SIZE];      /**< block of coil output samples (ADC)*/
+  double voltage_values[WAVEFORM_BLOCK_SIZE];   /**< block of voltage samples (V)*/
+  double current_values[WAVEFORM_BLOCK_SIZE];   /**< block of current samples (A)*/
+  spl_t frames[WAVEFORM_BLOCK_SIZE * 4];        /**< interleaved frames handed to the driver*/
+  size_t plot_remaining;                        /**< samples still to be decimated for plotting*/
+  PlotDecimator<double> v_decimator;            /**< decimator for the voltage plot*/
+  PlotDecimator<double> i_decimator;            /**< decimator for the current plot*/
+  std::vector<double> *p_v_plot;                /**< voltage plot buffer*/
+  std::vector<double> *p_i_plot;                /**< current plot buffer*/
+};
+
+#endif /* _SAMPLE_SOURCE_H_*/
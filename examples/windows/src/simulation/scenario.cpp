@@ -0,0 +1,191 @@
+#include "scenario.hpp"
+#include <algorithm>
+#include <cmath>
+
+void ScenarioDefault(Scenario *const p_scenario, ScenarioType type, double vrms, double irms, double ps, double unbalance)
+{
+  static const double angles[] = {0.0, -120.0, 120.0};
+  static const double split_angles[] = {0.0, 180.0};
+  const size_t conductors = (SCENARIO_SINGLE == type) ? 1 : (SCENARIO_SPLIT == type) ? 2 : 3;
+  const double scale[] = {1.0, 1.0 - unbalance, 1.0 + unbalance};
+
+  p_scenario->type = type;
+  p_scenario->phases.clear();
+  p_scenario->harmonics.clear();
+  p_scenario->noise = 0.0;
+  p_scenario->offset = 0.0;
+  p_scenario->step_time = 0.0;
+  p_scenario->step_scale = 1.0;
+  p_scenario->load_profile.clear();
+  p_scenario->load_interval = 0.0;
+  p_scenario->voltage_profile.clear();
+  p_scenario->voltage_interval = 0.0;
+  p_scenario->earth_fraction = 0.0;
+  p_scenario->seed = 1;
+
+  for (size_t c = 0; c < conductors; ++c)
+  {
+    const double angle = (SCENARIO_SPLIT == type) ? split_angles[c] : angles[c];
+    p_scenario->phases.push_back({vrms, angle, irms * scale[c], ps});
+  }
+}
+
+ScenarioSource::ScenarioSource(const Scenario &scenario, double fs, double fline, bool v90)
+    : type(scenario.type), fs(fs), v90(v90), noise(scenario.noise),
+      offset(std::llround(scenario.offset)), sample(0),
+      step_sample((scenario.step_time > 0.0) ? static_cast<uint64_t>(std::llround(scenario.step_time * fs)) : UINT64_MAX),
+      step_scale(scenario.step_scale), load_profile(scenario.load_profile),
+      load_samples(std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(scenario.load_interval * fs)))),
+      voltage_profile(scenario.voltage_profile),
+      voltage_samples(std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(scenario.voltage_interval * fs)))),
+      neutral_scale(1.0 - scenario.earth_fraction), scratch(WAVEFORM_BLOCK_SIZE),
+      rng(scenario.seed),
+      normal(0.0, (scenario.noise > 0.0) ? scenario.noise : 1.0)
+{
+  for (const ScenarioPhase &phase : scenario.phases)
+  {
+    Conductor conductor;
+    const double i_angle = phase.v_angle + phase.ps;
+
+    /* Same analog front end as the single phase WaveformSource, so the default calibration holds*/
+    conductor.v_gens.emplace_back(fline, phase.v_angle, phase.vrms, 1, 0.0012623, fs);
+    conductor.v90_gens.emplace_back(fline, phase.v_angle - 90.0, phase.vrms, 1, 0.0012623, fs);
+    conductor.i_gens.emplace_back(fline, i_angle, phase.irms, 8, 0.0004, fs);
+
+    /* Harmonic angles scale with the order, so triplens are in phase across a balanced supply*/
+    for (const ScenarioHarmonic &harmonic : scenario.harmonics)
+    {
+      const double h = static_cast<double>(harmonic.order);
+      conductor.v_gens.emplace_back(fline * h, phase.v_angle * h, phase.vrms * harmonic.v_fraction, 1, 0.0012623, fs);
+      conductor.v90_gens.emplace_back(fline * h, (phase.v_angle * h) - 90.0, phase.vrms * harmonic.v_fraction, 1, 0.0012623,
+                                      fs);
+      conductor.i_gens.emplace_back(fline * h, i_angle * h, phase.irms * harmonic.i_fraction, 8, 0.0004, fs);
+    }
+
+    conductor.v.resize(WAVEFORM_BLOCK_SIZE);
+    conductor.v90.resize(WAVEFORM_BLOCK_SIZE);
+    conductor.i.resize(WAVEFORM_BLOCK_SIZE);
+    conductors.push_back(std::move(conductor));
+  }
+
+  /* Channel maths below indexes the conductors the wiring needs - missing ones repeat the last given*/
+  if (!conductors.empty())
+  {
+    conductors.resize((SCENARIO_SINGLE == type) ? 1 : (SCENARIO_SPLIT == type) ? 2 : 3, conductors.back());
+  }
+  frames.resize(WAVEFORM_BLOCK_SIZE * FrameSize());
+}
+
+void ScenarioSource::Generate_sum(std::vector<WaveformGenerator> *p_gens, int32_t *p_out, size_t count)
+{
+  std::fill(p_out, p_out + count, 0);
+
+  for (WaveformGenerator &gen : *p_gens)
+  {
+    gen.Generate(scratch.data(), nullptr, count);
+    for (size_t n = 0; n < count; ++n)
+    {
+      p_out[n] += scratch[n];
+    }
+  }
+}
+
+spl_t ScenarioSource::Sample(int64_t value)
+{
+  value += offset;
+
+  if (noise > 0.0)
+  {
+    value += static_cast<int64_t>(std::llround(normal(rng)));
+  }
+
+  return static_cast<spl_t>(value);
+}
+
+size_t ScenarioSource::Read(const spl_t **pp_frames, size_t max_frames)
+{
+  const size_t count = std::min<size_t>(max_frames, WAVEFORM_BLOCK_SIZE);
+  const size_t frame_size = FrameSize();
+  /* Load step - the currents are scaled from step_sample on*/
+  const size_t step_first = (step_sample > sample) ? static_cast<size_t>(std::min<uint64_t>(step_sample - sample, count)) : 0;
+
+  for (Conductor &conductor : conductors)
+  {
+    Generate_sum(&(conductor.v_gens), conductor.v.data(), count);
+    Generate_sum(&(conductor.i_gens), conductor.i.data(), count);
+    for (size_t n = step_first; n < count; ++n)
+    {
+      conductor.i[n] = static_cast<int32_t>(std::lround(conductor.i[n] * step_scale));
+    }
+    if (!load_profile.empty())
+    {
+      for (size_t n = 0; n < count; ++n)
+      {
+        const double scale = load_profile[((sample + n) / load_samples) % load_profile.size()];
+        conductor.i[n] = static_cast<int32_t>(std::lround(conductor.i[n] * scale));
+      }
+    }
+    if (v90)
+    {
+      Generate_sum(&(conductor.v90_gens), conductor.v90.data(), count);
+    }
+    if (!voltage_profile.empty())
+    {
+      for (size_t n = 0; n < count; ++n)
+      {
+        const double scale = voltage_profile[((sample + n) / voltage_samples) % voltage_profile.size()];
+        conductor.v[n] = static_cast<int32_t>(std::lround(conductor.v[n] * scale));
+        conductor.v90[n] = static_cast<int32_t>(std::lround(conductor.v90[n] * scale));
+      }
+    }
+  }
+
+  for (size_t n = 0; n < count; ++n)
+  {
+    spl_t *p_frame = frames.data() + (n * frame_size);
+
+    if (SCENARIO_DELTA == type)
+    {
+      /* Two element method - both voltages are measured against line b*/
+      const Conductor &a = conductors[0];
+      const Conductor &b = conductors[1];
+      const Conductor &c = conductors[2];
+
+      *p_frame++ = Sample(static_cast<int64_t>(a.v[n]) - b.v[n]);
+      if (v90)
+      {
+        *p_frame++ = Sample(static_cast<int64_t>(a.v90[n]) - b.v90[n]);
+      }
+      *p_frame++ = Sample(a.i[n]);
+
+      *p_frame++ = Sample(static_cast<int64_t>(c.v[n]) - b.v[n]);
+      if (v90)
+      {
+        *p_frame++ = Sample(static_cast<int64_t>(c.v90[n]) - b.v90[n]);
+      }
+      *p_frame++ = Sample(c.i[n]);
+    }
+    else
+    {
+      int64_t neutral = 0;
+
+      for (const Conductor &conductor : conductors)
+      {
+        *p_frame++ = Sample(conductor.v[n]);
+        if (v90)
+        {
+          *p_frame++ = Sample(conductor.v90[n]);
+        }
+        *p_frame++ = Sample(conductor.i[n]);
+        neutral += conductor.i[n];
+      }
+
+      /* Return current of the line currents (single phase - the phase current itself), less any returned through earth*/
+      *p_frame = Sample((1.0 == neutral_scale) ? neutral : std::llround(static_cast<double>(neutral) * neutral_scale));
+    }
+  }
+
+  sample += count;
+  *pp_frames = frames.data();
+  return count;
+}
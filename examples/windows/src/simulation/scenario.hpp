@@ -0,0 +1,154 @@
+#ifndef _SCENARIO_H_
+#define _SCENARIO_H_
+
+#include "sample_source.hpp"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+/** @brief wiring of the simulated supply*/
+typedef enum ScenarioType
+{
+  SCENARIO_SINGLE = 0, /**< one phase and neutral - one element plus the neutral current*/
+  SCENARIO_WYE,        /**< three phase four wire - three line to neutral elements plus the neutral current*/
+  SCENARIO_DELTA,      /**< three phase three wire - two line to line elements (Vab/Ia and Vcb/Ic), no neutral*/
+  SCENARIO_SPLIT       /**< split phase - two legs 180 degrees apart plus the neutral current*/
+} ScenarioType;
+
+/** @brief one phase conductor of the supply and its load*/
+typedef struct ScenarioPhase
+{
+  double vrms;    /**< RMS voltage to neutral*/
+  double v_angle; /**< voltage angle in degrees*/
+  double irms;    /**< RMS line current*/
+  double ps;      /**< phase shift of the current relative to its voltage in degrees*/
+} ScenarioPhase;
+
+/** @brief harmonic added to every phase*/
+typedef struct ScenarioHarmonic
+{
+  uint32_t order;    /**< harmonic order (2 = twice the line frequency)*/
+  double v_fraction; /**< voltage amplitude as a fraction of the fundamental*/
+  double i_fraction; /**< current amplitude as a fraction of the fundamental*/
+} ScenarioHarmonic;
+
+/** @brief description of a simulated supply and load*/
+typedef struct Scenario
+{
+  ScenarioType type;                       /**< wiring*/
+  std::vector<ScenarioPhase> phases;       /**< phase conductors (1 for single, 2 for split, 3 otherwise)*/
+  std::vector<ScenarioHarmonic> harmonics; /**< harmonics added to every phase*/
+  double noise;                            /**< RMS of the gaussian noise added to every channel in ADC codes*/
+  double offset;                           /**< DC offset added to every channel in ADC codes (e.g. ADC offset)*/
+  double step_time;                        /**< time of a load step in seconds (0 = no step)*/
+  double step_scale;                       /**< factor applied to every current from step_time on*/
+  std::vector<double> load_profile;        /**< factor applied to every current, each for load_interval in turn (cycled)*/
+  double load_interval;                    /**< time each load_profile entry lasts in seconds*/
+  std::vector<double> voltage_profile;     /**< factor applied to every voltage, each for voltage_interval in turn (cycled)*/
+  double voltage_interval;                 /**< time each voltage_profile entry lasts in seconds*/
+  double earth_fraction;                   /**< fraction of the return current flowing to earth rather than the neutral*/
+  uint32_t seed;                           /**< seed of the noise - the same seed gives the same waveform*/
+} Scenario;
+
+/** @brief Fills a scenario with a balanced supply and load.
+ * @param[out] p_scenario - scenario to fill (harmonics are cleared, noise, offset, load step, load and voltage profiles and
+ * earth return disabled).
+ * @param[in] type - wiring.
+ * @param[in] vrms - RMS voltage to neutral of each phase.
+ * @param[in] irms - RMS current of each phase.
+ * @param[in] ps - phase shift of each current relative to its voltage in degrees.
+ * @param[in] unbalance - current unbalance as a fraction: the second phase carries (1 - unbalance) and the third
+ * (1 + unbalance) times irms.
+ */
+void ScenarioDefault(Scenario *const p_scenario, ScenarioType type, double vrms, double irms, double ps, double unbalance);
+
+/** @brief Multi-phase synthetic source generating a scenario.
+ * @details Each phase conductor (and each harmonic of it) has its own waveform generators, the measured channels are then
+ * formed from the conductor signals:
+ * - single, wye and split: v and i of each conductor, the neutral carries the sum of the line currents.
+ * - delta: Va - Vb with Ia and Vc - Vb with Ic (the two element method), no neutral.
+ *
+ * An exact 90 degree shifted voltage channel is generated if requested.
+ */
+class ScenarioSource : public SampleSource
+{
+public:
+  /** @brief Constructs the source.
+   * @param[in] scenario - supply and load to generate.
+   * @param[in] fs - sampling frequency in Hz.
+   * @param[in] fline - line frequency in Hz.
+   * @param[in] v90 - generate the 90 degree shifted voltage (SAMPLE_CHANNEL_V90) rather than leave it to the driver.
+   */
+  ScenarioSource(const Scenario &scenario, double fs, double fline, bool v90);
+
+  size_t Phases() const override
+  {
+    return (SCENARIO_WYE == type) ? 3 : (SCENARIO_SINGLE == type) ? 1 : 2;
+  }
+
+  uint16_t Channels() const override
+  {
+    return (v90 ? SAMPLE_CHANNEL_V90 : 0) | ((SCENARIO_DELTA == type) ? 0 : SAMPLE_CHANNEL_NEUTRAL);
+  }
+
+  double Fs() const override
+  {
+    return fs;
+  }
+
+  uint64_t Frames() const override
+  {
+    return 0;
+  }
+
+  size_t Read(const spl_t **pp_frames, size_t max_frames) override;
+
+  void Rewind() override
+  {
+    /* Endless - nothing to rewind*/
+  }
+
+private:
+  /** @brief generators and generated block of one conductor*/
+  typedef struct Conductor
+  {
+    std::vector<WaveformGenerator> v_gens;   /**< voltage generators (fundamental then harmonics)*/
+    std::vector<WaveformGenerator> v90_gens; /**< 90 degree shifted voltage generators*/
+    std::vector<WaveformGenerator> i_gens;   /**< current generators*/
+    std::vector<int32_t> v;                  /**< voltage block (ADC)*/
+    std::vector<int32_t> v90;                /**< 90 degree shifted voltage block (ADC)*/
+    std::vector<int32_t> i;                  /**< current block (ADC)*/
+  } Conductor;
+
+  /** @brief Sums the output of generators into a block.
+   * @param[inout] p_gens - generators to run.
+   * @param[out] p_out - block to write (count entries).
+   * @param[in] count - number of samples.
+   */
+  void Generate_sum(std::vector<WaveformGenerator> *p_gens, int32_t *p_out, size_t count);
+
+  /** @brief Converts a channel value to a sample, adding the offset and noise if enabled.*/
+  spl_t Sample(int64_t value);
+
+  ScenarioType type;                       /**< wiring*/
+  double fs;                               /**< sampling frequency*/
+  bool v90;                                /**< frames carry the 90 degree shifted voltage*/
+  double noise;                            /**< RMS noise in ADC codes (0 = none)*/
+  int64_t offset;                          /**< DC offset in ADC codes*/
+  uint64_t sample;                         /**< index of the next sample generated*/
+  uint64_t step_sample;                    /**< index of the first sample after the load step*/
+  double step_scale;                       /**< factor applied to the currents from step_sample on*/
+  std::vector<double> load_profile;        /**< factor applied to the currents, each for load_samples in turn*/
+  uint64_t load_samples;                   /**< samples each load_profile entry lasts*/
+  std::vector<double> voltage_profile;     /**< factor applied to the voltages, each for voltage_samples in turn*/
+  uint64_t voltage_samples;                /**< samples each voltage_profile entry lasts*/
+  double neutral_scale;                    /**< fraction of the return current flowing in the neutral*/
+  std::vector<Conductor> conductors;       /**< phase conductors*/
+  std::vector<int32_t> scratch;            /**< output of one generator*/
+  std::vector<spl_t> frames;               /**< interleaved frames handed to the driver*/
+  std::mt19937 rng;                        /**< noise generator*/
+  std::normal_distribution<double> normal; /**< noise distribution*/
+};
+
+#endif /* _SCENARIO_H_*/
@@ -1,51 +1,107 @@
 #include "simulation.hpp"
+#include "capture.hpp"
+#include "rogowski.hpp"
+#include "sample_source.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <math.h>
 #include <thread>
 #include <vector>
 
-/** @brief parameters passed to the driver thread*/
-typedef struct DriverParams
+/** @brief state of the 90 degree phase shifter for one phase*/
+typedef struct PhaseShift90State
 {
-  std::unique_ptr<std::vector<int32_t>> p_current_samples; /**< Pointer to the current samples */
-  std::unique_ptr<std::vector<int32_t>> p_voltage_samples; /**< Pointer to the coltage samples */
-  std::atomic<bool> stop_driver_thread;    /**< Pointer to the variable for stopping/cancelling the driver thread*/
-  std::atomic<bool> driver_thread_running; /**< Pointer to the variable for indicating the driver thread is running*/
-  std::unique_ptr<LMA_Phase> p_phase;      /**< Pointer to the phase to work on*/
-  std::unique_ptr<LMA_Neutral> p_neutral;  /**< Pointer to the neautral to work on*/
-  double fs;                               /**< sampling frequency*/
-} DriverParams;
+  spl_t voltage_buffer[32]; /**< delay line of voltage samples*/
+  uint8_t buffer_index;     /**< index of the newest sample*/
+} PhaseShift90State;
 
-// Sine wave generator
-static std::pair<std::unique_ptr<std::vector<int32_t>>, std::unique_ptr<std::vector<double>>>
-GenerateSineWaveADC(size_t numSamples, double frequency, double phaseShift, double rmsValue, double gain, double divRatio,
-                    double sampleRate)
+/** @brief state of the virtual clock driving the LMA callbacks*/
+typedef struct DriverParams
 {
-  auto res_adc = std::make_unique<std::vector<int32_t>>();
-  auto res = std::make_unique<std::vector<double>>();
-
-  if (sampleRate <= 0.0 || numSamples == 0 || divRatio == 0.0)
-  {
-    std::cerr << "\n\rInvalid waveform, potential memory issue, check args and try reducing samples\n\r";
-  }
+  std::unique_ptr<SampleSource> p_source;               /**< Source of the ADC frames*/
+  const spl_t *p_block;                                 /**< Current block of frames*/
+  size_t block_frames;                                  /**< number of frames in the current block*/
+  size_t block_index;                                   /**< index of the next frame in the current block*/
+  size_t frame_size;                                    /**< samples per frame*/
+  bool has_v90;                                         /**< frames carry the 90 degree shifted voltage*/
+  bool has_neutral;                                     /**< frames carry the neutral current*/
+  bool has_didt;                                        /**< frames carry Rogowski coil outputs as the phase currents*/
+  size_t sample_count;                                  /**< number of samples to feed the ADC*/
+  std::unique_ptr<PlotDecimator<int32_t>> p_v_adc_plot; /**< Decimator for the plotted voltage signal (ADC)*/
+  std::unique_ptr<PlotDecimator<int32_t>> p_i_adc_plot; /**< Decimator for the plotted current signal (ADC)*/
+  std::unique_ptr<CaptureWriter> p_recorder;            /**< Records the consumed frames (if requested)*/
+  SimulationResults *p_results;                         /**< Results to store the plotted signals in*/
+  std::vector<LMA_Phase> phases;                        /**< Phases to work on*/
+  std::vector<PhaseShift90State> shifters;              /**< 90 degree phase shifters, one per phase*/
+  std::vector<RogowskiFrontEnd> rogowskis;              /**< Rogowski integrators, one per phase (if has_didt)*/
+  std::unique_ptr<LMA_Neutral> p_neutral;               /**< Pointer to the neautral to work on*/
+  std::unique_ptr<LMA_ComputedNeutral> p_computed;      /**< Computed neutral (vector sum of the phase currents)*/
+  std::unique_ptr<LMA_SystemMeasurements> p_system;     /**< Symmetrical components (three phase scenarios)*/
+  std::vector<LMA_Register> registers;                  /**< Energy registers, SIM_PHASE_REGISTERS per phase*/
+  std::unique_ptr<LMA_Tariff> p_tariff;                 /**< Time of use tariff (if a schedule is given)*/
+  std::vector<double> tariff_times;                     /**< virtual time of each tariff switch*/
+  uint8_t tariff_active;                                /**< tariff active at the last RTC callback*/
+  std::vector<LMA_Demand> demands;                      /**< Demand registers, SIM_DEMANDS on the system*/
+  std::vector<SimulationDemand> demand_log;             /**< every demand interval ended*/
+  std::vector<uint32_t> demand_times;                   /**< end of the last interval of each demand register*/
+  std::unique_ptr<ProfileStorage> p_profile_storage;    /**< Emulated flash region of the load profile (if recorded)*/
+  std::unique_ptr<LMA_Profile> p_profile;               /**< Load profile recorder (if recorded)*/
+  std::vector<LMA_HistorySlot> history_slots;           /**< Slots of every history level in turn*/
+  std::vector<LMA_HistoryLevel> history_levels;         /**< History levels, SIM_HISTORY_LEVELS (if kept)*/
+  std::unique_ptr<LMA_History> p_history;               /**< Measurement history of the first phase (if kept)*/
+  std::vector<LMA_PhaseInputs> capture_buffers;         /**< Buffers of the waveform capture, one per event held*/
+  std::vector<LMA_CaptureEvent> capture_events;         /**< Events of the waveform capture*/
+  std::unique_ptr<LMA_Capture> p_capture;               /**< Waveform capture (if captured)*/
+  std::string waveform_path;                            /**< prefix of the capture file of each waveform (empty = none)*/
+  std::vector<SimulationWaveform> waveforms;            /**< every waveform capture event read*/
+  std::vector<LMA_Event> event_ring;                    /**< Ring of the status event log*/
+  std::vector<LMA_EventTrack> event_tracks;             /**< Status events in progress of each phase*/
+  std::unique_ptr<LMA_EventLog> p_event_log;            /**< Status event log (if logged)*/
+  std::vector<LMA_Event> events;                        /**< every status event read*/
+  std::vector<double> event_times;                      /**< simulated time each status event was read at*/
+  uint32_t event_callbacks;                             /**< status events passed to the log callback*/
+  std::vector<LMA_PhaseCalibArgs> calib_args;           /**< Phases of the asynchronous calibration and their targets*/
+  std::vector<LMA_CalibState> calib_states;             /**< State of each phase of the asynchronous calibration*/
+  std::unique_ptr<LMA_CalibJob> p_calib_job;            /**< Asynchronous calibration (if requested)*/
+  std::vector<double> calib_done_times;                 /**< virtual time each phase of it was done (0 = not done)*/
+  uint32_t calib_callbacks;                             /**< asynchronous calibration callbacks*/
+  double fs;                                            /**< sampling frequency*/
+  bool realtime;                                        /**< pace the virtual clock to the wall clock*/
+  double tmr_period;                                    /**< TMR period in ticks (10ms)*/
+  double rtc_period;                                    /**< RTC period in ticks (1s)*/
+  double tmr_elapsed;                                   /**< ticks elapsed since the last TMR callback*/
+  double rtc_elapsed;                                   /**< ticks elapsed since the last RTC callback*/
+  uint64_t tick;                                        /**< virtual clock - number of ADC periods elapsed*/
+  size_t sample;                                        /**< index of the next sample to feed the ADC*/
+  std::chrono::steady_clock::time_point clock_start;    /**< wall clock time the virtual clock started*/
+  std::vector<LMA_Measurements> measurements;           /**< measurements of the first phase collected from the TMR*/
+  std::vector<double> measurement_times;                /**< virtual time each of the measurements was collected at*/
+  std::vector<LMA_Measurements> last_measurements;      /**< latest measurements of every phase*/
+  benchmark_t *p_benchmark;                             /**< accounts the time spent in each callback (nullptr = off)*/
+  bool callback_thread;                                 /**< callbacks on a thread - the foreground waits on the first phase*/
+  std::atomic<uint32_t> tmr_begun;                      /**< TMR callbacks started (read by a waiting foreground)*/
+  std::atomic<uint32_t> tmr_ended;                      /**< TMR callbacks returned (read by a waiting foreground)*/
+} DriverParams;
 
-  const double amplitude = rmsValue * std::sqrt(2.0);
-  const double omega = 2.0 * 3.14159265358979323846 * frequency;
-  const double dt = 1.0 / sampleRate;
+/** @brief driver stepped by the LMA wait hook*/
+static DriverParams *p_active_driver = nullptr;
 
-  for (size_t i = 0; i < numSamples; ++i)
-  {
-    double time = i * dt;
-    double sample = amplitude * std::sin(omega * time + (phaseShift * 3.14159265358979323846 / 180.0));
-    res->push_back(sample);
-    res_adc->push_back(static_cast<int32_t>(std::round(sample * gain * divRatio * (1 << 23) / 0.5)));
-  }
+/** @brief Reads the host monotonic clock (ns) as the benchmark timer.*/
+static uint32_t Benchmark_timer_read(void)
+{
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
-  return std::make_pair<std::unique_ptr<std::vector<int32_t>>, std::unique_ptr<std::vector<double>>>(std::move(res_adc),
-                                                                                                     std::move(res));
+/** @brief Nanoseconds between two benchmark timer readings.*/
+static uint32_t Benchmark_timer_elapsed(uint32_t start, uint32_t end)
+{
+  return end - start;
 }
 
 /** @brief phase shifts voltage signal
@@ -56,14 +112,14 @@ GenerateSineWaveADC(size_t numSamples, double frequency, double phaseShift, doub
  * - to delay 5ms with a 3906Hz clock we can do 0.005/(1/3906) = 19.53 samples - so we do 20
  * samples.
  *
+ * @param[inout] p_state - phase shifter of the phase the voltage belongs to.
  * @param[in] new_voltage - new voltage to store in the buffer
  * @return voltage sample 90degree (20 samples) ago.
  */
-static spl_t PhaseShift90(spl_t new_voltage)
+static spl_t PhaseShift90(PhaseShift90State *const p_state, spl_t new_voltage)
 {
-  static spl_t voltage_buffer[32] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  static uint8_t buffer_index = 0;
+  spl_t *const voltage_buffer = p_state->voltage_buffer;
+  uint8_t buffer_index = p_state->buffer_index;
 
   uint8_t buffer_index_19 = buffer_index + 2;
   uint8_t buffer_index_20 = buffer_index + 1;
@@ -84,57 +140,287 @@ static spl_t PhaseShift90(spl_t new_voltage)
   /* Interpolate 19.53 samples - just take the mid point*/
   int32_t interpolated_value = ((voltage_buffer[buffer_index_19] * 60) >> 7) + ((voltage_buffer[buffer_index_20] * 68) >> 7);
 
-  buffer_index = buffer_index_20;
+  p_state->buffer_index = buffer_index_20;
 
   /* Convert back to its 32b value*/
   return interpolated_value;
 }
 
-static void Driver_thread(std::shared_ptr<DriverParams> drvr_params)
+/** @brief Reads the next block of frames from the source.
+ * @details Frames within the simulated duration are decimated for plotting (first phase) and recorded if requested. A
+ * finite source which runs out while LMA is still blocked is replayed from the start.
+ * @param[inout] drvr_params - driver state.
+ */
+static void Driver_next_block(DriverParams *const drvr_params)
 {
-  size_t sample = 0;
-  size_t rtc_counter = 0;
-  size_t tmr_counter = 0;
-  size_t sleep_counter = 0;
+  drvr_params->block_frames = drvr_params->p_source->Read(&(drvr_params->p_block), WAVEFORM_BLOCK_SIZE);
+  if (0 == drvr_params->block_frames)
+  {
+    /* Source ended early (e.g. a truncated capture) - finish the simulation where it ended*/
+    drvr_params->sample_count = std::min(drvr_params->sample_count, drvr_params->sample);
+    drvr_params->p_source->Rewind();
+    drvr_params->block_frames = drvr_params->p_source->Read(&(drvr_params->p_block), WAVEFORM_BLOCK_SIZE);
+  }
+  drvr_params->block_index = 0;
 
-  const uint32_t one_sec = static_cast<uint32_t>(drvr_params->fs);
-  const uint32_t ten_ms = one_sec / 10;
+  if (drvr_params->sample >= drvr_params->sample_count)
+  {
+    return;
+  }
 
-  drvr_params->driver_thread_running = true;
+  const size_t in_duration = std::min(drvr_params->block_frames, drvr_params->sample_count - drvr_params->sample);
+  const size_t i_offset = drvr_params->has_v90 ? 2 : 1;
+  SimulationResults *const p_results = drvr_params->p_results;
+
+  for (size_t i = 0; i < in_duration; ++i)
+  {
+    const spl_t *const p_frame = drvr_params->p_block + (i * drvr_params->frame_size);
+    drvr_params->p_v_adc_plot->Add(p_frame[0], p_results->raw_voltage_signal.get());
+    drvr_params->p_i_adc_plot->Add(p_frame[i_offset], p_results->raw_current_signal.get());
+  }
 
-  while (sample < drvr_params->p_voltage_samples->size() && !(drvr_params->stop_driver_thread))
+  if (nullptr != drvr_params->p_recorder)
   {
-    if (rtc_running && ++rtc_counter >= one_sec)
+    drvr_params->p_recorder->Write(drvr_params->p_block, in_duration);
+  }
+}
+
+/** @brief Reads a waveform capture event in place, as an application would, and writes it to a capture file.
+ * @param[inout] drvr_params - driver holding the capture.
+ * @param[in] p_event - event to read.
+ */
+static void Driver_waveform_read(DriverParams *const drvr_params, const LMA_CaptureEvent *const p_event)
+{
+  SimulationWaveform waveform;
+  const size_t phases = drvr_params->phases.size();
+
+  waveform.time = p_event->time;
+  waveform.read_time = static_cast<double>(drvr_params->tick) / drvr_params->fs;
+  waveform.status = p_event->status;
+  waveform.phase_number = p_event->phase_number;
+  waveform.trigger = p_event->trigger;
+  for (size_t part = 0; part < 2; ++part)
+  {
+    if (nullptr != p_event->p_frames[part])
+    {
+      waveform.frames.insert(waveform.frames.end(), p_event->p_frames[part],
+                             p_event->p_frames[part] + (p_event->count[part] * phases));
+    }
+  }
+
+  // The inputs of a phase are v, v90 and i - the frame layout of a capture with SAMPLE_CHANNEL_V90
+  if (!drvr_params->waveform_path.empty())
+  {
+    CaptureWriter writer;
+    const std::string path =
+        drvr_params->waveform_path + "-" + std::to_string(drvr_params->waveforms.size() + 1) + ".cap";
+
+    if (writer.Open(path.c_str(), phases, SAMPLE_CHANNEL_V90, drvr_params->fs) &&
+        writer.Write(&(waveform.frames.data()->v_sample), waveform.frames.size() / phases))
+    {
+      waveform.path = path;
+    }
+    writer.Close();
+  }
+
+  drvr_params->waveforms.push_back(std::move(waveform));
+}
+
+/** @brief Advances the virtual clock by one tick and runs the callbacks that are due.
+ * @details One tick of the virtual clock is one ADC period (1/fs). The TMR (10ms) and RTC (1s) callbacks are derived from the
+ * same tick count and the callbacks run on the same thread as LMA's foreground, so the interleaving of callbacks is fixed by
+ * the waveform and not by the host scheduler. Unless realtime pacing is requested the clock runs as fast as the CPU allows.
+ * Frames are taken a block at a time from the sample source, so the signal continues past sample_count if LMA is still
+ * blocked (e.g. calibrating a short waveform).
+ * @param[inout] drvr_params - driver state.
+ */
+static void Driver_step(DriverParams *const drvr_params)
+{
+  if (rtc_running && ++drvr_params->rtc_elapsed >= drvr_params->rtc_period)
+  {
+    drvr_params->rtc_elapsed -= drvr_params->rtc_period;
+    if (nullptr != drvr_params->p_benchmark)
+    {
+      Benchmark_work_begin(drvr_params->p_benchmark, BENCHMARK_RTC);
+      LMA_CB_RTC();
+      Benchmark_work_end(drvr_params->p_benchmark);
+    }
+    else
     {
-      rtc_counter = 0;
       LMA_CB_RTC();
     }
 
-    if (tmr_running && ++tmr_counter >= ten_ms)
+    /* Tariffs switch in the RTC context - note when*/
+    if ((nullptr != drvr_params->p_tariff) && (drvr_params->p_tariff->active != drvr_params->tariff_active))
     {
-      tmr_counter = 0;
+      drvr_params->tariff_active = drvr_params->p_tariff->active;
+      drvr_params->tariff_times.push_back(static_cast<double>(drvr_params->tick) / drvr_params->fs);
+    }
+
+    /* Demand intervals end in the RTC context - log each*/
+    for (size_t d = 0; d < drvr_params->demands.size(); ++d)
+    {
+      const LMA_DemandReading &reading = drvr_params->demands[d].reading;
+      if (reading.time != drvr_params->demand_times[d])
+      {
+        drvr_params->demand_times[d] = reading.time;
+        drvr_params->demand_log.push_back({d, reading.time, reading.demand});
+      }
+    }
+  }
+
+  if (tmr_running && ++drvr_params->tmr_elapsed >= drvr_params->tmr_period)
+  {
+    drvr_params->tmr_elapsed -= drvr_params->tmr_period;
+    ++drvr_params->tmr_begun;
+    if (nullptr != drvr_params->p_benchmark)
+    {
+      Benchmark_work_begin(drvr_params->p_benchmark, BENCHMARK_TMR);
       LMA_CB_TMR();
+      Benchmark_work_end(drvr_params->p_benchmark);
+      Benchmark_cb_period(drvr_params->p_benchmark);
     }
+    else
+    {
+      LMA_CB_TMR();
+    }
+    ++drvr_params->tmr_ended;
 
-    if (adc_running)
+    /* Collect results in the TMR context so no measurement window is missed - unless the foreground waits on the first phase*/
+    for (size_t p = drvr_params->callback_thread ? 1 : 0; p < drvr_params->phases.size(); ++p)
     {
-      drvr_params->p_phase->inputs.v_sample = static_cast<spl_t>((*drvr_params->p_voltage_samples)[sample]);
-      drvr_params->p_phase->inputs.v90_sample = PhaseShift90(drvr_params->p_phase->inputs.v_sample);
-      drvr_params->p_phase->inputs.i_sample = static_cast<spl_t>((*drvr_params->p_current_samples)[sample]);
-      drvr_params->p_neutral->inputs.i_sample = static_cast<spl_t>((*drvr_params->p_current_samples)[sample]);
+      if (LMA_MeasurementsReady(&(drvr_params->phases[p])))
+      {
+        LMA_MeasurementsGet(&(drvr_params->phases[p]), &(drvr_params->last_measurements[p]));
+        if (0 == p)
+        {
+          drvr_params->measurements.push_back(drvr_params->last_measurements[p]);
+          drvr_params->measurement_times.push_back(static_cast<double>(drvr_params->tick) / drvr_params->fs);
+        }
+        if (0 == p && nullptr != drvr_params->p_profile)
+        {
+          /* The load profile takes its snapshots as an application would - with each new set of measurements*/
+          LMA_SystemEnergy energy;
+          LMA_ConsumptionData consumption;
+          LMA_EnergyGet(&energy);
+          LMA_ConsumptionDataGet(&energy, &consumption);
+          LMA_ProfileUpdate(drvr_params->p_profile.get(), LMA_ClockGet(), &(drvr_params->last_measurements[p]), &consumption);
+        }
+        if (0 == p && nullptr != drvr_params->p_history)
+        {
+          LMA_HistoryUpdate(drvr_params->p_history.get(), LMA_ClockGet(), &(drvr_params->last_measurements[p]));
+        }
+      }
+    }
 
-      LMA_CB_ADC();
-      ++sample;
+    /* Status events - drained a few at a time as an application would*/
+    if (nullptr != drvr_params->p_event_log)
+    {
+      LMA_Event events[8];
+      for (uint32_t count = LMA_EventsRead(drvr_params->p_event_log.get(), events, 8); 0 != count;
+           count = LMA_EventsRead(drvr_params->p_event_log.get(), events, 8))
+      {
+        drvr_params->events.insert(drvr_params->events.end(), events, events + count);
+        drvr_params->event_times.insert(drvr_params->event_times.end(), count,
+                                        static_cast<double>(drvr_params->tick) / drvr_params->fs);
+      }
     }
 
-    if (++sleep_counter >= 78)
+    /* Waveform capture - each event is released once read so its buffer records again*/
+    if (nullptr != drvr_params->p_capture)
+    {
+      for (const LMA_CaptureEvent *p_event = LMA_CaptureGet(drvr_params->p_capture.get()); nullptr != p_event;
+           p_event = LMA_CaptureGet(drvr_params->p_capture.get()))
+      {
+        Driver_waveform_read(drvr_params, p_event);
+        LMA_CaptureRelease(drvr_params->p_capture.get());
+      }
+    }
+  }
+
+  if (adc_running)
+  {
+    if (drvr_params->block_index >= drvr_params->block_frames)
+    {
+      Driver_next_block(drvr_params);
+    }
+
+    /* Frames are read in place from the source - v, (v90), i per phase then (neutral)*/
+    const spl_t *p_frame = drvr_params->p_block + (drvr_params->block_index++ * drvr_params->frame_size);
+    for (size_t p = 0; p < drvr_params->phases.size(); ++p)
+    {
+      LMA_Phase *const p_phase = &(drvr_params->phases[p]);
+      p_phase->inputs.v_sample = *p_frame++;
+      p_phase->inputs.v90_sample =
+          drvr_params->has_v90 ? *p_frame++ : PhaseShift90(&(drvr_params->shifters[p]), p_phase->inputs.v_sample);
+      p_phase->inputs.i_sample = drvr_params->has_didt ? drvr_params->rogowskis[p].Process(*p_frame) : *p_frame;
+      ++p_frame;
+    }
+
+    if (drvr_params->has_neutral)
+    {
+      drvr_params->p_neutral->inputs.i_sample = *p_frame;
+    }
+    ++drvr_params->sample;
+
+    if (nullptr != drvr_params->p_benchmark)
+    {
+      Benchmark_work_begin(drvr_params->p_benchmark, BENCHMARK_ADC);
+      LMA_CB_ADC();
+      Benchmark_work_end(drvr_params->p_benchmark);
+    }
+    else
     {
-      sleep_counter = 0;
-      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      LMA_CB_ADC();
     }
   }
 
-  drvr_params->driver_thread_running = false;
+  ++drvr_params->tick;
+
+  if (drvr_params->realtime && (0 == (drvr_params->tick % (static_cast<uint64_t>(drvr_params->tmr_period) + 1))))
+  {
+    const auto virtual_time = std::chrono::duration<double>(static_cast<double>(drvr_params->tick) / drvr_params->fs);
+    std::this_thread::sleep_until(drvr_params->clock_start +
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(virtual_time));
+  }
+}
+
+/** @brief Status event log callback - counts the events passed as they are logged.
+ * @param[in] p_event - event logged.
+ */
+static void Driver_event_callback(const LMA_Event *p_event)
+{
+  (void)p_event;
+  ++p_active_driver->event_callbacks;
+}
+
+/** @brief Asynchronous calibration callback - times each phase as it is done.
+ * @param[in] p_job - calibration job.
+ * @param[in] index - phase of the job which moved on.
+ */
+static void Driver_calib_callback(const LMA_CalibJob *p_job, uint32_t index)
+{
+  ++p_active_driver->calib_callbacks;
+  if (LMA_CALIB_DONE == p_job->p_states[index])
+  {
+    p_active_driver->calib_done_times[index] = static_cast<double>(p_active_driver->tick) / p_active_driver->fs;
+  }
+}
+
+/** @brief Wait hook installed in the port - steps the virtual clock while LMA is blocked.*/
+static void Driver_wait_hook(void)
+{
+  Driver_step(p_active_driver);
+}
+
+/** @brief Number of samples to simulate.
+ * @param[in] sim_params - simulation parameters.
+ * @param[in] fs - sampling frequency of the sample source.
+ * @return duration converted to samples if given, otherwise the sample count.
+ */
+static size_t Sample_count(const SimulationParams *sim_params, double fs)
+{
+  return (0.0 != sim_params->duration) ? static_cast<size_t>(sim_params->duration * fs) : sim_params->sample_count;
 }
 
 std::shared_ptr<SimulationResults> Simulation(const SimulationParams *sim_params)
@@ -142,33 +428,96 @@ std::shared_ptr<SimulationResults> Simulation(const SimulationParams *sim_params
   auto results = std::make_shared<SimulationResults>();
   auto drv_params = std::make_shared<DriverParams>();
 
+  results->raw_voltage_signal = std::make_unique<std::vector<int32_t>>();
+  results->raw_current_signal = std::make_unique<std::vector<int32_t>>();
   results->voltage_signal = std::make_unique<std::vector<double>>();
   results->current_signal = std::make_unique<std::vector<double>>();
 
-  // Construct waveforms
-  auto v_pair =
-      GenerateSineWaveADC(sim_params->sample_count, sim_params->fline, 0.0, sim_params->vrms, 1, 0.0012623, sim_params->fs);
-  drv_params->p_voltage_samples = std::move(v_pair.first);
-  results->voltage_signal = std::move(v_pair.second);
-
-  if (sim_params->rogowski)
+  // Construct the sample source - a capture replayed in place, or waveforms generated a block at a time
+  if (!sim_params->capture_path.empty())
   {
-    // TODO: Handle rogowski processing
+    drv_params->p_source = CaptureSourceOpen(sim_params->capture_path.c_str());
+    if (nullptr == drv_params->p_source)
+    {
+      return results;
+    }
+  }
+  else if (nullptr != sim_params->p_scenario)
+  {
+    drv_params->p_source =
+        std::make_unique<ScenarioSource>(*(sim_params->p_scenario), sim_params->fs, sim_params->fline, sim_params->v90);
   }
   else
   {
-    auto i_pair = GenerateSineWaveADC(sim_params->sample_count, sim_params->fline, sim_params->ps, sim_params->irms, 8, 0.0004,
-                                      sim_params->fs);
-    drv_params->p_current_samples = std::move(i_pair.first);
-    results->current_signal = std::move(i_pair.second);
+    drv_params->p_source =
+        std::make_unique<WaveformSource>(sim_params->fs, sim_params->fline, sim_params->vrms, sim_params->irms, sim_params->ps,
+                                         Sample_count(sim_params, sim_params->fs), results->voltage_signal.get(),
+                                         results->current_signal.get(), sim_params->v90, sim_params->rogowski);
   }
-  drv_params->fs = sim_params->fs;
+
+  const double fs = drv_params->p_source->Fs();
+  const size_t phase_count = drv_params->p_source->Phases();
+
+  drv_params->sample_count = Sample_count(sim_params, fs);
+  if (0 != drv_params->p_source->Frames() && drv_params->p_source->Frames() < drv_params->sample_count)
+  {
+    drv_params->sample_count = static_cast<size_t>(drv_params->p_source->Frames());
+  }
+
+  drv_params->frame_size = drv_params->p_source->FrameSize();
+  drv_params->has_v90 = (0 != (drv_params->p_source->Channels() & SAMPLE_CHANNEL_V90));
+  drv_params->has_neutral = (0 != (drv_params->p_source->Channels() & SAMPLE_CHANNEL_NEUTRAL));
+  drv_params->has_didt = (0 != (drv_params->p_source->Channels() & SAMPLE_CHANNEL_DIDT));
+  drv_params->p_block = nullptr;
+  drv_params->block_frames = 0;
+  drv_params->block_index = 0;
+
+  // Only a bounded number of points are kept for plotting
+  drv_params->p_v_adc_plot = std::make_unique<PlotDecimator<int32_t>>(drv_params->sample_count, WAVEFORM_PLOT_POINTS);
+  drv_params->p_i_adc_plot = std::make_unique<PlotDecimator<int32_t>>(drv_params->sample_count, WAVEFORM_PLOT_POINTS);
+  drv_params->p_results = results.get();
+
+  if (!sim_params->record_path.empty())
+  {
+    drv_params->p_recorder = std::make_unique<CaptureWriter>();
+    if (!drv_params->p_recorder->Open(sim_params->record_path.c_str(), phase_count, drv_params->p_source->Channels(), fs,
+                                      sim_params->record_compressed))
+    {
+      std::cerr << "Unable to create capture: " << sim_params->record_path << "\n";
+      drv_params->p_recorder.reset();
+    }
+  }
+
+  drv_params->fs = fs;
+  drv_params->realtime = sim_params->realtime;
+  drv_params->callback_thread = false;
+  drv_params->tmr_begun = 0;
+  drv_params->tmr_ended = 0;
+  drv_params->p_benchmark = nullptr;
+  if (sim_params->benchmark)
+  {
+    // Periods of 50 TMR ticks (500ms of simulated time) as on the boards
+    const benchmark_timer_t timer = {&Benchmark_timer_read, &Benchmark_timer_elapsed};
+    Benchmark_init(&(results->benchmark), &timer, 50);
+    drv_params->p_benchmark = &(results->benchmark);
+  }
+  drv_params->tmr_period = fs / 100.0;
+  drv_params->rtc_period = fs;
+  drv_params->tmr_elapsed = 0.0;
+  drv_params->rtc_elapsed = 0.0;
+  drv_params->tick = 0;
+  drv_params->sample = 0;
 
   // Config
   auto p_config = std::make_unique<LMA_Config>();
-  p_config->gcalib.fs = sim_params->fs;
+  p_config->gcalib.fs = fs;
   p_config->gcalib.deg_per_sample = 4.608f;
   p_config->update_interval = 25;
+  p_config->update_interval_min = sim_params->window_min;
+  p_config->transient_threshold = 0.1f;
+  p_config->adc_bits = 24;
+  p_config->coherent_windows = sim_params->coherent;
+  p_config->rtc_rate = 1;
   p_config->fline_tol_low = sim_params->fline - (sim_params->fline / 2);
   p_config->fline_tol_high = sim_params->fline + (sim_params->fline / 2);
   p_config->meter_constant = 4500.0f;
@@ -176,6 +525,9 @@ std::shared_ptr<SimulationResults> Simulation(const SimulationParams *sim_params
   p_config->no_load_p = 2.0f;
   p_config->v_sag = sim_params->vrms * 0.25;
   p_config->v_swell = sim_params->vrms * 1.25;
+  p_config->i_over = sim_params->irms * 1.5;
+  p_config->residual_i = sim_params->residual_i;
+  p_config->neutral_mismatch = 0.1f;
 
   // PhaseCalibration
   auto p_default_phase_calib = std::make_unique<LMA_PhaseCalibration>();
@@ -190,37 +542,176 @@ std::shared_ptr<SimulationResults> Simulation(const SimulationParams *sim_params
 
   // SystemEnergy
   auto p_system_energy = std::make_unique<LMA_SystemEnergy>();
-  p_system_energy->impulse.led_on_count = 0.01 / (1.0 / sim_params->fs); // 10ms
+  p_system_energy->impulse.led_on_count = 0.01 / (1.0 / fs); // 10ms
   p_system_energy->impulse.active_counter = 0;
   p_system_energy->impulse.reactive_counter = 0;
   p_system_energy->impulse.active_on = false;
   p_system_energy->impulse.reactive_on = false;
 
-  drv_params->p_phase = std::make_unique<LMA_Phase>();
+  drv_params->phases.resize(phase_count);
+  drv_params->shifters.resize(phase_count);
+  if (drv_params->has_didt)
+  {
+    // Integrate the coils back to currents - compensated at the line frequency as a calibrated board would be
+    drv_params->rogowskis.assign(phase_count, RogowskiFrontEnd(fs, sim_params->fline));
+  }
+  drv_params->last_measurements.resize(phase_count);
   drv_params->p_neutral = std::make_unique<LMA_Neutral>();
+  drv_params->p_computed = std::make_unique<LMA_ComputedNeutral>();
+  drv_params->p_system = std::make_unique<LMA_SystemMeasurements>();
 
   LMA_Init(p_config.get());
   LMA_EnergySet(p_system_energy.get());
-  LMA_PhaseRegister(drv_params->p_phase.get());
-  LMA_NeutralRegister(drv_params->p_phase.get(), drv_params->p_neutral.get());
-  LMA_PhaseLoadCalibration(drv_params->p_phase.get(), p_default_phase_calib.get());
-  LMA_NeutralLoadCalibration(drv_params->p_neutral.get(), p_default_neutral_calib.get());
+  for (auto &phase : drv_params->phases)
+  {
+    LMA_PhaseRegister(&phase);
+    LMA_PhaseLoadCalibration(&phase, p_default_phase_calib.get());
+  }
+
+  // The MACL model accumulates no neutral, so leave it unregistered rather than read zero
+  if (drv_params->has_neutral && (0 == LMA_PORT_MACL))
+  {
+    LMA_NeutralRegister(&(drv_params->phases[0]), drv_params->p_neutral.get());
+    LMA_NeutralLoadCalibration(drv_params->p_neutral.get(), p_default_neutral_calib.get());
+  }
+  if (sim_params->computed_neutral)
+  {
+    LMA_ComputedNeutralRegister(drv_params->p_computed.get());
+  }
+  if (sim_params->system_measurements)
+  {
+    LMA_SystemMeasurementsRegister(drv_params->p_system.get());
+  }
+
+  // Per phase energy registers - active and reactive, import and export
+  for (auto &phase : drv_params->phases)
+  {
+    static const LMA_RegisterQuantity quantities[SIM_PHASE_REGISTERS] = {LMA_REGISTER_ACT_IMP, LMA_REGISTER_ACT_EXP,
+                                                                         LMA_REGISTER_REACT_IMP, LMA_REGISTER_REACT_EXP};
+    for (LMA_RegisterQuantity quantity : quantities)
+    {
+      LMA_Register energy_register{};
+      energy_register.p_phase = &phase;
+      energy_register.quantity = quantity;
+      energy_register.meter_constant = p_config->meter_constant;
+      drv_params->registers.push_back(energy_register);
+    }
+  }
+  LMA_RegistersSet(drv_params->registers.data(), static_cast<uint32_t>(drv_params->registers.size()));
+
+  // Time of use - the system active import on each tariff of the schedule
+  LMA_ClockSet(sim_params->clock_start);
+  if (nullptr != sim_params->p_tariff)
+  {
+    drv_params->p_tariff = std::make_unique<LMA_Tariff>();
+    drv_params->p_tariff->p_schedule = sim_params->p_tariff;
+    for (LMA_Register &tariff_register : drv_params->p_tariff->registers)
+    {
+      tariff_register.p_phase = nullptr;
+      tariff_register.quantity = LMA_REGISTER_ACT_IMP;
+      tariff_register.meter_constant = p_config->meter_constant;
+    }
+    LMA_TariffSet(drv_params->p_tariff.get());
+    drv_params->tariff_active = drv_params->p_tariff->active;
+  }
 
-  drv_params->driver_thread_running = false;
-  drv_params->stop_driver_thread = false;
-  std::thread driver_thread = std::thread(Driver_thread, drv_params);
+  // Demand - the system active import over 15 minute blocks and sliding by the minute, the apparent over 30 minute blocks
+  drv_params->demands.resize(SIM_DEMANDS);
+  drv_params->demand_times.assign(SIM_DEMANDS, 0);
+  for (LMA_Demand &demand : drv_params->demands)
+  {
+    demand.p_phase = nullptr;
+  }
+  drv_params->demands[0].quantity = LMA_REGISTER_ACT_IMP;
+  drv_params->demands[0].subinterval = 900;
+  drv_params->demands[0].subintervals = 1;
+  drv_params->demands[1].quantity = LMA_REGISTER_ACT_IMP;
+  drv_params->demands[1].subinterval = 60;
+  drv_params->demands[1].subintervals = 15;
+  drv_params->demands[2].quantity = LMA_REGISTER_APP_IMP;
+  drv_params->demands[2].subinterval = 1800;
+  drv_params->demands[2].subintervals = 1;
+  LMA_DemandsSet(drv_params->demands.data(), static_cast<uint32_t>(drv_params->demands.size()));
+
+  // Load profile - recorded from the first phase and the system energy into an emulated data flash region
+  if (0 != sim_params->profile_interval && !sim_params->profile_path.empty())
+  {
+    drv_params->p_profile_storage = std::make_unique<ProfileStorage>();
+    drv_params->p_profile = std::make_unique<LMA_Profile>();
+    if (!drv_params->p_profile_storage->Open(sim_params->profile_path.c_str(), SIM_PROFILE_SECTOR_SIZE,
+                                             sim_params->profile_sectors) ||
+        !LMA_ProfileInit(drv_params->p_profile.get(), drv_params->p_profile_storage->Storage(), sim_params->profile_interval))
+    {
+      std::cerr << "Could not record a load profile to " << sim_params->profile_path << "\n";
+      drv_params->p_profile.reset();
+      drv_params->p_profile_storage.reset();
+    }
+  }
 
-  // Wait until the driver thread is running
-  while (!drv_params->driver_thread_running)
+  // Measurement history - the slots of every level are held in one block as an application would place them
+  if (sim_params->history)
   {
+    static const uint32_t levels[SIM_HISTORY_LEVELS][2] = {{1U, 3600U}, {60U, 1440U}, {3600U, 720U}};
+    size_t offset = 0;
+
+    drv_params->history_slots.resize(levels[0][1] + levels[1][1] + levels[2][1]);
+    drv_params->history_levels.resize(SIM_HISTORY_LEVELS);
+    for (size_t l = 0; l < SIM_HISTORY_LEVELS; ++l)
+    {
+      drv_params->history_levels[l].period = levels[l][0];
+      drv_params->history_levels[l].slots = levels[l][1];
+      drv_params->history_levels[l].p_slots = &(drv_params->history_slots[offset]);
+      offset += levels[l][1];
+    }
+    drv_params->p_history = std::make_unique<LMA_History>();
+    LMA_HistoryInit(drv_params->p_history.get(), drv_params->history_levels.data(), SIM_HISTORY_LEVELS);
   }
 
+  // Waveform capture - sags, swells and overcurrents of any phase freeze SIM_CAPTURE_CYCLES around them
+  if (0 != sim_params->waveform_events)
+  {
+    const double cycle_frames = fs / sim_params->fline;
+
+    drv_params->p_capture = std::make_unique<LMA_Capture>();
+    drv_params->p_capture->frames = static_cast<uint32_t>(std::lround(SIM_CAPTURE_CYCLES * cycle_frames));
+    drv_params->p_capture->post_frames = static_cast<uint32_t>(std::lround(SIM_CAPTURE_POST_CYCLES * cycle_frames));
+    drv_params->p_capture->event_count = sim_params->waveform_events;
+    drv_params->p_capture->trigger_mask = LMA_VOLTAGE_SAG | LMA_VOLTAGE_SWELL | LMA_OVERCURRENT;
+    drv_params->capture_buffers.resize(static_cast<size_t>(drv_params->p_capture->frames) * sim_params->waveform_events *
+                                       drv_params->phases.size());
+    drv_params->capture_events.resize(sim_params->waveform_events);
+    drv_params->p_capture->p_buffers = drv_params->capture_buffers.data();
+    drv_params->p_capture->p_events = drv_params->capture_events.data();
+    drv_params->waveform_path = sim_params->waveform_path;
+    LMA_CaptureSet(drv_params->p_capture.get());
+  }
+
+  // Status event log - every status bit of every phase
+  drv_params->event_callbacks = 0;
+  if (sim_params->events)
+  {
+    drv_params->event_ring.resize(SIM_EVENT_LOG_SIZE);
+    drv_params->event_tracks.resize(drv_params->phases.size());
+    drv_params->p_event_log = std::make_unique<LMA_EventLog>();
+    drv_params->p_event_log->p_events = drv_params->event_ring.data();
+    drv_params->p_event_log->size = SIM_EVENT_LOG_SIZE;
+    drv_params->p_event_log->event_mask = (1U << LMA_EVENT_STATUS_BITS) - 1U;
+    drv_params->p_event_log->p_callback = Driver_event_callback;
+    drv_params->p_event_log->p_tracks = drv_params->event_tracks.data();
+    LMA_EventLogSet(drv_params->p_event_log.get());
+  }
+
+  // Drive the callbacks from this thread whenever LMA blocks
+  p_active_driver = drv_params.get();
+  p_wait_hook = Driver_wait_hook;
+  drv_params->clock_start = std::chrono::steady_clock::now();
+
   LMA_Start();
 
   LMA_PhaseCalibArgs ca;
   LMA_GlobalCalibArgs gca;
 
-  ca.p_phase = drv_params->p_phase.get();
+  ca.p_phase = &(drv_params->phases[0]);
   ca.vrms_tgt = static_cast<float>(sim_params->vrms);
   ca.irms_tgt = static_cast<float>(sim_params->irms);
   ca.line_cycles = 25;
@@ -240,84 +731,264 @@ std::shared_ptr<SimulationResults> Simulation(const SimulationParams *sim_params
     LMA_GlobalCalibrate(&gca);
     std::cout << "Finished!" << std::endl;
 
-    std::cout << std::fixed << std::setprecision(4) << "\t\tVrms Coefficient:     " << drv_params->p_phase->calib.vrms_coeff
+    std::cout << std::fixed << std::setprecision(4) << "\t\tVrms Coefficient:     " << drv_params->phases[0].calib.vrms_coeff
               << "\n"
-              << "\t\tIrms Coefficient:     " << drv_params->p_phase->calib.irms_coeff << "\n"
+              << "\t\tIrms Coefficient:     " << drv_params->phases[0].calib.irms_coeff << "\n"
               << "\t\tIrms Neutral Coefficient:     " << drv_params->p_neutral->calib.irms_coeff << "\n"
-              << "\t\tPower Coefficient:    " << drv_params->p_phase->calib.p_coeff << "\n"
-              << "\t\tPhase Correction:     " << drv_params->p_phase->calib.vi_phase_correction << "\n"
+              << "\t\tPower Coefficient:    " << drv_params->phases[0].calib.p_coeff << "\n"
+              << "\t\tPhase Correction:     " << drv_params->phases[0].calib.vi_phase_correction << "\n"
               << "\t\tSampling Frequency:   " << p_config->gcalib.fs << "\n"
               << "\t\tDegrees Per Sample:   " << p_config->gcalib.deg_per_sample << "\n"
               << std::endl;
   }
 
-  std::cout << "\tLive Measurement Output...\n" << std::endl;
+  // Asynchronous calibration - the phases calibrate together while the others keep metering
+  drv_params->calib_callbacks = 0;
+  results->calib_start_time = static_cast<double>(drv_params->tick) / drv_params->fs;
+  for (size_t i = 0; i < drv_params->phases.size(); ++i)
+  {
+    if (0 != (sim_params->calibrate_async & (1U << i)))
+    {
+      LMA_PhaseCalibArgs args = ca;
+      args.p_phase = &(drv_params->phases[i]);
+      if ((nullptr != sim_params->p_scenario) && (i < sim_params->p_scenario->phases.size()))
+      {
+        // Target the supply generated - delta elements measure the line to line voltage
+        const bool delta = (SCENARIO_DELTA == sim_params->p_scenario->type);
+        args.vrms_tgt = static_cast<float>(sim_params->p_scenario->phases[i].vrms * (delta ? sqrt(3.0) : 1.0));
+        args.irms_tgt = static_cast<float>(sim_params->p_scenario->phases[i].irms);
+      }
+      drv_params->calib_args.push_back(args);
+    }
+  }
+  if (!drv_params->calib_args.empty())
+  {
+    drv_params->calib_states.resize(drv_params->calib_args.size());
+    drv_params->calib_done_times.assign(drv_params->calib_args.size(), 0.0);
+    drv_params->p_calib_job = std::make_unique<LMA_CalibJob>();
+    drv_params->p_calib_job->p_args = drv_params->calib_args.data();
+    drv_params->p_calib_job->p_states = drv_params->calib_states.data();
+    drv_params->p_calib_job->count = static_cast<uint32_t>(drv_params->calib_args.size());
+    drv_params->p_calib_job->p_callback = Driver_calib_callback;
+    std::cout << "\tCalibrating " << drv_params->calib_args.size() << " Phase(s) While Metering..."
+              << (LMA_PhaseCalibrateStart(drv_params->p_calib_job.get()) ? "Started!" : "Failed!") << std::endl;
+  }
+
+  if (!sim_params->quiet)
+  {
+    std::cout << "\tLive Measurement Output...\n" << std::endl;
+  }
+
+  if (nullptr != drv_params->p_benchmark)
+  {
+    Benchmark_start(drv_params->p_benchmark, 0);
+  }
 
   int str_len = 0;
+  size_t measurements_shown = 0;
+  auto last_output = std::chrono::steady_clock::now();
 
-  while (drv_params->driver_thread_running)
+  // Callbacks on a thread of their own - the port blocks LMA_MeasurementsWait on its condition variable. They run until the
+  // foreground is done waiting, so no wait is left without the TMR calls it times out on.
+  if (0 != sim_params->wait_timeout)
   {
-    /* Update simulation state from calling thread*/
-    drv_params->stop_driver_thread.store(sim_params->stop_simulation.load());
+    const uint32_t tmr_end = static_cast<uint32_t>(static_cast<double>(drv_params->sample_count) / drv_params->tmr_period);
+    std::atomic<bool> waiting(true);
+
+    drv_params->callback_thread = true;
+    p_wait_hook = nullptr;
+    std::thread callbacks([&]() {
+      while (waiting)
+      {
+        Driver_step(drv_params.get());
+      }
+    });
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Wait on the first phase as an application would - each wait is counted from the TMR calls ended before it to those
+    // begun after it, never fewer than LMA counted
+    while ((drv_params->tmr_ended < tmr_end) && !(sim_params->stop_simulation))
+    {
+      const uint32_t start = drv_params->tmr_ended;
+      const bool ready = LMA_MeasurementsWait(&(drv_params->phases[0]), sim_params->wait_timeout);
+      const uint32_t calls = drv_params->tmr_begun - start;
+
+      if (ready)
+      {
+        LMA_Measurements measurements;
+        LMA_MeasurementsGet(&(drv_params->phases[0]), &measurements);
+        drv_params->measurements.push_back(measurements);
+        drv_params->measurement_times.push_back(static_cast<double>(drv_params->tmr_ended) / 100.0);
+        results->wait_ready_tmr.push_back(calls);
+      }
+      else
+      {
+        results->wait_timeout_tmr.push_back(calls);
+      }
+    }
+
+    waiting = false;
+    callbacks.join();
+  }
+
+  while (drv_params->sample < drv_params->sample_count && !(sim_params->stop_simulation))
+  {
+    Driver_step(drv_params.get());
+
+    if (sim_params->quiet || (0 != (drv_params->tick % 4096)) || drv_params->measurements.size() == measurements_shown ||
+        (std::chrono::steady_clock::now() - last_output) < std::chrono::milliseconds(500))
+    {
+      continue;
+    }
 
     LMA_Measurements measurements;
     LMA_ConsumptionData energy;
 
-    if (LMA_MeasurementsReady(drv_params->p_phase.get()))
-    {
-      LMA_MeasurementsGet(drv_params->p_phase.get(), &measurements);
-      LMA_EnergyGet(p_system_energy.get());
-      LMA_ConsumptionDataGet(p_system_energy.get(), &energy);
+    measurements_shown = drv_params->measurements.size();
+    measurements = drv_params->measurements.back();
+    last_output = std::chrono::steady_clock::now();
+    LMA_EnergyGet(p_system_energy.get());
+    LMA_ConsumptionDataGet(p_system_energy.get(), &energy);
 
-      if (str_len != 0)
+    if (str_len != 0)
+    {
+      for (int i = 0; i < 15; ++i)
       {
-        for (int i = 0; i < 15; ++i)
-        {
-          std::cout << "\033[2K\033[1F";
-        }
+        std::cout << "\033[2K\033[1F";
       }
-
-      std::cout << std::fixed << std::setprecision(4) << "\t\tVrms:    " << measurements.vrms << " [V]\n"
-                << "\t\tIrms:    " << measurements.irms << " [A]\n"
-                << "\t\tIrms Neutral:    " << measurements.irms_neutral << " [A]\n"
-                << "\t\tFline:   " << measurements.fline << " [Hz]\n"
-                << "\t\tP:       " << measurements.p << " [W]\n"
-                << "\t\tQ:       " << measurements.q << " [VAR]\n"
-                << "\t\tS:       " << measurements.s << " [VA]\n"
-                << "\t\tAct Imp: " << energy.act_imp_energy_wh << " [Wh]\n"
-                << "\t\tAct Exp: " << energy.act_exp_energy_wh << " [Wh]\n"
-                << "\t\tApp Imp: " << energy.app_imp_energy_wh << " [Wh]\n"
-                << "\t\tApp Exp: " << energy.app_exp_energy_wh << " [Wh]\n"
-                << "\t\tC Imp:   " << energy.c_imp_energy_wh << " [Wh]\n"
-                << "\t\tC Exp:   " << energy.c_exp_energy_wh << " [Wh]\n"
-                << "\t\tL Imp:   " << energy.l_imp_energy_wh << " [Wh]\n"
-                << "\t\tL Exp:   " << energy.l_exp_energy_wh << " [Wh]\n"
-                << std::flush;
-
-      results->measurements.push_back(measurements);
-
-      str_len = 1;
     }
+
+    std::cout << std::fixed << std::setprecision(4) << "\t\tVrms:    " << measurements.vrms << " [V]\n"
+              << "\t\tIrms:    " << measurements.irms << " [A]\n"
+              << "\t\tIrms Neutral:    " << measurements.irms_neutral << " [A]\n"
+              << "\t\tFline:   " << measurements.fline << " [Hz]\n"
+              << "\t\tP:       " << measurements.p << " [W]\n"
+              << "\t\tQ:       " << measurements.q << " [VAR]\n"
+              << "\t\tS:       " << measurements.s << " [VA]\n"
+              << "\t\tAct Imp: " << energy.act_imp_energy_wh << " [Wh]\n"
+              << "\t\tAct Exp: " << energy.act_exp_energy_wh << " [Wh]\n"
+              << "\t\tApp Imp: " << energy.app_imp_energy_wh << " [Wh]\n"
+              << "\t\tApp Exp: " << energy.app_exp_energy_wh << " [Wh]\n"
+              << "\t\tC Imp:   " << energy.c_imp_energy_wh << " [Wh]\n"
+              << "\t\tC Exp:   " << energy.c_exp_energy_wh << " [Wh]\n"
+              << "\t\tL Imp:   " << energy.l_imp_energy_wh << " [Wh]\n"
+              << "\t\tL Exp:   " << energy.l_exp_energy_wh << " [Wh]\n"
+              << std::flush;
+
+    str_len = 1;
   }
 
-  if (driver_thread.joinable())
+  const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - drv_params->clock_start).count();
+
+  LMA_Stop();
+  p_wait_hook = nullptr;
+  p_active_driver = nullptr;
+
+  if (nullptr != drv_params->p_benchmark)
   {
-    driver_thread.join();
+    Benchmark_stop(drv_params->p_benchmark);
   }
 
-  LMA_Stop();
+  if (nullptr != drv_params->p_recorder)
+  {
+    drv_params->p_recorder->Close();
+  }
 
+  LMA_EnergyGet(p_system_energy.get());
   LMA_ConsumptionDataGet(p_system_energy.get(), &(results->final_energy));
-  std::memcpy(&(results->calib_parameters), &(drv_params->p_phase->calib), sizeof(LMA_GlobalCalibration));
+  std::memcpy(&(results->calib_parameters), &(drv_params->phases[0].calib), sizeof(LMA_PhaseCalibration));
+  for (const LMA_Phase &phase : drv_params->phases)
+  {
+    results->calibrations.push_back(phase.calib);
+  }
+  results->calib_done_times = std::move(drv_params->calib_done_times);
+  results->calib_callbacks = drv_params->calib_callbacks;
+  results->measurements = std::move(drv_params->measurements);
+  results->measurement_times = std::move(drv_params->measurement_times);
+  results->irms_computed_neutral = LMA_ComputedNeutralGet();
+  results->status = LMA_StatusGet(&(drv_params->phases[0]));
+  LMA_SystemMeasurementsGet(&(results->system));
+  for (const LMA_Register &energy_register : drv_params->registers)
+  {
+    results->register_wh.push_back(LMA_RegisterWhGet(&energy_register));
+  }
+  if (nullptr != drv_params->p_tariff)
+  {
+    for (const LMA_Register &tariff_register : drv_params->p_tariff->registers)
+    {
+      results->tariff_wh.push_back(LMA_RegisterWhGet(&tariff_register));
+    }
+  }
+  results->tariff_times = std::move(drv_params->tariff_times);
+  for (const LMA_Demand &demand : drv_params->demands)
+  {
+    LMA_DemandReading reading;
+    LMA_DemandGet(&demand, &reading);
+    results->demand_readings.push_back(reading);
+  }
+  results->demands = std::move(drv_params->demand_log);
+  results->profile_records = 0;
+  results->profile_stats = {};
+  if (nullptr != drv_params->p_profile)
+  {
+    results->profile_records = drv_params->p_profile->records;
+    results->profile_stats = drv_params->p_profile_storage->Stats();
+
+    /* Every record is at least 10 bytes after the sector header*/
+    results->profile.resize((sim_params->profile_sectors * (SIM_PROFILE_SECTOR_SIZE - LMA_PROFILE_HEADER_SIZE)) / 10U);
+    results->profile.resize(LMA_ProfileRead(drv_params->p_profile.get(), 0, UINT32_MAX, results->profile.data(),
+                                            static_cast<uint32_t>(results->profile.size())));
+  }
+  results->waveforms = std::move(drv_params->waveforms);
+  results->events = std::move(drv_params->events);
+  results->event_times = std::move(drv_params->event_times);
+  results->event_callbacks = drv_params->event_callbacks;
+  results->events_dropped = (nullptr != drv_params->p_event_log) ? drv_params->p_event_log->dropped : 0;
+  if (nullptr != drv_params->p_history)
+  {
+    for (uint32_t l = 0; l < SIM_HISTORY_LEVELS; ++l)
+    {
+      LMA_HistoryRange range;
+      std::vector<LMA_HistorySlot> slots;
+
+      LMA_HistoryRead(drv_params->p_history.get(), l, 0, UINT32_MAX, &range);
+      for (size_t part = 0; part < 2; ++part)
+      {
+        slots.insert(slots.end(), range.p_slots[part], range.p_slots[part] + range.count[part]);
+      }
+      results->history.push_back(std::move(slots));
+    }
+  }
+  results->last_measurements = std::move(drv_params->last_measurements);
+  results->simulated_seconds = static_cast<double>(drv_params->tick) / drv_params->fs;
+  results->elapsed_seconds = elapsed_seconds;
 
   LMA_Deinit();
 
   std::cout << "\nSimulation Complete!\n";
-
-  results->raw_voltage_signal = std::move(drv_params->p_voltage_samples);
-  results->raw_current_signal = std::move(drv_params->p_current_samples);
+  std::cout << std::fixed << std::setprecision(2) << "\tSimulated " << results->simulated_seconds << " [s] in "
+            << results->elapsed_seconds << " [s] ("
+            << (results->elapsed_seconds > 0.0 ? results->simulated_seconds / results->elapsed_seconds : 0.0)
+            << " simulated seconds per second)\n";
 
   return results;
 }
+
+std::string SimulationClockText(uint32_t seconds)
+{
+  /* Civil from days - counted from 0000-03-01 so the leap day ends the year*/
+  const int64_t days = (seconds / 86400) + 730425;
+  const int64_t era = days / 146097;
+  const int64_t doe = days - (era * 146097);
+  const int64_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+  const int64_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+  const int64_t mp = ((5 * doy) + 2) / 153;
+  const int64_t day = doy - (((153 * mp) + 2) / 5) + 1;
+  const int64_t month = (mp < 10) ? (mp + 3) : (mp - 9);
+  const int64_t year = yoe + (era * 400) + ((month <= 2) ? 1 : 0);
+  const uint32_t time = seconds % 86400;
+  char text[32];
+
+  std::snprintf(text, sizeof(text), "%04d-%02d-%02d %02u:%02u:%02u", static_cast<int>(year), static_cast<int>(month),
+                static_cast<int>(day), time / 3600, (time / 60) % 60, time % 60);
+  return text;
+}
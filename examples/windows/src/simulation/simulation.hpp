@@ -1,43 +1,147 @@
 #ifndef _SIMULTAION_H_
 #define _SIMULTAION_H_
 
+#include "profile_storage.hpp"
+#include "scenario.hpp"
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 extern "C"
 {
+#include "Benchmark.h"
 #include "LMA_Core.h"
+#include "LMA_History.h"
+#include "LMA_Profile.h"
   extern bool tmr_running;
   extern bool adc_running;
   extern bool rtc_running;
+  extern void (*p_wait_hook)(void);
 }
 
+/** @brief Energy registers set on each phase (act imp, act exp, react imp, react exp) */
+#define SIM_PHASE_REGISTERS (4U)
+
+/** @brief Demand registers set on the system (P 15 min block, P 15 min sliding by the minute, S 30 min block) */
+#define SIM_DEMANDS (3U)
+
+/** @brief Sector size of the emulated flash region holding the load profile (bytes) */
+#define SIM_PROFILE_SECTOR_SIZE (1024U)
+
+/** @brief Sectors of the emulated load profile region by default - 64 KB of data flash */
+#define SIM_PROFILE_SECTORS (64U)
+
+/** @brief Measurement history levels kept of the first phase (an hour of seconds, a day of minutes and 30 days of hours) */
+#define SIM_HISTORY_LEVELS (3U)
+
+/** @brief Line cycles of each waveform capture (a trigger is decided per 25 cycle window, so 30 precede it) */
+#define SIM_CAPTURE_CYCLES (40U)
+
+/** @brief Line cycles of each waveform capture after its trigger */
+#define SIM_CAPTURE_POST_CYCLES (10U)
+
+/** @brief Entries of the status event log ring */
+#define SIM_EVENT_LOG_SIZE (64U)
+
+/** @brief one waveform capture event read during the simulation*/
+typedef struct SimulationWaveform
+{
+  uint32_t time;                       /**< clock at the trigger (seconds since 2000-01-01 00:00:00)*/
+  double read_time;                    /**< simulated time the event was read at*/
+  LMA_Status status;                   /**< status bits raised by the trigger*/
+  uint32_t phase_number;               /**< phase raising them*/
+  uint32_t trigger;                    /**< frame of the trigger*/
+  std::vector<LMA_PhaseInputs> frames; /**< inputs of every phase of each frame, oldest first*/
+  std::string path;                    /**< capture file the event was written to (empty = not written)*/
+} SimulationWaveform;
+
+/** @brief one demand interval ended during the simulation*/
+typedef struct SimulationDemand
+{
+  size_t index;  /**< entry of the demand table*/
+  uint32_t time; /**< clock at the end of the interval (seconds since 2000-01-01 00:00:00)*/
+  float demand;  /**< demand over the interval*/
+} SimulationDemand;
+
 /** @brief interface param structure for simulation. */
 typedef struct SimulationParams
 {
-  size_t sample_count;               /**< number of sample pairs available */
-  double ps;                         /**< Phase shift between current and coltage in degrees*/
-  double vrms;                       /**< target vrms for calibration */
-  double irms;                       /**< target vrms for calibration */
-  double fs;                         /**< sampling frequency */
-  double fline;                      /**< line frequency */
-  bool calibrate;                    /**< flag to enable/disable calibration on startup */
-  bool rogowski;                     /**< flag to enable/disable rogowski on startup */
-  std::atomic<bool> stop_simulation; /**< signal to stop the simulation*/
+  size_t sample_count = 0;                        /**< number of sample pairs to simulate */
+  double duration = 0.0;                          /**< simulated time in seconds - overrides sample_count when non-zero */
+  double ps = 0.0;                                /**< Phase shift between current and coltage in degrees*/
+  double vrms = 230.0;                            /**< target vrms for calibration */
+  double irms = 5.0;                              /**< target vrms for calibration */
+  double fs = 3906.25;                            /**< sampling frequency */
+  double fline = 50.0;                            /**< line frequency */
+  bool calibrate = false;                         /**< flag to enable/disable calibration on startup */
+  bool rogowski = false;                          /**< flag to enable/disable rogowski on startup */
+  bool realtime = false;                          /**< flag to pace the virtual clock to the wall clock (false = flat out) */
+  bool quiet = false;                             /**< flag to suppress the live measurement output */
+  bool benchmark = false;                         /**< flag to account the host CPU time of each callback context */
+  bool v90 = false;                               /**< flag to generate an exact 90 degree voltage (not the driver's shifter) */
+  uint32_t window_min = 0;                        /**< shortest adaptive window in line cycles (0 = fixed windows) */
+  double residual_i = 0.0;                        /**< neutral current raising LMA_RESIDUAL_CURRENT (0 = not checked) */
+  bool computed_neutral = false;                  /**< flag to register a computed neutral (vector sum of the phases) */
+  bool coherent = false;                          /**< flag to end the window of every phase with the first phase */
+  bool system_measurements = false;               /**< flag to register the symmetrical components (three phases) */
+  uint32_t clock_start = 0;                       /**< local time the clock starts at (seconds since 2000-01-01 00:00:00) */
+  const LMA_TariffSchedule *p_tariff = nullptr;   /**< time of use schedule of the system active import (nullptr = none) */
+  uint32_t profile_interval = 0;                  /**< load profile interval in seconds - whole minutes (0 = not recorded) */
+  uint32_t profile_sectors = SIM_PROFILE_SECTORS; /**< sectors of SIM_PROFILE_SECTOR_SIZE in the load profile region */
+  std::string profile_path;                       /**< file of the emulated load profile region - kept between runs */
+  bool history = false;                           /**< flag to keep a history of the first phase (SIM_HISTORY_LEVELS) */
+  uint32_t waveform_events = 0;                   /**< sag, swell and overcurrent waveforms held at once (0 = not captured) */
+  std::string waveform_path;                      /**< prefix of the file written per waveform (empty = not written) */
+  bool events = false;                            /**< flag to log the status events of every phase (SIM_EVENT_LOG_SIZE) */
+  uint32_t calibrate_async = 0;                   /**< phases to calibrate while metering - bit n is phase n + 1 (0 = none) */
+  std::shared_ptr<Scenario> p_scenario;           /**< multi-phase supply and load (nullptr = single phase waveform) */
+  std::string capture_path;                       /**< capture file to replay instead of generating (empty = generate) */
+  std::string record_path;                        /**< capture file to record the ADC frames to (empty = no recording) */
+  bool record_compressed = false;                 /**< flag to delta + Rice code the recorded capture */
+  uint32_t wait_timeout = 0;                      /**< callbacks on a thread, first phase waited on for TMR calls (0 = hook) */
+  std::atomic<bool> stop_simulation{false};       /**< signal to stop the simulation*/
 } SimulationParams;
 
 /** @brief results of smiulation*/
 typedef struct SimulationResults
 {
-  std::unique_ptr<std::vector<int32_t>> raw_voltage_signal; /**< Generated raw voltage signal (ADC)*/
-  std::unique_ptr<std::vector<int32_t>> raw_current_signal; /**< Generated raw current signal (ADC)*/
-  std::unique_ptr<std::vector<double>> voltage_signal;      /**< Generated voltage signal in volts*/
-  std::unique_ptr<std::vector<double>> current_signal;      /**< Generated current signal in amps*/
-  std::vector<LMA_Measurements> measurements;               /**< Computed measurment results*/
+  std::unique_ptr<std::vector<int32_t>> raw_voltage_signal; /**< Generated raw voltage signal (ADC) - decimated for plotting*/
+  std::unique_ptr<std::vector<int32_t>> raw_current_signal; /**< Generated raw current signal (ADC) - decimated for plotting*/
+  std::unique_ptr<std::vector<double>> voltage_signal;      /**< Generated voltage signal in volts - decimated for plotting*/
+  std::unique_ptr<std::vector<double>> current_signal;      /**< Generated current signal in amps - decimated for plotting*/
+  std::vector<LMA_Measurements> measurements;               /**< Computed measurment results (first phase)*/
+  std::vector<double> measurement_times;                    /**< Simulated time each of the measurements was collected at*/
+  std::vector<LMA_Measurements> last_measurements;          /**< Latest measurement results of every phase*/
   LMA_ConsumptionData final_energy;                         /**< Final measured energy*/
+  float irms_computed_neutral;                              /**< Final computed neutral current (vector sum of the phases)*/
+  LMA_Status status;                                        /**< Final status of the first phase*/
+  LMA_SystemMeasurements system;                            /**< Final symmetrical components (three phase scenarios)*/
+  std::vector<float> register_wh;                           /**< Final energy of the per phase registers (Wh)*/
+  std::vector<float> tariff_wh;                             /**< Final energy of each tariff (Wh - empty without a schedule)*/
+  std::vector<double> tariff_times;                         /**< Simulated time of each tariff switch*/
+  std::vector<LMA_DemandReading> demand_readings;           /**< Final demand and maximum demand of each demand register*/
+  std::vector<SimulationDemand> demands;                    /**< Every demand interval ended, in order*/
+  std::vector<LMA_ProfileEntry> profile;                    /**< Every load profile entry held by the region, oldest first*/
+  uint32_t profile_records;                                 /**< Load profile records written during the simulation*/
+  ProfileStorageStats profile_stats;                        /**< Operations on the load profile region*/
+  std::vector<std::vector<LMA_HistorySlot>> history;        /**< Slots held by each history level, oldest first (if kept)*/
+  std::vector<SimulationWaveform> waveforms;                /**< Every waveform capture event, in order*/
+  std::vector<LMA_Event> events;                            /**< Every status event read from the log, in order (if logged)*/
+  std::vector<double> event_times;                          /**< Simulated time each of the status events was read at*/
+  uint32_t event_callbacks;                                 /**< Status events passed to the log callback*/
+  uint32_t events_dropped;                                  /**< Status events dropped while the log was full*/
   LMA_PhaseCalibration calib_parameters;                    /**< Calibration parameters*/
+  std::vector<LMA_PhaseCalibration> calibrations;           /**< Final calibration of every phase*/
+  double calib_start_time;                                  /**< Simulated time the asynchronous calibration started at*/
+  std::vector<double> calib_done_times;                     /**< Simulated time each phase of it was done (0 = not done)*/
+  uint32_t calib_callbacks;                                 /**< Asynchronous calibration callbacks*/
+  std::vector<uint32_t> wait_ready_tmr;                     /**< TMR calls each LMA_MeasurementsWait returning ready took*/
+  std::vector<uint32_t> wait_timeout_tmr;                   /**< TMR calls each LMA_MeasurementsWait timing out took*/
+  double simulated_seconds;                                 /**< Virtual time covered by the simulation */
+  double elapsed_seconds;                                   /**< Wall clock time taken to run the simulation */
+  benchmark_t benchmark;                                    /**< CPU load of each callback context (if requested) */
 } SimulationResults;
 
 /** @brief driver for our simulation
@@ -46,4 +150,10 @@ typedef struct SimulationResults
  */
 std::shared_ptr<SimulationResults> Simulation(const SimulationParams *const p_sim_params);
 
+/** @brief Formats a time of the LMA clock.
+ * @param[in] seconds - seconds since 2000-01-01 00:00:00.
+ * @return the time as YYYY-MM-DD hh:mm:ss.
+ */
+std::string SimulationClockText(uint32_t seconds);
+
 #endif /* _SIMULTAION_H_*/
@@ -0,0 +1,40 @@
+#include "waveform.hpp"
+#include <cmath>
+
+WaveformGenerator::WaveformGenerator(double frequency, double phase_shift, double rms, double gain, double div_ratio,
+                                     double fs)
+{
+  const double omega = 2.0 * 3.14159265358979323846 * frequency / fs;
+  const double phi = phase_shift * 3.14159265358979323846 / 180.0;
+
+  amplitude = rms * std::sqrt(2.0);
+  adc_scale = gain * div_ratio * (1 << 23) / 0.5;
+  step_re = std::cos(omega);
+  step_im = std::sin(omega);
+  re = std::cos(phi);
+  im = std::sin(phi);
+}
+
+void WaveformGenerator::Generate(int32_t *p_adc, double *p_value, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    const double sample = amplitude * im;
+
+    if (nullptr != p_value)
+    {
+      p_value[i] = sample;
+    }
+    p_adc[i] = static_cast<int32_t>(std::round(sample * adc_scale));
+
+    /* Rotate the phasor by one sample*/
+    const double next_re = (re * step_re) - (im * step_im);
+    im = (re * step_im) + (im * step_re);
+    re = next_re;
+  }
+
+  /* Renormalise - pulls the magnitude back to 1 so rounding errors do not build up over long runs*/
+  const double magnitude = std::sqrt((re * re) + (im * im));
+  re /= magnitude;
+  im /= magnitude;
+}
@@ -0,0 +1,102 @@
+#ifndef _WAVEFORM_H_
+#define _WAVEFORM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** @brief number of samples produced per block by the waveform generators*/
+#define WAVEFORM_BLOCK_SIZE (1024U)
+
+/** @brief maximum number of points kept per signal for plotting*/
+#define WAVEFORM_PLOT_POINTS (65536U)
+
+/** @brief Streaming sine wave generator.
+ * @details Produces samples in blocks on demand so memory use does not depend on the simulated duration. A recursive
+ * oscillator (a phasor rotated by a fixed step each sample) replaces a std::sin call per sample. The phasor magnitude is
+ * renormalised once per block to stop rounding errors from accumulating.
+ */
+class WaveformGenerator
+{
+public:
+  /** @brief Constructs the generator.
+   * @param[in] frequency - signal frequency in Hz.
+   * @param[in] phase_shift - initial phase in degrees.
+   * @param[in] rms - RMS value of the signal.
+   * @param[in] gain - analog gain applied before the ADC.
+   * @param[in] div_ratio - divider/sensor ratio applied before the ADC.
+   * @param[in] fs - sampling frequency in Hz.
+   */
+  WaveformGenerator(double frequency, double phase_shift, double rms, double gain, double div_ratio, double fs);
+
+  /** @brief Generates the next block of samples.
+   * @param[out] p_adc - destination for the ADC codes (count entries).
+   * @param[out] p_value - destination for the signal values (count entries), may be nullptr.
+   * @param[in] count - number of samples to generate.
+   */
+  void Generate(int32_t *p_adc, double *p_value, size_t count);
+
+private:
+  double amplitude; /**< peak value of the signal*/
+  double adc_scale; /**< conversion from signal value to ADC code*/
+  double step_re;   /**< real part of the per-sample rotation*/
+  double step_im;   /**< imaginary part of the per-sample rotation*/
+  double re;        /**< real part of the phasor (cosine)*/
+  double im;        /**< imaginary part of the phasor (sine)*/
+};
+
+/** @brief Reduces a signal to a bounded number of points for plotting.
+ * @details The signal is split into buckets of equal length and the minimum and maximum of each bucket are kept, so the
+ * envelope of a long signal is preserved. Signals short enough to fit are kept as is.
+ */
+template <typename T> class PlotDecimator
+{
+public:
+  /** @brief Constructs the decimator.
+   * @param[in] total_samples - number of samples that will be added.
+   * @param[in] max_points - maximum number of points to keep.
+   */
+  PlotDecimator(size_t total_samples, size_t max_points)
+      : bucket_size((total_samples <= max_points) ? 1 : ((total_samples + (max_points / 2) - 1) / (max_points / 2))),
+        bucket_count(0), bucket_min(0), bucket_max(0)
+  {
+  }
+
+  /** @brief Adds a sample to the signal.
+   * @param[in] value - the sample.
+   * @param[inout] p_out - the decimated signal.
+   */
+  void Add(T value, std::vector<T> *p_out)
+  {
+    if (1 == bucket_size)
+    {
+      p_out->push_back(value);
+      return;
+    }
+
+    if (0 == bucket_count || value < bucket_min)
+    {
+      bucket_min = value;
+    }
+
+    if (0 == bucket_count || value > bucket_max)
+    {
+      bucket_max = value;
+    }
+
+    if (++bucket_count >= bucket_size)
+    {
+      p_out->push_back(bucket_min);
+      p_out->push_back(bucket_max);
+      bucket_count = 0;
+    }
+  }
+
+private:
+  size_t bucket_size;  /**< number of samples per bucket*/
+  size_t bucket_count; /**< number of samples in the current bucket*/
+  T bucket_min;        /**< minimum of the current bucket*/
+  T bucket_max;        /**< maximum of the current bucket*/
+};
+
+#endif /* _WAVEFORM_H_*/
@@ -0,0 +1,2338 @@
+#include "capture.hpp"
+#include "rogowski.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+  #define popen _popen
+  #define pclose _pclose
+#endif
+
+/** @brief prefix of the line a worker reports its point on*/
+#define VERIFY_RESULT_TAG "RESULT"
+
+/** @brief prefix of the line a worker reports its load step on*/
+#define VERIFY_WINDOW_TAG "WINDOW"
+
+/** @brief seconds simulated before the measured interval - covers start up and the first windows*/
+#define VERIFY_SETTLE_SECONDS (2.0)
+
+/** @brief windows discarded from the start of a run before averaging*/
+#define VERIFY_SKIP_WINDOWS (2U)
+
+/** @brief sampling frequency of the simulated ADC*/
+#define VERIFY_FS (3906.25)
+
+/** @brief allowed gain deviation of Trap_integrate from its design in percent*/
+#define VERIFY_ROGOWSKI_GAIN_TOL (0.01)
+
+/** @brief allowed phase deviation of Trap_integrate from its design in degrees*/
+#define VERIFY_ROGOWSKI_PHASE_TOL (0.01)
+
+/** @brief coil offset used to check the DC-drift HPF (ADC codes)*/
+#define VERIFY_ROGOWSKI_OFFSET (1000)
+
+/** @brief time of the load step of the window check in seconds - part way through a window*/
+#define VERIFY_WINDOW_STEP_SECONDS (5.3)
+
+/** @brief time after the load step from which the window check measures steady state in seconds*/
+#define VERIFY_WINDOW_SETTLED_SECONDS (3.0)
+
+/** @brief prefix of the line a worker reports its tariff run on*/
+#define VERIFY_TARIFF_TAG "TARIFF"
+
+/** @brief simulated time of each tariff run in seconds*/
+#define VERIFY_TARIFF_SECONDS (120.0)
+
+/** @brief allowed difference between the sum of the tariff registers and the system active import in percent*/
+#define VERIFY_TARIFF_SUM_TOL (0.001)
+
+/** @brief prefix of the line a worker reports its demand run on*/
+#define VERIFY_DEMAND_TAG "DEMAND"
+
+/** @brief length of each entry of the demand load profile in seconds - a quarter of an hour*/
+#define VERIFY_DEMAND_STEP_SECONDS (900U)
+
+/** @brief prefix of the line a worker reports its load profile run on*/
+#define VERIFY_PROFILE_TAG "PROFILE"
+
+/** @brief sectors of the load profile region checked - small, so the region wraps within a few days*/
+#define VERIFY_PROFILE_SECTORS (4U)
+
+/** @brief random ranges read back from the load profile*/
+#define VERIFY_PROFILE_RANGES (1000U)
+
+/** @brief prefix of the line a worker reports its measurement history run on*/
+#define VERIFY_HISTORY_TAG "HISTORY"
+
+/** @brief slots of the seconds ring of the measurement history checked - small, so every level wraps within a day*/
+#define VERIFY_HISTORY_SECONDS (900U)
+
+/** @brief slots of the minutes ring of the measurement history checked*/
+#define VERIFY_HISTORY_MINUTES (240U)
+
+/** @brief slots of the hours ring of the measurement history checked*/
+#define VERIFY_HISTORY_HOURS (12U)
+
+/** @brief random ranges read from each level of the measurement history*/
+#define VERIFY_HISTORY_RANGES (1000U)
+
+/** @brief allowed difference of the mean of a history slot from the mean of its windows in percent*/
+#define VERIFY_HISTORY_MEAN_TOL (0.001)
+
+/** @brief prefix of the line a worker reports its waveform capture run on*/
+#define VERIFY_WAVEFORM_TAG "WAVEFORM"
+
+/** @brief length of each entry of the waveform capture load profile in seconds - the load doubles every 4 entries*/
+#define VERIFY_WAVEFORM_STEP_SECONDS (2.0)
+
+/** @brief simulated time of the waveform capture run in seconds - two steps up*/
+#define VERIFY_WAVEFORM_SECONDS (18.0)
+
+/** @brief events the waveform capture holds - each is read and released before the next*/
+#define VERIFY_WAVEFORM_EVENTS (2U)
+
+/** @brief prefix of the line a worker reports its status event run on*/
+#define VERIFY_EVENTS_TAG "EVENTS"
+
+/** @brief length of each entry of the voltage and load profiles of the status event run in seconds*/
+#define VERIFY_EVENTS_STEP_SECONDS (4.0)
+
+/** @brief simulated time of the status event run in seconds - the last swell is still going at the end*/
+#define VERIFY_EVENTS_SECONDS (30.0)
+
+/** @brief prefix of the line a worker reports its asynchronous calibration run on*/
+#define VERIFY_CALIBRATION_TAG "CALIBRATION"
+
+/** @brief phases calibrated by the asynchronous calibration run - the first and third (bit n is phase n + 1)*/
+#define VERIFY_CALIBRATION_PHASES (0x5U)
+
+/** @brief phases calibrated by the coherent window run - the second and third, both following the first*/
+#define VERIFY_CALIBRATION_COHERENT_PHASES (0x6U)
+
+/** @brief line cycles of each window of the asynchronous calibration - the stabilising one, then the accumulating one*/
+#define VERIFY_CALIBRATION_CYCLES (25U)
+
+/** @brief simulated time of the asynchronous calibration run in seconds*/
+#define VERIFY_CALIBRATION_SECONDS (20.0)
+
+/** @brief prefix of the line a worker reports its measurement wait run on*/
+#define VERIFY_WAIT_TAG "WAIT"
+
+/** @brief TMR calls each LMA_MeasurementsWait of the wait run times out after - a fifth of a 25 cycle window*/
+#define VERIFY_WAIT_TMR (10U)
+
+/** @brief simulated time of the wait run in seconds - paced to the wall clock*/
+#define VERIFY_WAIT_SECONDS (4.0)
+
+/** @brief Vrms and Irms coefficients of the simulated front end (the defaults the sweep is measured with)*/
+#define VERIFY_VRMS_COEFF (21177.2051)
+#define VERIFY_IRMS_COEFF (53685.3828)
+
+/** @brief Load point of the sweep and the limits it is checked against.*/
+typedef struct VerifyPoint
+{
+  double ib_multiple; /**< current as a multiple of Ib*/
+  double pf;          /**< power factor (magnitude)*/
+  bool capacitive;    /**< current leads the voltage*/
+  double fline;       /**< line frequency in Hz*/
+  double limit_pqs;   /**< limit of the P, S and energy errors in percent*/
+  double limit_q;     /**< limit of the Q error in percent (0 = not checked)*/
+} VerifyPoint;
+
+/** @brief Measurements a worker reports for one point.*/
+typedef struct VerifyMeasured
+{
+  bool valid;        /**< worker ran and reported*/
+  double vrms;       /**< mean RMS voltage*/
+  double irms;       /**< mean RMS current*/
+  double p;          /**< mean active power*/
+  double q;          /**< mean reactive power*/
+  double s;          /**< mean apparent power*/
+  double fline;      /**< mean line frequency*/
+  double energy_wh;  /**< active energy imported over the measured interval*/
+  double interval_s; /**< length of the measured interval*/
+  size_t windows;    /**< number of windows averaged*/
+} VerifyMeasured;
+
+/** @brief Sweep settings.*/
+typedef struct VerifySettings
+{
+  double vrms;            /**< nominal RMS voltage*/
+  double ib;              /**< basic current*/
+  double imax;            /**< maximum current*/
+  double accuracy;        /**< active accuracy class (percent)*/
+  double duration;        /**< measured interval of each point in seconds*/
+  unsigned jobs;          /**< points run in parallel*/
+  bool rogowski;          /**< sense the current with a Rogowski coil and Trap_integrate*/
+  uint32_t window_min;    /**< shortest adaptive computation window in line cycles (0 = fixed windows)*/
+  bool tariff;            /**< check the time of use tariff schedule and switching*/
+  unsigned demand_days;   /**< days of load profile the demand registers are checked over (0 = not checked)*/
+  unsigned profile_days;  /**< days of load profile recorded and read back (0 = not checked)*/
+  unsigned history_hours; /**< hours of load profile replayed through the measurement history (0 = not checked)*/
+  bool waveform;          /**< check the waveform capture of overcurrent steps against a recording*/
+  bool events;            /**< check the status event log over voltage and load steps*/
+  bool calibration;       /**< check the asynchronous calibration of two phases while the third meters (both windows)*/
+  bool wait;              /**< check LMA_MeasurementsWait with the callbacks on a thread of their own*/
+} VerifySettings;
+
+/** @brief Prints the command line usage.
+ * @param[in] p_name - name of the executable.
+ */
+static void Print_usage(const char *p_name)
+{
+  std::cout << "Usage: " << p_name << " [options]\n"
+            << "  --vrms <V>        nominal RMS voltage (default 230)\n"
+            << "  --ib <A>          basic current (default 5)\n"
+            << "  --imax <A>        maximum current (default 60)\n"
+            << "  --class <c>       active accuracy class in percent (default 1) - reactive is checked to twice this\n"
+            << "  --duration <s>    measured interval of each point (default 10)\n"
+            << "  --jobs <n>        points run in parallel (default: number of cores)\n"
+            << "  --rogowski        characterise Trap_integrate, then sweep through it (at 50 Hz - it is compensated there)\n"
+            << "  --adaptive <n>    compare fixed and adaptive windows on load steps, then sweep with n to 25 cycle windows\n"
+            << "  --tariff          check the time of use schedule at its edges and the energy split across a tariff switch\n"
+            << "  --demand <days>   check the block and sliding demands and their peaks over days of load profile\n"
+            << "  --profile <days>  record days of load profile to a small emulated flash region, then recover and read it\n"
+            << "  --history <hours> replay hours of load profile through a measurement history and check every slot\n"
+            << "  --waveform        capture the waveform around overcurrent steps and find each capture in a recording\n"
+            << "  --events          log the status events of sags, swells, an overcurrent and no load, and check each\n"
+            << "  --calibration     calibrate two phases of three together while the third meters, and check each - then\n"
+            << "                    again with coherent windows, calibrating the two phases following the first\n"
+            << "  --wait            run the callbacks on a thread of their own and wait on the measurements without the\n"
+            << "                    simulation's hook, checking the ready and timed out returns\n"
+            << "  --help            show this message\n";
+}
+
+/** @brief Builds the sweep - accuracy class load points over the line frequency range.
+ * @details Currents from 5% Ib to Imax at unity power factor, and from 10% Ib at 0.5 inductive and 0.8 capacitive. The
+ * percentage error limits follow the shape of the IEC 62053 tables: the class at and above 10% Ib (unity) or 20% Ib (0.5L and
+ * 0.8C), half a percent more below. Q is only checked where the power factor makes it significant.
+ * @param[in] settings - sweep settings.
+ * @return the load points.
+ */
+static std::vector<VerifyPoint> Build_sweep(const VerifySettings &settings)
+{
+  /* The Rogowski front end is only compensated at the line frequency - its error elsewhere is characterised separately*/
+  const std::vector<double> frequencies =
+      settings.rogowski ? std::vector<double>{50.0} : std::vector<double>{45.0, 50.0, 55.0, 60.0, 65.0};
+  const double currents[] = {0.05, 0.1, 0.2, 0.5, 1.0, (0.5 * settings.imax) / settings.ib, settings.imax / settings.ib};
+  std::vector<VerifyPoint> points;
+
+  for (const double fline : frequencies)
+  {
+    for (const double ib_multiple : currents)
+    {
+      const double limit = settings.accuracy;
+      const double limit_low = settings.accuracy + 0.5;
+
+      points.push_back({ib_multiple, 1.0, false, fline, (ib_multiple < 0.1) ? limit_low : limit, 0.0});
+
+      if (ib_multiple >= 0.1)
+      {
+        const double limit_pf = (ib_multiple < 0.2) ? limit_low : limit;
+        const double limit_q = 2.0 * limit_pf;
+
+        points.push_back({ib_multiple, 0.5, false, fline, limit_pf, limit_q});
+        points.push_back({ib_multiple, 0.8, true, fline, limit_pf, limit_q});
+      }
+    }
+  }
+
+  return points;
+}
+
+/** @brief Sets the parameters common to every verification run - the rest keep their defaults.
+ * @param[out] p_params - parameters to set.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] irms - RMS current.
+ * @param[in] duration - simulated time in seconds.
+ */
+static void Verify_params(SimulationParams *const p_params, double vrms, double irms, double duration)
+{
+  p_params->duration = duration;
+  p_params->vrms = vrms;
+  p_params->irms = irms;
+  p_params->fs = VERIFY_FS;
+  p_params->quiet = true;
+  p_params->v90 = true;
+}
+
+/** @brief Runs one point in this process and reports it on stdout.
+ * @details The core is a singleton, so each point runs in its own process. Two runs of the same waveform differing only in
+ * length give the energy of the interval between them - start up is identical in both and cancels out.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] irms - RMS current.
+ * @param[in] ps - phase shift of the current relative to the voltage in degrees.
+ * @param[in] fline - line frequency in Hz.
+ * @param[in] duration - measured interval in seconds.
+ * @param[in] rogowski - sense the current with a Rogowski coil.
+ * @param[in] window_min - shortest adaptive computation window in line cycles (0 = fixed windows).
+ * @return EXIT_SUCCESS if the point produced measurements.
+ */
+static int Run_point(double vrms, double irms, double ps, double fline, double duration, bool rogowski, uint32_t window_min)
+{
+  SimulationParams params;
+
+  Verify_params(&params, vrms, irms, VERIFY_SETTLE_SECONDS);
+  params.ps = ps;
+  params.fline = fline;
+  params.rogowski = rogowski;
+  params.window_min = window_min;
+
+  const auto settle = Simulation(&params);
+  params.duration = VERIFY_SETTLE_SECONDS + duration;
+  const auto run = Simulation(&params);
+
+  if (run->measurements.size() <= VERIFY_SKIP_WINDOWS)
+  {
+    std::cerr << "No measurements were produced at " << irms << " A, " << ps << " deg, " << fline << " Hz\n";
+    return EXIT_FAILURE;
+  }
+
+  VerifyMeasured m = {};
+  for (size_t w = VERIFY_SKIP_WINDOWS; w < run->measurements.size(); ++w)
+  {
+    const LMA_Measurements &window = run->measurements[w];
+    m.vrms += window.vrms;
+    m.irms += window.irms;
+    m.p += window.p;
+    m.q += window.q;
+    m.s += window.s;
+    m.fline += window.fline;
+    ++m.windows;
+  }
+
+  m.energy_wh = static_cast<double>(run->final_energy.act_imp_energy_wh) - settle->final_energy.act_imp_energy_wh;
+  m.interval_s = run->simulated_seconds - settle->simulated_seconds;
+
+  std::cout << VERIFY_RESULT_TAG << std::setprecision(17) << " " << (m.vrms / m.windows) << " " << (m.irms / m.windows) << " "
+            << (m.p / m.windows) << " " << (m.q / m.windows) << " " << (m.s / m.windows) << " " << (m.fline / m.windows) << " "
+            << m.energy_wh << " " << m.interval_s << " " << m.windows << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Runs this executable as a worker process and captures the line it reports on.
+ * @param[in] cmd - command line of the worker.
+ * @param[in] p_tag - tag prefixing the report line.
+ * @param[out] p_fields - fields of the report line (empty if none was reported).
+ * @return true if the worker reported and exited successfully.
+ */
+static bool Run_command(const std::string &cmd, const char *p_tag, std::string *p_fields)
+{
+  const size_t tag_length = std::strlen(p_tag);
+
+#if defined(_WIN32)
+  /* cmd.exe strips the outer quotes of the command*/
+  const std::string command = "\"" + cmd + "\"";
+#else
+  const std::string command = cmd;
+#endif
+
+  p_fields->clear();
+
+  std::FILE *p_pipe = popen(command.c_str(), "r");
+  if (nullptr == p_pipe)
+  {
+    return false;
+  }
+
+  char line[2048];
+  while (nullptr != std::fgets(line, sizeof(line), p_pipe))
+  {
+    if (0 == std::strncmp(line, p_tag, tag_length) && ' ' == line[tag_length])
+    {
+      *p_fields = line + tag_length + 1;
+    }
+  }
+
+  return (0 == pclose(p_pipe)) && !p_fields->empty();
+}
+
+/** @brief Runs one point in a worker process and parses its report.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @param[in] point - point to run.
+ * @return measurements of the point (valid is false if the worker failed).
+ */
+static VerifyMeasured Run_worker(const char *p_self, const VerifySettings &settings, const VerifyPoint &point)
+{
+  const double angle = std::acos(point.pf) * 180.0 / 3.14159265358979323846;
+  std::ostringstream cmd;
+  std::string report;
+  VerifyMeasured m = {};
+
+  cmd << std::setprecision(17) << "\"" << p_self << "\"" << (settings.rogowski ? " --rogowski" : "");
+  if (0 != settings.window_min)
+  {
+    cmd << " --adaptive " << settings.window_min;
+  }
+  cmd << " --point " << settings.vrms << " " << (point.ib_multiple * settings.ib) << " " << (point.capacitive ? angle : -angle)
+      << " " << point.fline << " " << settings.duration;
+
+  if (Run_command(cmd.str(), VERIFY_RESULT_TAG, &report))
+  {
+    std::istringstream fields(report);
+    m.valid = static_cast<bool>(fields >> m.vrms >> m.irms >> m.p >> m.q >> m.s >> m.fline >> m.energy_wh >> m.interval_s >>
+                                m.windows);
+  }
+
+  return m;
+}
+
+/** @brief Percentage error of a measurement.
+ * @param[in] measured - measured value.
+ * @param[in] reference - true value.
+ * @return error in percent of the reference.
+ */
+static double Percent_error(double measured, double reference)
+{
+  return 100.0 * (measured - reference) / reference;
+}
+
+/** @brief Prints one error column, marking it if it exceeds its limit.
+ * @param[in] error - error in percent.
+ * @param[in] limit - limit in percent (0 = not checked).
+ * @param[inout] p_pass - cleared if the limit is exceeded.
+ */
+static void Print_error(double error, double limit, bool *p_pass)
+{
+  const bool fail = (0.0 != limit) && !(std::fabs(error) <= limit);
+
+  std::cout << std::showpos << std::fixed << std::setprecision(3) << std::setw(9) << error << std::noshowpos
+            << (fail ? "*" : " ");
+  if (fail)
+  {
+    *p_pass = false;
+  }
+}
+
+/** @brief Characterises Trap_integrate against its design over the line frequency range.
+ * @details For each frequency the integrator is driven with the coil output of Ib and its gain and phase relative to the
+ * current are fitted. The deviation from the floating point design is checked - this is the fixed point implementation. The
+ * error of the design itself, and what is left of it once compensated at 50 Hz, are reported but not checked: they belong to
+ * the choice of HPF. A constant coil offset then checks the HPF holds the integrator output rather than letting it ramp.
+ * @param[in] settings - sweep settings.
+ * @return true if the implementation matches its design and the drift is held.
+ */
+static bool Verify_rogowski(const VerifySettings &settings)
+{
+  static const double frequencies[] = {45.0, 50.0, 55.0, 60.0, 65.0};
+  const double deg = 180.0 / 3.14159265358979323846;
+  const double amplitude = settings.ib * std::sqrt(2.0) * 8.0 * 0.0004 * (1 << 23) / 0.5;
+  const RogowskiFrontEnd front_end(VERIFY_FS, 50.0);
+  bool pass = true;
+
+  std::cout << "\n\tRogowski Integrator (Trap_integrate at " << VERIFY_FS << " Hz, limits " << VERIFY_ROGOWSKI_GAIN_TOL
+            << "% / " << VERIFY_ROGOWSKI_PHASE_TOL << " deg from design)\n"
+            << "\t" << std::setw(7) << "f [Hz]" << std::setw(12) << "Gain %" << std::setw(12) << "Phase [deg]" << std::setw(14)
+            << "vs Design %" << std::setw(14) << "vs Design deg" << std::setw(12) << "Comp %" << std::setw(12) << "Comp deg"
+            << "\n";
+
+  for (const double f : frequencies)
+  {
+    const std::complex<double> measured = RogowskiMeasure(f, VERIFY_FS, amplitude);
+    const std::complex<double> design = RogowskiDesign(f, VERIFY_FS);
+    const std::complex<double> compensated = front_end.Response(f);
+    const double gain_dev = 100.0 * ((std::abs(measured) / std::abs(design)) - 1.0);
+    const double phase_dev = std::arg(measured / design) * deg;
+    const bool fail =
+        !(std::fabs(gain_dev) <= VERIFY_ROGOWSKI_GAIN_TOL) || !(std::fabs(phase_dev) <= VERIFY_ROGOWSKI_PHASE_TOL);
+
+    std::cout << "\t" << std::fixed << std::setprecision(1) << std::setw(7) << f << std::showpos << std::setprecision(4)
+              << std::setw(12) << (100.0 * (std::abs(measured) - 1.0)) << std::setw(12) << (std::arg(measured) * deg)
+              << std::setw(14) << gain_dev << std::setw(14) << phase_dev << std::setw(12)
+              << (100.0 * (std::abs(compensated) - 1.0)) << std::setw(12) << (std::arg(compensated) * deg) << std::noshowpos
+              << (fail ? "  FAIL" : "") << "\n";
+
+    pass = pass && !fail;
+  }
+
+  /* A constant offset should settle at -a / (1 - a) times itself without overshooting*/
+  const double expected = -(ROGOWSKI_HPF_COEFF / (1.0 - ROGOWSKI_HPF_COEFF)) * VERIFY_ROGOWSKI_OFFSET;
+  const RogowskiDrift drift = RogowskiMeasureDrift(VERIFY_FS, VERIFY_ROGOWSKI_OFFSET, 10.0);
+  const bool drift_fail = !(std::fabs(Percent_error(drift.settled, expected)) <= 1.0) ||
+                          !(drift.peak <= (std::fabs(expected) * 1.01));
+
+  std::cout << std::fixed << std::setprecision(1) << "\n\tDC drift: offset " << VERIFY_ROGOWSKI_OFFSET << " -> settled "
+            << drift.settled << " (expected " << expected << "), peak " << drift.peak << (drift_fail ? "  FAIL" : "") << "\n";
+
+  return pass && !drift_fail;
+}
+
+/** @brief Statistics of the active power error over a run of windows.*/
+typedef struct VerifyWindowStats
+{
+  double mean;    /**< mean error in percent*/
+  double sigma;   /**< standard deviation of the error in percent - the window to window noise*/
+  double cycles;  /**< mean window length in line cycles*/
+  size_t windows; /**< number of windows*/
+} VerifyWindowStats;
+
+/** @brief Results a worker reports for one load step.*/
+typedef struct VerifyStep
+{
+  bool valid;               /**< worker ran and reported*/
+  double latency;           /**< time from the step until every window is within the class (negative = never)*/
+  VerifyWindowStats before; /**< windows before the step*/
+  VerifyWindowStats after;  /**< windows once settled after the step*/
+} VerifyStep;
+
+/** @brief Active power error of the windows collected within a time range.
+ * @param[in] results - simulation results.
+ * @param[in] p - true active power.
+ * @param[in] fline - line frequency in Hz.
+ * @param[in] start - windows collected from this time on (seconds).
+ * @param[in] end - windows collected before this time (seconds).
+ * @return statistics of the windows.
+ */
+static VerifyWindowStats Window_stats(const SimulationResults &results, double p, double fline, double start, double end)
+{
+  VerifyWindowStats stats = {};
+  double sum_sq = 0.0;
+  double first = 0.0;
+  double last = 0.0;
+
+  for (size_t w = 0; w < results.measurements.size(); ++w)
+  {
+    const double t = results.measurement_times[w];
+    if (t >= start && t < end)
+    {
+      const double error = Percent_error(results.measurements[w].p, p);
+      first = (0 == stats.windows) ? t : first;
+      last = t;
+      stats.mean += error;
+      sum_sq += error * error;
+      ++stats.windows;
+    }
+  }
+
+  if (0 != stats.windows)
+  {
+    stats.mean /= stats.windows;
+    stats.sigma = std::sqrt(std::max(0.0, (sum_sq / stats.windows) - (stats.mean * stats.mean)));
+    stats.cycles = (stats.windows > 1) ? ((last - first) * fline) / (stats.windows - 1) : 0.0;
+  }
+
+  return stats;
+}
+
+/** @brief Runs one load step in this process and reports it on stdout.
+ * @details A single phase unity power factor load steps part way through a window at 50 Hz. The latency is the time from the
+ * step until every later window is within the class of the new load. Steady state is taken before the step and once settled
+ * after it, where adaptive windows should have grown back to full length.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] i_from - RMS current before the step.
+ * @param[in] i_to - RMS current after the step.
+ * @param[in] accuracy - active accuracy class in percent.
+ * @param[in] window_min - shortest adaptive computation window in line cycles (0 = fixed windows).
+ * @return EXIT_SUCCESS if the step produced measurements.
+ */
+static int Run_step(double vrms, double i_from, double i_to, double accuracy, uint32_t window_min)
+{
+  const double end = VERIFY_WINDOW_STEP_SECONDS + (2.0 * VERIFY_WINDOW_SETTLED_SECONDS);
+  SimulationParams params;
+
+  Verify_params(&params, vrms, i_from, end);
+  params.window_min = window_min;
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, i_from, 0.0, 0.0);
+  params.p_scenario->step_time = VERIFY_WINDOW_STEP_SECONDS;
+  params.p_scenario->step_scale = i_to / i_from;
+
+  const auto results = Simulation(&params);
+  const double p_after = vrms * i_to;
+  double latency = -1.0;
+
+  /* The latency restarts at every window outside the class, so it ends on the run that lasts to the end*/
+  for (size_t w = 0; w < results->measurements.size(); ++w)
+  {
+    const double t = results->measurement_times[w];
+    if (t <= VERIFY_WINDOW_STEP_SECONDS || !(std::fabs(Percent_error(results->measurements[w].p, p_after)) <= accuracy))
+    {
+      latency = -1.0;
+    }
+    else if (latency < 0.0)
+    {
+      latency = t - VERIFY_WINDOW_STEP_SECONDS;
+    }
+  }
+
+  const VerifyWindowStats before =
+      Window_stats(*results, vrms * i_from, params.fline, VERIFY_SETTLE_SECONDS, VERIFY_WINDOW_STEP_SECONDS);
+  const VerifyWindowStats after =
+      Window_stats(*results, p_after, params.fline, VERIFY_WINDOW_STEP_SECONDS + VERIFY_WINDOW_SETTLED_SECONDS, end);
+
+  std::cout << VERIFY_WINDOW_TAG << std::setprecision(17) << " " << latency << " " << before.mean << " " << before.sigma << " "
+            << before.cycles << " " << before.windows << " " << after.mean << " " << after.sigma << " " << after.cycles << " "
+            << after.windows << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Compares fixed and adaptive computation windows on load steps.
+ * @details The load steps from Ib to Imax and back, each with fixed windows and with adaptive windows of settings.window_min
+ * to 25 cycles. Each step runs in its own worker process as the sweep points do.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if every step settles within the class before and after the step.
+ */
+static bool Verify_window(const char *p_self, const VerifySettings &settings)
+{
+  const double steps[][2] = {{settings.ib, settings.imax}, {settings.imax, settings.ib}};
+  const uint32_t modes[] = {0, settings.window_min};
+  bool pass = true;
+
+  std::cout << "\n\tComputation Window (load step at " << VERIFY_WINDOW_STEP_SECONDS << " s, 50 Hz, class "
+            << settings.accuracy << ")\n"
+            << "\t" << std::setw(14) << "Step [A]" << std::setw(9) << "Window" << std::setw(14) << "Latency [s]"
+            << std::setw(11) << "Before %" << std::setw(10) << "Noise %" << std::setw(10) << "After %" << std::setw(10)
+            << "Noise %" << std::setw(14) << "Steady [cyc]" << "\n";
+
+  for (const auto &step : steps)
+  {
+    for (const uint32_t window_min : modes)
+    {
+      std::ostringstream cmd;
+      std::ostringstream label;
+      std::string report;
+      VerifyStep m = {};
+
+      cmd << std::setprecision(17) << "\"" << p_self << "\" --step " << settings.vrms << " " << step[0] << " " << step[1]
+          << " " << settings.accuracy << " " << window_min;
+
+      if (Run_command(cmd.str(), VERIFY_WINDOW_TAG, &report))
+      {
+        std::istringstream fields(report);
+        m.valid = static_cast<bool>(fields >> m.latency >> m.before.mean >> m.before.sigma >> m.before.cycles >>
+                                    m.before.windows >> m.after.mean >> m.after.sigma >> m.after.cycles >> m.after.windows);
+      }
+
+      label << std::fixed << std::setprecision(1) << step[0] << " -> " << step[1];
+      std::cout << "\t" << std::setw(14) << label.str() << std::setw(9)
+                << ((0 == window_min) ? std::string("25") : (std::to_string(window_min) + "-25"));
+
+      const bool fail = !m.valid || (m.latency < 0.0) || (0 == m.before.windows) || (0 == m.after.windows) ||
+                        !(std::fabs(m.before.mean) <= settings.accuracy) || !(std::fabs(m.after.mean) <= settings.accuracy);
+
+      if (!m.valid)
+      {
+        std::cout << "  worker failed\n";
+      }
+      else
+      {
+        std::cout << std::fixed << std::setprecision(3) << std::setw(14) << m.latency << std::showpos << std::setw(11)
+                  << m.before.mean << std::noshowpos << std::setw(10) << m.before.sigma << std::showpos << std::setw(10)
+                  << m.after.mean << std::noshowpos << std::setw(10) << m.after.sigma << std::setprecision(1)
+                  << std::setw(14) << m.after.cycles << (fail ? "  FAIL" : "") << "\n";
+      }
+
+      pass = pass && !fail;
+    }
+  }
+
+  return pass;
+}
+
+/** @brief Seconds since 2000-01-01 00:00:00 of a date and time - the epoch of the LMA clock.
+ * @param[in] year - year (2000 on).
+ * @param[in] month - month (1-12).
+ * @param[in] day - day of the month (1-31).
+ * @param[in] hour - hour (0-23).
+ * @param[in] minute - minute (0-59).
+ * @param[in] second - second (0-59).
+ * @return clock time in seconds.
+ */
+static uint32_t Clock_seconds(int year, int month, int day, int hour, int minute, int second)
+{
+  /* Days from civil - counted from 0000-03-01 so the leap day ends the year*/
+  const int y = year - ((month <= 2) ? 1 : 0);
+  const int era = y / 400;
+  const int yoe = y - (era * 400);
+  const int doy = ((153 * (month + ((month > 2) ? -3 : 9))) + 2) / 5 + day - 1;
+  const int doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+  const int days = (era * 146097) + doe - 730425;
+
+  return static_cast<uint32_t>(days) * 86400U + static_cast<uint32_t>((hour * 3600) + (minute * 60) + second);
+}
+
+/** @brief Builds the schedule the tariff checks run against.
+ * @details Summer (1 Mar) and winter (1 Oct) seasons, so January and February fall before the first season. Summer weekdays
+ * switch at 07:00, 12:00 and 22:00, winter weekdays at 06:30 and 23:00 - both start the day on their last switch. Weekends
+ * and the two special days are flat.
+ * @param[out] p_schedule - schedule to populate.
+ */
+static void Tariff_schedule(LMA_TariffSchedule *const p_schedule)
+{
+  *p_schedule = {};
+  p_schedule->season_count = 2;
+  p_schedule->season_start[0] = LMA_TARIFF_DATE(3, 1);
+  p_schedule->season_start[1] = LMA_TARIFF_DATE(10, 1);
+  for (uint8_t d = 0; d < 7; ++d)
+  {
+    p_schedule->week_profile[0][d] = (d < 5) ? 0 : 1;
+    p_schedule->week_profile[1][d] = (d < 5) ? 2 : 1;
+  }
+
+  p_schedule->day_profile[0][0] = LMA_TARIFF_SWITCH(7, 0, 1);
+  p_schedule->day_profile[0][1] = LMA_TARIFF_SWITCH(12, 0, 2);
+  p_schedule->day_profile[0][2] = LMA_TARIFF_SWITCH(22, 0, 0);
+  p_schedule->switch_count[0] = 3;
+  p_schedule->day_profile[1][0] = LMA_TARIFF_SWITCH(0, 0, 3);
+  p_schedule->switch_count[1] = 1;
+  p_schedule->day_profile[2][0] = LMA_TARIFF_SWITCH(6, 30, 4);
+  p_schedule->day_profile[2][1] = LMA_TARIFF_SWITCH(23, 0, 5);
+  p_schedule->switch_count[2] = 2;
+  p_schedule->day_profile[3][0] = LMA_TARIFF_SWITCH(0, 0, 7);
+  p_schedule->switch_count[3] = 1;
+
+  p_schedule->special_day[0] = LMA_TARIFF_DATE(1, 1);
+  p_schedule->special_day[1] = LMA_TARIFF_DATE(12, 25);
+  p_schedule->special_count = 2;
+  p_schedule->special_profile = 3;
+}
+
+/** @brief Runs the system active import across a tariff switch in this process and reports it on stdout.
+ * @details A single phase unity power factor load runs for VERIFY_TARIFF_SECONDS from a minute before a switch point. The line
+ * frequency moves the window boundaries relative to the RTC, so the switch lands at a different point of a window.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] irms - RMS current.
+ * @param[in] fline - line frequency in Hz.
+ * @return EXIT_SUCCESS if the run produced measurements.
+ */
+static int Run_tariff(double vrms, double irms, double fline)
+{
+  LMA_TariffSchedule schedule;
+  SimulationParams params;
+
+  Tariff_schedule(&schedule);
+  Verify_params(&params, vrms, irms, VERIFY_TARIFF_SECONDS);
+  params.fline = fline;
+  params.clock_start = Clock_seconds(2025, 6, 18, 11, 59, 0);
+  params.p_tariff = &schedule;
+
+  const auto results = Simulation(&params);
+  if (results->measurements.empty() || (LMA_TARIFF_COUNT != results->tariff_wh.size()))
+  {
+    std::cerr << "No measurements were produced at " << fline << " Hz\n";
+    return EXIT_FAILURE;
+  }
+
+  /* Where the switch landed - time since the last window was collected*/
+  const double switch_time = results->tariff_times.empty() ? -1.0 : results->tariff_times.front();
+  double window_end = 0.0;
+  for (const double t : results->measurement_times)
+  {
+    window_end = (t <= switch_time) ? t : window_end;
+  }
+
+  std::cout << VERIFY_TARIFF_TAG << std::setprecision(17) << " " << results->tariff_times.size() << " " << switch_time << " "
+            << (switch_time - window_end) << " " << results->simulated_seconds << " "
+            << results->final_energy.act_imp_energy_wh;
+  for (const float wh : results->tariff_wh)
+  {
+    std::cout << " " << wh;
+  }
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the time of use tariff - the schedule at its edges, then the energy split across a switch.
+ * @details The schedule is looked up through LMA_ClockSet at each side of switch points, midnight, the weekend, the seasons
+ * (including the wrap before the first), a leap day and the special days. The switch then runs in worker processes at three
+ * line frequencies: only the two tariffs either side may count, they must sum to the system active import and the tariff
+ * after the switch must hold the energy of the time after it.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if every lookup and every run passes.
+ */
+static bool Verify_tariff(const char *p_self, const VerifySettings &settings)
+{
+  struct TariffEdge
+  {
+    int time[6];      /**< clock time - year, month, day, hour, minute, second*/
+    uint8_t tariff;   /**< expected tariff*/
+    const char *p_at; /**< what the edge is*/
+  };
+  static const TariffEdge edges[] = {
+      {{2025, 6, 18, 6, 59, 59}, 0, "summer weekday, before the first switch"},
+      {{2025, 6, 18, 7, 0, 0}, 1, "summer weekday, first switch"},
+      {{2025, 6, 18, 11, 59, 59}, 1, "summer weekday, before noon"},
+      {{2025, 6, 18, 12, 0, 0}, 2, "summer weekday, noon"},
+      {{2025, 6, 18, 22, 0, 0}, 0, "summer weekday, last switch"},
+      {{2025, 6, 20, 23, 59, 59}, 0, "Friday, before midnight"},
+      {{2025, 6, 21, 0, 0, 0}, 3, "Saturday, midnight"},
+      {{2025, 2, 28, 12, 0, 0}, 4, "before the first season"},
+      {{2024, 2, 29, 23, 59, 59}, 5, "leap day, before midnight"},
+      {{2024, 3, 1, 0, 0, 0}, 0, "first season starts"},
+      {{2025, 9, 30, 23, 59, 59}, 0, "summer, last second"},
+      {{2025, 10, 1, 0, 0, 0}, 5, "winter starts"},
+      {{2025, 12, 24, 23, 59, 59}, 5, "before a special day"},
+      {{2025, 12, 25, 12, 0, 0}, 7, "special day"},
+      {{2025, 12, 26, 0, 0, 0}, 5, "after a special day"},
+      {{2000, 1, 1, 0, 0, 0}, 7, "clock epoch (special day)"},
+      {{2099, 12, 31, 23, 59, 59}, 5, "end of the century"},
+  };
+  static const double frequencies[] = {47.3, 50.0, 52.9};
+  LMA_TariffSchedule schedule;
+  LMA_Tariff tariff = {};
+  bool pass = true;
+
+  Tariff_schedule(&schedule);
+  tariff.p_schedule = &schedule;
+  LMA_TariffSet(&tariff);
+
+  std::cout << "\n\tTime of Use Schedule (" << (sizeof(edges) / sizeof(edges[0])) << " edges, " << sizeof(LMA_TariffSchedule)
+            << " byte schedule)\n";
+  for (const TariffEdge &edge : edges)
+  {
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-%02d-%02d %02d:%02d:%02d", edge.time[0], edge.time[1], edge.time[2], edge.time[3],
+                  edge.time[4], edge.time[5]);
+    LMA_ClockSet(Clock_seconds(edge.time[0], edge.time[1], edge.time[2], edge.time[3], edge.time[4], edge.time[5]));
+    const bool fail = (edge.tariff != tariff.active);
+
+    std::cout << "\t" << label << "  T" << static_cast<unsigned>(tariff.active) << "  " << edge.p_at
+              << (fail ? "  FAIL (expected T" + std::to_string(edge.tariff) + ")" : "") << "\n";
+    pass = pass && !fail;
+  }
+  LMA_TariffSet(nullptr);
+  LMA_ClockSet(0);
+
+  std::cout << "\n\tTariff Switch (T1 -> T2 at noon, " << VERIFY_TARIFF_SECONDS << " s at Ib, unity)\n"
+            << "\t" << std::setw(7) << "f [Hz]" << std::setw(12) << "Switch [s]" << std::setw(12) << "In window"
+            << std::setw(12) << "T1 [Wh]" << std::setw(12) << "T2 [Wh]" << std::setw(10) << "Sum %" << std::setw(10) << "T2 %"
+            << "\n";
+
+  for (const double fline : frequencies)
+  {
+    std::ostringstream cmd;
+    std::string report;
+    size_t switches = 0;
+    double switch_time = 0.0;
+    double offset = 0.0;
+    double seconds = 0.0;
+    double total_wh = 0.0;
+    double wh[LMA_TARIFF_COUNT] = {};
+    bool valid = false;
+
+    cmd << std::setprecision(17) << "\"" << p_self << "\" --tariff-run " << settings.vrms << " " << settings.ib << " " << fline;
+    if (Run_command(cmd.str(), VERIFY_TARIFF_TAG, &report))
+    {
+      std::istringstream fields(report);
+      valid = static_cast<bool>(fields >> switches >> switch_time >> offset >> seconds >> total_wh);
+      for (double &tariff_wh : wh)
+      {
+        valid = valid && static_cast<bool>(fields >> tariff_wh);
+      }
+    }
+
+    std::cout << "\t" << std::fixed << std::setprecision(1) << std::setw(7) << fline;
+    if (!valid)
+    {
+      std::cout << "  worker failed\n";
+      pass = false;
+      continue;
+    }
+
+    /* Only the tariffs either side of the switch count*/
+    double others_wh = 0.0;
+    for (size_t t = 0; t < LMA_TARIFF_COUNT; ++t)
+    {
+      others_wh += ((1 == t) || (2 == t)) ? 0.0 : wh[t];
+    }
+
+    bool run_pass = (1 == switches) && (0.0 == others_wh);
+    std::cout << std::setprecision(3) << std::setw(12) << switch_time << std::setw(12) << offset << std::setprecision(4)
+              << std::setw(12) << wh[1] << std::setw(12) << wh[2];
+    Print_error(Percent_error(wh[1] + wh[2], total_wh), VERIFY_TARIFF_SUM_TOL, &run_pass);
+    Print_error(Percent_error(wh[2], (settings.vrms * settings.ib * (seconds - switch_time)) / 3600.0), settings.accuracy,
+                &run_pass);
+    std::cout << (run_pass ? "" : "  FAIL") << "\n";
+
+    pass = pass && run_pass;
+  }
+
+  return pass;
+}
+
+/** @brief Builds the load profile the demand checks run against - one factor of Ib per quarter hour.
+ * @details Each day has a night, day, evening and late shape scaled by a factor that changes from day to day. One quarter
+ * hour on the middle day (18:15 to 18:30) is a spike well above every other, so each demand register has a single peak.
+ * @param[in] days - days of profile.
+ * @return the factor of each quarter hour in turn.
+ */
+static std::vector<double> Demand_profile(unsigned days)
+{
+  static const double shape[] = {0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.5, 0.8, 0.7, 0.6, 0.6, 0.6,
+                                 0.7, 0.6, 0.6, 0.6, 0.7, 0.9, 1.0, 1.0, 0.9, 0.7, 0.5, 0.3};
+  const unsigned quarters = 86400U / VERIFY_DEMAND_STEP_SECONDS;
+  std::vector<double> profile;
+
+  for (unsigned day = 0; day < days; ++day)
+  {
+    const double day_factor = 0.8 + (0.1 * ((day * 3U) % 5U));
+    for (unsigned q = 0; q < quarters; ++q)
+    {
+      /* A small ripple within the hour so the sliding demand moves every minute it is updated*/
+      const double ripple = 0.02 * static_cast<double>(q % 4U);
+      profile.push_back(day_factor * (shape[(q * 24U) / quarters] + ripple));
+    }
+  }
+
+  profile[((days / 2U) * quarters) + ((18U * quarters) / 24U) + 1U] = 1.8;
+  return profile;
+}
+
+/** @brief Runs the demand registers over days of load profile in this process and reports them on stdout.
+ * @details A single phase unity power factor load follows Demand_profile from a Monday midnight, so the demand of every
+ * interval is known exactly: the mean of the profile over it. Each interval logged by the simulation is checked against it.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current - the current of a profile factor of 1.
+ * @param[in] days - days of load profile to run.
+ * @return EXIT_SUCCESS if the run produced measurements.
+ */
+static int Run_demand(double vrms, double ib, unsigned days)
+{
+  const std::vector<double> profile = Demand_profile(days);
+  SimulationParams params;
+
+  Verify_params(&params, vrms, ib, static_cast<double>(days) * 86400.0);
+  params.clock_start = Clock_seconds(2025, 6, 16, 0, 0, 0);
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, ib, 0.0, 0.0);
+  params.p_scenario->load_profile = profile;
+  params.p_scenario->load_interval = static_cast<double>(VERIFY_DEMAND_STEP_SECONDS);
+
+  const auto results = Simulation(&params);
+  if (results->measurements.empty() || (SIM_DEMANDS != results->demand_readings.size()))
+  {
+    std::cerr << "No measurements were produced over " << days << " days\n";
+    return EXIT_FAILURE;
+  }
+
+  /* Energy of the profile from the start of the run in Ib seconds*/
+  const auto energy = [&profile](uint32_t t) {
+    const size_t whole = std::min<size_t>(t / VERIFY_DEMAND_STEP_SECONDS, profile.size());
+    double sum = 0.0;
+    for (size_t n = 0; n < whole; ++n)
+    {
+      sum += profile[n] * VERIFY_DEMAND_STEP_SECONDS;
+    }
+    return sum + ((whole < profile.size()) ? (profile[whole] * (t % VERIFY_DEMAND_STEP_SECONDS)) : 0.0);
+  };
+
+  /* Demand intervals of the simulation - see SIM_DEMANDS*/
+  static const uint32_t lengths[SIM_DEMANDS] = {900U, 900U, 1800U};
+  std::cout << VERIFY_DEMAND_TAG << std::setprecision(17);
+  for (size_t d = 0; d < SIM_DEMANDS; ++d)
+  {
+    const LMA_DemandReading &reading = results->demand_readings[d];
+    size_t intervals = 0;
+    double max_error = 0.0;
+    double expected_peak = 0.0;
+    uint32_t expected_time = 0;
+
+    for (const SimulationDemand &logged : results->demands)
+    {
+      const uint32_t end = logged.time - params.clock_start;
+      if ((d != logged.index) || (end < lengths[d]))
+      {
+        continue;
+      }
+
+      const double expected = (vrms * ib * (energy(end) - energy(end - lengths[d]))) / lengths[d];
+      const double error = Percent_error(logged.demand, expected);
+      max_error = (std::fabs(error) > std::fabs(max_error)) ? error : max_error;
+      if (expected > expected_peak)
+      {
+        expected_peak = expected;
+        expected_time = logged.time;
+      }
+      ++intervals;
+    }
+
+    std::cout << " " << intervals << " " << max_error << " " << reading.peak << " " << reading.peak_time << " "
+              << expected_peak << " " << expected_time;
+  }
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the block and sliding demands and their peaks over days of load profile.
+ * @details The days run in a worker process. Every interval of every demand register must be within the class of the mean
+ * of the profile over it, and the peak must be the largest of them with the time it ended.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if every demand register passes.
+ */
+static bool Verify_demand(const char *p_self, const VerifySettings &settings)
+{
+  static const char *const names[SIM_DEMANDS] = {"P 15 min block", "P 15 min sliding", "S 30 min block"};
+  static const uint32_t subintervals[SIM_DEMANDS][2] = {{900U, 1U}, {60U, 15U}, {1800U, 1U}};
+  std::ostringstream cmd;
+  std::string report;
+  bool pass = false;
+
+  std::cout << "\n\tDemand (" << settings.demand_days << " days of load profile from Monday 2025-06-16, Ib = " << settings.ib
+            << " A, class " << settings.accuracy << ")\n";
+
+  const auto start = std::chrono::steady_clock::now();
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --demand-run " << settings.vrms << " " << settings.ib << " "
+      << settings.demand_days;
+  if (!Run_command(cmd.str(), VERIFY_DEMAND_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+  const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "\t" << std::setw(18) << "Register" << std::setw(11) << "Intervals" << std::setw(10) << "Max %"
+            << std::setw(12) << "Peak" << std::setw(10) << "Peak %" << std::setw(22) << "Peak at" << "\n";
+
+  std::istringstream fields(report);
+  pass = true;
+  for (size_t d = 0; d < SIM_DEMANDS; ++d)
+  {
+    size_t intervals = 0;
+    double max_error = 0.0;
+    double peak = 0.0;
+    uint32_t peak_time = 0;
+    double expected_peak = 0.0;
+    uint32_t expected_time = 0;
+
+    if (!(fields >> intervals >> max_error >> peak >> peak_time >> expected_peak >> expected_time))
+    {
+      std::cout << "\t" << std::setw(18) << names[d] << "  worker failed\n";
+      pass = false;
+      continue;
+    }
+
+    /* The first boundary only starts the sub-intervals, the demand follows once the ring is full - the run stops just short
+     * of the boundary at its end*/
+    const size_t boundaries = ((settings.demand_days * 86400U) - 1U) / subintervals[d][0];
+    bool run_pass = (intervals == (boundaries - subintervals[d][1])) && (peak_time == expected_time);
+    std::cout << "\t" << std::setw(18) << names[d] << std::setw(11) << intervals;
+    Print_error(max_error, settings.accuracy, &run_pass);
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << peak;
+    Print_error(Percent_error(peak, expected_peak), settings.accuracy, &run_pass);
+    std::cout << std::setw(22) << SimulationClockText(peak_time)
+              << (run_pass ? "" : "  FAIL (expected " + SimulationClockText(expected_time) + ")") << "\n";
+
+    pass = pass && run_pass;
+  }
+
+  std::cout << std::fixed << std::setprecision(2) << "\t" << settings.demand_days << " days simulated in " << elapsed_seconds
+            << " [s]\n";
+
+  return pass;
+}
+
+/** @brief Records days of load profile to a small flash region in this process, then recovers it and reports on stdout.
+ * @details The load follows Demand_profile from a Monday midnight with 15 minute intervals, so the energy and averages of
+ * every interval are known. The region is VERIFY_PROFILE_SECTORS sectors, so over a few days the oldest sectors are erased
+ * to make room. Once the run ends the region is opened again as after a reset, and random ranges are read from it.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current - the current of a profile factor of 1.
+ * @param[in] days - days of load profile to run.
+ * @param[in] p_path - file of the emulated region - removed before and after the run.
+ * @return EXIT_SUCCESS if the run recorded a profile.
+ */
+static int Run_profile(double vrms, double ib, unsigned days, const char *p_path)
+{
+  const std::vector<double> profile = Demand_profile(days);
+  SimulationParams params;
+
+  std::remove(p_path);
+  Verify_params(&params, vrms, ib, static_cast<double>(days) * 86400.0);
+  params.clock_start = Clock_seconds(2025, 6, 16, 0, 0, 0);
+  params.profile_interval = VERIFY_DEMAND_STEP_SECONDS;
+  params.profile_sectors = VERIFY_PROFILE_SECTORS;
+  params.profile_path = p_path;
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, ib, 0.0, 0.0);
+  params.p_scenario->load_profile = profile;
+  params.p_scenario->load_interval = static_cast<double>(VERIFY_DEMAND_STEP_SECONDS);
+
+  const auto results = Simulation(&params);
+  const std::vector<LMA_ProfileEntry> &held = results->profile;
+  if (held.empty())
+  {
+    std::cerr << "No load profile was recorded over " << days << " days\n";
+    std::remove(p_path);
+    return EXIT_FAILURE;
+  }
+
+  /* Every held entry against the profile - energy, then Vrms, Irms and P*/
+  double max_error[4] = {0.0, 0.0, 0.0, 0.0};
+  bool consecutive = true;
+  for (size_t n = 0; n < held.size(); ++n)
+  {
+    const LMA_ProfileEntry &entry = held[n];
+    const size_t quarter = ((entry.time - params.clock_start) / VERIFY_DEMAND_STEP_SECONDS) - 1U;
+    const double factor = (quarter < profile.size()) ? profile[quarter] : 0.0;
+    const double error[4] = {
+        Percent_error(entry.energy_wh[0], (vrms * ib * factor * VERIFY_DEMAND_STEP_SECONDS) / 3600.0),
+        Percent_error(entry.average[0], vrms), Percent_error(entry.average[1], ib * factor),
+        Percent_error(entry.average[2], vrms * ib * factor)};
+
+    for (size_t e = 0; e < 4; ++e)
+    {
+      max_error[e] = (std::fabs(error[e]) > std::fabs(max_error[e])) ? error[e] : max_error[e];
+    }
+    consecutive = consecutive && ((0 == n) || (entry.time == (held[n - 1].time + VERIFY_DEMAND_STEP_SECONDS)));
+  }
+
+  /* Open the region again as after a reset - the recorder must pick up after the newest record*/
+  ProfileStorage storage;
+  LMA_Profile recovered;
+  std::vector<LMA_ProfileEntry> entries(held.size() + 1U);
+  const auto init_start = std::chrono::steady_clock::now();
+  bool recovery_pass = storage.Open(p_path, SIM_PROFILE_SECTOR_SIZE, VERIFY_PROFILE_SECTORS) &&
+                       LMA_ProfileInit(&recovered, storage.Storage(), VERIFY_DEMAND_STEP_SECONDS);
+  const double init_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - init_start).count();
+  recovery_pass = recovery_pass && (recovered.last.time == held.back().time) &&
+                  (held.size() == LMA_ProfileRead(&recovered, 0, UINT32_MAX, entries.data(),
+                                                  static_cast<uint32_t>(entries.size())));
+  for (size_t n = 0; recovery_pass && (n < held.size()); ++n)
+  {
+    recovery_pass = (entries[n].time == held[n].time) && (0 == std::memcmp(entries[n].energy_wh, held[n].energy_wh,
+                                                                          sizeof(held[n].energy_wh)));
+  }
+
+  /* Random ranges either side of the held entries, each read must match the full read*/
+  const uint64_t reads_before = storage.Stats().reads;
+  const uint32_t span = (held.back().time - held.front().time) + (8U * VERIFY_DEMAND_STEP_SECONDS);
+  uint32_t seed = 12345U;
+  double read_us = 0.0;
+  size_t ranges_pass = 0;
+  for (size_t r = 0; r < VERIFY_PROFILE_RANGES; ++r)
+  {
+    seed = (seed * 1103515245U) + 12345U;
+    const uint32_t from = (held.front().time - (4U * VERIFY_DEMAND_STEP_SECONDS)) + ((seed >> 8) % span);
+    seed = (seed * 1103515245U) + 12345U;
+    const uint32_t to = from + ((seed >> 8) % 86400U);
+    const uint32_t max_count = 1U + (static_cast<uint32_t>(r) % 64U);
+
+    const auto read_start = std::chrono::steady_clock::now();
+    const uint32_t count = LMA_ProfileRead(&recovered, from, to, entries.data(), max_count);
+    read_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - read_start).count();
+
+    std::vector<const LMA_ProfileEntry *> expected;
+    for (const LMA_ProfileEntry &entry : held)
+    {
+      if ((entry.time >= from) && (entry.time < to) && (expected.size() < max_count))
+      {
+        expected.push_back(&entry);
+      }
+    }
+
+    bool match = (expected.size() == count);
+    for (uint32_t n = 0; match && (n < count); ++n)
+    {
+      match = (entries[n].time == expected[n]->time) && (entries[n].average[2] == expected[n]->average[2]);
+    }
+    ranges_pass += match ? 1U : 0U;
+  }
+  const double reads_per_range =
+      static_cast<double>(storage.Stats().reads - reads_before) / static_cast<double>(VERIFY_PROFILE_RANGES);
+  storage.Close();
+  std::remove(p_path);
+
+  const ProfileStorageStats &stats = results->profile_stats;
+  const double record_bytes =
+      static_cast<double>(stats.bytes_written - (stats.erases * LMA_PROFILE_HEADER_SIZE)) / results->profile_records;
+
+  std::cout << VERIFY_PROFILE_TAG << std::setprecision(17) << " " << results->profile_records << " " << held.size() << " "
+            << held.front().time << " " << held.back().time << " " << (consecutive ? 1 : 0) << " " << max_error[0] << " "
+            << max_error[1] << " " << max_error[2] << " " << max_error[3] << " " << stats.erases << " " << record_bytes
+            << " " << (recovery_pass ? 1 : 0) << " " << init_us << " " << ranges_pass << " "
+            << (read_us / VERIFY_PROFILE_RANGES) << " " << reads_per_range << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the load profile recorder over days of load profile.
+ * @details The days run in a worker process. The region must have wrapped and hold the newest intervals without a gap, each
+ * within the class of the profile, and must read back the same after it is opened again - as a whole and in random ranges.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if the load profile passes.
+ */
+static bool Verify_profile(const char *p_self, const VerifySettings &settings)
+{
+  static const char *const names[4] = {"Energy", "Vrms", "Irms", "P"};
+  const std::string path = std::string(p_self) + ".profile";
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << "\n\tLoad Profile (" << settings.profile_days << " days of 15 min intervals from Monday 2025-06-16 into "
+            << VERIFY_PROFILE_SECTORS << " x " << SIM_PROFILE_SECTOR_SIZE << " byte sectors, class " << settings.accuracy
+            << ")\n";
+
+  const auto start = std::chrono::steady_clock::now();
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --profile-run " << settings.vrms << " " << settings.ib << " "
+      << settings.profile_days << " \"" << path << "\"";
+  if (!Run_command(cmd.str(), VERIFY_PROFILE_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+  const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::istringstream fields(report);
+  uint32_t written = 0;
+  size_t held = 0;
+  uint32_t first = 0;
+  uint32_t last = 0;
+  int consecutive = 0;
+  double max_error[4] = {0.0, 0.0, 0.0, 0.0};
+  uint64_t erases = 0;
+  double record_bytes = 0.0;
+  int recovered = 0;
+  double init_us = 0.0;
+  size_t ranges_pass = 0;
+  double read_us = 0.0;
+  double reads_per_range = 0.0;
+  if (!(fields >> written >> held >> first >> last >> consecutive >> max_error[0] >> max_error[1] >> max_error[2] >>
+        max_error[3] >> erases >> record_bytes >> recovered >> init_us >> ranges_pass >> read_us >> reads_per_range))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  /* The interval running at the start is not whole and the run stops just short of the boundary at its end*/
+  const uint32_t expected_written = ((settings.profile_days * 86400U) / VERIFY_DEMAND_STEP_SECONDS) - 2U;
+  bool pass = (written == expected_written) && (0 != erases) && (held < written) && (0 != consecutive);
+  std::cout << std::fixed << std::setprecision(1) << "\t" << written << " records written (" << record_bytes
+            << " bytes each), " << erases << " sectors erased, " << held << " held from " << SimulationClockText(first)
+            << " to " << SimulationClockText(last)
+            << ((pass) ? "" : "  FAIL (expected " + std::to_string(expected_written) + " written and a wrapped region)")
+            << "\n\t";
+
+  for (size_t e = 0; e < 4; ++e)
+  {
+    std::cout << names[e] << " max %";
+    Print_error(max_error[e], settings.accuracy, &pass);
+    std::cout << "  ";
+  }
+
+  pass = pass && (0 != recovered) && (VERIFY_PROFILE_RANGES == ranges_pass);
+  std::cout << std::fixed << std::setprecision(2) << "\n\tRecovered after reset in " << init_us << " [us]"
+            << ((0 != recovered) ? "" : "  FAIL") << ", " << ranges_pass << "/" << VERIFY_PROFILE_RANGES
+            << " range reads match, " << read_us << " [us] and " << std::setprecision(1) << reads_per_range
+            << " storage reads each\n";
+
+  std::cout << std::fixed << std::setprecision(2) << "\t" << settings.profile_days << " days simulated in "
+            << elapsed_seconds << " [s]\n";
+
+  return pass;
+}
+
+/** @brief Replays hours of load profile through a measurement history in this process and reports it on stdout.
+ * @details The windows of the first phase are collected from a run of Demand_profile, then replayed into a history whose
+ * rings are small enough that every level wraps. Each slot held is checked against the windows it covers, computed directly,
+ * and random ranges are read from each level.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current - the current of a profile factor of 1.
+ * @param[in] hours - hours of load profile to run.
+ * @return EXIT_SUCCESS if the run produced measurements.
+ */
+static int Run_history(double vrms, double ib, unsigned hours)
+{
+  static const uint32_t periods[SIM_HISTORY_LEVELS] = {1U, 60U, 3600U};
+  static const uint32_t ring[SIM_HISTORY_LEVELS] = {VERIFY_HISTORY_SECONDS, VERIFY_HISTORY_MINUTES, VERIFY_HISTORY_HOURS};
+  const std::vector<double> profile = Demand_profile((hours + 23U) / 24U);
+  SimulationParams params;
+
+  Verify_params(&params, vrms, ib, static_cast<double>(hours) * 3600.0);
+  params.clock_start = Clock_seconds(2025, 6, 16, 0, 0, 0);
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, ib, 0.0, 0.0);
+  params.p_scenario->load_profile = profile;
+  params.p_scenario->load_interval = static_cast<double>(VERIFY_DEMAND_STEP_SECONDS);
+
+  const auto results = Simulation(&params);
+  const std::vector<LMA_Measurements> &windows = results->measurements;
+  if (windows.empty())
+  {
+    std::cerr << "No measurements were produced over " << hours << " hours\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<uint32_t> times(windows.size());
+  for (size_t w = 0; w < windows.size(); ++w)
+  {
+    times[w] = params.clock_start + static_cast<uint32_t>(results->measurement_times[w]);
+  }
+
+  /* Replay every window, timing each update*/
+  std::vector<LMA_HistorySlot> slots(ring[0] + ring[1] + ring[2]);
+  std::vector<LMA_HistoryLevel> levels(SIM_HISTORY_LEVELS);
+  LMA_History history;
+  for (size_t l = 0, offset = 0; l < SIM_HISTORY_LEVELS; offset += ring[l], ++l)
+  {
+    levels[l].period = periods[l];
+    levels[l].slots = ring[l];
+    levels[l].p_slots = &(slots[offset]);
+  }
+  if (!LMA_HistoryInit(&history, levels.data(), SIM_HISTORY_LEVELS))
+  {
+    std::cerr << "The history levels were refused\n";
+    return EXIT_FAILURE;
+  }
+
+  double update_us = 0.0;
+  double update_max_us = 0.0;
+  for (size_t w = 0; w < windows.size(); ++w)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    LMA_HistoryUpdate(&history, times[w], &(windows[w]));
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    update_us += us;
+    update_max_us = std::max(update_max_us, us);
+  }
+
+  std::cout << VERIFY_HISTORY_TAG << std::setprecision(17) << " " << windows.size();
+  double load_error = 0.0;
+  double read_us = 0.0;
+  uint32_t seed = 12345U;
+  for (uint32_t l = 0; l < SIM_HISTORY_LEVELS; ++l)
+  {
+    /* A slot holds the windows of the slots of the level before which have closed - all before its newest*/
+    const uint32_t frontier = (0 == l) ? UINT32_MAX : levels[l - 1].p_slots[levels[l - 1].newest].time;
+    std::vector<uint32_t> starts;
+    std::vector<LMA_HistorySlot> expected;
+    std::vector<double> sums;
+    for (size_t w = 0; (w < windows.size()) && (times[w] < frontier); ++w)
+    {
+      const uint32_t start = times[w] - (times[w] % periods[l]);
+      if (starts.empty() || (start != starts.back()))
+      {
+        LMA_HistorySlot slot = {start, 0, windows[w], windows[w], windows[w]};
+        starts.push_back(start);
+        expected.push_back(slot);
+        sums.push_back(0.0);
+      }
+      LMA_HistorySlot &slot = expected.back();
+      slot.count++;
+      slot.min.p = std::min(slot.min.p, windows[w].p);
+      slot.max.p = std::max(slot.max.p, windows[w].p);
+      slot.min.vrms = std::min(slot.min.vrms, windows[w].vrms);
+      slot.max.vrms = std::max(slot.max.vrms, windows[w].vrms);
+      sums.back() += windows[w].p;
+    }
+
+    LMA_HistoryRange range;
+    const uint32_t held = LMA_HistoryRead(&history, l, 0, UINT32_MAX, &range);
+    std::vector<const LMA_HistorySlot *> read;
+    for (size_t part = 0; part < 2; ++part)
+    {
+      for (uint32_t n = 0; n < range.count[part]; ++n)
+      {
+        read.push_back(&(range.p_slots[part][n]));
+      }
+    }
+
+    /* Every slot held against the windows it covers - the newest of the expected ones - in order without gaps*/
+    size_t mismatched = 0;
+    double max_error = 0.0;
+    for (size_t n = 0; n < read.size(); ++n)
+    {
+      const LMA_HistorySlot &slot = *(read[n]);
+      const size_t e = expected.size() - read.size() + n;
+      const bool match = (e < expected.size()) && (slot.time == starts[e]) && (slot.count == expected[e].count) &&
+                         (slot.min.p == expected[e].min.p) && (slot.max.p == expected[e].max.p) &&
+                         (slot.min.vrms == expected[e].min.vrms) && (slot.max.vrms == expected[e].max.vrms);
+      mismatched += match ? 0U : 1U;
+      if (match)
+      {
+        const double error = Percent_error(slot.mean.p, sums[e] / expected[e].count);
+        max_error = (std::fabs(error) > std::fabs(max_error)) ? error : max_error;
+      }
+      if ((2U == l) && match)
+      {
+        /* Hourly mean P against the load - the mean of the profile over the hour*/
+        const size_t first = (slot.time - params.clock_start) / VERIFY_DEMAND_STEP_SECONDS;
+        const double factor = (profile[first] + profile[first + 1U] + profile[first + 2U] + profile[first + 3U]) / 4.0;
+        const double error = Percent_error(slot.mean.p, vrms * ib * factor);
+        load_error = (std::fabs(error) > std::fabs(load_error)) ? error : load_error;
+      }
+    }
+
+    /* Random ranges either side of the held slots against the slots read whole*/
+    size_t ranges_pass = 0;
+    const uint32_t first_time = read.front()->time;
+    const uint32_t span = (read.back()->time - first_time) + (8U * periods[l]);
+    for (size_t r = 0; r < VERIFY_HISTORY_RANGES; ++r)
+    {
+      seed = (seed * 1103515245U) + 12345U;
+      const uint32_t from = (first_time - (4U * periods[l])) + ((seed >> 8) % span);
+      seed = (seed * 1103515245U) + 12345U;
+      const uint32_t to = from + ((seed >> 8) % (span / 2U));
+
+      const auto start = std::chrono::steady_clock::now();
+      const uint32_t count = LMA_HistoryRead(&history, l, from, to, &range);
+      read_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+      std::vector<const LMA_HistorySlot *> in_range;
+      for (const LMA_HistorySlot *p_slot : read)
+      {
+        if ((p_slot->time >= from) && (p_slot->time < to))
+        {
+          in_range.push_back(p_slot);
+        }
+      }
+      bool match = (in_range.size() == count) && (count == (range.count[0] + range.count[1]));
+      for (uint32_t n = 0; match && (n < count); ++n)
+      {
+        const LMA_HistorySlot *p_slot =
+            (n < range.count[0]) ? &(range.p_slots[0][n]) : &(range.p_slots[1][n - range.count[0]]);
+        match = (p_slot == in_range[n]);
+      }
+      ranges_pass += match ? 1U : 0U;
+    }
+
+    std::cout << " " << held << " " << std::min<size_t>(expected.size(), ring[l]) << " " << mismatched << " "
+              << max_error << " " << ranges_pass;
+  }
+
+  std::cout << " " << load_error << " " << (update_us / windows.size()) << " " << update_max_us << " "
+            << (read_us / (SIM_HISTORY_LEVELS * VERIFY_HISTORY_RANGES)) << " " << (sizeof(LMA_HistorySlot) * slots.size())
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the measurement history over hours of load profile.
+ * @details The hours run in a worker process. Every level must hold the newest slots its ring has room for, each with the
+ * count, min, max and mean of the windows it covers, the hourly mean of P must be within the class of the load, and random
+ * ranges must read the slots starting in them.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if the history passes.
+ */
+static bool Verify_history(const char *p_self, const VerifySettings &settings)
+{
+  static const char *const names[SIM_HISTORY_LEVELS] = {"Seconds", "Minutes", "Hours"};
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << "\n\tMeasurement History (" << settings.history_hours << " hours of load profile from Monday 2025-06-16 into "
+            << VERIFY_HISTORY_SECONDS << " s, " << VERIFY_HISTORY_MINUTES << " min and " << VERIFY_HISTORY_HOURS
+            << " h rings)\n";
+
+  const auto start = std::chrono::steady_clock::now();
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --history-run " << settings.vrms << " " << settings.ib << " "
+      << settings.history_hours;
+  if (!Run_command(cmd.str(), VERIFY_HISTORY_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+  const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::istringstream fields(report);
+  size_t windows = 0;
+  bool pass = static_cast<bool>(fields >> windows);
+
+  std::cout << "\t" << std::setw(10) << "Level" << std::setw(8) << "Held" << std::setw(12) << "Mismatched" << std::setw(10)
+            << "Mean %" << std::setw(10) << "Ranges" << "\n";
+  for (size_t l = 0; l < SIM_HISTORY_LEVELS; ++l)
+  {
+    size_t held = 0;
+    size_t expected = 0;
+    size_t mismatched = 0;
+    double max_error = 0.0;
+    size_t ranges_pass = 0;
+
+    if (!(fields >> held >> expected >> mismatched >> max_error >> ranges_pass))
+    {
+      std::cout << "\t" << std::setw(10) << names[l] << "  worker failed\n";
+      return false;
+    }
+
+    bool level_pass = (held == expected) && (0 == mismatched) && (VERIFY_HISTORY_RANGES == ranges_pass);
+    std::cout << "\t" << std::setw(10) << names[l] << std::setw(8) << held << std::setw(12) << mismatched;
+    Print_error(max_error, VERIFY_HISTORY_MEAN_TOL, &level_pass);
+    std::cout << std::setw(6) << ranges_pass << "/" << VERIFY_HISTORY_RANGES
+              << (level_pass ? "" : "  FAIL (expected " + std::to_string(expected) + " held)") << "\n";
+    pass = pass && level_pass;
+  }
+
+  double load_error = 0.0;
+  double update_us = 0.0;
+  double update_max_us = 0.0;
+  double read_us = 0.0;
+  size_t bytes = 0;
+  if (!(fields >> load_error >> update_us >> update_max_us >> read_us >> bytes))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::cout << "\tHourly mean P against the load";
+  Print_error(load_error, settings.accuracy, &pass);
+  std::cout << std::fixed << std::setprecision(3) << "\n\t" << windows << " windows, " << update_us << " [us] mean and "
+            << update_max_us << " [us] max per update, " << read_us << " [us] per range read, " << bytes
+            << " bytes of slots\n";
+
+  std::cout << std::fixed << std::setprecision(2) << "\t" << settings.history_hours << " hours simulated in "
+            << elapsed_seconds << " [s]\n";
+
+  return pass;
+}
+
+/** @brief Captures the waveform around overcurrent steps in this process, finds each capture in a recording of the run and
+ * reports it on stdout.
+ * @details The load steps from Ib to twice Ib (above LMA_Config.i_over) every 4 load profile entries. Every frame the driver
+ * consumes is recorded, so each capture must be one run of the recorded frames, ending no more than a couple of TMR periods
+ * before it was read.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current - the current of a profile factor of 1.
+ * @param[in] p_path - file of the recording - removed after the run.
+ * @return EXIT_SUCCESS if the run produced waveform captures.
+ */
+static int Run_waveform(double vrms, double ib, const char *p_path)
+{
+  static const std::vector<double> profile = {1.0, 1.0, 2.0, 2.0};
+  const double period = VERIFY_WAVEFORM_STEP_SECONDS * profile.size();
+  SimulationParams params;
+
+  Verify_params(&params, vrms, ib, VERIFY_WAVEFORM_SECONDS);
+  params.waveform_events = VERIFY_WAVEFORM_EVENTS;
+  params.record_path = p_path;
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, ib, 0.0, 0.0);
+  params.p_scenario->load_profile = profile;
+  params.p_scenario->load_interval = VERIFY_WAVEFORM_STEP_SECONDS;
+
+  const auto results = Simulation(&params);
+  std::unique_ptr<SampleSource> p_recording = CaptureSourceOpen(p_path);
+  if (results->waveforms.empty() || (nullptr == p_recording))
+  {
+    std::cerr << "No waveform was captured over " << VERIFY_WAVEFORM_SECONDS << " s\n";
+    std::remove(p_path);
+    return EXIT_FAILURE;
+  }
+
+  /* The recording holds v, v90, i and the neutral of each frame - a capture holds v, v90 and i*/
+  std::vector<spl_t> recorded;
+  const spl_t *p_frames = nullptr;
+  const size_t frame_size = p_recording->FrameSize();
+  for (size_t count = p_recording->Read(&p_frames, 4096); 0 != count; count = p_recording->Read(&p_frames, 4096))
+  {
+    recorded.insert(recorded.end(), p_frames, p_frames + (count * frame_size));
+  }
+  p_recording.reset();
+  std::remove(p_path);
+
+  const size_t recorded_frames = recorded.size() / frame_size;
+  const size_t tmr_frames = static_cast<size_t>(std::ceil(VERIFY_FS / 100.0));
+  std::cout << VERIFY_WAVEFORM_TAG << std::setprecision(17) << " " << results->waveforms.size();
+  for (const SimulationWaveform &waveform : results->waveforms)
+  {
+    const size_t frames = waveform.frames.size();
+    const size_t read_frame = static_cast<size_t>(std::llround(waveform.read_time * VERIFY_FS));
+    const size_t last = std::min(read_frame, recorded_frames) - std::min(frames, std::min(read_frame, recorded_frames));
+    const size_t first = last - std::min(last, 2U * tmr_frames);
+    size_t matches = 0;
+    size_t start = 0;
+
+    for (size_t f = first; f <= last; ++f)
+    {
+      bool match = true;
+      for (size_t n = 0; (n < frames) && match; ++n)
+      {
+        const spl_t *const p_frame = &(recorded[(f + n) * frame_size]);
+        match = (p_frame[0] == waveform.frames[n].v_sample) && (p_frame[1] == waveform.frames[n].v90_sample) &&
+                (p_frame[2] == waveform.frames[n].i_sample);
+      }
+      start = (match && (0 == matches)) ? f : start;
+      matches += match ? 1U : 0U;
+    }
+
+    /* The step up is the latest start of the third profile entry before the trigger*/
+    const double trigger_time = static_cast<double>(start + waveform.trigger) / VERIFY_FS;
+    const double step_time = (std::floor((trigger_time - (2.0 * VERIFY_WAVEFORM_STEP_SECONDS)) / period) * period) +
+                             (2.0 * VERIFY_WAVEFORM_STEP_SECONDS);
+    const double onset = (step_time * VERIFY_FS) - static_cast<double>(start);
+
+    std::cout << " " << waveform.read_time << " " << waveform.status << " " << waveform.phase_number << " " << frames << " "
+              << waveform.trigger << " " << matches << " " << onset << " " << (trigger_time - step_time);
+  }
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the waveform capture around overcurrent steps.
+ * @details The run is done in a worker process. Each step up must give one event of LMA_OVERCURRENT on the first phase,
+ * SIM_CAPTURE_CYCLES long with SIM_CAPTURE_POST_CYCLES after the trigger, which is found exactly once in the recording of
+ * the run and holds the step before its trigger.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if the waveform capture passes.
+ */
+static bool Verify_waveform(const char *p_self, const VerifySettings &settings)
+{
+  const std::string path = std::string(p_self) + ".cap";
+  const size_t expected_events = static_cast<size_t>(
+      std::ceil((VERIFY_WAVEFORM_SECONDS - (2.0 * VERIFY_WAVEFORM_STEP_SECONDS)) / (4.0 * VERIFY_WAVEFORM_STEP_SECONDS)));
+  const size_t expected_frames = static_cast<size_t>(std::lround(SIM_CAPTURE_CYCLES * VERIFY_FS / 50.0));
+  const size_t expected_trigger =
+      expected_frames - static_cast<size_t>(std::lround(SIM_CAPTURE_POST_CYCLES * VERIFY_FS / 50.0));
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << "\n\tWaveform Capture (" << settings.ib << " A to " << (2.0 * settings.ib) << " A every "
+            << (4.0 * VERIFY_WAVEFORM_STEP_SECONDS) << " s over " << VERIFY_WAVEFORM_SECONDS << " s, " << SIM_CAPTURE_CYCLES
+            << " cycles with " << SIM_CAPTURE_POST_CYCLES << " after the trigger, " << VERIFY_WAVEFORM_EVENTS
+            << " events held)\n";
+
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --waveform-run " << settings.vrms << " " << settings.ib << " \""
+      << path << "\"";
+  if (!Run_command(cmd.str(), VERIFY_WAVEFORM_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::istringstream fields(report);
+  size_t events = 0;
+  bool pass = static_cast<bool>(fields >> events) && (expected_events == events);
+
+  std::cout << "\t" << std::setw(8) << "Event" << std::setw(10) << "Read [s]" << std::setw(8) << "Phase" << std::setw(14)
+            << "Status" << std::setw(9) << "Frames" << std::setw(10) << "Trigger" << std::setw(10) << "Matches"
+            << std::setw(10) << "Onset" << std::setw(14) << "Latency [s]" << "\n";
+  for (size_t e = 0; e < events; ++e)
+  {
+    double read_time = 0.0;
+    uint32_t status = 0;
+    uint32_t phase_number = 0;
+    size_t frames = 0;
+    size_t trigger = 0;
+    size_t matches = 0;
+    double onset = 0.0;
+    double latency = 0.0;
+
+    if (!(fields >> read_time >> status >> phase_number >> frames >> trigger >> matches >> onset >> latency))
+    {
+      std::cout << "\tworker failed\n";
+      return false;
+    }
+
+    /* The onset must fall in the pre-trigger part of the capture*/
+    const bool event_pass = (LMA_OVERCURRENT == status) && (0 == phase_number) && (expected_frames == frames) &&
+                            (expected_trigger == trigger) && (1 == matches) && (onset >= 0.0) &&
+                            (onset < static_cast<double>(trigger));
+    std::cout << "\t" << std::setw(8) << (e + 1) << std::fixed << std::setprecision(3) << std::setw(10) << read_time
+              << std::setw(8) << (phase_number + 1) << std::setw(14)
+              << ((LMA_OVERCURRENT == status) ? "OVERCURRENT" : std::to_string(status)) << std::setw(9) << frames
+              << std::setw(10) << trigger << std::setw(10) << matches << std::setprecision(0) << std::setw(10) << onset
+              << std::setprecision(3) << std::setw(14) << latency << (event_pass ? "" : "  FAIL") << "\n";
+    pass = pass && event_pass;
+  }
+
+  std::cout << "\t" << events << " events captured" << ((expected_events == events) ? "" : "  FAIL (expected " +
+                                                              std::to_string(expected_events) + ")")
+            << "\n";
+
+  return pass;
+}
+
+/** @brief Logs the status events of voltage and load steps in this process and reports them on stdout.
+ * @details The voltage steps to 20% (a sag) and 130% (a swell) of nominal and the load to twice Ib (an overcurrent) and
+ * nothing (no load), each for VERIFY_EVENTS_STEP_SECONDS. LMA_NO_REACTIVE_LOAD follows the window to window noise of Q at unity
+ * power factor, so its events are left out.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current - the current of a profile factor of 1.
+ * @return EXIT_SUCCESS if the run logged status events.
+ */
+static int Run_events(double vrms, double ib)
+{
+  SimulationParams params;
+
+  Verify_params(&params, vrms, ib, VERIFY_EVENTS_SECONDS);
+  params.events = true;
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_SINGLE, vrms, ib, 0.0, 0.0);
+  params.p_scenario->voltage_profile = {1.0, 0.2, 1.0, 1.3};
+  params.p_scenario->voltage_interval = VERIFY_EVENTS_STEP_SECONDS;
+  params.p_scenario->load_profile = {1.0, 1.0, 1.0, 1.0, 2.0, 0.0, 1.0, 1.0};
+  params.p_scenario->load_interval = VERIFY_EVENTS_STEP_SECONDS;
+
+  const auto results = Simulation(&params);
+  if (results->events.empty())
+  {
+    std::cerr << "No status events were logged over " << VERIFY_EVENTS_SECONDS << " s\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<const LMA_Event *> events;
+  for (const LMA_Event &event : results->events)
+  {
+    if (LMA_NO_REACTIVE_LOAD != event.status)
+    {
+      events.push_back(&event);
+    }
+  }
+
+  std::cout << VERIFY_EVENTS_TAG << std::setprecision(9) << " " << results->events.size() << " "
+            << results->event_callbacks << " " << results->events_dropped << " " << events.size();
+  for (const LMA_Event *p_event : events)
+  {
+    std::cout << " " << p_event->status << " " << (p_event->end ? 1 : 0) << " " << p_event->time << " " << p_event->start
+              << " " << p_event->duration << " " << p_event->extreme;
+  }
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the status event log over voltage and load steps.
+ * @details The run is done in a worker process. Every step must log an event raised within a second of the step on the
+ * clock, and ended (but for the last swell) after the time of the step to within a window, with the extreme within the class
+ * of the step. Every event must belong to a step and every event logged must have been passed to the callback.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if the status event log passes.
+ */
+static bool Verify_events(const char *p_self, const VerifySettings &settings)
+{
+  /** @brief one status event the steps give*/
+  typedef struct VerifyEvent
+  {
+    LMA_Status status; /**< status bit*/
+    const char *name;  /**< status name*/
+    double start;      /**< step raising it in seconds*/
+    bool ends;         /**< the step ends within the run*/
+    double extreme;    /**< extreme of the measurement it follows*/
+  } VerifyEvent;
+
+  const double step = VERIFY_EVENTS_STEP_SECONDS;
+  const VerifyEvent expected[] = {
+      {LMA_VOLTAGE_SAG, "Sag", step, true, 0.2 * settings.vrms},
+      {LMA_VOLTAGE_SWELL, "Swell", 3.0 * step, true, 1.3 * settings.vrms},
+      {LMA_OVERCURRENT, "Overcurrent", 4.0 * step, true, 2.0 * settings.ib},
+      {LMA_NO_ACTIVE_LOAD, "No active load", 5.0 * step, true, 0.0},
+      {LMA_NO_APPARENT_LOAD, "No apparent load", 5.0 * step, true, 0.0},
+      {LMA_VOLTAGE_SAG, "Sag", 5.0 * step, true, 0.2 * settings.vrms},
+      {LMA_VOLTAGE_SWELL, "Swell", 7.0 * step, false, 1.3 * settings.vrms}};
+  /* A window is 25 cycles at 50 Hz*/
+  const double window_seconds = 0.5;
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << "\n\tStatus Events (voltage to 20% and 130%, load to 2 Ib and 0 for " << step << " s each over "
+            << VERIFY_EVENTS_SECONDS << " s, class " << settings.accuracy << ")\n";
+
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --events-run " << settings.vrms << " " << settings.ib;
+  if (!Run_command(cmd.str(), VERIFY_EVENTS_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::istringstream fields(report);
+  size_t logged = 0;
+  size_t callbacks = 0;
+  size_t dropped = 0;
+  size_t count = 0;
+  std::vector<LMA_Event> events;
+  bool pass = static_cast<bool>(fields >> logged >> callbacks >> dropped >> count);
+  for (size_t e = 0; (e < count) && pass; ++e)
+  {
+    LMA_Event event = {};
+    uint32_t status = 0;
+    int end = 0;
+
+    pass = static_cast<bool>(fields >> status >> end >> event.time >> event.start >> event.duration >> event.extreme);
+    event.status = static_cast<LMA_Status>(status);
+    event.end = (0 != end);
+    events.push_back(event);
+  }
+  if (!pass)
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::cout << "\t" << std::setw(18) << "Event" << std::setw(11) << "Step [s]" << std::setw(12) << "Raised [s]"
+            << std::setw(14) << "Duration [s]" << std::setw(13) << "Extreme %" << "\n";
+  std::vector<bool> matched(events.size(), false);
+  for (const VerifyEvent &step_event : expected)
+  {
+    const LMA_Event *p_raised = nullptr;
+    const LMA_Event *p_ended = nullptr;
+
+    /* The raising event is followed by the ending event with the same start*/
+    for (size_t e = 0; e < events.size(); ++e)
+    {
+      const LMA_Event &event = events[e];
+      const bool same = (step_event.status == event.status) && !matched[e];
+
+      if (same && (nullptr == p_raised) && !event.end && (event.start >= step_event.start) &&
+          (event.start <= (step_event.start + 1.0)))
+      {
+        p_raised = &event;
+        matched[e] = true;
+      }
+      else if (same && (nullptr != p_raised) && (nullptr == p_ended) && event.end && (event.start == p_raised->start))
+      {
+        p_ended = &event;
+        matched[e] = true;
+      }
+    }
+
+    std::cout << "\t" << std::setw(18) << step_event.name << std::fixed << std::setprecision(1) << std::setw(11)
+              << step_event.start;
+    if ((nullptr == p_raised) || (step_event.ends != (nullptr != p_ended)))
+    {
+      std::cout << "  FAIL (" << ((nullptr == p_raised) ? "not raised" : (step_event.ends ? "not ended" : "ended")) << ")\n";
+      pass = false;
+      continue;
+    }
+
+    const LMA_Event &last = (nullptr != p_ended) ? *p_ended : *p_raised;
+    /* An event still raised only has the window which raised it*/
+    const double duration_expected = step_event.ends ? step : window_seconds;
+    bool event_pass = (std::fabs(last.duration - duration_expected) <= window_seconds);
+    std::cout << std::setw(12) << p_raised->start << std::setprecision(2) << std::setw(14) << last.duration;
+    if (0.0 == step_event.extreme)
+    {
+      /* No load - the current must be within the noise of nothing*/
+      event_pass = event_pass && (std::fabs(last.extreme) < (0.01 * settings.ib));
+      std::cout << std::setw(13) << "-";
+    }
+    else
+    {
+      Print_error(Percent_error(last.extreme, step_event.extreme), settings.accuracy, &event_pass);
+      std::cout << "   ";
+    }
+    std::cout << (event_pass ? "" : "  FAIL") << "\n";
+    pass = pass && event_pass;
+  }
+
+  const size_t unexpected = static_cast<size_t>(std::count(matched.begin(), matched.end(), false));
+  const bool log_pass = (0 == unexpected) && (callbacks == logged) && (0 == dropped);
+  std::cout << "\t" << logged << " events logged, " << callbacks << " passed to the callback, " << dropped << " dropped, "
+            << unexpected << " unexpected" << (log_pass ? "" : "  FAIL") << "\n";
+
+  return pass && log_pass;
+}
+
+/** @brief Calibrates two phases of a wye supply together in this process and reports them on stdout.
+ * @details Every phase is started on the default coefficients and the job is started with LMA, targeting the supply. The
+ * status events are logged and the frequency errors among them counted - the supply is at 50 Hz throughout.
+ * @param[in] vrms - RMS voltage of each phase.
+ * @param[in] ib - basic current - the current of each phase.
+ * @param[in] coherent - end the windows of every phase with the first, calibrating the second and third phases rather than
+ * the first and third.
+ * @return EXIT_SUCCESS if the run calibrated every phase of the job.
+ */
+static int Run_calibration(double vrms, double ib, bool coherent)
+{
+  const uint32_t phases = coherent ? VERIFY_CALIBRATION_COHERENT_PHASES : VERIFY_CALIBRATION_PHASES;
+  SimulationParams params;
+  size_t frequency_errors = 0;
+
+  Verify_params(&params, vrms, ib, VERIFY_CALIBRATION_SECONDS);
+  params.calibrate_async = phases;
+  params.coherent = coherent;
+  params.events = true;
+  params.p_scenario = std::make_shared<Scenario>();
+  ScenarioDefault(params.p_scenario.get(), SCENARIO_WYE, vrms, ib, 0.0, 0.0);
+
+  const auto results = Simulation(&params);
+  if ((3 != results->calibrations.size()) || (2 != results->calib_done_times.size()) ||
+      (results->register_wh.size() < (3 * SIM_PHASE_REGISTERS)))
+  {
+    std::cerr << "The calibration run did not simulate three phases\n";
+    return EXIT_FAILURE;
+  }
+
+  for (const LMA_Event &event : results->events)
+  {
+    frequency_errors += (LMA_FREQUENCY_ERROR == event.status) ? 1 : 0;
+  }
+
+  std::cout << VERIFY_CALIBRATION_TAG << std::setprecision(9) << " " << results->simulated_seconds << " "
+            << results->calib_callbacks << " " << frequency_errors;
+  for (size_t p = 0, n = 0; p < results->calibrations.size(); ++p)
+  {
+    const LMA_PhaseCalibration &calib = results->calibrations[p];
+    const bool calibrated = (0 != (phases & (1U << p)));
+    const double done = calibrated ? (results->calib_done_times[n++] - results->calib_start_time) : 0.0;
+
+    std::cout << " " << calib.vrms_coeff << " " << calib.irms_coeff << " " << calib.p_coeff << " "
+              << calib.vi_phase_correction << " " << done << " " << results->register_wh[p * SIM_PHASE_REGISTERS];
+  }
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks the asynchronous calibration of two phases while the third meters.
+ * @details The run is done in a worker process. Each calibrated phase must find the coefficients of the front end to within
+ * the class and be done in one pass of its two windows - run one after the other they would take twice as long. Each must
+ * call back as it accumulates and as it is done. The uncalibrated phase must meter throughout: a phase reset meters from the
+ * end of its second window, so it counts P over the run less two windows, and a calibrated phase the same less the time it
+ * took to calibrate. With coherent windows a calibrated phase rejoins the windows of the first phase at the end of the one in
+ * progress, so it may count up to one window less. No frequency error may be raised - a phase rejoining part way through a
+ * window of the first phase would take its line cycles over fewer samples.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @param[in] coherent - run with coherent windows.
+ * @return true if the asynchronous calibration passes.
+ */
+static bool Verify_calibration(const char *p_self, const VerifySettings &settings, bool coherent)
+{
+  /* A window is 25 cycles at 50 Hz*/
+  const double window_seconds = VERIFY_CALIBRATION_CYCLES / 50.0;
+  const double p = settings.vrms * settings.ib;
+  const uint32_t phases = coherent ? VERIFY_CALIBRATION_COHERENT_PHASES : VERIFY_CALIBRATION_PHASES;
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << std::defaultfloat << "\n\tAsynchronous Calibration (phases " << (coherent ? "2 and 3" : "1 and 3")
+            << " of a wye supply" << (coherent ? " with coherent windows, " : ", ") << VERIFY_CALIBRATION_CYCLES << " + "
+            << VERIFY_CALIBRATION_CYCLES << " cycles, " << VERIFY_CALIBRATION_SECONDS << " s, class " << settings.accuracy
+            << ")\n";
+
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --calibration-run " << settings.vrms << " " << settings.ib << " "
+      << (coherent ? 1 : 0);
+  if (!Run_command(cmd.str(), VERIFY_CALIBRATION_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::istringstream fields(report);
+  double seconds = 0.0;
+  size_t callbacks = 0;
+  size_t frequency_errors = 0;
+  double values[3][6] = {};
+  bool pass = static_cast<bool>(fields >> seconds >> callbacks >> frequency_errors);
+  for (size_t n = 0; (n < 3) && pass; ++n)
+  {
+    pass = static_cast<bool>(fields >> values[n][0] >> values[n][1] >> values[n][2] >> values[n][3] >> values[n][4] >>
+                             values[n][5]);
+  }
+  if (!pass)
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  /* Energy of a phase metering throughout - over the run less the two windows after its reset*/
+  const double metered_wh = (p * (seconds - (2.0 * window_seconds))) / 3600.0;
+  std::cout << "\t" << std::setw(7) << "Phase" << std::setw(10) << "Vrms c %" << std::setw(10) << "Irms c %" << std::setw(10)
+            << "P c %" << std::setw(11) << "Corr [deg]" << std::setw(10) << "Done [s]" << std::setw(10) << "E %"
+            << "\n";
+  for (size_t n = 0; n < 3; ++n)
+  {
+    const bool calibrated = (0 != (phases & (1U << n)));
+    const double done = values[n][4];
+    const double expected_wh = metered_wh - ((p * done) / 3600.0);
+    bool phase_pass = true;
+
+    std::cout << "\t" << std::setw(7) << (n + 1);
+    if (calibrated)
+    {
+      Print_error(Percent_error(values[n][0], VERIFY_VRMS_COEFF), settings.accuracy, &phase_pass);
+      Print_error(Percent_error(values[n][1], VERIFY_IRMS_COEFF), settings.accuracy, &phase_pass);
+      Print_error(Percent_error(values[n][2], VERIFY_VRMS_COEFF * VERIFY_IRMS_COEFF), settings.accuracy, &phase_pass);
+      /* Both windows in one pass, ending on the TMR after the second*/
+      phase_pass = phase_pass && (done > 0.0) && (done <= ((2.0 * window_seconds) + 0.1));
+      std::cout << std::setprecision(4) << std::setw(11) << values[n][3] << std::setprecision(2) << std::setw(10) << done;
+    }
+    else
+    {
+      std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(11) << "-"
+                << std::setw(10) << "-";
+    }
+    if (coherent && calibrated)
+    {
+      /* Up to a window late rejoining the first phase*/
+      const double late = Percent_error(expected_wh - ((p * window_seconds) / 3600.0), expected_wh);
+      const double error = Percent_error(values[n][5], expected_wh);
+      Print_error(error, 0.0, &phase_pass);
+      phase_pass = phase_pass && (error <= settings.accuracy) && (error >= (late - settings.accuracy));
+    }
+    else
+    {
+      Print_error(Percent_error(values[n][5], expected_wh), settings.accuracy, &phase_pass);
+    }
+    std::cout << (phase_pass ? "" : "  FAIL") << "\n";
+    pass = pass && phase_pass;
+  }
+
+  const bool callback_pass = (4 == callbacks) && (0 == frequency_errors);
+  std::cout << "\t" << callbacks << " callbacks (2 per phase calibrated), " << frequency_errors << " frequency errors"
+            << (callback_pass ? "" : "  FAIL") << "\n";
+
+  return pass && callback_pass;
+}
+
+/** @brief Waits on the measurements of a single phase supply in this process and reports the returns on stdout.
+ * @details The callbacks run on a thread of their own, paced to the wall clock, and the simulation's wait hook is not
+ * installed: the foreground blocks in LMA_MeasurementsWait on the Windows port's condition variable, woken by LMA_PortSignal.
+ * @param[in] vrms - RMS voltage.
+ * @param[in] ib - basic current.
+ * @return EXIT_SUCCESS if the run completed.
+ */
+static int Run_wait(double vrms, double ib)
+{
+  SimulationParams params;
+  double vrms_sum = 0.0;
+  double irms_sum = 0.0;
+  size_t averaged = 0;
+
+  Verify_params(&params, vrms, ib, VERIFY_WAIT_SECONDS);
+  params.realtime = true;
+  params.wait_timeout = VERIFY_WAIT_TMR;
+
+  const auto results = Simulation(&params);
+  for (size_t n = VERIFY_SKIP_WINDOWS; n < results->measurements.size(); ++n)
+  {
+    vrms_sum += results->measurements[n].vrms;
+    irms_sum += results->measurements[n].irms;
+    ++averaged;
+  }
+
+  const auto timeout_range = std::minmax_element(results->wait_timeout_tmr.begin(), results->wait_timeout_tmr.end());
+  const auto ready_max = std::max_element(results->wait_ready_tmr.begin(), results->wait_ready_tmr.end());
+  std::cout << VERIFY_WAIT_TAG << std::setprecision(9) << " " << results->simulated_seconds << " "
+            << results->wait_ready_tmr.size() << " " << results->wait_timeout_tmr.size() << " "
+            << (results->wait_timeout_tmr.empty() ? 0U : *(timeout_range.first)) << " "
+            << (results->wait_timeout_tmr.empty() ? 0U : *(timeout_range.second)) << " "
+            << (results->wait_ready_tmr.empty() ? 0U : *ready_max) << " " << ((0 != averaged) ? (vrms_sum / averaged) : 0.0)
+            << " " << ((0 != averaged) ? (irms_sum / averaged) : 0.0) << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/** @brief Checks LMA_MeasurementsWait and the Windows port's wait and signal without the simulation's wait hook.
+ * @details The run is done in a worker process. Waiting with a timeout of a fifth of a window, every window must be returned
+ * ready with its measurements and the waits between must time out, none early. The TMR calls of a wait are counted by the
+ * driver around it, so they are never fewer than LMA counted - a wait may take up to two more as the foreground is scheduled.
+ * Without LMA_PortSignal the waits would only wake every LMA_PORT_WAIT_MS.
+ * @param[in] p_self - path to this executable.
+ * @param[in] settings - sweep settings.
+ * @return true if the waits pass.
+ */
+static bool Verify_wait(const char *p_self, const VerifySettings &settings)
+{
+  /* A window is 25 cycles at 50 Hz, a TMR call 10 ms*/
+  const double window_tmr = 50.0;
+  std::ostringstream cmd;
+  std::string report;
+
+  std::cout << std::defaultfloat << "\n\tMeasurement Wait (callbacks on a thread, no wait hook, timeout " << VERIFY_WAIT_TMR
+            << " TMR calls, " << VERIFY_WAIT_SECONDS << " s, class " << settings.accuracy << ")\n";
+
+  cmd << std::setprecision(17) << "\"" << p_self << "\" --wait-run " << settings.vrms << " " << settings.ib;
+  if (!Run_command(cmd.str(), VERIFY_WAIT_TAG, &report))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  std::istringstream fields(report);
+  double seconds = 0.0;
+  size_t ready = 0;
+  size_t timeouts = 0;
+  uint32_t timeout_min = 0;
+  uint32_t timeout_max = 0;
+  uint32_t ready_max = 0;
+  double vrms = 0.0;
+  double irms = 0.0;
+  if (!(fields >> seconds >> ready >> timeouts >> timeout_min >> timeout_max >> ready_max >> vrms >> irms))
+  {
+    std::cout << "\tworker failed\n";
+    return false;
+  }
+
+  /* Every window of the run, less the start up (LMA_Start and the first window) and the one in progress at the end*/
+  const size_t windows = static_cast<size_t>((seconds * 100.0) / window_tmr) - 3;
+  bool pass = (ready >= windows) && (ready_max <= (VERIFY_WAIT_TMR + 2U));
+  std::cout << "\t" << ready << " ready (" << windows << " windows at least), at most " << ready_max << " TMR calls"
+            << (pass ? "" : "  FAIL") << "\n";
+
+  const bool timeout_pass = (timeouts >= (windows * 3)) && (timeout_min >= VERIFY_WAIT_TMR) &&
+                            (timeout_max <= (VERIFY_WAIT_TMR + 2U));
+  std::cout << "\t" << timeouts << " timed out, after " << timeout_min << " to " << timeout_max << " TMR calls"
+            << (timeout_pass ? "" : "  FAIL") << "\n";
+
+  bool measurement_pass = true;
+  std::cout << "\tVrms %";
+  Print_error(Percent_error(vrms, settings.vrms), settings.accuracy, &measurement_pass);
+  std::cout << " Irms %";
+  Print_error(Percent_error(irms, settings.ib), settings.accuracy, &measurement_pass);
+  std::cout << (measurement_pass ? "" : "  FAIL") << "\n";
+
+  return pass && timeout_pass && measurement_pass;
+}
+
+int main(int argc, const char *argv[])
+{
+  VerifySettings settings;
+
+  settings.vrms = 230.0;
+  settings.ib = 5.0;
+  settings.imax = 60.0;
+  settings.accuracy = 1.0;
+  settings.duration = 10.0;
+  settings.jobs = std::max(1U, std::thread::hardware_concurrency());
+  settings.rogowski = false;
+  settings.window_min = 0;
+  settings.tariff = false;
+  settings.demand_days = 0;
+  settings.profile_days = 0;
+  settings.history_hours = 0;
+  settings.waveform = false;
+  settings.events = false;
+  settings.calibration = false;
+  settings.wait = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = (i + 1) < argc;
+
+    if ("--point" == arg && (i + 5) < argc)
+    {
+      return Run_point(std::stod(argv[i + 1]), std::stod(argv[i + 2]), std::stod(argv[i + 3]), std::stod(argv[i + 4]),
+                       std::stod(argv[i + 5]), settings.rogowski, settings.window_min);
+    }
+    else if ("--step" == arg && (i + 5) < argc)
+    {
+      return Run_step(std::stod(argv[i + 1]), std::stod(argv[i + 2]), std::stod(argv[i + 3]), std::stod(argv[i + 4]),
+                      static_cast<uint32_t>(std::stoul(argv[i + 5])));
+    }
+    else if ("--tariff-run" == arg && (i + 3) < argc)
+    {
+      return Run_tariff(std::stod(argv[i + 1]), std::stod(argv[i + 2]), std::stod(argv[i + 3]));
+    }
+    else if ("--demand-run" == arg && (i + 3) < argc)
+    {
+      return Run_demand(std::stod(argv[i + 1]), std::stod(argv[i + 2]), static_cast<unsigned>(std::stoul(argv[i + 3])));
+    }
+    else if ("--profile-run" == arg && (i + 4) < argc)
+    {
+      return Run_profile(std::stod(argv[i + 1]), std::stod(argv[i + 2]), static_cast<unsigned>(std::stoul(argv[i + 3])),
+                         argv[i + 4]);
+    }
+    else if ("--history-run" == arg && (i + 3) < argc)
+    {
+      return Run_history(std::stod(argv[i + 1]), std::stod(argv[i + 2]), static_cast<unsigned>(std::stoul(argv[i + 3])));
+    }
+    else if ("--waveform-run" == arg && (i + 3) < argc)
+    {
+      return Run_waveform(std::stod(argv[i + 1]), std::stod(argv[i + 2]), argv[i + 3]);
+    }
+    else if ("--events-run" == arg && (i + 2) < argc)
+    {
+      return Run_events(std::stod(argv[i + 1]), std::stod(argv[i + 2]));
+    }
+    else if ("--wait-run" == arg && (i + 2) < argc)
+    {
+      return Run_wait(std::stod(argv[i + 1]), std::stod(argv[i + 2]));
+    }
+    else if ("--calibration-run" == arg && (i + 3) < argc)
+    {
+      return Run_calibration(std::stod(argv[i + 1]), std::stod(argv[i + 2]), (0 != std::stoi(argv[i + 3])));
+    }
+    else if ("--vrms" == arg && has_value)
+    {
+      settings.vrms = std::stod(argv[++i]);
+    }
+    else if ("--ib" == arg && has_value)
+    {
+      settings.ib = std::stod(argv[++i]);
+    }
+    else if ("--imax" == arg && has_value)
+    {
+      settings.imax = std::stod(argv[++i]);
+    }
+    else if ("--class" == arg && has_value)
+    {
+      settings.accuracy = std::stod(argv[++i]);
+    }
+    else if ("--duration" == arg && has_value)
+    {
+      settings.duration = std::stod(argv[++i]);
+    }
+    else if ("--jobs" == arg && has_value)
+    {
+      settings.jobs = std::max(1, std::stoi(argv[++i]));
+    }
+    else if ("--rogowski" == arg)
+    {
+      settings.rogowski = true;
+    }
+    else if ("--adaptive" == arg && has_value)
+    {
+      settings.window_min = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+    }
+    else if ("--tariff" == arg)
+    {
+      settings.tariff = true;
+    }
+    else if ("--demand" == arg && has_value)
+    {
+      settings.demand_days = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+    }
+    else if ("--profile" == arg && has_value)
+    {
+      settings.profile_days = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+    }
+    else if ("--history" == arg && has_value)
+    {
+      settings.history_hours = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+    }
+    else if ("--waveform" == arg)
+    {
+      settings.waveform = true;
+    }
+    else if ("--events" == arg)
+    {
+      settings.events = true;
+    }
+    else if ("--calibration" == arg)
+    {
+      settings.calibration = true;
+    }
+    else if ("--wait" == arg)
+    {
+      settings.wait = true;
+    }
+    else if ("--help" == arg)
+    {
+      Print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    else
+    {
+      std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+      Print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  const bool rogowski_pass = !settings.rogowski || Verify_rogowski(settings);
+  const bool window_pass = (0 == settings.window_min) || Verify_window(argv[0], settings);
+  const bool tariff_pass = !settings.tariff || Verify_tariff(argv[0], settings);
+  const bool demand_pass = (0 == settings.demand_days) || Verify_demand(argv[0], settings);
+  const bool profile_pass = (0 == settings.profile_days) || Verify_profile(argv[0], settings);
+  const bool history_pass = (0 == settings.history_hours) || Verify_history(argv[0], settings);
+  const bool waveform_pass = !settings.waveform || Verify_waveform(argv[0], settings);
+  const bool events_pass = !settings.events || Verify_events(argv[0], settings);
+  const bool calibration_pass = !settings.calibration || Verify_calibration(argv[0], settings, false);
+  const bool coherent_pass = !settings.calibration || Verify_calibration(argv[0], settings, true);
+  const bool wait_pass = !settings.wait || Verify_wait(argv[0], settings);
+  const std::vector<VerifyPoint> points = Build_sweep(settings);
+  std::vector<VerifyMeasured> measured(points.size());
+  std::atomic<size_t> next_point(0);
+  std::vector<std::thread> workers;
+
+  std::cout << "\n\tAccuracy Sweep (" << points.size() << " points, " << settings.jobs << " jobs, class " << settings.accuracy
+            << ")\n"
+            << std::endl;
+
+  /* Each thread keeps one worker process busy until the sweep is done*/
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned j = 0; j < std::min<size_t>(settings.jobs, points.size()); ++j)
+  {
+    workers.emplace_back([&]() {
+      for (size_t n = next_point++; n < points.size(); n = next_point++)
+      {
+        measured[n] = Run_worker(argv[0], settings, points[n]);
+      }
+    });
+  }
+
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+  const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "\t" << std::setw(8) << "I [A]" << std::setw(7) << "PF" << std::setw(7) << "f [Hz]" << std::setw(10) << "Vrms %"
+            << std::setw(10) << "Irms %" << std::setw(10) << "P %" << std::setw(10) << "Q %" << std::setw(10) << "S %"
+            << std::setw(10) << "E %" << std::setw(10) << "f %" << "  Limit\n";
+
+  size_t passed = 0;
+  for (size_t n = 0; n < points.size(); ++n)
+  {
+    const VerifyPoint &point = points[n];
+    const VerifyMeasured &m = measured[n];
+    const double irms = point.ib_multiple * settings.ib;
+    const double s = settings.vrms * irms;
+    const double p = s * point.pf;
+    const double q = s * std::sqrt(1.0 - (point.pf * point.pf)) * (point.capacitive ? -1.0 : 1.0);
+    std::ostringstream pf;
+    bool pass = m.valid;
+
+    pf << std::fixed << std::setprecision(1) << point.pf << ((1.0 == point.pf) ? " " : (point.capacitive ? "C" : "L"));
+
+    std::cout << "\t" << std::fixed << std::setprecision(2) << std::setw(8) << irms << std::setw(7) << pf.str()
+              << std::setprecision(1) << std::setw(7) << point.fline;
+
+    if (!m.valid)
+    {
+      std::cout << "  worker failed\n";
+      continue;
+    }
+
+    /* Vrms, Irms and fline are checked to the active class - they feed every other quantity*/
+    Print_error(Percent_error(m.vrms, settings.vrms), point.limit_pqs, &pass);
+    Print_error(Percent_error(m.irms, irms), point.limit_pqs, &pass);
+    Print_error(Percent_error(m.p, p), point.limit_pqs, &pass);
+    if (0.0 != point.limit_q)
+    {
+      Print_error(Percent_error(m.q, q), point.limit_q, &pass);
+    }
+    else
+    {
+      std::cout << std::setw(10) << "-";
+    }
+    Print_error(Percent_error(m.s, s), point.limit_pqs, &pass);
+    Print_error(Percent_error(m.energy_wh, (p * m.interval_s) / 3600.0), point.limit_pqs, &pass);
+    Print_error(Percent_error(m.fline, point.fline), point.limit_pqs, &pass);
+
+    std::cout << std::noshowpos << std::setprecision(1) << "  " << point.limit_pqs;
+    if (0.0 != point.limit_q)
+    {
+      std::cout << "/" << point.limit_q;
+    }
+    std::cout << (pass ? "" : "  FAIL") << "\n";
+
+    passed += pass ? 1 : 0;
+  }
+
+  std::cout << std::fixed << std::setprecision(2) << "\n\t" << passed << "/" << points.size() << " points within limits in "
+            << elapsed_seconds << " [s]\n"
+            << std::endl;
+
+  const bool checks_pass = rogowski_pass && window_pass && tariff_pass && demand_pass && profile_pass && history_pass &&
+                           waveform_pass && events_pass && calibration_pass && coherent_pass && wait_pass;
+  return (checks_pass && (passed == points.size())) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -25,6 +25,16 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase)
         ((acc_t)p_phase->p_neutral->inputs.i_sample * (acc_t)p_phase->p_neutral->inputs.i_sample);
   }
 
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.temp.v_sum += (acc_t)p_phase->inputs.v_sample;
+  p_phase->accs.temp.v90_sum += (acc_t)p_phase->inputs.v90_sample;
+  p_phase->accs.temp.i_sum += (acc_t)p_phase->inputs.i_sample;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_temp += (acc_t)p_phase->p_neutral->inputs.i_sample;
+  }
+#endif
+
   ++p_phase->accs.temp.sample_count;
 }
 
@@ -41,6 +51,16 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
         ((acc_t)p_phase->p_neutral->inputs.i_sample * (acc_t)p_phase->p_neutral->inputs.i_sample);
   }
 
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.temp.v_sum = (acc_t)p_phase->inputs.v_sample;
+  p_phase->accs.temp.v90_sum = (acc_t)p_phase->inputs.v90_sample;
+  p_phase->accs.temp.i_sum = (acc_t)p_phase->inputs.i_sample;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_temp = (acc_t)p_phase->p_neutral->inputs.i_sample;
+  }
+#endif
+
   p_phase->accs.temp.sample_count = (uint32_t)0;
 }
 
@@ -55,6 +75,15 @@ void LMA_AccPhaseLoad(LMA_Phase *const p_phase)
   {
     p_phase->p_neutral->accs.i_acc_snapshot = p_phase->p_neutral->accs.i_acc_temp;
   }
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.snapshot.v_sum = p_phase->accs.temp.v_sum;
+  p_phase->accs.snapshot.v90_sum = p_phase->accs.temp.v90_sum;
+  p_phase->accs.snapshot.i_sum = p_phase->accs.temp.i_sum;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_snapshot = p_phase->p_neutral->accs.i_sum_temp;
+  }
+#endif
 }
 
 void LMA_PhaseResetHook(LMA_Phase *const p_phase)
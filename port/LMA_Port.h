@@ -35,6 +35,31 @@
  */
 #define LMA_CRITICAL_SECTION_EXIT()
 
+/** @brief Macro called by LMA while the foreground is blocked waiting on the callbacks (e.g. LMA_Start,
+ * LMA_MeasurementsWait).
+ * @details Generally idles the CPU until the next interrupt (e.g. WFI) or blocks the task until LMA_PORT_SIGNAL. It may return
+ * early - LMA checks what it is waiting on again - but must not miss a signal made since the last return.
+ */
+#define LMA_PORT_WAIT()
+
+/** @brief Macro called by the callbacks when the foreground may stop waiting (a window or calibration finishing, every TMR).
+ * @details Generally empty where any interrupt ends LMA_PORT_WAIT, or used to post a flag or event to the waiting task.
+ */
+#define LMA_PORT_SIGNAL()
+
+/** @brief Macro returning the free running counter read by the trace instrumentation (LMA_TRACE_ENABLE only).
+ * @details Generally a core cycle counter or a free running timer - it must be cheap and readable from any interrupt.
+ */
+#define LMA_TRACE_CYCLES() ((uint32_t)0)
+
+/** @brief Macro returning the number of counts between two LMA_TRACE_CYCLES readings.
+ * @details Handles the counting direction and width of the counter.
+ */
+#define LMA_TRACE_ELAPSED(start, end) ((uint32_t)((end) - (start)))
+
+/** @brief Macro called by LMA_Init to start the trace counter (LMA_TRACE_ENABLE only).*/
+#define LMA_TRACE_INIT()
+
 /** @brief handles sample accumulation for a phase
  * @details Performs:
  * vacc += v_sample ^ 2
@@ -42,6 +67,9 @@
  * pacc += i_sample * v_sample
  * qacc += i_sample * v90_sample
  * and where applicable iacc_neutral += i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL it also performs:
+ * v_sum += v_sample, v90_sum += v90_sample, i_sum += i_sample
+ * and where applicable i_sum_neutral += i_neutral_sample - MAC based ports can keep these in C, they are plain adds.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseRun(LMA_Phase *const p_phase);
@@ -53,6 +81,7 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase);
  * pacc = i_sample * v_sample
  * qacc = i_sample * v90_sample
  * and where applicable iacc_neutral = i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL the sums of the samples are reset in the same way.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseReset(LMA_Phase *const p_phase);
@@ -61,6 +90,7 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase);
  * @details This could be done directly in LMA_Core, however with devices supporting hardware accumulator
  * buffers, the temp values might not be stored where expected for efficiency.
  * So we leave it to the porting layer to manage the accumulators in this way.
+ * With LMA_OFFSET_REMOVAL the sums of the samples are copied as well.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseLoad(LMA_Phase *const p_phase);
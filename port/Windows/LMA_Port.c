@@ -12,10 +12,205 @@
 
 #include "LMA_Port.h"
 
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <time.h>
+#endif
+
 bool tmr_running = false;
 bool adc_running = false;
 bool rtc_running = false;
+void (*p_wait_hook)(void) = NULL;
+
+/* Signal from the callbacks to a waiting foreground - pending until taken by LMA_PortWait, so none is missed between LMA
+ * checking its flag and waiting*/
+static bool signal_pending = false;
+#if defined(_WIN32)
+static SRWLOCK signal_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE signal_cond = CONDITION_VARIABLE_INIT;
+#else
+static pthread_mutex_t signal_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t signal_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+void LMA_PortWait(void)
+{
+  if (NULL != p_wait_hook)
+  {
+    p_wait_hook();
+    return;
+  }
+
+#if defined(_WIN32)
+  AcquireSRWLockExclusive(&signal_lock);
+  if (!signal_pending)
+  {
+    SleepConditionVariableSRW(&signal_cond, &signal_lock, LMA_PORT_WAIT_MS, 0);
+  }
+  signal_pending = false;
+  ReleaseSRWLockExclusive(&signal_lock);
+#else
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += (long)LMA_PORT_WAIT_MS * 1000000L;
+  deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+
+  pthread_mutex_lock(&signal_lock);
+  while (!signal_pending && (0 == pthread_cond_timedwait(&signal_cond, &signal_lock, &deadline)))
+  {
+    /* Spurious wake - wait on*/
+  }
+  signal_pending = false;
+  pthread_mutex_unlock(&signal_lock);
+#endif
+}
+
+void LMA_PortSignal(void)
+{
+  if (NULL != p_wait_hook)
+  {
+    return;
+  }
+
+#if defined(_WIN32)
+  AcquireSRWLockExclusive(&signal_lock);
+  signal_pending = true;
+  ReleaseSRWLockExclusive(&signal_lock);
+  WakeAllConditionVariable(&signal_cond);
+#else
+  pthread_mutex_lock(&signal_lock);
+  signal_pending = true;
+  pthread_mutex_unlock(&signal_lock);
+  pthread_cond_broadcast(&signal_cond);
+#endif
+}
+
+uint32_t LMA_PortCycles(void)
+{
+#if defined(_WIN32)
+  static LARGE_INTEGER freq = {0};
+  LARGE_INTEGER count;
+
+  if (0 == freq.QuadPart)
+  {
+    QueryPerformanceFrequency(&freq);
+  }
+  QueryPerformanceCounter(&count);
+
+  return (uint32_t)(((count.QuadPart / freq.QuadPart) * 1000000000LL) +
+                    (((count.QuadPart % freq.QuadPart) * 1000000000LL) / freq.QuadPart));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+#if LMA_PORT_MACL
+/** @brief Host model of the RA2A2 MACL multiply-accumulate unit.
+ * @details Writing MULBn multiplies it by the value last written to MAC32S and adds the product to MULRn. The RA2A2 port keeps
+ * phase n in MULR(4n) to MULR(4n + 3), so three phases fill the twelve registers.
+ */
+typedef struct MACL_Model
+{
+  spl_t mac32s;    /**< multiplicand (MAC32S)*/
+  acc_t mulr[12U]; /**< accumulators (MULR0 - MULR11)*/
+} MACL_Model;
+
+/** @brief the MACL unit*/
+static MACL_Model macl;
+
+/** @brief Models a write to MULBn.
+ * @param[in] n - register number.
+ * @param[in] b - value written.
+ */
+static void MACL_MulbWrite(uint32_t n, spl_t b)
+{
+  macl.mulr[n] += (acc_t)macl.mac32s * (acc_t)b;
+}
+
+void LMA_AccPhaseRun(LMA_Phase *const p_phase)
+{
+  if (p_phase->phase_number < 3U)
+  {
+    const uint32_t base = p_phase->phase_number * 4U;
+
+    macl.mac32s = p_phase->inputs.i_sample;
+    MACL_MulbWrite(base, p_phase->inputs.i_sample);
+    MACL_MulbWrite(base + 1U, p_phase->inputs.v_sample);
+    MACL_MulbWrite(base + 2U, p_phase->inputs.v90_sample);
+    macl.mac32s = p_phase->inputs.v_sample;
+    MACL_MulbWrite(base + 3U, p_phase->inputs.v_sample);
+
+#if LMA_OFFSET_REMOVAL
+    /* No spare MACL registers - the sums are plain adds*/
+    p_phase->accs.temp.v_sum += (acc_t)p_phase->inputs.v_sample;
+    p_phase->accs.temp.v90_sum += (acc_t)p_phase->inputs.v90_sample;
+    p_phase->accs.temp.i_sum += (acc_t)p_phase->inputs.i_sample;
+#endif
+
+    ++p_phase->accs.temp.sample_count;
+  }
+  else
+  {
+    /* Invalid Phase*/
+  }
+}
+
+void LMA_AccPhaseReset(LMA_Phase *const p_phase)
+{
+  /* Not using temp accs in p_phase->accs.temp - instead using the MACL registers as buffers*/
+  if (p_phase->phase_number < 3U)
+  {
+    const uint32_t base = p_phase->phase_number * 4U;
+
+    macl.mulr[base] = 0LL;
+    macl.mulr[base + 1U] = 0LL;
+    macl.mulr[base + 2U] = 0LL;
+    macl.mulr[base + 3U] = 0LL;
+
+#if LMA_OFFSET_REMOVAL
+    p_phase->accs.temp.v_sum = (acc_t)0;
+    p_phase->accs.temp.v90_sum = (acc_t)0;
+    p_phase->accs.temp.i_sum = (acc_t)0;
+#endif
+
+    p_phase->accs.temp.sample_count = (uint32_t)0;
+  }
+  else
+  {
+    /* Invalid Phase*/
+  }
+}
 
+void LMA_AccPhaseLoad(LMA_Phase *const p_phase)
+{
+  if (p_phase->phase_number < 3U)
+  {
+    const uint32_t base = p_phase->phase_number * 4U;
+
+    p_phase->accs.snapshot.i_acc = macl.mulr[base];
+    p_phase->accs.snapshot.p_acc = macl.mulr[base + 1U];
+    p_phase->accs.snapshot.q_acc = macl.mulr[base + 2U];
+    p_phase->accs.snapshot.v_acc = macl.mulr[base + 3U];
+#if LMA_OFFSET_REMOVAL
+    p_phase->accs.snapshot.v_sum = p_phase->accs.temp.v_sum;
+    p_phase->accs.snapshot.v90_sum = p_phase->accs.temp.v90_sum;
+    p_phase->accs.snapshot.i_sum = p_phase->accs.temp.i_sum;
+#endif
+    p_phase->accs.snapshot.sample_count = p_phase->accs.temp.sample_count;
+  }
+  else
+  {
+    /* Invalid Phase*/
+  }
+}
+#else
 void LMA_AccPhaseRun(LMA_Phase *const p_phase)
 {
   p_phase->accs.temp.v_acc += ((acc_t)p_phase->inputs.v_sample * (acc_t)p_phase->inputs.v_sample);
@@ -29,6 +224,16 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase)
         ((acc_t)p_phase->p_neutral->inputs.i_sample * (acc_t)p_phase->p_neutral->inputs.i_sample);
   }
 
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.temp.v_sum += (acc_t)p_phase->inputs.v_sample;
+  p_phase->accs.temp.v90_sum += (acc_t)p_phase->inputs.v90_sample;
+  p_phase->accs.temp.i_sum += (acc_t)p_phase->inputs.i_sample;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_temp += (acc_t)p_phase->p_neutral->inputs.i_sample;
+  }
+#endif
+
   ++p_phase->accs.temp.sample_count;
 }
 
@@ -44,6 +249,16 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
     p_phase->p_neutral->accs.i_acc_temp = 0LL;
   }
 
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.temp.v_sum = (acc_t)0;
+  p_phase->accs.temp.v90_sum = (acc_t)0;
+  p_phase->accs.temp.i_sum = (acc_t)0;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_temp = (acc_t)0;
+  }
+#endif
+
   p_phase->accs.temp.sample_count = (uint32_t)0;
 }
 
@@ -58,7 +273,17 @@ void LMA_AccPhaseLoad(LMA_Phase *const p_phase)
   {
     p_phase->p_neutral->accs.i_acc_snapshot = p_phase->p_neutral->accs.i_acc_temp;
   }
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.snapshot.v_sum = p_phase->accs.temp.v_sum;
+  p_phase->accs.snapshot.v90_sum = p_phase->accs.temp.v90_sum;
+  p_phase->accs.snapshot.i_sum = p_phase->accs.temp.i_sum;
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->accs.i_sum_snapshot = p_phase->p_neutral->accs.i_sum_temp;
+  }
+#endif
 }
+#endif
 
 void LMA_PhaseResetHook(LMA_Phase *const p_phase)
 {
@@ -21,6 +21,13 @@
 
 #include "LMA_Types.h"
 
+#ifndef LMA_PORT_MACL
+/** @brief Accumulate through a host model of the RA2A2 MACL unit (1) rather than in C (0).
+ * @details Runs the register mapping of the RA2A2 port - three phases at most and no neutral accumulation.
+ */
+  #define LMA_PORT_MACL (0)
+#endif
+
 /** @brief Macro to prepare function/code block for a crticial section.
  * @details Generally stores interrupt state information for restoration on exit of critical section.
  */
@@ -36,6 +43,48 @@
  */
 #define LMA_CRITICAL_SECTION_EXIT()
 
+/** @brief Macro called by LMA while the foreground is blocked waiting on the callbacks (e.g. LMA_Start,
+ * LMA_MeasurementsWait).
+ * @details Calls the wait hook installed by the simulation, which drives the callbacks from the same thread - otherwise
+ * blocks on a condition variable until LMA_PORT_SIGNAL.
+ */
+#define LMA_PORT_WAIT() LMA_PortWait()
+
+/** @brief Macro called by the callbacks when the foreground may stop waiting (a window or calibration finishing, every TMR).
+ * @details Wakes LMA_PORT_WAIT when the callbacks run on a thread of their own.
+ */
+#define LMA_PORT_SIGNAL() LMA_PortSignal()
+
+/** @brief Longest LMA_PortWait blocks without a signal in milliseconds - a wait with nothing running cannot hang.*/
+#define LMA_PORT_WAIT_MS (100U)
+
+/** @brief Macro returning the free running counter read by the trace instrumentation (LMA_TRACE_ENABLE only).
+ * @details Nanoseconds of the host monotonic clock.
+ */
+#define LMA_TRACE_CYCLES() LMA_PortCycles()
+
+/** @brief Macro returning the number of counts between two LMA_TRACE_CYCLES readings.*/
+#define LMA_TRACE_ELAPSED(start, end) ((uint32_t)((end) - (start)))
+
+/** @brief Macro called by LMA_Init to start the trace counter (LMA_TRACE_ENABLE only).*/
+#define LMA_TRACE_INIT()
+
+/** @brief Hook called while the foreground is blocked waiting on the callbacks.
+ * @details Calls p_wait_hook when one is installed, otherwise waits (at most LMA_PORT_WAIT_MS) until LMA_PortSignal has been
+ * called since the last return.
+ */
+void LMA_PortWait(void);
+
+/** @brief Hook called by the callbacks when the foreground may stop waiting.
+ * @details Does nothing while p_wait_hook is installed - the callbacks then run within LMA_PortWait.
+ */
+void LMA_PortSignal(void);
+
+/** @brief Reads the host monotonic clock for the trace instrumentation.
+ * @return monotonic time in nanoseconds (wraps every ~4.3s).
+ */
+uint32_t LMA_PortCycles(void);
+
 /** @brief handles sample accumulation for a phase
  * @details Performs:
  * vacc += v_sample ^ 2
@@ -43,6 +92,9 @@
  * pacc += i_sample * v_sample
  * qacc += i_sample * v90_sample
  * and where applicable iacc_neutral += i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL it also performs:
+ * v_sum += v_sample, v90_sum += v90_sample, i_sum += i_sample
+ * and where applicable i_sum_neutral += i_neutral_sample - MAC based ports can keep these in C, they are plain adds.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseRun(LMA_Phase *const p_phase);
@@ -54,6 +106,7 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase);
  * pacc = i_sample * v_sample
  * qacc = i_sample * v90_sample
  * and where applicable iacc_neutral = i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL the sums of the samples are reset in the same way.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseReset(LMA_Phase *const p_phase);
@@ -62,6 +115,7 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase);
  * @details This could be done directly in LMA_Core, however with devices supporting hardware accumulator
  * buffers, the temp values might not be stored where expected for efficiency.
  * So we leave it to the porting layer to manage the accumulators in this way.
+ * With LMA_OFFSET_REMOVAL the sums of the samples are copied as well.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseLoad(LMA_Phase *const p_phase);
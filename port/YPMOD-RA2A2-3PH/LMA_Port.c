@@ -101,6 +101,16 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase)
   {
     /* Invalid Phase*/
   }
+
+#if LMA_OFFSET_REMOVAL
+  /* The MACL registers are all in use - the sums are plain adds*/
+  if (p_phase->phase_number < 3U)
+  {
+    p_phase->accs.temp.v_sum += (acc_t)p_phase->inputs.v_sample;
+    p_phase->accs.temp.v90_sum += (acc_t)p_phase->inputs.v90_sample;
+    p_phase->accs.temp.i_sum += (acc_t)p_phase->inputs.i_sample;
+  }
+#endif
 }
 
 void LMA_AccPhaseReset(LMA_Phase *const p_phase)
@@ -114,6 +124,8 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
     R_MACL->MULR1.MULRH = 0;
     R_MACL->MULR2.MULRL = 0;
     R_MACL->MULR2.MULRH = 0;
+    R_MACL->MULR3.MULRL = 0;
+    R_MACL->MULR3.MULRH = 0;
 
     p_phase->accs.temp.sample_count = 0;
   }
@@ -125,6 +137,8 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
     R_MACL->MULR5.MULRH = 0;
     R_MACL->MULR6.MULRL = 0;
     R_MACL->MULR6.MULRH = 0;
+    R_MACL->MULR7.MULRL = 0;
+    R_MACL->MULR7.MULRH = 0;
 
     p_phase->accs.temp.sample_count = 0;
   }
@@ -136,6 +150,8 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
     R_MACL->MULR9.MULRH = 0;
     R_MACL->MULR10.MULRL = 0;
     R_MACL->MULR10.MULRH = 0;
+    R_MACL->MULR11.MULRL = 0;
+    R_MACL->MULR11.MULRH = 0;
 
     p_phase->accs.temp.sample_count = 0;
   }
@@ -143,6 +159,15 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase)
   {
     /* Invalid Phase*/
   }
+
+#if LMA_OFFSET_REMOVAL
+  if (p_phase->phase_number < 3U)
+  {
+    p_phase->accs.temp.v_sum = (acc_t)0;
+    p_phase->accs.temp.v90_sum = (acc_t)0;
+    p_phase->accs.temp.i_sum = (acc_t)0;
+  }
+#endif
 }
 
 void LMA_AccPhaseLoad(LMA_Phase *const p_phase)
@@ -199,6 +224,15 @@ void LMA_AccPhaseLoad(LMA_Phase *const p_phase)
   {
     /* Invalid Phase*/
   }
+
+#if LMA_OFFSET_REMOVAL
+  if (p_phase->phase_number < 3U)
+  {
+    p_phase->accs.snapshot.v_sum = p_phase->accs.temp.v_sum;
+    p_phase->accs.snapshot.v90_sum = p_phase->accs.temp.v90_sum;
+    p_phase->accs.snapshot.i_sum = p_phase->accs.temp.i_sum;
+  }
+#endif
 }
 
 void LMA_PhaseResetHook(LMA_Phase *const p_phase)
@@ -36,6 +36,33 @@
  */
 #define LMA_CRITICAL_SECTION_EXIT() __set_PRIMASK(interrupt_save)
 
+/** @brief Macro called by LMA while the foreground is blocked waiting on the callbacks (e.g. LMA_Start,
+ * LMA_MeasurementsWait).
+ * @details Sleeps until the next interrupt - an interrupt just before the sleep delays the wake by at most an ADC period.
+ */
+#define LMA_PORT_WAIT() __WFI()
+
+/** @brief Macro called by the callbacks when the foreground may stop waiting (a window or calibration finishing, every TMR).
+ * @details Empty - the interrupt calling it ends LMA_PORT_WAIT.
+ */
+#define LMA_PORT_SIGNAL()
+
+/** @brief Macro returning the free running counter read by the trace instrumentation (LMA_TRACE_ENABLE only).
+ * @details The Cortex-M23 has no DWT cycle counter, so SysTick is run free (no interrupt) at the core clock.
+ */
+#define LMA_TRACE_CYCLES() (SysTick->VAL)
+
+/** @brief Macro returning the number of counts between two LMA_TRACE_CYCLES readings.
+ * @details SysTick is a 24 bit down counter.
+ */
+#define LMA_TRACE_ELAPSED(start, end) ((uint32_t)(((start) - (end)) & SysTick_VAL_CURRENT_Msk))
+
+/** @brief Macro called by LMA_Init to start the trace counter (LMA_TRACE_ENABLE only).*/
+#define LMA_TRACE_INIT()                                                                                                       \
+  SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;                                                                                     \
+  SysTick->VAL = 0UL;                                                                                                          \
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk
+
 /** @brief handles sample accumulation for a phase
  * @details Performs:
  * vacc += v_sample ^ 2
@@ -43,6 +70,9 @@
  * pacc += i_sample * v_sample
  * qacc += i_sample * v90_sample
  * and where applicable iacc_neutral += i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL it also performs:
+ * v_sum += v_sample, v90_sum += v90_sample, i_sum += i_sample
+ * and where applicable i_sum_neutral += i_neutral_sample - MAC based ports can keep these in C, they are plain adds.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseRun(LMA_Phase *const p_phase);
@@ -54,6 +84,7 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase);
  * pacc = i_sample * v_sample
  * qacc = i_sample * v90_sample
  * and where applicable iacc_neutral = i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL the sums of the samples are reset in the same way.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseReset(LMA_Phase *const p_phase);
@@ -62,6 +93,7 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase);
  * @details This could be done directly in LMA_Core, however with devices supporting hardware accumulator
  * buffers, the temp values might not be stored where expected for efficiency.
  * So we leave it to the porting layer to manage the accumulators in this way.
+ * With LMA_OFFSET_REMOVAL the sums of the samples are copied as well.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseLoad(LMA_Phase *const p_phase);
@@ -30,6 +30,7 @@
     {                                                                                                                          \
       asm("ei");                                                                                                               \
     }
+  #define LMA_PORT_HALT() asm("halt")
 
 /* CCRL Toolchain*/
 #elif defined(__CCRL__)
@@ -41,6 +42,7 @@
     {                                                                                                                          \
       __EI();                                                                                                                  \
     }
+  #define LMA_PORT_HALT() __halt()
 
 /* IAR Toolcahin*/
 #elif define(__ICCRL78__)
@@ -49,11 +51,43 @@
   #define LMA_CRITICAL_SECTION_PREPARE() __istate_t _cs_is = __get_interrupt_state()
   #define LMA_CRITICAL_SECTION_ENTER() __disable_interrupt()
   #define LMA_CRITICAL_SECTION_EXIT() __set_interrupt_state(_cs_is)
+  #define LMA_PORT_HALT() __halt()
 
 #else
   #error "Unsupported compiler!"
 #endif
 
+/** @brief Macro called by LMA while the foreground is blocked waiting on the callbacks (e.g. LMA_Start,
+ * LMA_MeasurementsWait).
+ * @details HALTs until the next interrupt (the DSADC, TAU and RTC run in HALT) - an interrupt just before the HALT delays the
+ * wake by at most an ADC period.
+ */
+#define LMA_PORT_WAIT() LMA_PORT_HALT()
+
+/** @brief Macro called by the callbacks when the foreground may stop waiting (a window or calibration finishing, every TMR).
+ * @details Empty - the interrupt calling it ends LMA_PORT_WAIT.
+ */
+#define LMA_PORT_SIGNAL()
+
+#if LMA_TRACE_ENABLE
+  #include "iodefine.h"
+#endif
+
+/** @brief Macro returning the free running counter read by the trace instrumentation (LMA_TRACE_ENABLE only).
+ * @details Reads the TAU0 channel 0 counter which also generates the TMR interrupt, so it counts TAU clocks and only runs
+ * once LMA_TMR_Start has been called.
+ */
+#define LMA_TRACE_CYCLES() ((uint32_t)TCR00)
+
+/** @brief Macro returning the number of counts between two LMA_TRACE_CYCLES readings.
+ * @details TCR00 counts down from TDR00 and reloads, so sections longer than the TMR period (10ms) are not measurable.
+ */
+#define LMA_TRACE_ELAPSED(start, end)                                                                                          \
+  (((start) >= (end)) ? ((start) - (end)) : (((start) + (uint32_t)TDR00 + (uint32_t)1) - (end)))
+
+/** @brief Macro called by LMA_Init to start the trace counter (LMA_TRACE_ENABLE only).*/
+#define LMA_TRACE_INIT()
+
 /** @brief handles sample accumulation for a phase
  * @details Performs:
  * vacc += v_sample ^ 2
@@ -61,6 +95,9 @@
  * pacc += i_sample * v_sample
  * qacc += i_sample * v90_sample
  * and where applicable iacc_neutral += i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL it also performs:
+ * v_sum += v_sample, v90_sum += v90_sample, i_sum += i_sample
+ * and where applicable i_sum_neutral += i_neutral_sample - MAC based ports can keep these in C, they are plain adds.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseRun(LMA_Phase *const p_phase);
@@ -72,6 +109,7 @@ void LMA_AccPhaseRun(LMA_Phase *const p_phase);
  * pacc = i_sample * v_sample
  * qacc = i_sample * v90_sample
  * and where applicable iacc_neutral = i_neutral_sample ^ 2
+ * With LMA_OFFSET_REMOVAL the sums of the samples are reset in the same way.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseReset(LMA_Phase *const p_phase);
@@ -80,6 +118,7 @@ void LMA_AccPhaseReset(LMA_Phase *const p_phase);
  * @details This could be done directly in LMA_Core, however with devices supporting hardware accumulator
  * buffers, the temp values might not be stored where expected for efficiency.
  * So we leave it to the porting layer to manage the accumulators in this way.
+ * With LMA_OFFSET_REMOVAL the sums of the samples are copied as well.
  * @param[inout] p_phase - pointer to the phase we are working with.
  */
 void LMA_AccPhaseLoad(LMA_Phase *const p_phase);
@@ -17,13 +17,13 @@
  */
 typedef struct LMA_CalibFs_str
 {
-  bool start;           /**< flag to indicate starting fs calibration routine */
-  bool running;         /**< flag to indicate we are running */
-  bool finished;        /**< flag to indicate calibration is finished */
-  bool active;          /**< flag to indicate calibration of global params is active*/
-  uint32_t rtc_counter; /**< counter to count rtc cycles for accumulation */
-  uint32_t adc_counter; /**< counter to count number of ADC cycles have accumulated. */
-  LMA_Phase *p_phase;   /**< pinter to phase to work on */
+  volatile bool start;           /**< flag to indicate starting fs calibration routine */
+  volatile bool running;         /**< flag to indicate we are running */
+  volatile bool finished;        /**< flag to indicate calibration is finished */
+  volatile bool active;          /**< flag to indicate calibration of global params is active*/
+  uint32_t rtc_counter;          /**< counter to count rtc cycles for accumulation */
+  volatile uint32_t adc_counter; /**< counter to count number of ADC cycles have accumulated. */
+  LMA_Phase *p_phase;            /**< pinter to phase to work on */
 } LMA_CalibFs;
 
 /**
@@ -36,11 +36,67 @@ typedef struct LMA_PhaseList_str
   uint32_t phase_count;     /**< number of phases total*/
 } LMA_PhaseList;
 
+/**
+ * @brief Internal system energy register index
+ * @details One register per counter of LMA_Energy, counted by Registers_run - the registers driving each LED are adjacent.
+ */
+typedef enum LMA_SysRegister_e
+{
+  SYS_REG_ACT_IMP = 0, /**< Active import - active LED*/
+  SYS_REG_ACT_EXP,     /**< Active export - active LED*/
+  SYS_REG_APP_IMP,     /**< Apparent import - apparent LED*/
+  SYS_REG_APP_EXP,     /**< Apparent export - apparent LED*/
+  SYS_REG_C_REACT_IMP, /**< C reactive import (quadrant II) - reactive LED*/
+  SYS_REG_C_REACT_EXP, /**< C reactive export (quadrant IV) - reactive LED*/
+  SYS_REG_L_REACT_IMP, /**< L reactive import (quadrant I) - reactive LED*/
+  SYS_REG_L_REACT_EXP, /**< L reactive export (quadrant III) - reactive LED*/
+  SYS_REG_COUNT        /**< Number of system energy registers*/
+} LMA_SysRegister;
+
+/**
+ * @brief Internal complex number
+ * @details Phasor used by the symmetrical components.
+ */
+typedef struct LMA_Complex_str
+{
+  float re; /**< real part*/
+  float im; /**< imaginary part*/
+} LMA_Complex;
+
 /* Static/Local Variable Declarations*/
 static LMA_Config *p_config = NULL; /**< Internal copy of the meter configuration */
 static LMA_CalibFs calib_fs = {false,       false,       false, false,
                                (uint32_t)0, (uint32_t)0, NULL}; /**< Instance of the fs calibration data */
 static LMA_PhaseList phase_list = {NULL, (uint32_t)0};          /**< Internal phase list*/
+static uint32_t window_max = UINT32_MAX;                        /**< Longest window the accumulators hold (line cycles)*/
+static LMA_ComputedNeutral *p_computed_neutral = NULL;          /**< Computed neutral (if registered)*/
+static LMA_SystemMeasurements *p_system_measurements = NULL;    /**< System measurements (if registered)*/
+static uint32_t adc_tick = (uint32_t)0;                         /**< ADC callback counter - timestamps the zero crosses*/
+static LMA_Register *p_registers = NULL;                        /**< Energy register table (if set)*/
+static uint32_t register_count = (uint32_t)0;                   /**< Number of entries in the energy register table*/
+static LMA_Tariff *p_tariff = NULL;                             /**< Time of use tariff (if set)*/
+static LMA_Register *p_tariff_register = NULL;                  /**< Register of the active tariff - counted in LMA_CB_ADC*/
+static uint32_t clock_seconds = (uint32_t)0;                    /**< Local time - seconds since 2000-01-01 00:00:00*/
+static uint32_t clock_rtc_count = (uint32_t)0;                  /**< LMA_CB_RTC calls into the current second*/
+static LMA_Demand *p_demands = NULL;                            /**< Demand table (if set)*/
+static uint32_t demand_count = (uint32_t)0;                     /**< Number of entries in the demand table*/
+static LMA_Capture *p_capture = NULL;                           /**< Waveform capture (if set)*/
+static LMA_EventLog *p_event_log = NULL;                        /**< Status event log (if set)*/
+static volatile uint32_t tmr_tick = (uint32_t)0;                /**< TMR callback counter - times LMA_MeasurementsWait*/
+static LMA_CalibJob *p_calib_job = NULL;                        /**< Asynchronous calibration running (if any)*/
+
+#if LMA_TRACE_ENABLE
+static LMA_TraceStats trace_stats[LMA_TRACE_COUNT]; /**< Latency histogram of each trace point*/
+
+  /** @brief Marks the start of a traced section (reads the port cycle counter).*/
+  #define LMA_TRACE_BEGIN(id) const uint32_t trace_start_##id = LMA_TRACE_CYCLES()
+
+  /** @brief Marks the end of a traced section and records its duration.*/
+  #define LMA_TRACE_END(id) Trace_record((id), trace_start_##id)
+#else
+  #define LMA_TRACE_BEGIN(id)
+  #define LMA_TRACE_END(id)
+#endif
 
 static LMA_SystemEnergy sys_energy = /**< System Energy*/
     {
@@ -82,105 +138,1498 @@ static LMA_SystemEnergy sys_energy = /**< System Energy*/
             },
 };
 
+static LMA_Register sys_registers[SYS_REG_COUNT]; /**< Registers counting the system energy - sys_energy is their stored view*/
+
 /* Static/Local functions*/
 
+#if LMA_TRACE_ENABLE
+/** @brief Records the duration of a traced section.
+ * @details Each trace point is only recorded from one context, so no critical section is needed here.
+ * @param[in] id - trace point.
+ * @param[in] start - cycle count read at the start of the section.
+ */
+static void Trace_record(const LMA_TraceId id, const uint32_t start)
+{
+  const uint32_t end = LMA_TRACE_CYCLES();
+  const uint32_t cycles = LMA_TRACE_ELAPSED(start, end);
+  LMA_TraceStats *const p_stats = &(trace_stats[id]);
+  uint32_t bucket = (uint32_t)0;
+  uint32_t remaining = cycles;
+
+  /* log2 bucket - 0 cycles in bucket 0, [2^(b-1), 2^b) in bucket b*/
+  while ((uint32_t)0 != remaining && bucket < (LMA_TRACE_BUCKETS - 1U))
+  {
+    remaining >>= 1;
+    ++bucket;
+  }
+
+  ++p_stats->buckets[bucket];
+  ++p_stats->count;
+
+  if ((uint32_t)1 == p_stats->count || cycles < p_stats->min)
+  {
+    p_stats->min = cycles;
+  }
+
+  if (cycles > p_stats->max)
+  {
+    p_stats->max = cycles;
+  }
+
+  if ((uint32_t)0 != p_stats->budget && cycles > p_stats->budget)
+  {
+    ++p_stats->overruns;
+  }
+}
+/* END OF FUNCTION*/
+#endif
+
 /** @brief Check for zero cross
  * @param[inout] p_zc - pointer to the zero cross object to work on.
+ * @param[in] new_spl - voltage sample.
+ * @param[in] tick - ADC callback count of the sample, recorded with the samples either side of a zero cross.
  * @note The zero cross runs a imple LPF with coefficient 0.5 to ensure stable crossing detection.
  * This is only used for sample synchronisation in computation windows and phase angle error detection during calibration.
  * The impacts of this should be evaluated in the end system.
  * @return true if new zero cross detected - false otherwise.
  */
-static bool Zero_cross_detect(LMA_ZeroCross *const p_zc, const spl_t new_spl)
+static bool Zero_cross_detect(LMA_ZeroCross *const p_zc, const spl_t new_spl, const uint32_t tick)
 {
   spl_t filtered_new_sample = (spl_t)0;
 
   /* If we have running for the first time*/
   if (p_zc->already_run)
   {
-    filtered_new_sample = (new_spl >> 1) + (p_zc->last_sample >> 1);
+    filtered_new_sample = (new_spl >> 1) + (p_zc->last_sample >> 1);
+  }
+  else
+  {
+    /* Otherwise prime the initial value*/
+    filtered_new_sample = new_spl;
+    p_zc->last_sample = new_spl;
+    p_zc->already_run = true;
+  }
+
+  if ((!p_zc->debounce) && (p_zc->last_sample < (spl_t)0) && (filtered_new_sample >= (spl_t)0))
+  {
+    ++p_zc->count;
+    p_zc->debounce = true;
+    p_zc->first_event = true;
+    p_zc->cross_tick = tick;
+    p_zc->cross_below = p_zc->last_sample;
+    p_zc->cross_above = filtered_new_sample;
+  }
+  else
+  {
+    p_zc->debounce = false;
+  }
+
+  p_zc->last_sample = filtered_new_sample;
+
+  return p_zc->debounce;
+}
+/* END OF FUNCTION*/
+
+/** @brief Records the timing of a rising zero cross only.
+ * @param[inout] p_zc - pointer to the zero cross object to work on.
+ * @param[in] new_spl - voltage sample.
+ * @param[in] tick - ADC callback count of the sample.
+ * @note Coherent followers take their windows from the first phase, so only the crossing the system measurements time is
+ * kept - through the same filter as Zero_cross_detect so the phases are timed alike, but with no count or debounce.
+ */
+static void Zero_cross_tick(LMA_ZeroCross *const p_zc, const spl_t new_spl, const uint32_t tick)
+{
+  const spl_t filtered_new_sample = (new_spl >> 1) + (p_zc->last_sample >> 1);
+
+  if ((p_zc->last_sample < (spl_t)0) && (filtered_new_sample >= (spl_t)0))
+  {
+    p_zc->cross_tick = tick;
+    p_zc->cross_below = p_zc->last_sample;
+    p_zc->cross_above = filtered_new_sample;
+  }
+
+  p_zc->last_sample = filtered_new_sample;
+}
+/* END OF FUNCTION*/
+
+/** @brief Resets zero cross structure.
+ * @param[inout] p_zc - pointer to the zero cross object to work on.
+ */
+static void Zero_cross_hard_reset(LMA_ZeroCross *const p_zc)
+{
+  p_zc->last_sample = (spl_t)0;
+  p_zc->count = (uint32_t)0;
+  p_zc->cross_tick = (uint32_t)0;
+  p_zc->cross_below = (spl_t)0;
+  p_zc->cross_above = (spl_t)0;
+  p_zc->debounce = false;
+  p_zc->first_event = false;
+  p_zc->already_run = false;
+}
+
+/** @brief Resets the computed neutral (if registered).*/
+static void Computed_neutral_reset(void)
+{
+  if (NULL != p_computed_neutral)
+  {
+    p_computed_neutral->i_acc_temp = (acc_t)0;
+    p_computed_neutral->i_acc_snapshot = (acc_t)0;
+#if LMA_OFFSET_REMOVAL
+    p_computed_neutral->i_sum_temp = (acc_t)0;
+    p_computed_neutral->i_sum_snapshot = (acc_t)0;
+#endif
+    p_computed_neutral->irms = 0.0f;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Complete hard reset on a phase
+ * @details Will reset the zero cross synch flag so we wait for the next full zero cross to be detected.
+ * And resets all accumulators to zero.
+ * @param[inout] p_phase - pointer to the phase block to reset
+ */
+static void Phase_hard_reset(LMA_Phase *const p_phase)
+{
+  LMA_Phase *p_follower = phase_list.p_first_phase;
+
+  Zero_cross_hard_reset(&(p_phase->zero_cross_v));
+
+  p_phase->inputs.v_sample = (spl_t)0;
+  p_phase->inputs.v90_sample = (spl_t)0;
+  p_phase->inputs.i_sample = (spl_t)0;
+
+  p_phase->accs.snapshot.v_acc = (acc_t)0;
+  p_phase->accs.snapshot.i_acc = (acc_t)0;
+  p_phase->accs.snapshot.p_acc = (acc_t)0;
+  p_phase->accs.snapshot.q_acc = (acc_t)0;
+  p_phase->accs.snapshot.sample_count = (uint32_t)0;
+#if LMA_OFFSET_REMOVAL
+  p_phase->accs.snapshot.v_sum = (acc_t)0;
+  p_phase->accs.snapshot.v90_sum = (acc_t)0;
+  p_phase->accs.snapshot.i_sum = (acc_t)0;
+#endif
+
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->inputs.i_sample = (spl_t)0;
+    p_phase->p_neutral->accs.i_acc_snapshot = (acc_t)0;
+#if LMA_OFFSET_REMOVAL
+    p_phase->p_neutral->accs.i_sum_snapshot = (acc_t)0;
+#endif
+  }
+
+  p_phase->measurements.vrms = 0.0f;
+  p_phase->measurements.irms = 0.0f;
+  p_phase->measurements.p = 0.0f;
+  p_phase->measurements.q = 0.0f;
+  p_phase->measurements.s = 0.0f;
+  p_phase->measurements.irms_neutral = 0.0f;
+  p_phase->measurements.fline = 0.0f;
+
+  p_phase->energy_units.act = 0.0f;
+  p_phase->energy_units.react = 0.0f;
+  p_phase->energy_units.app = 0.0f;
+
+  /* Start on the long window - the first windows are discarded while the signal chain settles anyway*/
+  p_phase->window.cycles = p_config->update_interval;
+  p_phase->window.snapshot_cycles = (uint32_t)0;
+  p_phase->window.irms = 0.0f;
+  p_phase->window.p = 0.0f;
+  p_phase->window.joined = false;
+
+  LMA_AccPhaseReset(p_phase);
+
+  LMA_PhaseResetHook(p_phase);
+
+  /* The computed neutral and the coherent windows of the other phases run on the window of the first phase*/
+  if (p_phase == phase_list.p_first_phase)
+  {
+    Computed_neutral_reset();
+
+    while (NULL != p_follower)
+    {
+      p_follower->window.joined = false;
+      p_follower = p_follower->p_next;
+    }
+  }
+
+  p_phase->sigs.accumulators_ready = false;
+  p_phase->sigs.measurements_ready = false;
+  p_phase->sigs.calibrating = false;
+}
+/* END OF FUNCTION*/
+
+#if LMA_OFFSET_REMOVAL
+/** @brief Removes the DC offsets from the snapshot accumulators of a phase (and its neutral).
+ * @details acc -= sum_x * sum_y / n for each accumulator, leaving the accumulation of the signals less their mean over the
+ * window. The sums are cleared so a second call has no effect.
+ * @param[inout] p_phase - pointer to the phase to work on.
+ */
+static void Phase_offset_remove(LMA_Phase *const p_phase)
+{
+  LMA_Accs *const p_accs = &(p_phase->accs.snapshot);
+
+  if ((uint32_t)0 != p_accs->sample_count)
+  {
+    const double n = (double)p_accs->sample_count;
+    const double v_sum = (double)p_accs->v_sum;
+    const double v90_sum = (double)p_accs->v90_sum;
+    const double i_sum = (double)p_accs->i_sum;
+
+    p_accs->v_acc -= (acc_t)((v_sum * v_sum) / n);
+    p_accs->i_acc -= (acc_t)((i_sum * i_sum) / n);
+    p_accs->p_acc -= (acc_t)((v_sum * i_sum) / n);
+    p_accs->q_acc -= (acc_t)((v90_sum * i_sum) / n);
+
+    if (NULL != p_phase->p_neutral)
+    {
+      const double i_sum_neutral = (double)p_phase->p_neutral->accs.i_sum_snapshot;
+      p_phase->p_neutral->accs.i_acc_snapshot -= (acc_t)((i_sum_neutral * i_sum_neutral) / n);
+      p_phase->p_neutral->accs.i_sum_snapshot = (acc_t)0;
+    }
+  }
+
+  p_accs->v_sum = (acc_t)0;
+  p_accs->v90_sum = (acc_t)0;
+  p_accs->i_sum = (acc_t)0;
+}
+/* END OF FUNCTION*/
+#endif
+
+/** @brief Runs the front end filters of a phase (and its neutral) on the loaded samples.
+ * @details Every registered chain runs on every sample so their state stays aligned - a decimating chain on one channel
+ * must be matched on the others.
+ * @param[inout] p_phase - pointer to the phase to work on.
+ * @return true if the samples are ready to process - false while a decimating filter is still summing.
+ */
+static bool Phase_filter(LMA_Phase *const p_phase)
+{
+  bool ready = true;
+
+  if (NULL != p_phase->p_v_filter)
+  {
+    ready = LMA_FilterSample(p_phase->p_v_filter, &(p_phase->inputs.v_sample)) && ready;
+  }
+
+  if (NULL != p_phase->p_v90_filter)
+  {
+    ready = LMA_FilterSample(p_phase->p_v90_filter, &(p_phase->inputs.v90_sample)) && ready;
+  }
+
+  if (NULL != p_phase->p_i_filter)
+  {
+    ready = LMA_FilterSample(p_phase->p_i_filter, &(p_phase->inputs.i_sample)) && ready;
+  }
+
+  if ((NULL != p_phase->p_neutral) && (NULL != p_phase->p_neutral->p_i_filter))
+  {
+    ready = LMA_FilterSample(p_phase->p_neutral->p_i_filter, &(p_phase->p_neutral->inputs.i_sample)) && ready;
+  }
+
+  return ready;
+}
+/* END OF FUNCTION*/
+
+/** @brief Updates the longest window the accumulators can hold and clamps the configured windows to it.
+ * @details A sample of adc_bits squares to less than 2^(2.adc_bits - 2), so an acc_t holds 2^(acc bits + 1 - 2.adc_bits) of
+ * them. The computed neutral squares the sum of every phase, which is up to ceil(log2(phase_count)) bits wider, so it takes
+ * twice that off. A window is longest in samples at the lowest line frequency accepted (fline_tol_low) - below it the window
+ * may overflow, but its measurements are discarded as out of tolerance anyway. Called whenever fs or the configuration
+ * changes.
+ */
+static void Window_limit_update(void)
+{
+  const uint32_t acc_bits = (uint32_t)(sizeof(acc_t) * 8U);
+  const uint32_t adc_bits = ((uint32_t)p_config->adc_bits > (uint32_t)(sizeof(spl_t) * 8U)) ? (uint32_t)(sizeof(spl_t) * 8U)
+                                                                                              : (uint32_t)p_config->adc_bits;
+  uint32_t square_bits = (uint32_t)2 * adc_bits;
+  uint32_t n = (uint32_t)0;
+
+  if (NULL != p_computed_neutral)
+  {
+    for (n = (uint32_t)1; n < phase_list.phase_count; n <<= 1U)
+    {
+      square_bits += (uint32_t)2;
+    }
+  }
+
+  window_max = UINT32_MAX;
+
+  if (((uint32_t)0 != adc_bits) && (p_config->gcalib.fs > 0.0f))
+  {
+    const float samples = ((acc_bits + 1U) > square_bits) ? (float)((uint64_t)1 << (acc_bits + 1U - square_bits)) : 1.0f;
+    const float cycles = (samples * p_config->fline_tol_low) / p_config->gcalib.fs;
+
+    if (cycles < (float)UINT32_MAX)
+    {
+      /* Never below one cycle - adc_bits this wide cannot be held for even that long*/
+      window_max = (cycles < 1.0f) ? (uint32_t)1 : (uint32_t)cycles;
+    }
+  }
+
+  if (p_config->update_interval > window_max)
+  {
+    p_config->update_interval = window_max;
+  }
+
+  if (p_config->update_interval_min > p_config->update_interval)
+  {
+    p_config->update_interval_min = p_config->update_interval;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Sets the length of the next window of a phase from the change in its measurements (adaptive windows).
+ * @details A change of Irms or P larger than transient_threshold (relative) or the no load thresholds (absolute) cuts the
+ * window being accumulated down to update_interval_min, so the new load is measured quickly. Otherwise the window doubles
+ * each time, up to update_interval, for the best accuracy in steady state. Without update_interval_min every window is
+ * update_interval.
+ * @param[inout] p_phase - pointer to the phase to work on (measurements of the window just computed).
+ */
+static void Window_adapt(LMA_Phase *const p_phase)
+{
+  LMA_Window *const p_window = &(p_phase->window);
+  uint32_t cycles = p_config->update_interval;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  if ((uint32_t)0 != p_config->update_interval_min)
+  {
+    const float di = fabsf(p_phase->measurements.irms - p_window->irms);
+    const float dp = fabsf(p_phase->measurements.p - p_window->p);
+    float i_tol = p_config->transient_threshold * p_window->irms;
+    float p_tol = p_config->transient_threshold * fabsf(p_window->p);
+
+    /* Near no load the relative change is noise*/
+    i_tol = (i_tol < p_config->no_load_i) ? p_config->no_load_i : i_tol;
+    p_tol = (p_tol < p_config->no_load_p) ? p_config->no_load_p : p_tol;
+
+    if ((di > i_tol) || (dp > p_tol))
+    {
+      cycles = p_config->update_interval_min;
+    }
+    else if (p_window->snapshot_cycles < (p_config->update_interval / 2U))
+    {
+      cycles = (p_window->snapshot_cycles < p_config->update_interval_min) ? p_config->update_interval_min
+                                                                            : (p_window->snapshot_cycles * 2U);
+    }
+    else
+    {
+      /* Steady state - long window*/
+    }
+
+    p_window->irms = p_phase->measurements.irms;
+    p_window->p = p_phase->measurements.p;
+  }
+
+  LMA_CRITICAL_SECTION_ENTER();
+  /* A window already past the new length ends on the next zero cross rather than part way through a cycle*/
+  p_window->cycles = (cycles > p_phase->zero_cross_v.count) ? cycles : (p_phase->zero_cross_v.count + 1U);
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Selects the quantity counted by a register (or demand) from active, apparent and reactive values.
+ * @param[in] quantity - quantity to select.
+ * @param[in] p_unit - active, apparent and reactive values (energy units or powers).
+ * @return value of the quantity (0 when its direction is not flowing).
+ */
+static float Quantity_select(const LMA_RegisterQuantity quantity, const LMA_EnergyUnit *const p_unit)
+{
+  float value = 0.0f;
+
+  switch (quantity)
+  {
+    case LMA_REGISTER_ACT_IMP:
+      value = p_unit->act;
+      break;
+
+    case LMA_REGISTER_ACT_EXP:
+      value = -p_unit->act;
+      break;
+
+    case LMA_REGISTER_REACT_IMP:
+      value = p_unit->react;
+      break;
+
+    case LMA_REGISTER_REACT_EXP:
+      value = -p_unit->react;
+      break;
+
+    case LMA_REGISTER_APP_IMP:
+      value = (p_unit->act >= 0.0f) ? p_unit->app : 0.0f;
+      break;
+
+    case LMA_REGISTER_APP_EXP:
+      value = (p_unit->act < 0.0f) ? p_unit->app : 0.0f;
+      break;
+
+    case LMA_REGISTER_REACT_Q1:
+      value = (p_unit->act >= 0.0f) ? p_unit->react : 0.0f;
+      break;
+
+    case LMA_REGISTER_REACT_Q2:
+      value = (p_unit->act < 0.0f) ? p_unit->react : 0.0f;
+      break;
+
+    case LMA_REGISTER_REACT_Q3:
+      value = (p_unit->act < 0.0f) ? -p_unit->react : 0.0f;
+      break;
+
+    case LMA_REGISTER_REACT_Q4:
+      value = (p_unit->act >= 0.0f) ? -p_unit->react : 0.0f;
+      break;
+
+    default:
+      /* Unknown quantity - not counted*/
+      break;
+  }
+
+  /* Only the direction counted accumulates*/
+  return (value > 0.0f) ? value : 0.0f;
+}
+/* END OF FUNCTION*/
+
+/** @brief Resolves the Ws per ADC interval of an energy register from the latest energy units.
+ * @param[in] p_register - register to resolve.
+ * @param[in] p_system - energy units of the whole system.
+ * @return Ws per ADC interval counted by the register (0 when its direction is not flowing).
+ */
+static float Register_unit(const LMA_Register *const p_register, const LMA_EnergyUnit *const p_system)
+{
+  return Quantity_select(p_register->quantity,
+                         (NULL != p_register->p_phase) ? &(p_register->p_phase->energy_units) : p_system);
+}
+/* END OF FUNCTION*/
+
+/** @brief Resolves the Ws per ADC interval of every energy register (and the active tariff register) from the latest energy
+ * units.
+ * @details The quadrant is decided here once per TMR update, so counting in LMA_CB_ADC is the same add and compare for every
+ * register.
+ * @param[in] p_system - energy units of the whole system.
+ */
+static void Registers_unit_update(const LMA_EnergyUnit *const p_system)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  uint32_t r = (uint32_t)0;
+
+  LMA_CRITICAL_SECTION_ENTER();
+  for (r = (uint32_t)0; r < register_count; ++r)
+  {
+    p_registers[r].unit = Register_unit(&(p_registers[r]), p_system);
+  }
+
+  if (NULL != p_tariff_register)
+  {
+    p_tariff_register->unit = Register_unit(p_tariff_register, p_system);
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Counts one ADC interval of energy on a register and manages its impulse output.
+ * @param[in] p_register - register to count.
+ */
+static void Register_count(LMA_Register *const p_register)
+{
+  /* Impulse Management*/
+  if (p_register->impulse_on)
+  {
+    ++p_register->impulse_counter;
+    if (p_register->impulse_counter > sys_energy.impulse.led_on_count)
+    {
+      p_register->impulse_on = false;
+      p_register->p_impulse(false);
+    }
+  }
+
+  /* Energy accumulation*/
+  p_register->accumulator_ws += p_register->unit;
+  if (p_register->accumulator_ws >= p_register->meter_constant)
+  {
+    p_register->accumulator_ws -= p_register->meter_constant;
+    ++p_register->counter;
+
+    /* Trigger Pulse*/
+    if (NULL != p_register->p_impulse)
+    {
+      p_register->impulse_counter = (uint32_t)0;
+      p_register->impulse_on = true;
+      p_register->p_impulse(true);
+    }
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Counts one ADC interval of energy on the system energy registers, every register and on the register of the active
+ * tariff.
+ */
+static void Registers_run(void)
+{
+  uint32_t r = (uint32_t)0;
+
+  for (r = (uint32_t)0; r < (uint32_t)SYS_REG_COUNT; ++r)
+  {
+    Register_count(&(sys_registers[r]));
+  }
+
+  for (r = (uint32_t)0; r < register_count; ++r)
+  {
+    Register_count(&(p_registers[r]));
+  }
+
+  /* Time of use - the tariff switch swaps this pointer, so counting does not depend on the tariff*/
+  if (NULL != p_tariff_register)
+  {
+    Register_count(p_tariff_register);
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Drives the active LED - impulse output of the system active registers.
+ * @param[in] on - true to switch the LED on.
+ */
+static void Impulse_active(const bool on)
+{
+  if (on)
+  {
+    LMA_IMP_ActiveOn();
+  }
+  else
+  {
+    LMA_IMP_ActiveOff();
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Drives the apparent LED - impulse output of the system apparent registers.
+ * @param[in] on - true to switch the LED on.
+ */
+static void Impulse_apparent(const bool on)
+{
+  if (on)
+  {
+    LMA_IMP_ApparentOn();
+  }
+  else
+  {
+    LMA_IMP_ApparentOff();
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Drives the reactive LED - impulse output of the system reactive registers.
+ * @param[in] on - true to switch the LED on.
+ */
+static void Impulse_reactive(const bool on)
+{
+  if (on)
+  {
+    LMA_IMP_ReactiveOn();
+  }
+  else
+  {
+    LMA_IMP_ReactiveOff();
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Gets the accumulator and counter of the energy data behind each system energy register.
+ * @param[in] p_energy - energy data.
+ * @param[out] pp_accumulators - SYS_REG_COUNT accumulators, in register order.
+ * @param[out] pp_counters - SYS_REG_COUNT counters, in register order.
+ */
+static void System_energy_fields(LMA_Energy *const p_energy, float **const pp_accumulators, uint64_t **const pp_counters)
+{
+  pp_accumulators[SYS_REG_ACT_IMP] = &(p_energy->accumulator.act_imp_ws);
+  pp_accumulators[SYS_REG_ACT_EXP] = &(p_energy->accumulator.act_exp_ws);
+  pp_accumulators[SYS_REG_APP_IMP] = &(p_energy->accumulator.app_imp_ws);
+  pp_accumulators[SYS_REG_APP_EXP] = &(p_energy->accumulator.app_exp_ws);
+  pp_accumulators[SYS_REG_C_REACT_IMP] = &(p_energy->accumulator.c_react_imp_ws);
+  pp_accumulators[SYS_REG_C_REACT_EXP] = &(p_energy->accumulator.c_react_exp_ws);
+  pp_accumulators[SYS_REG_L_REACT_IMP] = &(p_energy->accumulator.l_react_imp_ws);
+  pp_accumulators[SYS_REG_L_REACT_EXP] = &(p_energy->accumulator.l_react_exp_ws);
+
+  pp_counters[SYS_REG_ACT_IMP] = &(p_energy->counter.act_imp);
+  pp_counters[SYS_REG_ACT_EXP] = &(p_energy->counter.act_exp);
+  pp_counters[SYS_REG_APP_IMP] = &(p_energy->counter.app_imp);
+  pp_counters[SYS_REG_APP_EXP] = &(p_energy->counter.app_exp);
+  pp_counters[SYS_REG_C_REACT_IMP] = &(p_energy->counter.c_react_imp);
+  pp_counters[SYS_REG_C_REACT_EXP] = &(p_energy->counter.c_react_exp);
+  pp_counters[SYS_REG_L_REACT_IMP] = &(p_energy->counter.l_react_imp);
+  pp_counters[SYS_REG_L_REACT_EXP] = &(p_energy->counter.l_react_exp);
+}
+/* END OF FUNCTION*/
+
+/** @brief Sets what each system energy register counts and which LED it drives.*/
+static void System_registers_init(void)
+{
+  static const LMA_RegisterQuantity quantities[SYS_REG_COUNT] = {
+      LMA_REGISTER_ACT_IMP,  LMA_REGISTER_ACT_EXP,  LMA_REGISTER_APP_IMP,  LMA_REGISTER_APP_EXP,
+      LMA_REGISTER_REACT_Q2, LMA_REGISTER_REACT_Q4, LMA_REGISTER_REACT_Q1, LMA_REGISTER_REACT_Q3};
+  uint32_t r = (uint32_t)0;
+
+  for (r = (uint32_t)0; r < (uint32_t)SYS_REG_COUNT; ++r)
+  {
+    sys_registers[r].p_phase = NULL;
+    sys_registers[r].quantity = quantities[r];
+    sys_registers[r].meter_constant = p_config->meter_constant;
+    sys_registers[r].p_impulse = (r < (uint32_t)SYS_REG_APP_IMP)       ? Impulse_active
+                                 : (r < (uint32_t)SYS_REG_C_REACT_IMP) ? Impulse_apparent
+                                                                       : Impulse_reactive;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Loads the system energy registers from their stored view (sys_energy).
+ * @details An LED left on in the view is timed out by the first register driving it.
+ */
+static void System_registers_load(void)
+{
+  const LMA_EnergyUnit system_unit = {sys_energy.energy.unit.act, sys_energy.energy.unit.app, sys_energy.energy.unit.react};
+  float *p_accumulators[SYS_REG_COUNT];
+  uint64_t *p_counters[SYS_REG_COUNT];
+  uint32_t r = (uint32_t)0;
+
+  System_energy_fields(&(sys_energy.energy), p_accumulators, p_counters);
+
+  for (r = (uint32_t)0; r < (uint32_t)SYS_REG_COUNT; ++r)
+  {
+    sys_registers[r].meter_constant = p_config->meter_constant;
+    sys_registers[r].unit = Register_unit(&(sys_registers[r]), &system_unit);
+    sys_registers[r].accumulator_ws = *(p_accumulators[r]);
+    sys_registers[r].counter = *(p_counters[r]);
+    sys_registers[r].impulse_counter = (uint32_t)0;
+    sys_registers[r].impulse_on = false;
+  }
+
+  sys_registers[SYS_REG_ACT_IMP].impulse_counter = sys_energy.impulse.active_counter;
+  sys_registers[SYS_REG_ACT_IMP].impulse_on = sys_energy.impulse.active_on;
+  sys_registers[SYS_REG_APP_IMP].impulse_counter = sys_energy.impulse.apparent_counter;
+  sys_registers[SYS_REG_APP_IMP].impulse_on = sys_energy.impulse.apparent_on;
+  sys_registers[SYS_REG_C_REACT_IMP].impulse_counter = sys_energy.impulse.reactive_counter;
+  sys_registers[SYS_REG_C_REACT_IMP].impulse_on = sys_energy.impulse.reactive_on;
+}
+/* END OF FUNCTION*/
+
+/** @brief Writes the system energy registers to a stored view.
+ * @param[out] p_energy - view to write (units and LED on count as sys_energy).
+ */
+static void System_registers_store(LMA_SystemEnergy *const p_energy)
+{
+  float *p_accumulators[SYS_REG_COUNT];
+  uint64_t *p_counters[SYS_REG_COUNT];
+  uint32_t r = (uint32_t)0;
+
+  *p_energy = sys_energy;
+  System_energy_fields(&(p_energy->energy), p_accumulators, p_counters);
+
+  p_energy->impulse.active_on = false;
+  p_energy->impulse.apparent_on = false;
+  p_energy->impulse.reactive_on = false;
+
+  for (r = (uint32_t)0; r < (uint32_t)SYS_REG_COUNT; ++r)
+  {
+    *(p_accumulators[r]) = sys_registers[r].accumulator_ws;
+    *(p_counters[r]) = sys_registers[r].counter;
+
+    if (sys_registers[r].impulse_on)
+    {
+      if (r < (uint32_t)SYS_REG_APP_IMP)
+      {
+        p_energy->impulse.active_on = true;
+        p_energy->impulse.active_counter = sys_registers[r].impulse_counter;
+      }
+      else if (r < (uint32_t)SYS_REG_C_REACT_IMP)
+      {
+        p_energy->impulse.apparent_on = true;
+        p_energy->impulse.apparent_counter = sys_registers[r].impulse_counter;
+      }
+      else
+      {
+        p_energy->impulse.reactive_on = true;
+        p_energy->impulse.reactive_counter = sys_registers[r].impulse_counter;
+      }
+    }
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Computes the tariff of a schedule at a time.
+ * @details Called once per minute by LMA_CB_RTC (and when the tariff or clock is set) - never per sample.
+ * @param[in] p_schedule - schedule to follow.
+ * @param[in] seconds - local time in seconds since 2000-01-01 00:00:00.
+ * @return Tariff active at the time.
+ */
+static uint8_t Tariff_lookup(const LMA_TariffSchedule *const p_schedule, const uint32_t seconds)
+{
+  static const uint8_t month_days[12] = {31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U};
+  const uint32_t minute = (seconds % (uint32_t)86400) / (uint32_t)60;
+  const uint32_t weekday = ((seconds / (uint32_t)86400) + (uint32_t)5) % (uint32_t)7; /* 2000-01-01 was a Saturday*/
+  uint32_t days = seconds / (uint32_t)86400;
+  uint32_t year = (uint32_t)2000;
+  uint32_t month = (uint32_t)0;
+  uint32_t date = (uint32_t)0;
+  uint32_t i = (uint32_t)0;
+  uint32_t count = (uint32_t)0;
+  uint8_t season = (uint8_t)0;
+  uint8_t profile = (uint8_t)0;
+  uint8_t tariff = (uint8_t)0;
+
+  /* Calendar date (leap years by the Gregorian rules)*/
+  for (;;)
+  {
+    const bool leap = ((uint32_t)0 == (year % (uint32_t)4)) &&
+                      (((uint32_t)0 != (year % (uint32_t)100)) || ((uint32_t)0 == (year % (uint32_t)400)));
+    const uint32_t year_days = leap ? (uint32_t)366 : (uint32_t)365;
+
+    if (days < year_days)
+    {
+      for (month = (uint32_t)0; month < (uint32_t)11; ++month)
+      {
+        const uint32_t length = (uint32_t)month_days[month] + ((leap && ((uint32_t)1 == month)) ? (uint32_t)1 : (uint32_t)0);
+
+        if (days < length)
+        {
+          break;
+        }
+        days -= length;
+      }
+      break;
+    }
+    days -= year_days;
+    ++year;
+  }
+  date = LMA_TARIFF_DATE(month + (uint32_t)1, days + (uint32_t)1);
+
+  /* Season - the last to have started this year*/
+  count = (p_schedule->season_count < LMA_TARIFF_SEASONS) ? p_schedule->season_count : LMA_TARIFF_SEASONS;
+  season = (count > (uint32_t)0) ? (uint8_t)(count - (uint32_t)1) : (uint8_t)0;
+  for (i = (uint32_t)0; i < count; ++i)
+  {
+    if (date >= p_schedule->season_start[i])
+    {
+      season = (uint8_t)i;
+    }
+  }
+
+  /* Day profile - special days override the week*/
+  profile = p_schedule->week_profile[season][weekday];
+  count = (p_schedule->special_count < LMA_TARIFF_SPECIAL_DAYS) ? p_schedule->special_count : LMA_TARIFF_SPECIAL_DAYS;
+  for (i = (uint32_t)0; i < count; ++i)
+  {
+    if (date == p_schedule->special_day[i])
+    {
+      profile = p_schedule->special_profile;
+    }
+  }
+  profile = (profile < LMA_TARIFF_DAY_PROFILES) ? profile : (uint8_t)0;
+
+  /* Tariff - the last switch point reached today*/
+  count = (p_schedule->switch_count[profile] < LMA_TARIFF_SWITCHES) ? p_schedule->switch_count[profile] : LMA_TARIFF_SWITCHES;
+  if (count > (uint32_t)0)
+  {
+    tariff = (uint8_t)(p_schedule->day_profile[profile][count - (uint32_t)1] & (uint16_t)7);
+  }
+  for (i = (uint32_t)0; i < count; ++i)
+  {
+    if ((uint32_t)(p_schedule->day_profile[profile][i] >> 3U) <= minute)
+    {
+      tariff = (uint8_t)(p_schedule->day_profile[profile][i] & (uint16_t)7);
+    }
+  }
+
+  return tariff;
+}
+/* END OF FUNCTION*/
+
+/** @brief Makes a tariff the one counting - an O(1) swap of the register LMA_CB_ADC counts.
+ * @details The incoming register takes the current energy unit, the outgoing register stops (with its impulse turned off), so
+ * no ADC interval is counted twice or lost across the switch.
+ * @param[in] tariff - tariff to activate.
+ */
+static void Tariff_switch(const uint8_t tariff)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_Register *const p_next = &(p_tariff->registers[tariff]);
+  LMA_EnergyUnit system_unit;
+
+  LMA_CRITICAL_SECTION_ENTER();
+  if (p_next != p_tariff_register)
+  {
+    if (NULL != p_tariff_register)
+    {
+      p_tariff_register->unit = 0.0f;
+      if (p_tariff_register->impulse_on)
+      {
+        p_tariff_register->impulse_on = false;
+        p_tariff_register->p_impulse(false);
+      }
+    }
+
+    system_unit.act = sys_energy.energy.unit.act;
+    system_unit.app = sys_energy.energy.unit.app;
+    system_unit.react = sys_energy.energy.unit.react;
+    p_next->unit = Register_unit(p_next, &system_unit);
+    p_tariff_register = p_next;
+    p_tariff->active = tariff;
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Restarts the running demand of a demand register - its reading is kept.
+ * @details The sub-interval running when restarted is not a whole one, so it is dropped at the next boundary.
+ * @param[inout] p_demand - demand register to restart.
+ */
+static void Demand_restart(LMA_Demand *const p_demand)
+{
+  uint32_t i = (uint32_t)0;
+
+  for (i = (uint32_t)0; i < LMA_DEMAND_SUBINTERVALS; ++i)
+  {
+    p_demand->energy[i] = 0.0f;
+  }
+  p_demand->sum = 0.0f;
+  p_demand->accumulator = 0.0f;
+  p_demand->index = (uint32_t)0;
+  p_demand->filled = (uint32_t)0;
+  p_demand->synced = false;
+}
+/* END OF FUNCTION*/
+
+/** @brief Adds the energy of a measurement window of a phase to every demand register measuring it.
+ * @param[in] p_phase - phase whose window was computed.
+ * @param[in] seconds - length of the window.
+ */
+static void Demands_window(const LMA_Phase *const p_phase, const float seconds)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  const LMA_EnergyUnit power = {p_phase->measurements.p, p_phase->measurements.s, p_phase->measurements.q};
+  uint32_t d = (uint32_t)0;
+
+  LMA_CRITICAL_SECTION_ENTER();
+  for (d = (uint32_t)0; d < demand_count; ++d)
+  {
+    LMA_Demand *const p_demand = &(p_demands[d]);
+
+    if ((NULL == p_demand->p_phase) || (p_phase == p_demand->p_phase))
+    {
+      p_demand->accumulator += Quantity_select(p_demand->quantity, &power) * seconds;
+    }
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Ends the running sub-interval of every demand register with a boundary at the current clock second.
+ * @details The demand is the running sum of the ring over the demand interval - O(1) per sub-interval. The sum is taken
+ * afresh each time the ring wraps, so rounding cannot build up over weeks of running.
+ */
+static void Demands_subinterval_end(void)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  uint32_t d = (uint32_t)0;
+  uint32_t i = (uint32_t)0;
+
+  for (d = (uint32_t)0; d < demand_count; ++d)
+  {
+    LMA_Demand *const p_demand = &(p_demands[d]);
+    const uint32_t count = (p_demand->subintervals < LMA_DEMAND_SUBINTERVALS) ? p_demand->subintervals
+                                                                               : LMA_DEMAND_SUBINTERVALS;
+    const bool boundary = ((uint32_t)0 != p_demand->subinterval) && ((uint32_t)0 != count) &&
+                          ((uint32_t)0 == (clock_seconds % p_demand->subinterval));
+
+    if (boundary)
+    {
+      LMA_CRITICAL_SECTION_ENTER();
+      if (!p_demand->synced)
+      {
+        /* The partial sub-interval before the first boundary is dropped*/
+        p_demand->synced = true;
+      }
+      else
+      {
+        p_demand->sum += p_demand->accumulator - p_demand->energy[p_demand->index];
+        p_demand->energy[p_demand->index] = p_demand->accumulator;
+
+        ++p_demand->index;
+        if (p_demand->index >= count)
+        {
+          p_demand->index = (uint32_t)0;
+          p_demand->sum = 0.0f;
+          for (i = (uint32_t)0; i < count; ++i)
+          {
+            p_demand->sum += p_demand->energy[i];
+          }
+        }
+
+        if (p_demand->filled < count)
+        {
+          ++p_demand->filled;
+        }
+
+        /* Demand once a whole demand interval is in the ring*/
+        if (p_demand->filled >= count)
+        {
+          p_demand->reading.demand = p_demand->sum / ((float)p_demand->subinterval * (float)count);
+          p_demand->reading.time = clock_seconds;
+          if (p_demand->reading.demand > p_demand->reading.peak)
+          {
+            p_demand->reading.peak = p_demand->reading.demand;
+            p_demand->reading.peak_time = clock_seconds;
+          }
+        }
+      }
+      p_demand->accumulator = 0.0f;
+      LMA_CRITICAL_SECTION_EXIT();
+    }
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Copies the measurements of a phase - call from within a critical section.
+ * @param[in] p_phase - pointer to the phase to copy from.
+ * @param[out] p_measurements - pointer to the measurement structure to populate.
+ */
+static void Measurements_copy(const LMA_Phase *const p_phase, LMA_Measurements *const p_measurements)
+{
+  p_measurements->vrms = p_phase->measurements.vrms;
+  p_measurements->irms = p_phase->measurements.irms;
+  p_measurements->fline = p_phase->measurements.fline;
+  p_measurements->p = p_phase->measurements.p;
+  p_measurements->q = p_phase->measurements.q;
+  p_measurements->s = p_phase->measurements.s;
+
+  if (NULL != p_phase->p_neutral)
+  {
+    p_measurements->irms_neutral = p_phase->measurements.irms_neutral;
+  }
+  else
+  {
+    p_measurements->irms_neutral = 0.0f;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Sets the window of the first phase to the shortest of the phases (see LMA_Config.coherent_windows).
+ * @details A transient on any phase shortens the window they all follow. Calibrating phases run their own windows so are
+ * left out.
+ */
+static void Window_coherent(void)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_Phase *const p_reference = phase_list.p_first_phase;
+  const LMA_Phase *p_phase = p_reference->p_next;
+  uint32_t cycles = p_reference->window.cycles;
+
+  while (NULL != p_phase)
+  {
+    if ((!p_phase->sigs.calibrating) && (p_phase->window.cycles < cycles))
+    {
+      cycles = p_phase->window.cycles;
+    }
+    p_phase = p_phase->p_next;
+  }
+
+  LMA_CRITICAL_SECTION_ENTER();
+  /* A window already past the new length ends on the next zero cross rather than part way through a cycle*/
+  p_reference->window.cycles = (cycles > p_reference->zero_cross_v.count) ? cycles : (p_reference->zero_cross_v.count + 1U);
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Computes the computed neutral current and evaluates the tamper alarms of the first phase.
+ * @details The computed neutral is scaled by the mean irms_coeff of the phases - the samples are summed raw, so this assumes
+ * matched current gains. The mismatch compares it to the measured neutral of the first phase (if registered) and is only
+ * raised above no_load_i, so small currents do not trip it.
+ * @param[inout] p_phase - pointer to the first phase (its measurements computed for the same window).
+ * @param[in] sample_count_fp - samples in the window.
+ */
+static void Computed_neutral_update(LMA_Phase *const p_phase, const float sample_count_fp)
+{
+  const LMA_Phase *tmp = phase_list.p_first_phase;
+  float irms_coeff = 0.0f;
+
+#if LMA_OFFSET_REMOVAL
+  {
+    const double i_sum = (double)p_computed_neutral->i_sum_snapshot;
+    p_computed_neutral->i_acc_snapshot -= (acc_t)((i_sum * i_sum) / (double)sample_count_fp);
+    p_computed_neutral->i_sum_snapshot = (acc_t)0;
+  }
+#endif
+
+  while (NULL != tmp)
+  {
+    irms_coeff += tmp->calib.irms_coeff;
+    tmp = tmp->p_next;
+  }
+  irms_coeff /= (float)phase_list.phase_count;
+
+  p_computed_neutral->irms =
+      sqrtf((float)((double)p_computed_neutral->i_acc_snapshot) / sample_count_fp) / irms_coeff;
+
+  /* Residual current - e.g. leakage to earth in a three wire system*/
+  if ((p_config->residual_i > 0.0f) && (p_computed_neutral->irms > p_config->residual_i))
+  {
+    p_phase->status |= LMA_RESIDUAL_CURRENT;
+  }
+  else
+  {
+    p_phase->status &= ~LMA_RESIDUAL_CURRENT;
+  }
+
+  /* Phase/neutral mismatch - e.g. load current returned through earth rather than the neutral*/
+  if ((p_config->neutral_mismatch > 0.0f) && (NULL != p_phase->p_neutral))
+  {
+    const float irms_neutral = p_phase->measurements.irms_neutral;
+    const float larger = (irms_neutral > p_computed_neutral->irms) ? irms_neutral : p_computed_neutral->irms;
+    const float difference = fabsf(irms_neutral - p_computed_neutral->irms);
+
+    if ((difference > p_config->no_load_i) && (difference > (p_config->neutral_mismatch * larger)))
+    {
+      p_phase->status |= LMA_NEUTRAL_MISMATCH;
+    }
+    else
+    {
+      p_phase->status &= ~LMA_NEUTRAL_MISMATCH;
+    }
+  }
+  else
+  {
+    p_phase->status &= ~LMA_NEUTRAL_MISMATCH;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Computes the symmetrical components of a three phase quantity.
+ * @param[in] p_x - phasors of the three phases (in phase order).
+ * @param[out] p_seq - pointer to the sequence components to populate.
+ */
+static void Sequence_components(const LMA_Complex *const p_x, LMA_SequenceComponents *const p_seq)
+{
+  /* Rotation by 120 degrees (a) and 240 degrees (a^2)*/
+  const float c = -0.5f;
+  const float s = 0.8660254f;
+  const LMA_Complex a_x1 = {(c * p_x[1].re) - (s * p_x[1].im), (s * p_x[1].re) + (c * p_x[1].im)};
+  const LMA_Complex a2_x1 = {(c * p_x[1].re) + (s * p_x[1].im), (c * p_x[1].im) - (s * p_x[1].re)};
+  const LMA_Complex a_x2 = {(c * p_x[2].re) - (s * p_x[2].im), (s * p_x[2].re) + (c * p_x[2].im)};
+  const LMA_Complex a2_x2 = {(c * p_x[2].re) + (s * p_x[2].im), (c * p_x[2].im) - (s * p_x[2].re)};
+  const LMA_Complex zero = {p_x[0].re + p_x[1].re + p_x[2].re, p_x[0].im + p_x[1].im + p_x[2].im};
+  const LMA_Complex positive = {p_x[0].re + a_x1.re + a2_x2.re, p_x[0].im + a_x1.im + a2_x2.im};
+  const LMA_Complex negative = {p_x[0].re + a2_x1.re + a_x2.re, p_x[0].im + a2_x1.im + a_x2.im};
+
+  p_seq->zero = sqrtf((zero.re * zero.re) + (zero.im * zero.im)) / 3.0f;
+  p_seq->positive = sqrtf((positive.re * positive.re) + (positive.im * positive.im)) / 3.0f;
+  p_seq->negative = sqrtf((negative.re * negative.re) + (negative.im * negative.im)) / 3.0f;
+  p_seq->unbalance = (p_seq->positive > 0.0f) ? ((100.0f * p_seq->negative) / p_seq->positive) : 0.0f;
+}
+/* END OF FUNCTION*/
+
+/** @brief Computes the system measurements of a three phase system from the last measurements of each phase.
+ * @details The voltage angles come from the last zero cross of each phase, interpolated between the samples either side and
+ * scaled by the line frequency of the first phase. The current angles subtract the V-I angle given by P and Q. Magnitudes are
+ * the RMS values of each phase, so harmonics are included.
+ */
+static void System_measurements_update(void)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  const LMA_Phase *p_phase = phase_list.p_first_phase;
+  LMA_SystemMeasurements tmp;
+  LMA_Complex v[3];
+  LMA_Complex i[3];
+  float samples_per_cycle = 0.0f;
+  uint32_t first_tick = (uint32_t)0;
+  float first_fraction = 0.0f;
+  bool valid = true;
+  uint32_t n = (uint32_t)0;
+
+  /* Every phase needs a valid window*/
+  while (NULL != p_phase)
+  {
+    valid = valid && (p_phase->measurements.fline > 0.0f);
+    p_phase = p_phase->p_next;
+  }
+  p_phase = phase_list.p_first_phase;
+  samples_per_cycle = valid ? (p_config->gcalib.fs / p_phase->measurements.fline) : 0.0f;
+
+  for (n = (uint32_t)0; valid && (n < 3U); ++n)
+  {
+    uint32_t tick = (uint32_t)0;
+    float below = 0.0f;
+    float above = 0.0f;
+    float fraction = 0.0f;
+    float angle = 0.0f;
+    float v_rad = 0.0f;
+    float i_rad = 0.0f;
+
+    LMA_CRITICAL_SECTION_ENTER();
+    tick = p_phase->zero_cross_v.cross_tick;
+    below = (float)p_phase->zero_cross_v.cross_below;
+    above = (float)p_phase->zero_cross_v.cross_above;
+    LMA_CRITICAL_SECTION_EXIT();
+
+    /* Where the crossing falls before its tick - linear between the samples either side*/
+    fraction = (above > below) ? (above / (above - below)) : 0.0f;
+
+    if ((uint32_t)0 == n)
+    {
+      first_tick = tick;
+      first_fraction = fraction;
+    }
+
+    /* A later crossing lags - wrap into -180 to 180 degrees*/
+    angle = (-360.0f * ((float)(int32_t)(tick - first_tick) - fraction + first_fraction)) / samples_per_cycle;
+    angle -= 360.0f * floorf((angle + 180.0f) / 360.0f);
+
+    /* I lags V by atan(Q/P)*/
+    v_rad = angle * (3.14159265359f / 180.0f);
+    i_rad = v_rad - atan2f(p_phase->measurements.q, p_phase->measurements.p);
+
+    tmp.v_angle[n] = angle;
+    tmp.i_angle[n] = i_rad * (180.0f / 3.14159265359f);
+    tmp.i_angle[n] -= 360.0f * floorf((tmp.i_angle[n] + 180.0f) / 360.0f);
+    v[n].re = p_phase->measurements.vrms * cosf(v_rad);
+    v[n].im = p_phase->measurements.vrms * sinf(v_rad);
+    i[n].re = p_phase->measurements.irms * cosf(i_rad);
+    i[n].im = p_phase->measurements.irms * sinf(i_rad);
+
+    p_phase = p_phase->p_next;
+  }
+
+  if (valid)
+  {
+    Sequence_components(v, &(tmp.v));
+    Sequence_components(i, &(tmp.i));
+  }
+  else
+  {
+    memset(&tmp, 0, sizeof(tmp));
+  }
+
+  LMA_CRITICAL_SECTION_ENTER();
+  *p_system_measurements = tmp;
+  LMA_CRITICAL_SECTION_EXIT();
+}
+/* END OF FUNCTION*/
+
+/** @brief Starts recording into the next free capture buffer, or stops while every buffer holds an event.*/
+static void Capture_start(void)
+{
+  p_capture->index = (uint32_t)0;
+  p_capture->wrapped = false;
+  p_capture->remaining = (uint32_t)0;
+
+  if ((p_capture->frozen - p_capture->released) < p_capture->event_count)
+  {
+    p_capture->p_buffer =
+        &(p_capture->p_buffers[(p_capture->frozen % p_capture->event_count) * p_capture->frames * p_capture->phase_count]);
+    p_capture->p_frame = p_capture->p_buffer;
+  }
+  else
+  {
+    p_capture->p_frame = NULL;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Freezes the buffer recording as the next event - its ring is unrolled in place, in two parts where it wrapped.*/
+static void Capture_freeze(void)
+{
+  LMA_CaptureEvent *const p_event = &(p_capture->p_events[p_capture->frozen % p_capture->event_count]);
+  const uint32_t index = p_capture->index;
+
+  if (p_capture->wrapped)
+  {
+    p_event->p_frames[0] = &(p_capture->p_buffer[index * p_capture->phase_count]);
+    p_event->count[0] = p_capture->frames - index;
+    p_event->p_frames[1] = ((uint32_t)0 != index) ? p_capture->p_buffer : NULL;
+    p_event->count[1] = index;
+    p_event->trigger = p_capture->frames - p_capture->post_frames;
+  }
+  else
+  {
+    p_event->p_frames[0] = p_capture->p_buffer;
+    p_event->count[0] = index;
+    p_event->p_frames[1] = NULL;
+    p_event->count[1] = (uint32_t)0;
+    p_event->trigger = index - p_capture->post_frames;
+  }
+
+  /* Counted last - the event is complete before the application can see it*/
+  ++p_capture->frozen;
+  Capture_start();
+}
+/* END OF FUNCTION*/
+
+/** @brief Moves the capture on a frame after the inputs of every phase have been stored.
+ * @param[in] p_next - frame after the one stored (NULL if nothing was stored).
+ */
+static void Capture_advance(LMA_PhaseInputs *const p_next)
+{
+  if (NULL == p_next)
+  {
+    /* Every buffer holds an event - start again once one is released*/
+    if ((p_capture->frozen - p_capture->released) < p_capture->event_count)
+    {
+      Capture_start();
+    }
+    return;
+  }
+
+  p_capture->p_frame = p_next;
+  if (++p_capture->index >= p_capture->frames)
+  {
+    p_capture->index = (uint32_t)0;
+    p_capture->wrapped = true;
+    p_capture->p_frame = p_capture->p_buffer;
+  }
+
+  if (((uint32_t)0 != p_capture->remaining) && ((uint32_t)0 == --p_capture->remaining))
+  {
+    Capture_freeze();
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Triggers the capture unless it is already triggered or every buffer holds an event.
+ * @param[in] status - status bits raised (LMA_OK for LMA_CaptureTrigger).
+ * @param[in] phase_number - phase raising them.
+ */
+static void Capture_trigger(const LMA_Status status, const uint32_t phase_number)
+{
+  if ((NULL != p_capture->p_frame) && ((uint32_t)0 == p_capture->remaining))
+  {
+    LMA_CaptureEvent *const p_event = &(p_capture->p_events[p_capture->frozen % p_capture->event_count]);
+
+    p_event->time = clock_seconds;
+    p_event->status = status;
+    p_event->phase_number = phase_number;
+    p_capture->remaining = p_capture->post_frames;
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Gets the measurement a status bit follows in an event.
+ * @param[in] p_phase - phase of the event.
+ * @param[in] bit - status bit number (0 = LMA_NO_ACTIVE_LOAD).
+ * @param[in] fline - line frequency of the window (before an invalid frequency zeroes the measurements).
+ * @return the measurement.
+ */
+static float Event_value(const LMA_Phase *const p_phase, const uint32_t bit, const float fline)
+{
+  const LMA_Status flag = (LMA_Status)((uint32_t)1 << bit);
+  float value = p_phase->measurements.irms;
+
+  if ((LMA_VOLTAGE_SAG == flag) || (LMA_VOLTAGE_SWELL == flag))
+  {
+    value = p_phase->measurements.vrms;
+  }
+  else if ((LMA_RESIDUAL_CURRENT == flag) || (LMA_NEUTRAL_MISMATCH == flag))
+  {
+    value = (NULL != p_computed_neutral) ? p_computed_neutral->irms : 0.0f;
+  }
+  else if (LMA_FREQUENCY_ERROR == flag)
+  {
+    value = fline;
+  }
+
+  return value;
+}
+/* END OF FUNCTION*/
+
+/** @brief Checks whether a measurement is further into an event than its extreme so far.
+ * @param[in] bit - status bit number (0 = LMA_NO_ACTIVE_LOAD).
+ * @param[in] value - measurement of the window.
+ * @param[in] extreme - extreme so far.
+ * @return true if value is the new extreme.
+ */
+static bool Event_more_extreme(const uint32_t bit, const float value, const float extreme)
+{
+  const LMA_Status flag = (LMA_Status)((uint32_t)1 << bit);
+  bool more = (value > extreme);
+
+  if (LMA_VOLTAGE_SAG == flag)
+  {
+    more = (value < extreme);
+  }
+  else if (LMA_FREQUENCY_ERROR == flag)
+  {
+    const float centre = (p_config->fline_tol_low + p_config->fline_tol_high) * 0.5f;
+    more = (fabsf(value - centre) > fabsf(extreme - centre));
+  }
+
+  return more;
+}
+/* END OF FUNCTION*/
+
+/** @brief Logs a status event - dropped if the ring is full, but passed to the callback either way.
+ * @param[in] p_event - event to log.
+ */
+static void Event_log(const LMA_Event *const p_event)
+{
+  if ((p_event_log->written - p_event_log->read) < p_event_log->size)
+  {
+    p_event_log->p_events[p_event_log->written % p_event_log->size] = *p_event;
+
+    /* Counted last - the event is complete before the application can see it*/
+    ++p_event_log->written;
   }
   else
   {
-    /* Otherwise prime the initial value*/
-    filtered_new_sample = new_spl;
-    p_zc->last_sample = new_spl;
-    p_zc->already_run = true;
+    ++p_event_log->dropped;
   }
 
-  if ((!p_zc->debounce) && (p_zc->last_sample < (spl_t)0) && (filtered_new_sample >= (spl_t)0))
+  if (NULL != p_event_log->p_callback)
   {
-    ++p_zc->count;
-    p_zc->debounce = true;
-    p_zc->first_event = true;
+    p_event_log->p_callback(p_event);
   }
-  else
+}
+/* END OF FUNCTION*/
+
+/** @brief Follows the logged status bits of a phase over a window, logging the edges.
+ * @details While the frequency is invalid the measurements are zeroed, so only the frequency error follows its measurement.
+ * @param[in] p_phase - phase whose window was processed.
+ * @param[in] status_before - status of the phase before the window.
+ * @param[in] window_seconds - length of the window.
+ * @param[in] fline - line frequency of the window (before an invalid frequency zeroes the measurements).
+ */
+static void Events_window(const LMA_Phase *const p_phase, const LMA_Status status_before, const float window_seconds,
+                          const float fline)
+{
+  LMA_EventTrack *const p_track = &(p_event_log->p_tracks[p_phase->phase_number]);
+  const uint32_t status = (uint32_t)p_phase->status;
+  const uint32_t follow = (status | (uint32_t)status_before) & p_event_log->event_mask;
+  const bool valid = ((uint32_t)0 == (status & (uint32_t)LMA_FREQUENCY_ERROR));
+  uint32_t bit = (uint32_t)0;
+
+  for (bit = (uint32_t)0; bit < LMA_EVENT_STATUS_BITS; ++bit)
   {
-    p_zc->debounce = false;
-  }
+    const uint32_t flag = (uint32_t)1 << bit;
+    const bool raised = ((uint32_t)0 == ((uint32_t)status_before & flag));
+    LMA_Event event;
 
-  p_zc->last_sample = filtered_new_sample;
+    if ((uint32_t)0 == (follow & flag))
+    {
+      continue;
+    }
 
-  return p_zc->debounce;
+    if ((uint32_t)0 != (status & flag))
+    {
+      const float value = Event_value(p_phase, bit, fline);
+
+      if (raised)
+      {
+        p_track->start[bit] = clock_seconds;
+        p_track->duration[bit] = 0.0f;
+        p_track->extreme[bit] = value;
+      }
+      else if ((valid || (LMA_FREQUENCY_ERROR == (LMA_Status)flag)) && Event_more_extreme(bit, value, p_track->extreme[bit]))
+      {
+        p_track->extreme[bit] = value;
+      }
+      p_track->duration[bit] += window_seconds;
+
+      if (!raised)
+      {
+        continue;
+      }
+    }
+
+    event.time = clock_seconds;
+    event.start = p_track->start[bit];
+    event.status = (LMA_Status)flag;
+    event.phase_number = p_phase->phase_number;
+    event.end = !raised;
+    event.duration = p_track->duration[bit];
+    event.extreme = p_track->extreme[bit];
+    Event_log(&event);
+  }
 }
 /* END OF FUNCTION*/
 
-/** @brief Resets zero cross structure.
- * @param[inout] p_zc - pointer to the zero cross object to work on.
+/** @brief Computes the calibration coefficients of a phase from its snapshot accumulators.
+ * @param[in] p_args - phase to update and its targets (the snapshot holds the calibration window).
  */
-static void Zero_cross_hard_reset(LMA_ZeroCross *const p_zc)
+static void Phase_calibration_compute(const LMA_PhaseCalibArgs *const p_args)
 {
-  p_zc->last_sample = (spl_t)0;
-  p_zc->count = (uint32_t)0;
-  p_zc->debounce = false;
-  p_zc->first_event = false;
-  p_zc->already_run = false;
+  LMA_Phase *const p_phase = p_args->p_phase;
+  const float sample_count_fp = (float)p_phase->accs.snapshot.sample_count;
+  float q, p = 0.0f;
+
+  /* Update Coefficients*/
+  p_phase->calib.vrms_coeff = sqrtf((float)((double)p_phase->accs.snapshot.v_acc) / sample_count_fp) / p_args->vrms_tgt;
+  p_phase->calib.irms_coeff = sqrtf((float)((double)p_phase->accs.snapshot.i_acc) / sample_count_fp) / p_args->irms_tgt;
+  p_phase->calib.p_coeff = p_phase->calib.vrms_coeff * p_phase->calib.irms_coeff;
+
+  if (NULL != p_phase->p_neutral)
+  {
+    p_phase->p_neutral->calib.irms_coeff =
+        sqrtf((float)((double)p_phase->p_neutral->accs.i_acc_snapshot) / sample_count_fp) / p_args->irms_tgt;
+  }
+
+  /* Phase Correction*/
+  q = (float)p_phase->accs.snapshot.q_acc / p_phase->calib.p_coeff;
+  p = (float)p_phase->accs.snapshot.p_acc / p_phase->calib.p_coeff;
+  p_phase->calib.vi_phase_correction = atanf(q / p) * (180.0f / 3.14159265359f);
 }
+/* END OF FUNCTION*/
 
-/** @brief Complete hard reset on a phase
- * @details Will reset the zero cross synch flag so we wait for the next full zero cross to be detected.
- * And resets all accumulators to zero.
- * @param[inout] p_phase - pointer to the phase block to reset
+/** @brief Steps the asynchronous calibration of a phase on the end of its window (see LMA_PhaseCalibrateStart).
+ * @details The stabilising window is discarded and the next accumulates for line_cycles. The phase then meters again from a
+ * fresh window.
+ * @param[inout] p_phase - pointer to the calibrating phase (its snapshot holds the window just ended).
  */
-static void Phase_hard_reset(LMA_Phase *const p_phase)
+static void Calibration_window(LMA_Phase *const p_phase)
 {
-  Zero_cross_hard_reset(&(p_phase->zero_cross_v));
-
-  p_phase->inputs.v_sample = (spl_t)0;
-  p_phase->inputs.v90_sample = (spl_t)0;
-  p_phase->inputs.i_sample = (spl_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_CalibJob *const p_job = p_calib_job;
+  uint32_t index = (uint32_t)0;
 
-  p_phase->accs.snapshot.v_acc = (acc_t)0;
-  p_phase->accs.snapshot.i_acc = (acc_t)0;
-  p_phase->accs.snapshot.p_acc = (acc_t)0;
-  p_phase->accs.snapshot.q_acc = (acc_t)0;
-  p_phase->accs.snapshot.sample_count = (uint32_t)0;
+  while ((index < p_job->count) && (p_job->p_args[index].p_phase != p_phase))
+  {
+    ++index;
+  }
 
-  if (NULL != p_phase->p_neutral)
+  if (index >= p_job->count)
   {
-    p_phase->p_neutral->inputs.i_sample = (spl_t)0;
-    p_phase->p_neutral->accs.i_acc_snapshot = (acc_t)0;
+    /* Calibrating by LMA_PhaseCalibrate - nothing to step*/
+    return;
   }
 
-  p_phase->measurements.vrms = 0.0f;
-  p_phase->measurements.irms = 0.0f;
-  p_phase->measurements.p = 0.0f;
-  p_phase->measurements.q = 0.0f;
-  p_phase->measurements.s = 0.0f;
-  p_phase->measurements.irms_neutral = 0.0f;
-  p_phase->measurements.fline = 0.0f;
+  if (LMA_CALIB_STABILISING == p_job->p_states[index])
+  {
+    const uint32_t line_cycles = p_job->p_args[index].line_cycles;
 
-  p_phase->energy_units.act = 0.0f;
-  p_phase->energy_units.react = 0.0f;
-  p_phase->energy_units.app = 0.0f;
+    LMA_CRITICAL_SECTION_ENTER();
+    p_phase->window.cycles = (line_cycles > window_max) ? window_max : line_cycles;
+    LMA_CRITICAL_SECTION_EXIT();
+    p_job->p_states[index] = LMA_CALIB_ACCUMULATING;
+  }
+  else if (LMA_CALIB_ACCUMULATING == p_job->p_states[index])
+  {
+    Phase_calibration_compute(&(p_job->p_args[index]));
 
-  LMA_AccPhaseReset(p_phase);
+    /* Back to metering on the new coefficients*/
+    LMA_CRITICAL_SECTION_ENTER();
+    Phase_hard_reset(p_phase);
+    LMA_CRITICAL_SECTION_EXIT();
+    p_job->p_states[index] = LMA_CALIB_DONE;
+    --p_job->remaining;
+  }
+  else
+  {
+    return;
+  }
 
-  LMA_PhaseResetHook(p_phase);
+  if (NULL != p_job->p_callback)
+  {
+    p_job->p_callback(p_job, index);
+  }
 
-  p_phase->sigs.accumulators_ready = false;
-  p_phase->sigs.measurements_ready = false;
-  p_phase->sigs.calibrating = false;
+  if ((uint32_t)0 == p_job->remaining)
+  {
+    p_calib_job = NULL;
+  }
 }
 /* END OF FUNCTION*/
 
@@ -195,6 +1644,14 @@ void LMA_Init(LMA_Config *const p_config_arg)
   LMA_ADC_Init();
   LMA_TMR_Init();
   LMA_RTC_Init();
+
+  Window_limit_update();
+  System_registers_init();
+
+#if LMA_TRACE_ENABLE
+  LMA_TRACE_INIT();
+  memset(trace_stats, 0, sizeof(trace_stats));
+#endif
 }
 
 void LMA_Deinit(void)
@@ -217,6 +1674,17 @@ void LMA_Deinit(void)
 
   phase_list.p_first_phase = NULL;
   phase_list.phase_count = (uint32_t)0;
+  p_computed_neutral = NULL;
+  p_system_measurements = NULL;
+  p_registers = NULL;
+  register_count = (uint32_t)0;
+  p_tariff = NULL;
+  p_tariff_register = NULL;
+  p_demands = NULL;
+  demand_count = (uint32_t)0;
+  p_capture = NULL;
+  p_event_log = NULL;
+  p_calib_job = NULL;
 }
 
 void LMA_PhaseRegister(LMA_Phase *const p_phase)
@@ -238,6 +1706,9 @@ void LMA_PhaseRegister(LMA_Phase *const p_phase)
   p_phase->p_next = NULL;
   p_phase->phase_number = phase_list.phase_count;
   p_phase->p_neutral = NULL;
+  p_phase->p_v_filter = NULL;
+  p_phase->p_v90_filter = NULL;
+  p_phase->p_i_filter = NULL;
   phase_list.phase_count += 1;
 
   Phase_hard_reset(p_phase);
@@ -248,7 +1719,45 @@ void LMA_NeutralRegister(LMA_Phase *const p_phase, LMA_Neutral *const p_neutral)
   p_phase->p_neutral = p_neutral;
 
   p_neutral->accs.i_acc_snapshot = (acc_t)0;
+#if LMA_OFFSET_REMOVAL
+  p_neutral->accs.i_sum_snapshot = (acc_t)0;
+#endif
   p_neutral->inputs.i_sample = (spl_t)0;
+  p_neutral->p_i_filter = NULL;
+}
+
+void LMA_ComputedNeutralRegister(LMA_ComputedNeutral *const p_neutral)
+{
+  p_computed_neutral = p_neutral;
+  Computed_neutral_reset();
+
+  if (NULL != p_config)
+  {
+    Window_limit_update();
+  }
+}
+
+void LMA_SystemMeasurementsRegister(LMA_SystemMeasurements *const p_measurements)
+{
+  p_system_measurements = p_measurements;
+
+  if (NULL != p_system_measurements)
+  {
+    memset(p_system_measurements, 0, sizeof(LMA_SystemMeasurements));
+  }
+}
+
+void LMA_PhaseFilterRegister(LMA_Phase *const p_phase, LMA_FilterChain *const p_v_filter, LMA_FilterChain *const p_v90_filter,
+                             LMA_FilterChain *const p_i_filter)
+{
+  p_phase->p_v_filter = p_v_filter;
+  p_phase->p_v90_filter = p_v90_filter;
+  p_phase->p_i_filter = p_i_filter;
+}
+
+void LMA_NeutralFilterRegister(LMA_Neutral *const p_neutral, LMA_FilterChain *const p_i_filter)
+{
+  p_neutral->p_i_filter = p_i_filter;
 }
 
 void LMA_ComputationHookRegister(LMA_Phase *const p_phase, float (*comp_hook)(float *i, float *v, float *f))
@@ -259,6 +1768,7 @@ void LMA_ComputationHookRegister(LMA_Phase *const p_phase, float (*comp_hook)(fl
 void LMA_GlobalLoadCalibration(const LMA_GlobalCalibration *const p_calib)
 {
   memcpy(&(p_config->gcalib), p_calib, sizeof(LMA_GlobalCalibration));
+  Window_limit_update();
 }
 
 void LMA_PhaseLoadCalibration(LMA_Phase *const p_phase, const LMA_PhaseCalibration *const p_calib)
@@ -294,6 +1804,7 @@ void LMA_Start(void)
     while (!tmp->sigs.accumulators_ready)
     {
       /* Wait until the accumulation has stopped*/
+      LMA_PORT_WAIT();
     }
 
     LMA_CRITICAL_SECTION_ENTER();
@@ -318,8 +1829,6 @@ void LMA_Stop(void)
 void LMA_PhaseCalibrate(LMA_PhaseCalibArgs *const calib_args)
 {
   uint32_t backup_update_interval = p_config->update_interval;
-  float sample_count_fp;
-  float q, p = 0.0f;
   LMA_CRITICAL_SECTION_PREPARE();
 
   LMA_ADC_Stop();
@@ -329,6 +1838,8 @@ void LMA_PhaseCalibrate(LMA_PhaseCalibArgs *const calib_args)
 
   calib_args->p_phase->sigs.calibrating = true;
   p_config->update_interval = calib_args->line_cycles_stability;
+  calib_args->p_phase->window.cycles = (calib_args->line_cycles_stability > window_max) ? window_max
+                                                                                         : calib_args->line_cycles_stability;
 
   LMA_ADC_Start();
 
@@ -336,39 +1847,28 @@ void LMA_PhaseCalibrate(LMA_PhaseCalibArgs *const calib_args)
   while (!calib_args->p_phase->sigs.accumulators_ready)
   {
     /* Wait until the accumulation has stopped*/
+    LMA_PORT_WAIT();
   }
 
   /* Accumulate Signal*/
   LMA_CRITICAL_SECTION_ENTER();
   calib_args->p_phase->sigs.accumulators_ready = false;
   p_config->update_interval = calib_args->line_cycles;
+  calib_args->p_phase->window.cycles = (calib_args->line_cycles > window_max) ? window_max : calib_args->line_cycles;
   LMA_CRITICAL_SECTION_EXIT();
   while (!calib_args->p_phase->sigs.accumulators_ready)
   {
     /* Wait until the accumulation has stopped*/
+    LMA_PORT_WAIT();
   }
 
   LMA_ADC_Stop();
 
-  sample_count_fp = (float)calib_args->p_phase->accs.snapshot.sample_count;
-
-  /* Update Coefficients*/
-  calib_args->p_phase->calib.vrms_coeff =
-      sqrtf((float)((double)calib_args->p_phase->accs.snapshot.v_acc) / sample_count_fp) / calib_args->vrms_tgt;
-  calib_args->p_phase->calib.irms_coeff =
-      sqrtf((float)((double)calib_args->p_phase->accs.snapshot.i_acc) / sample_count_fp) / calib_args->irms_tgt;
-  calib_args->p_phase->calib.p_coeff = calib_args->p_phase->calib.vrms_coeff * calib_args->p_phase->calib.irms_coeff;
-
-  if (NULL != calib_args->p_phase->p_neutral)
-  {
-    calib_args->p_phase->p_neutral->calib.irms_coeff =
-        sqrtf((float)((double)calib_args->p_phase->p_neutral->accs.i_acc_snapshot) / sample_count_fp) / calib_args->irms_tgt;
-  }
+#if LMA_OFFSET_REMOVAL
+  Phase_offset_remove(calib_args->p_phase);
+#endif
 
-  /* Phase Correction*/
-  q = (float)calib_args->p_phase->accs.snapshot.q_acc / calib_args->p_phase->calib.p_coeff;
-  p = (float)calib_args->p_phase->accs.snapshot.p_acc / calib_args->p_phase->calib.p_coeff;
-  calib_args->p_phase->calib.vi_phase_correction = atanf(q / p) * (180.0f / 3.14159265359f);
+  Phase_calibration_compute(calib_args);
 
   /* Restore operation*/
   p_config->update_interval = backup_update_interval;
@@ -378,6 +1878,35 @@ void LMA_PhaseCalibrate(LMA_PhaseCalibArgs *const calib_args)
   LMA_ADC_Start();
 }
 
+bool LMA_PhaseCalibrateStart(LMA_CalibJob *const p_job)
+{
+  uint32_t index = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  if ((NULL != p_calib_job) || ((uint32_t)0 == p_job->count))
+  {
+    return false;
+  }
+
+  LMA_CRITICAL_SECTION_ENTER();
+  for (index = (uint32_t)0; index < p_job->count; ++index)
+  {
+    LMA_Phase *const p_phase = p_job->p_args[index].p_phase;
+    const uint32_t stability = p_job->p_args[index].line_cycles_stability;
+
+    /* Each phase runs its own windows from a fresh start - its energy units are zero until it is done*/
+    Phase_hard_reset(p_phase);
+    p_phase->sigs.calibrating = true;
+    p_phase->window.cycles = (stability > window_max) ? window_max : stability;
+    p_job->p_states[index] = LMA_CALIB_STABILISING;
+  }
+  p_job->remaining = p_job->count;
+  p_calib_job = p_job;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  return true;
+}
+
 void LMA_GlobalCalibrate(LMA_GlobalCalibArgs *const calib_args)
 {
   LMA_Phase *tmp = phase_list.p_first_phase;
@@ -403,6 +1932,7 @@ void LMA_GlobalCalibrate(LMA_GlobalCalibArgs *const calib_args)
   while (!calib_fs.finished)
   {
     /* Wait until the accumulation has stopped*/
+    LMA_PORT_WAIT();
   }
 
   calib_fs.finished = false;
@@ -411,6 +1941,7 @@ void LMA_GlobalCalibrate(LMA_GlobalCalibArgs *const calib_args)
   /* Compute system timing parameters*/
   p_config->gcalib.fs = (float)calib_fs.adc_counter / ((float)calib_args->rtc_period * (float)calib_args->rtc_cycles);
   p_config->gcalib.deg_per_sample = (360.00f * calib_args->fline_target) / p_config->gcalib.fs;
+  Window_limit_update();
 
   LMA_ADC_Start();
 
@@ -421,31 +1952,249 @@ void LMA_GlobalCalibrate(LMA_GlobalCalibArgs *const calib_args)
     while (!tmp->sigs.accumulators_ready)
     {
       /* Wait until the accumulation has stopped*/
+      LMA_PORT_WAIT();
     }
 
     LMA_CRITICAL_SECTION_ENTER();
     tmp->sigs.accumulators_ready = false;
     LMA_CRITICAL_SECTION_EXIT();
 
-    tmp = tmp->p_next;
+    tmp = tmp->p_next;
+  }
+
+  LMA_TMR_Start();
+}
+
+void LMA_EnergySet(LMA_SystemEnergy *const p_energy)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_CRITICAL_SECTION_ENTER();
+  memcpy(&sys_energy, p_energy, sizeof(LMA_SystemEnergy));
+  System_registers_load();
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_RegistersSet(LMA_Register *const p_table, const uint32_t count)
+{
+  uint32_t r = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  p_registers = p_table;
+  register_count = (NULL != p_table) ? count : (uint32_t)0;
+
+  for (r = (uint32_t)0; r < register_count; ++r)
+  {
+    p_registers[r].unit = 0.0f;
+    p_registers[r].impulse_counter = (uint32_t)0;
+    p_registers[r].impulse_on = false;
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+float LMA_RegisterWhGet(const LMA_Register *const p_register)
+{
+  float wh = 0.0f;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  wh = (((float)p_register->counter * p_register->meter_constant) + p_register->accumulator_ws) / 3600.00f;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  return wh;
+}
+
+void LMA_ClockSet(const uint32_t seconds)
+{
+  uint32_t d = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  clock_seconds = seconds;
+  clock_rtc_count = (uint32_t)0;
+
+  /* Sub-intervals restart on the boundaries of the new time*/
+  for (d = (uint32_t)0; d < demand_count; ++d)
+  {
+    Demand_restart(&(p_demands[d]));
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+
+  /* The tariff follows the new time straight away*/
+  if (NULL != p_tariff)
+  {
+    Tariff_switch(Tariff_lookup(p_tariff->p_schedule, seconds));
+  }
+}
+
+uint32_t LMA_ClockGet(void)
+{
+  uint32_t seconds = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  seconds = clock_seconds;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  return seconds;
+}
+
+void LMA_TariffSet(LMA_Tariff *const p_new_tariff)
+{
+  uint32_t t = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  p_tariff = p_new_tariff;
+  p_tariff_register = NULL;
+
+  if (NULL != p_tariff)
+  {
+    for (t = (uint32_t)0; t < LMA_TARIFF_COUNT; ++t)
+    {
+      p_tariff->registers[t].unit = 0.0f;
+      p_tariff->registers[t].impulse_counter = (uint32_t)0;
+      p_tariff->registers[t].impulse_on = false;
+    }
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+
+  /* Start counting on the tariff active now*/
+  if (NULL != p_tariff)
+  {
+    Tariff_switch(Tariff_lookup(p_tariff->p_schedule, LMA_ClockGet()));
+  }
+}
+
+void LMA_DemandsSet(LMA_Demand *const p_table, const uint32_t count)
+{
+  uint32_t d = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  p_demands = p_table;
+  demand_count = (NULL != p_table) ? count : (uint32_t)0;
+
+  for (d = (uint32_t)0; d < demand_count; ++d)
+  {
+    Demand_restart(&(p_demands[d]));
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_DemandGet(const LMA_Demand *const p_demand, LMA_DemandReading *const p_reading)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  *p_reading = p_demand->reading;
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_DemandPeakClear(LMA_Demand *const p_demand)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  p_demand->reading.peak = 0.0f;
+  p_demand->reading.peak_time = (uint32_t)0;
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_CaptureSet(LMA_Capture *const p_new_capture)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  p_capture = p_new_capture;
+  if (NULL != p_capture)
+  {
+    p_capture->phase_count = phase_list.phase_count;
+    p_capture->frozen = (uint32_t)0;
+    p_capture->released = (uint32_t)0;
+    Capture_start();
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_CaptureTrigger(void)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  if (NULL != p_capture)
+  {
+    Capture_trigger(LMA_OK, (uint32_t)0);
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+const LMA_CaptureEvent *LMA_CaptureGet(const LMA_Capture *const p_held)
+{
+  return (p_held->frozen != p_held->released) ? &(p_held->p_events[p_held->released % p_held->event_count]) : NULL;
+}
+
+void LMA_CaptureRelease(LMA_Capture *const p_held)
+{
+  if (p_held->frozen != p_held->released)
+  {
+    ++p_held->released;
   }
-
-  LMA_TMR_Start();
 }
 
-void LMA_EnergySet(LMA_SystemEnergy *const p_energy)
+void LMA_EventLogSet(LMA_EventLog *const p_new_log)
 {
   LMA_CRITICAL_SECTION_PREPARE();
+
   LMA_CRITICAL_SECTION_ENTER();
-  memcpy(&sys_energy, p_energy, sizeof(LMA_SystemEnergy));
+  p_event_log = p_new_log;
+  if (NULL != p_event_log)
+  {
+    LMA_Phase *p_phase = phase_list.p_first_phase;
+
+    p_event_log->written = (uint32_t)0;
+    p_event_log->read = (uint32_t)0;
+    p_event_log->dropped = (uint32_t)0;
+
+    /* Bits already raised are followed from now on*/
+    while (NULL != p_phase)
+    {
+      LMA_EventTrack *const p_track = &(p_event_log->p_tracks[p_phase->phase_number]);
+      uint32_t bit = (uint32_t)0;
+
+      for (bit = (uint32_t)0; bit < LMA_EVENT_STATUS_BITS; ++bit)
+      {
+        p_track->start[bit] = clock_seconds;
+        p_track->duration[bit] = 0.0f;
+        p_track->extreme[bit] = Event_value(p_phase, bit, p_phase->measurements.fline);
+      }
+      p_phase = p_phase->p_next;
+    }
+  }
   LMA_CRITICAL_SECTION_EXIT();
 }
 
+uint32_t LMA_EventsRead(LMA_EventLog *const p_log, LMA_Event *const p_events, const uint32_t max_count)
+{
+  const uint32_t written = p_log->written;
+  uint32_t count = (uint32_t)0;
+
+  for (count = (uint32_t)0; (count < max_count) && ((p_log->read + count) != written); ++count)
+  {
+    p_events[count] = p_log->p_events[(p_log->read + count) % p_log->size];
+  }
+
+  /* Counted last - the entries are copied before LMA_CB_TMR can reuse them*/
+  p_log->read += count;
+
+  return count;
+}
+
 void LMA_EnergyGet(LMA_SystemEnergy *const p_energy)
 {
   LMA_CRITICAL_SECTION_PREPARE();
   LMA_CRITICAL_SECTION_ENTER();
-  memcpy(p_energy, &sys_energy, sizeof(LMA_SystemEnergy));
+  System_registers_store(p_energy);
   LMA_CRITICAL_SECTION_EXIT();
 }
 
@@ -466,24 +2215,26 @@ void LMA_MeasurementsGet(LMA_Phase *const p_phase, LMA_Measurements *const p_mea
   LMA_CRITICAL_SECTION_PREPARE();
 
   LMA_CRITICAL_SECTION_ENTER();
+  Measurements_copy(p_phase, p_measurements);
+  LMA_CRITICAL_SECTION_EXIT();
+}
 
-  p_measurements->vrms = p_phase->measurements.vrms;
-  p_measurements->irms = p_phase->measurements.irms;
-  p_measurements->fline = p_phase->measurements.fline;
-  p_measurements->p = p_phase->measurements.p;
-  p_measurements->q = p_phase->measurements.q;
-  p_measurements->s = p_phase->measurements.s;
+uint32_t LMA_MeasurementsGetAll(LMA_Measurements *const p_measurements, const uint32_t max_count)
+{
+  const LMA_Phase *p_phase = phase_list.p_first_phase;
+  uint32_t count = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
 
-  if (NULL != p_phase->p_neutral)
-  {
-    p_measurements->irms_neutral = p_phase->measurements.irms_neutral;
-  }
-  else
+  LMA_CRITICAL_SECTION_ENTER();
+  while ((NULL != p_phase) && (count < max_count))
   {
-    p_measurements->irms_neutral = 0.0f;
+    Measurements_copy(p_phase, &(p_measurements[count]));
+    ++count;
+    p_phase = p_phase->p_next;
   }
-
   LMA_CRITICAL_SECTION_EXIT();
+
+  return count;
 }
 
 void LMA_ConsumptionDataGet(const LMA_SystemEnergy *const p_se, LMA_ConsumptionData *const p_ec)
@@ -523,6 +2274,115 @@ bool LMA_MeasurementsReady(LMA_Phase *const p_phase)
   return tmp;
 }
 
+bool LMA_MeasurementsWait(LMA_Phase *const p_phase, const uint32_t timeout)
+{
+  uint32_t start = (uint32_t)0;
+  uint32_t now = (uint32_t)0;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  /* The tick is read in a critical section - it may take more than one access*/
+  LMA_CRITICAL_SECTION_ENTER();
+  start = tmr_tick;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  while (!LMA_MeasurementsReady(p_phase))
+  {
+    LMA_CRITICAL_SECTION_ENTER();
+    now = tmr_tick;
+    LMA_CRITICAL_SECTION_EXIT();
+
+    if ((LMA_WAIT_FOREVER != timeout) && ((now - start) >= timeout))
+    {
+      return false;
+    }
+
+    LMA_PORT_WAIT();
+  }
+
+  return true;
+}
+
+void LMA_SystemMeasurementsGet(LMA_SystemMeasurements *const p_measurements)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  if (NULL != p_system_measurements)
+  {
+    *p_measurements = *p_system_measurements;
+  }
+  else
+  {
+    memset(p_measurements, 0, sizeof(LMA_SystemMeasurements));
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+float LMA_ComputedNeutralGet(void)
+{
+  float tmp = 0.0f;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  if (NULL != p_computed_neutral)
+  {
+    tmp = p_computed_neutral->irms;
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+
+  return tmp;
+}
+
+uint32_t LMA_WindowMax(void)
+{
+  return window_max;
+}
+
+uint32_t LMA_WindowGet(LMA_Phase *const p_phase)
+{
+  uint32_t tmp;
+  LMA_CRITICAL_SECTION_PREPARE();
+
+  LMA_CRITICAL_SECTION_ENTER();
+  tmp = p_phase->window.snapshot_cycles;
+  LMA_CRITICAL_SECTION_EXIT();
+
+  return tmp;
+}
+
+#if LMA_TRACE_ENABLE
+void LMA_TraceGet(const LMA_TraceId id, LMA_TraceStats *const p_stats)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_CRITICAL_SECTION_ENTER();
+  memcpy(p_stats, &(trace_stats[id]), sizeof(LMA_TraceStats));
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_TraceBudgetSet(const LMA_TraceId id, const uint32_t cycles)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  LMA_CRITICAL_SECTION_ENTER();
+  trace_stats[id].budget = cycles;
+  LMA_CRITICAL_SECTION_EXIT();
+}
+
+void LMA_TraceReset(void)
+{
+  LMA_CRITICAL_SECTION_PREPARE();
+  uint32_t id = (uint32_t)0;
+
+  LMA_CRITICAL_SECTION_ENTER();
+  for (id = (uint32_t)0; id < (uint32_t)LMA_TRACE_COUNT; ++id)
+  {
+    const uint32_t budget = trace_stats[id].budget;
+    memset(&(trace_stats[id]), 0, sizeof(LMA_TraceStats));
+    trace_stats[id].budget = budget;
+  }
+  LMA_CRITICAL_SECTION_EXIT();
+}
+#endif
+
 /** @details The ADC Callback handles:
  *  1. Sample processing and accumulation.
  *  2. Energy Impulse Management.
@@ -531,35 +2391,91 @@ bool LMA_MeasurementsReady(LMA_Phase *const p_phase)
  */
 void LMA_CB_ADC(void)
 {
+  LMA_TRACE_BEGIN(LMA_TRACE_ADC);
   LMA_Phase *p_phase = phase_list.p_first_phase;
+  LMA_Phase *const p_reference = phase_list.p_first_phase;
   bool process_energy = true;
+  acc_t i_sum = (acc_t)0;
+  bool neutral_load = false;
+  bool reference_end = false;
+  LMA_PhaseInputs *p_capture_frame = (NULL != p_capture) ? p_capture->p_frame : NULL;
 
   /* If we are running fs calibration - increment the counter*/
   if (!calib_fs.active)
   {
+    ++adc_tick;
+
     while (NULL != p_phase)
     {
-      if (p_phase->sigs.calibrating)
+      /* Coherent windows - phases other than the first follow its zero cross and window (unless calibrating)*/
+      const bool follow = p_config->coherent_windows && (p_phase != p_reference) && (!p_phase->sigs.calibrating);
+      const LMA_ZeroCross *const p_sync = follow ? &(p_reference->zero_cross_v) : &(p_phase->zero_cross_v);
+      bool window_end = false;
+
+      /* Blocking calibration stops the meter - an asynchronous one only the calibrating phases (their units are zero)*/
+      if (p_phase->sigs.calibrating && (NULL == p_calib_job))
       {
         process_energy = false;
       }
 
-      /* Zero cross - voltage*/
-      (void)Zero_cross_detect(&(p_phase->zero_cross_v), p_phase->inputs.v_sample);
+      /* Waveform capture - the raw inputs, one store per phase*/
+      if (NULL != p_capture_frame)
+      {
+        *p_capture_frame++ = p_phase->inputs;
+      }
+
+      /* Front end filters - skip the phase until a decimating filter has an output*/
+      if (!Phase_filter(p_phase))
+      {
+        p_phase = p_phase->p_next;
+        continue;
+      }
+
+      /* Vector sum of the phase currents for the computed neutral*/
+      i_sum += (acc_t)p_phase->inputs.i_sample;
+
+      /* Zero cross - voltage (followers only time their own crossing, for the system measurements)*/
+      if (!follow)
+      {
+        (void)Zero_cross_detect(&(p_phase->zero_cross_v), p_phase->inputs.v_sample, adc_tick);
+      }
+      else if (NULL != p_system_measurements)
+      {
+        Zero_cross_tick(&(p_phase->zero_cross_v), p_phase->inputs.v_sample, adc_tick);
+      }
 
+      /* Coherent windows - a follower reset part way through a window of the first phase joins at the start of the next*/
+      if (follow && !p_phase->window.joined)
+      {
+        p_phase->window.joined = reference_end || !p_reference->zero_cross_v.first_event;
+        LMA_AccPhaseReset(p_phase);
+      }
       /* Handle active & apparent component once synched with zero cross and accumulation is enabled */
-      if (p_phase->zero_cross_v.first_event)
+      else if (p_sync->first_event)
       {
+        LMA_TRACE_BEGIN(LMA_TRACE_ACC_RUN);
         LMA_AccPhaseRun(p_phase);
+        LMA_TRACE_END(LMA_TRACE_ACC_RUN);
 
-        /* If appropriate number of line cycles have passed - process results*/
-        if (p_phase->zero_cross_v.count >= p_config->update_interval)
+        /* If appropriate number of line cycles have passed - process results (followers end with the first phase)*/
+        window_end = follow ? reference_end : (p_phase->zero_cross_v.count >= p_phase->window.cycles);
+        if (p_phase == p_reference)
+        {
+          reference_end = window_end;
+        }
+
+        if (window_end)
         {
           /* Get snapshot of accumulators*/
+          LMA_TRACE_BEGIN(LMA_TRACE_ACC_LOAD);
           LMA_AccPhaseLoad(p_phase);
+          LMA_TRACE_END(LMA_TRACE_ACC_LOAD);
+          p_phase->window.snapshot_cycles = follow ? p_reference->window.snapshot_cycles : p_phase->zero_cross_v.count;
+          neutral_load = (p_phase == phase_list.p_first_phase) || neutral_load;
 
           /* Signal Accumulators are ready*/
           p_phase->sigs.accumulators_ready = true;
+          LMA_PORT_SIGNAL();
 
           /* Reset*/
           LMA_AccPhaseReset(p_phase);
@@ -572,156 +2488,34 @@ void LMA_CB_ADC(void)
       p_phase = p_phase->p_next;
     }
 
-    if (process_energy)
+    if (NULL != p_capture)
     {
-      /* Active LED Management*/
-      if (sys_energy.impulse.active_on)
-      {
-        ++sys_energy.impulse.active_counter;
-        if (sys_energy.impulse.active_counter > sys_energy.impulse.led_on_count)
-        {
-          sys_energy.impulse.active_on = false;
-          LMA_IMP_ActiveOff();
-        }
-      }
-
-      /* Apparent LED Management*/
-      if (sys_energy.impulse.apparent_on)
-      {
-        ++sys_energy.impulse.apparent_counter;
-        if (sys_energy.impulse.apparent_counter > sys_energy.impulse.led_on_count)
-        {
-          sys_energy.impulse.apparent_on = false;
-          LMA_IMP_ApparentOff();
-        }
-      }
+      Capture_advance(p_capture_frame);
+    }
 
-      /* Reactive LED Management*/
-      if (sys_energy.impulse.reactive_on)
-      {
-        ++sys_energy.impulse.reactive_counter;
-        if (sys_energy.impulse.reactive_counter > sys_energy.impulse.led_on_count)
-        {
-          sys_energy.impulse.reactive_on = false;
-          LMA_IMP_ReactiveOff();
-        }
-      }
+    /* Computed neutral - accumulated over the same samples as the first phase, and loaded with it*/
+    if ((NULL != p_computed_neutral) && phase_list.p_first_phase->zero_cross_v.first_event)
+    {
+      p_computed_neutral->i_acc_temp += i_sum * i_sum;
+#if LMA_OFFSET_REMOVAL
+      p_computed_neutral->i_sum_temp += i_sum;
+#endif
 
-      /*Energy accumulation*/
-      if (sys_energy.energy.unit.act >= 0.0f)
+      if (neutral_load)
       {
-        sys_energy.energy.accumulator.act_imp_ws += sys_energy.energy.unit.act;
-        if (sys_energy.energy.accumulator.act_imp_ws >= p_config->meter_constant)
-        {
-          sys_energy.energy.accumulator.act_imp_ws -= p_config->meter_constant;
-          ++sys_energy.energy.counter.act_imp;
-
-          /* Trigger Pulse*/
-          sys_energy.impulse.active_counter = (uint32_t)0;
-          sys_energy.impulse.active_on = true;
-          LMA_IMP_ActiveOn();
-        }
-
-        sys_energy.energy.accumulator.app_imp_ws += sys_energy.energy.unit.app;
-        if (sys_energy.energy.accumulator.app_imp_ws >= p_config->meter_constant)
-        {
-          sys_energy.energy.accumulator.app_imp_ws -= p_config->meter_constant;
-          ++sys_energy.energy.counter.app_imp;
-
-          /* Trigger Pulse*/
-          sys_energy.impulse.apparent_counter = (uint32_t)0;
-          sys_energy.impulse.apparent_on = true;
-          LMA_IMP_ApparentOn();
-        }
-
-        if (sys_energy.energy.unit.react >= 0.0f)
-        {
-          /* QI - Active From Grid (Import) & Inductive From Grid (Import) - Apparent From Grid (Import)*/
-          sys_energy.energy.accumulator.l_react_imp_ws += sys_energy.energy.unit.react;
-          if (sys_energy.energy.accumulator.l_react_imp_ws >= p_config->meter_constant)
-          {
-            sys_energy.energy.accumulator.l_react_imp_ws -= p_config->meter_constant;
-            ++sys_energy.energy.counter.l_react_imp;
-
-            /* Trigger Pulse*/
-            sys_energy.impulse.reactive_counter = (uint32_t)0;
-            sys_energy.impulse.reactive_on = true;
-            LMA_IMP_ReactiveOn();
-          }
-        }
-        else
-        {
-          /* QIV - Active From Grid (Import) & Capacitive To Grid (Export) - Apparent From Grid (Import)*/
-          sys_energy.energy.accumulator.c_react_exp_ws -= sys_energy.energy.unit.react;
-          if (sys_energy.energy.accumulator.c_react_exp_ws >= p_config->meter_constant)
-          {
-            sys_energy.energy.accumulator.c_react_exp_ws -= p_config->meter_constant;
-            ++sys_energy.energy.counter.c_react_exp;
-
-            /* Trigger Pulse*/
-            sys_energy.impulse.reactive_counter = (uint32_t)0;
-            sys_energy.impulse.reactive_on = true;
-            LMA_IMP_ReactiveOn();
-          }
-        }
+        p_computed_neutral->i_acc_snapshot = p_computed_neutral->i_acc_temp;
+        p_computed_neutral->i_acc_temp = (acc_t)0;
+#if LMA_OFFSET_REMOVAL
+        p_computed_neutral->i_sum_snapshot = p_computed_neutral->i_sum_temp;
+        p_computed_neutral->i_sum_temp = (acc_t)0;
+#endif
       }
-      else
-      {
-        sys_energy.energy.accumulator.act_exp_ws -= sys_energy.energy.unit.act;
-        if (sys_energy.energy.accumulator.act_exp_ws >= p_config->meter_constant)
-        {
-          sys_energy.energy.accumulator.act_exp_ws -= p_config->meter_constant;
-          ++sys_energy.energy.counter.act_exp;
-
-          /* Trigger Pulse*/
-          sys_energy.impulse.active_counter = (uint32_t)0;
-          sys_energy.impulse.active_on = true;
-          LMA_IMP_ActiveOn();
-        }
-
-        sys_energy.energy.accumulator.app_exp_ws += sys_energy.energy.unit.app;
-        if (sys_energy.energy.accumulator.app_exp_ws >= p_config->meter_constant)
-        {
-          sys_energy.energy.accumulator.app_exp_ws -= p_config->meter_constant;
-          ++sys_energy.energy.counter.app_exp;
-
-          /* Trigger Pulse*/
-          sys_energy.impulse.apparent_counter = (uint32_t)0;
-          sys_energy.impulse.apparent_on = true;
-          LMA_IMP_ActiveOn();
-        }
-
-        if (sys_energy.energy.unit.react >= 0.0f)
-        {
-          /* QII - Active To Grid (Export) & Capacitive From Grid (Import) - Apparent To Grid (Export)*/
-          sys_energy.energy.accumulator.c_react_imp_ws += sys_energy.energy.unit.react;
-          if (sys_energy.energy.accumulator.c_react_imp_ws >= p_config->meter_constant)
-          {
-            sys_energy.energy.accumulator.c_react_imp_ws -= p_config->meter_constant;
-            ++sys_energy.energy.counter.c_react_imp;
-
-            /* Trigger Pulse*/
-            sys_energy.impulse.reactive_counter = (uint32_t)0;
-            sys_energy.impulse.reactive_on = true;
-            LMA_IMP_ReactiveOn();
-          }
-        }
-        else
-        {
-          /* QIII - Active To Grid (Export) & Inductive To Grid (Export) - Apparent To Grid (Export)*/
-          sys_energy.energy.accumulator.l_react_exp_ws -= sys_energy.energy.unit.react;
-          if (sys_energy.energy.accumulator.l_react_exp_ws >= p_config->meter_constant)
-          {
-            sys_energy.energy.accumulator.l_react_exp_ws -= p_config->meter_constant;
-            ++sys_energy.energy.counter.l_react_exp;
+    }
 
-            /* Trigger Pulse*/
-            sys_energy.impulse.reactive_counter = (uint32_t)0;
-            sys_energy.impulse.reactive_on = true;
-            LMA_IMP_ReactiveOn();
-          }
-        }
-      }
+    if (process_energy)
+    {
+      /* Energy - the system energy registers (and LEDs) and the register table share one add and compare per register*/
+      Registers_run();
     }
   }
   else if (calib_fs.running)
@@ -732,6 +2526,8 @@ void LMA_CB_ADC(void)
   {
     /* Do Nothing*/
   }
+
+  LMA_TRACE_END(LMA_TRACE_ADC);
 }
 
 /** @details The TMR Callback computes and updates:
@@ -746,10 +2542,15 @@ void LMA_CB_ADC(void)
 void LMA_CB_TMR(void)
 {
   LMA_CRITICAL_SECTION_PREPARE();
+  LMA_TRACE_BEGIN(LMA_TRACE_TMR);
   LMA_Phase *p_phase = phase_list.p_first_phase;
   static float act_energy_unit_tmp = 0.0f;
   static float react_energy_unit_tmp = 0.0f;
   static float app_energy_unit_tmp = 0.0f;
+  bool first_updated = false;
+  bool units_updated = false;
+  LMA_EnergyUnit system_unit = {0.0f, 0.0f, 0.0f};
+  uint32_t r = (uint32_t)0;
 
   /* Reset the energy units*/
   act_energy_unit_tmp = 0.0f;
@@ -761,10 +2562,25 @@ void LMA_CB_TMR(void)
     if (p_phase->sigs.accumulators_ready)
     {
       const float sample_count_fp = (float)p_phase->accs.snapshot.sample_count;
+      const LMA_Status status_before = p_phase->status;
+      float fline_window = 0.0f;
       p_phase->sigs.accumulators_ready = false;
 
+#if LMA_OFFSET_REMOVAL
+      Phase_offset_remove(p_phase);
+#endif
+
+      /* Asynchronous calibration - the window is the calibration's, not a measurement*/
+      if (p_phase->sigs.calibrating && (NULL != p_calib_job))
+      {
+        Calibration_window(p_phase);
+        p_phase = p_phase->p_next;
+        continue;
+      }
+
       /* Frequency*/
-      p_phase->measurements.fline = (p_config->gcalib.fs * (float)p_config->update_interval) / sample_count_fp;
+      p_phase->measurements.fline = (p_config->gcalib.fs * (float)p_phase->window.snapshot_cycles) / sample_count_fp;
+      fline_window = p_phase->measurements.fline;
 
       /* Check for valid frequency input*/
       if (p_phase->measurements.fline < p_config->fline_tol_high && p_phase->measurements.fline > p_config->fline_tol_low)
@@ -775,6 +2591,8 @@ void LMA_CB_TMR(void)
         const float pacc_fp = (float)((double)(p_phase->accs.snapshot.p_acc));
         const float qacc_fp = (float)((double)(p_phase->accs.snapshot.q_acc));
 
+        p_phase->status &= ~LMA_FREQUENCY_ERROR;
+
         /* Vrms*/
         p_phase->measurements.vrms = sqrtf(vacc_fp / sample_count_fp) / p_phase->calib.vrms_coeff;
         /* Irms*/
@@ -803,6 +2621,12 @@ void LMA_CB_TMR(void)
           p_phase->measurements.irms_neutral = sqrtf(iacc_neutral_fp / sample_count_fp) / p_phase->p_neutral->calib.irms_coeff;
         }
 
+        /* Computed neutral & tamper - on the window of the first phase*/
+        if ((NULL != p_computed_neutral) && (p_phase == phase_list.p_first_phase))
+        {
+          Computed_neutral_update(p_phase, sample_count_fp);
+        }
+
         /* V SAG AND SWELL*/
         if (p_phase->measurements.vrms < p_config->v_sag)
         {
@@ -811,7 +2635,7 @@ void LMA_CB_TMR(void)
         }
         else if (p_phase->measurements.vrms > p_config->v_swell)
         {
-          p_phase->status = LMA_VOLTAGE_SWELL;
+          p_phase->status |= LMA_VOLTAGE_SWELL;
           p_phase->status &= ~LMA_VOLTAGE_SAG;
         }
         else
@@ -820,6 +2644,16 @@ void LMA_CB_TMR(void)
           p_phase->status &= ~LMA_VOLTAGE_SWELL;
         }
 
+        /* OVERCURRENT*/
+        if ((p_config->i_over > 0.0f) && (p_phase->measurements.irms > p_config->i_over))
+        {
+          p_phase->status |= LMA_OVERCURRENT;
+        }
+        else
+        {
+          p_phase->status &= ~LMA_OVERCURRENT;
+        }
+
         /* Active Power (P) & Energy*/
         if (fabs(p_phase->measurements.p) < p_config->no_load_p)
         {
@@ -858,10 +2692,15 @@ void LMA_CB_TMR(void)
           p_phase->status &= ~LMA_NO_APPARENT_LOAD;
           p_phase->energy_units.app = p_phase->measurements.s / p_config->gcalib.fs;
         }
+
+        /* Length of the window being accumulated*/
+        Window_adapt(p_phase);
       }
       else
       {
         /* Handle Invalid Frequency*/
+        p_phase->status |= LMA_FREQUENCY_ERROR;
+
         /* Vrms*/
         p_phase->measurements.vrms = 0.0f;
         /* Irms*/
@@ -881,6 +2720,13 @@ void LMA_CB_TMR(void)
           p_phase->measurements.irms_neutral = 0.0f;
         }
 
+        /* Computed neutral*/
+        if ((NULL != p_computed_neutral) && (p_phase == phase_list.p_first_phase))
+        {
+          p_computed_neutral->irms = 0.0f;
+          p_phase->status &= ~(LMA_RESIDUAL_CURRENT | LMA_NEUTRAL_MISMATCH);
+        }
+
         /* Active Energy*/
         p_phase->energy_units.act = 0.0f;
         /* Reactive Energy*/
@@ -889,7 +2735,32 @@ void LMA_CB_TMR(void)
         p_phase->energy_units.app = 0.0f;
       }
 
+      /* Demand - the energy of this window*/
+      if ((uint32_t)0 != demand_count)
+      {
+        Demands_window(p_phase, sample_count_fp / p_config->gcalib.fs);
+      }
+
+      /* Waveform capture - a trigger bit raised by this window*/
+      if (NULL != p_capture)
+      {
+        const uint32_t raised = (uint32_t)p_phase->status & ~(uint32_t)status_before & p_capture->trigger_mask;
+
+        if ((uint32_t)0 != raised)
+        {
+          Capture_trigger((LMA_Status)raised, p_phase->phase_number);
+        }
+      }
+
+      /* Status events - the edges of this window*/
+      if (NULL != p_event_log)
+      {
+        Events_window(p_phase, status_before, sample_count_fp / p_config->gcalib.fs, fline_window);
+      }
+
       p_phase->sigs.measurements_ready = true;
+      first_updated = (p_phase == phase_list.p_first_phase) || first_updated;
+      units_updated = true;
     }
 
     act_energy_unit_tmp += p_phase->energy_units.act;
@@ -899,12 +2770,43 @@ void LMA_CB_TMR(void)
     p_phase = p_phase->p_next;
   }
 
-  /* Overwrite the energy units in the system energy manager*/
+  /* Coherent windows - the first phase ends the window of every phase*/
+  if (p_config->coherent_windows && first_updated)
+  {
+    Window_coherent();
+  }
+
+  /* Symmetrical components - once per window of the first phase, with the last window of the others*/
+  if ((NULL != p_system_measurements) && first_updated && ((uint32_t)3 == phase_list.phase_count))
+  {
+    System_measurements_update();
+  }
+
+  /* Overwrite the energy units in the system energy manager - and resolve them on its registers*/
+  system_unit.act = act_energy_unit_tmp;
+  system_unit.app = app_energy_unit_tmp;
+  system_unit.react = react_energy_unit_tmp;
   LMA_CRITICAL_SECTION_ENTER();
   sys_energy.energy.unit.act = act_energy_unit_tmp;
   sys_energy.energy.unit.react = react_energy_unit_tmp;
   sys_energy.energy.unit.app = app_energy_unit_tmp;
+  for (r = (uint32_t)0; r < (uint32_t)SYS_REG_COUNT; ++r)
+  {
+    sys_registers[r].unit = Register_unit(&(sys_registers[r]), &system_unit);
+  }
   LMA_CRITICAL_SECTION_EXIT();
+
+  /* Energy registers - only when an energy unit changed*/
+  if (units_updated && (((uint32_t)0 != register_count) || (NULL != p_tariff_register)))
+  {
+    Registers_unit_update(&system_unit);
+  }
+
+  /* Wake the foreground - on new measurements and to time out LMA_MeasurementsWait*/
+  ++tmr_tick;
+  LMA_PORT_SIGNAL();
+
+  LMA_TRACE_END(LMA_TRACE_TMR);
 }
 
 /** @details The RTC isr calling this should ideally have nested interrupts enabled in which the ADC can interrupt us.
@@ -912,6 +2814,29 @@ void LMA_CB_TMR(void)
  */
 void LMA_CB_RTC(void)
 {
+  LMA_TRACE_BEGIN(LMA_TRACE_RTC);
+
+  /* Clock - the tariff is looked up on each minute boundary, demand sub-intervals end on their boundaries*/
+  if ((NULL != p_config) && ((uint8_t)0 != p_config->rtc_rate))
+  {
+    ++clock_rtc_count;
+    if (clock_rtc_count >= (uint32_t)p_config->rtc_rate)
+    {
+      clock_rtc_count = (uint32_t)0;
+      ++clock_seconds;
+
+      if ((NULL != p_tariff) && ((uint32_t)0 == (clock_seconds % (uint32_t)60)))
+      {
+        Tariff_switch(Tariff_lookup(p_tariff->p_schedule, clock_seconds));
+      }
+
+      if ((uint32_t)0 != demand_count)
+      {
+        Demands_subinterval_end();
+      }
+    }
+  }
+
   /* If we are calibrating, synch the ADC sampling window to the RTC*/
   if (calib_fs.start)
   {
@@ -931,10 +2856,13 @@ void LMA_CB_RTC(void)
       calib_fs.start = false;
       calib_fs.running = false;
       calib_fs.finished = true; /* Signal to calibration routine we are done*/
+      LMA_PORT_SIGNAL();
     }
   }
   else
   {
     /* Do Nothing */
   }
+
+  LMA_TRACE_END(LMA_TRACE_RTC);
 }
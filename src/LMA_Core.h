@@ -8,6 +8,7 @@
 #ifndef _LMA_CORE_H
 #define _LMA_CORE_H
 
+#include "LMA_Filter.h"
 #include "LMA_Port.h"
 
 /** @addtogroup API
@@ -40,6 +41,9 @@ void LMA_Deinit(void);
  * This function also initialises the phase, so should be called BEFORE
  * LMA_NeutralRegister
  * LMA_ComputationHookRegister
+ * LMA_PhaseFilterRegister
+ * LMA_ComputedNeutralRegister
+ * LMA_SystemMeasurementsRegister
  * @param[in] p_phase - pointer to the phase
  */
 void LMA_PhaseRegister(LMA_Phase *const p_phase);
@@ -51,6 +55,29 @@ void LMA_PhaseRegister(LMA_Phase *const p_phase);
  */
 void LMA_NeutralRegister(LMA_Phase *const p_phase, LMA_Neutral *const p_neutral);
 
+/** @brief Registers a computed neutral - the vector sum of the phase currents (if used)
+ * @details Costs one add per phase and one multiply accumulate per sample in LMA_CB_ADC, and needs no ADC channel. It is
+ * accumulated over the window of the first phase, where LMA_CB_TMR raises LMA_RESIDUAL_CURRENT and LMA_NEUTRAL_MISMATCH
+ * (see LMA_Config.residual_i and LMA_Config.neutral_mismatch). The samples are summed raw, so the phases should have matched
+ * current gains - the result is scaled by the mean of their irms_coeff. With the two element (delta) method the sum is the
+ * current of the reference line rather than a neutral. The sum is up to ceil(log2(phase count)) bits wider than a sample, so
+ * the longest window (LMA_WindowMax) shrinks by 4^ceil(log2(phase count)) - 16 times with three phases.
+ * @warning Must be performed AFTER the phases are registered.
+ * @param[in] p_neutral - pointer to the computed neutral structure (NULL to remove).
+ */
+void LMA_ComputedNeutralRegister(LMA_ComputedNeutral *const p_neutral);
+
+/** @brief Registers the system measurements - symmetrical components of a three phase system (if used)
+ * @details Computed in LMA_CB_TMR once per window of the first phase, from the last measurements of all three phases - a
+ * fixed handful of complex operations per window. The phase angles are timed from the voltage zero crosses, so the phases
+ * should share a front end delay, and must be registered in phase order (a, b, c) - a reversed rotation reads as negative
+ * sequence. Only computed when exactly three phases are registered. With LMA_Config.coherent_windows the following phases
+ * keep a compare and a few stores per sample in LMA_CB_ADC to time their crossing, rather than a full zero cross detector.
+ * @warning Must be performed AFTER the phases are registered.
+ * @param[in] p_measurements - pointer to the system measurement structure (NULL to remove).
+ */
+void LMA_SystemMeasurementsRegister(LMA_SystemMeasurements *const p_measurements);
+
 /** @brief Registers a hook to be called during parameter computations.
  * @warning Must be performed AFTER a phase is registered - registering a phase nullifys this.
  * @details provides a function which is called after voltage and current are computed.
@@ -65,6 +92,26 @@ void LMA_NeutralRegister(LMA_Phase *const p_phase, LMA_Neutral *const p_neutral)
  */
 void LMA_ComputationHookRegister(LMA_Phase *const p_phase, float (*comp_hook)(float *i, float *v, float *f));
 
+/** @brief Registers front end filters on the channels of a phase (see LMA_Filter.h).
+ * @warning Must be performed AFTER a phase is registered - registering a phase nullifys this.
+ * @details The filters run on the loaded samples in LMA_CB_ADC, before zero cross detection and LMA_AccPhaseRun, so the
+ * measurements are of the filtered signals. Calibrate with the filters in place. If a chain decimates, the same factor must
+ * be applied to every filtered channel and LMA_Config.gcalib.fs set to the decimated rate.
+ * @param[in] p_phase - pointer to the phase structure to link to
+ * @param[in] p_v_filter - chain for the voltage channel (NULL = none)
+ * @param[in] p_v90_filter - chain for the 90 degree shifted voltage channel (NULL = none)
+ * @param[in] p_i_filter - chain for the current channel (NULL = none) - e.g. integrator and DC block for a Rogowski coil
+ */
+void LMA_PhaseFilterRegister(LMA_Phase *const p_phase, LMA_FilterChain *const p_v_filter, LMA_FilterChain *const p_v90_filter,
+                             LMA_FilterChain *const p_i_filter);
+
+/** @brief Registers a front end filter on the neutral current channel (see LMA_Filter.h).
+ * @warning Must be performed AFTER the neutral is registered - registering a neutral nullifys this.
+ * @param[in] p_neutral - pointer to the neutral structure
+ * @param[in] p_i_filter - chain for the current channel (NULL = none)
+ */
+void LMA_NeutralFilterRegister(LMA_Neutral *const p_neutral, LMA_FilterChain *const p_i_filter);
+
 /** @brief Loads calibration data to a system (and config).
  * @param[in] p_calib - pointer to the calibration data to load.
  */
@@ -103,17 +150,138 @@ void LMA_Stop(void);
  */
 void LMA_PhaseCalibrate(LMA_PhaseCalibArgs *const calib_args);
 
+/** @brief Starts calibrating several phases at once without blocking.
+ * @details Each phase of the job discards a window of line_cycles_stability, accumulates one of line_cycles and takes the
+ * coefficients as LMA_PhaseCalibrate does, all in LMA_CB_TMR and on its own windows, so the phases calibrate concurrently.
+ * The other phases keep metering and their energy keeps counting - a calibrating phase adds none until it is done.<br>
+ * p_callback is called from LMA_CB_TMR as each phase moves on (p_states[index]) and remaining counts down to 0 when the job
+ * is done. Call with LMA started and do not call LMA_PhaseCalibrate until the job is done.
+ * @param[inout] p_job - job to run, with p_args, p_states, count and p_callback set - keep in scope until it is done.
+ * @return true if started - false if a job is already running or count is 0.
+ */
+bool LMA_PhaseCalibrateStart(LMA_CalibJob *const p_job);
+
 /** @brief Performs a calibration command according to the flags passed.
  * @details - results stored in LMA_Config.gcalib
  */
 void LMA_GlobalCalibrate(LMA_GlobalCalibArgs *const calib_args);
 
 /** @brief Sets the energy data
+ * @details The system energy is counted by eight internal registers run with the register table (see LMA_RegistersSet), which
+ * drive the active, apparent and reactive LEDs - this loads them.
  * @param[in] p_energy - pointer to the energy data structure to work on
  */
 void LMA_EnergySet(LMA_SystemEnergy *const p_energy);
 
+/** @brief Sets the energy register table
+ * @details Registers count a quantity of a phase or of the whole system (LMA_Register.p_phase = NULL) in units of their own
+ * meter constant, in the same loop as the registers of the system energy. Each register costs one add and compare per sample
+ * in LMA_CB_ADC - the quadrant is resolved once per LMA_CB_TMR update. Set counter and accumulator_ws (e.g. restored from
+ * storage) before calling, and keep the table in scope while it is set. Impulses stay on for LMA_Impulse.led_on_count ADC
+ * intervals.
+ * @param[in] p_table - pointer to the table of registers (NULL to remove).
+ * @param[in] count - number of registers in the table.
+ */
+void LMA_RegistersSet(LMA_Register *const p_table, const uint32_t count);
+
+/** @brief Gets the energy counted by a register.
+ * @param[in] p_register - pointer to a register of the table set with LMA_RegistersSet.
+ * @return energy in Wh.
+ */
+float LMA_RegisterWhGet(const LMA_Register *const p_register);
+
+/** @brief Sets the clock (local time) kept by LMA_CB_RTC
+ * @details Counts with LMA_Config.rtc_rate set - re-evaluates the tariff straight away.
+ * @param[in] seconds - local time in seconds since 2000-01-01 00:00:00.
+ */
+void LMA_ClockSet(const uint32_t seconds);
+
+/** @brief Gets the clock (local time) kept by LMA_CB_RTC
+ * @return local time in seconds since 2000-01-01 00:00:00.
+ */
+uint32_t LMA_ClockGet(void);
+
+/** @brief Sets the time of use tariff
+ * @details The schedule is looked up by LMA_CB_RTC on each minute boundary of the clock (see LMA_ClockSet) - a tariff change
+ * swaps the one register counted in LMA_CB_ADC, so samples carry no tariff branching. Set counter and accumulator_ws of the
+ * registers (e.g. restored from storage) before calling, and keep the tariff and schedule in scope while set. Read each
+ * tariff with LMA_RegisterWhGet.
+ * @param[in] p_new_tariff - pointer to the tariff (NULL to remove).
+ */
+void LMA_TariffSet(LMA_Tariff *const p_new_tariff);
+
+/** @brief Sets the demand table
+ * @details Each demand register averages a quantity of a phase or of the whole system (LMA_Demand.p_phase = NULL) over
+ * block or sliding demand intervals of the clock (see LMA_ClockSet) and keeps the maximum demand. LMA_CB_TMR adds the energy
+ * of each window, LMA_CB_RTC ends the sub-intervals - needs LMA_Config.rtc_rate. Set the readings (e.g. restored from
+ * storage) before calling, and keep the table in scope while it is set. Setting the clock restarts the running intervals.
+ * @param[in] p_table - pointer to the table of demand registers (NULL to remove).
+ * @param[in] count - number of demand registers in the table.
+ */
+void LMA_DemandsSet(LMA_Demand *const p_table, const uint32_t count);
+
+/** @brief Gets the demand and maximum demand of a demand register
+ * @param[in] p_demand - pointer to a demand register of the table set with LMA_DemandsSet.
+ * @param[out] p_reading - pointer to the reading to populate.
+ */
+void LMA_DemandGet(const LMA_Demand *const p_demand, LMA_DemandReading *const p_reading);
+
+/** @brief Clears the maximum demand of a demand register (e.g. at the end of a billing period)
+ * @param[in] p_demand - pointer to a demand register of the table set with LMA_DemandsSet.
+ */
+void LMA_DemandPeakClear(LMA_Demand *const p_demand);
+
+/** @brief Sets the waveform capture
+ * @details LMA_CB_ADC stores the raw inputs of every phase (before the front end filters) in the ring of one buffer - a store
+ * per phase and an index increment per sample. A status bit of trigger_mask raised by LMA_CB_TMR (e.g. LMA_VOLTAGE_SAG,
+ * LMA_VOLTAGE_SWELL or LMA_OVERCURRENT), or LMA_CaptureTrigger, freezes the buffer post_frames frames later as an event and
+ * recording moves on to the next free buffer. Status is decided once per window, so give more than a window of frames before
+ * the trigger to hold the start of the event. Read the events in place with LMA_CaptureGet and LMA_CaptureRelease - while
+ * every buffer holds one, recording stops.
+ * @warning Must be performed AFTER the phases are registered. Keep the capture, its buffers and events in scope while set.
+ * @param[in] p_new_capture - pointer to the capture (NULL to remove).
+ */
+void LMA_CaptureSet(LMA_Capture *const p_new_capture);
+
+/** @brief Triggers the waveform capture from the application (e.g. on a command) - the event has status LMA_OK.
+ * @details Ignored while a trigger is pending or every buffer holds an event.
+ */
+void LMA_CaptureTrigger(void);
+
+/** @brief Gets the oldest event held by the waveform capture
+ * @details The frames are read in place, so they stay valid until the event is released.
+ * @param[in] p_held - pointer to the capture set with LMA_CaptureSet.
+ * @return the oldest event, or NULL if none is held.
+ */
+const LMA_CaptureEvent *LMA_CaptureGet(const LMA_Capture *const p_held);
+
+/** @brief Releases the oldest event held by the waveform capture so its buffer can record again
+ * @param[in] p_held - pointer to the capture set with LMA_CaptureSet.
+ */
+void LMA_CaptureRelease(LMA_Capture *const p_held);
+
+/** @brief Sets the status event log
+ * @details LMA_CB_TMR logs each edge of a status bit of event_mask on any phase (e.g. a sag starting or ending, a no load
+ * coming or going, the frequency leaving its tolerance), with the time it was raised, the seconds of windows it has been
+ * raised and the extreme of its measurement (see LMA_Event) - so the phases need not be polled every window. Events are read
+ * with LMA_EventsRead, or as they happen through p_callback (called in the TMR context - keep it short). Events arriving
+ * while the ring is full are counted as dropped but still passed to the callback. Bits already raised are followed from now.
+ * @warning Must be performed AFTER the phases are registered. Keep the log, its ring and tracks in scope while set.
+ * @param[in] p_new_log - pointer to the event log (NULL to remove).
+ */
+void LMA_EventLogSet(LMA_EventLog *const p_new_log);
+
+/** @brief Reads the oldest events of the status event log, freeing their entries
+ * @details Safe against LMA_CB_TMR without a critical section - call from one context only.
+ * @param[inout] p_log - pointer to the event log set with LMA_EventLogSet.
+ * @param[out] p_events - events to populate, oldest first.
+ * @param[in] max_count - number of events p_events holds.
+ * @return number of events populated.
+ */
+uint32_t LMA_EventsRead(LMA_EventLog *const p_log, LMA_Event *const p_events, const uint32_t max_count);
+
 /** @brief Gets the energy data
+ * @details Read from the internal registers counting the system energy (see LMA_EnergySet).
  * @param[in] p_energy - pointer to the energy data structure to work on
  */
 void LMA_EnergyGet(LMA_SystemEnergy *const p_energy);
@@ -138,6 +306,15 @@ LMA_Status LMA_StatusGet(const LMA_Phase *const p_phase);
  */
 void LMA_MeasurementsGet(LMA_Phase *const p_phase, LMA_Measurements *const p_measurements);
 
+/** @brief Outputs current snap shot of the measurement sets of all phases at once
+ * @details Copied in one critical section, so no LMA_CB_TMR update lands part way through - with
+ * LMA_Config.coherent_windows every set is from the same window.
+ * @param[out] p_measurements - pointer to an array of measurement structures to populate (in phase registration order).
+ * @param[in] max_count - number of entries in the array.
+ * @return number of phases copied.
+ */
+uint32_t LMA_MeasurementsGetAll(LMA_Measurements *const p_measurements, const uint32_t max_count);
+
 /** @brief Converts current snap shot of energy consumed by the meter in Wh.
  * @details Must call LMA_EnergyGet first.
  * @param[in] p_se - pointer to the system energy structure (containing system energy counters)
@@ -151,7 +328,70 @@ void LMA_ConsumptionDataGet(const LMA_SystemEnergy *const p_se, LMA_ConsumptionD
  */
 bool LMA_MeasurementsReady(LMA_Phase *const p_phase);
 
+/** @brief Timeout of LMA_MeasurementsWait which never expires*/
+#define LMA_WAIT_FOREVER (UINT32_MAX)
+
+/** @brief Waits until measurements are ready, idling through LMA_PORT_WAIT rather than polling LMA_MeasurementsReady.
+ * @details LMA_CB_TMR wakes the wait (LMA_PORT_SIGNAL) after every call, so the timeout is counted in TMR calls - the TMR
+ * must be running (see LMA_Start). Clears the ready flag as LMA_MeasurementsReady does.
+ * @param p_phase - pointer to the phase to wait on.
+ * @param timeout - most TMR calls to wait, 0 to only check or LMA_WAIT_FOREVER.
+ * @return true if new measurements are ready, false if the wait timed out.
+ */
+bool LMA_MeasurementsWait(LMA_Phase *const p_phase, const uint32_t timeout);
+
+/** @brief Outputs current snap shot of the system measurements.
+ * @param[out] p_measurements - pointer to the measurement structure to populate (zeroed if none are registered).
+ */
+void LMA_SystemMeasurementsGet(LMA_SystemMeasurements *const p_measurements);
+
+/** @brief Gets the computed neutral current.
+ * @return RMS of the vector sum of the phase currents from the last window (0 if no computed neutral is registered).
+ */
+float LMA_ComputedNeutralGet(void);
+
+/** @brief Gets the longest computation window the accumulators can hold without overflowing.
+ * @details Derived from LMA_Config.adc_bits, the sampling frequency and LMA_Config.fline_tol_low, and shortened while a
+ * computed neutral is registered - update_interval (and the calibration windows) are clamped to it.
+ * @return length in line cycles (UINT32_MAX if adc_bits is 0).
+ */
+uint32_t LMA_WindowMax(void);
+
+/** @brief Gets the length of the window the latest measurements of a phase were computed over.
+ * @param[in] p_phase - pointer to the phase to check.
+ * @return length in line cycles.
+ */
+uint32_t LMA_WindowGet(LMA_Phase *const p_phase);
+
+/** @} */
+
+#if LMA_TRACE_ENABLE
+/** @addtogroup Trace
+ * @brief LMA Trace API
+ * @details Available when built with LMA_TRACE_ENABLE - used to read the timing distributions of the callbacks and port hooks
+ * from a running meter.
+ *  @{
+ */
+
+/** @brief Gets a copy of the statistics of a trace point using critical sections.
+ * @param[in] id - trace point to read.
+ * @param[out] p_stats - pointer to the statistics structure to populate.
+ */
+void LMA_TraceGet(const LMA_TraceId id, LMA_TraceStats *const p_stats);
+
+/** @brief Sets the overrun threshold of a trace point.
+ * @details Executions longer than the budget are counted in LMA_TraceStats.overruns - typically the period of the interrupt
+ * calling the traced callback.
+ * @param[in] id - trace point to configure.
+ * @param[in] cycles - threshold in cycles of the port cycle counter (0 disables overrun counting).
+ */
+void LMA_TraceBudgetSet(const LMA_TraceId id, const uint32_t cycles);
+
+/** @brief Clears the statistics of all trace points (budgets are kept).*/
+void LMA_TraceReset(void);
+
 /** @} */
+#endif
 
 /** @} */
 
@@ -0,0 +1,371 @@
+/**
+ * @file LMA_Filter.c
+ * @brief Front end filter definitions for LMA.
+ *
+ * @details This file provides definitions of the filter stages exposed in the LMA_Filter header.
+ */
+
+#include "LMA_Filter.h"
+#include <string.h>
+
+/* Static/Local functions*/
+
+/** @brief Multiplies by a coefficient scaled by 2^shift, rounding to nearest.
+ * @param[in] value - value to scale.
+ * @param[in] coeff - coefficient scaled by 2^shift.
+ * @param[in] shift - scaling of the coefficient.
+ * @return value * coeff / 2^shift.
+ */
+static inline spl_t Filter_scale(const acc_t value, const int32_t coeff, const uint8_t shift)
+{
+  const acc_t product = value * (acc_t)coeff;
+
+  return (spl_t)(((uint8_t)0 == shift) ? product : ((product + ((acc_t)1 << (shift - 1U))) >> shift));
+}
+/* END OF FUNCTION*/
+
+/** @brief Trapezoidal integrator step.
+ * @details The running sum is kept as uint32_t so it wraps (rather than overflowing a signed type) under a sustained offset.
+ * @param[inout] p_state - stage state.
+ * @param[in] x - input.
+ * @return output.
+ */
+static inline spl_t Filter_integrate(LMA_FilterState *const p_state, const spl_t x)
+{
+  acc_t sum;
+
+  if (!p_state->primed)
+  {
+    p_state->x_prev = x;
+    p_state->primed = true;
+  }
+
+  /* Carry the LSB lost by halving into the next sample*/
+  sum = (acc_t)x + (acc_t)p_state->x_prev + p_state->sum;
+  p_state->sum = sum & (acc_t)1;
+  p_state->x_prev = x;
+  p_state->y_prev = (spl_t)((uint32_t)p_state->y_prev + (uint32_t)(spl_t)(sum >> 1));
+
+  return p_state->y_prev;
+}
+/* END OF FUNCTION*/
+
+/** @brief DC block step.
+ * @param[inout] p_stage - stage to run.
+ * @param[in] x - input.
+ * @return output.
+ */
+static inline spl_t Filter_dc_block(LMA_FilterStage *const p_stage, const spl_t x)
+{
+  LMA_FilterState *const p_state = &(p_stage->state);
+  spl_t delta;
+
+  if (!p_state->primed)
+  {
+    p_state->x_prev = x;
+    p_state->primed = true;
+  }
+
+  /* Difference taken modulo 2^32 so a wrapped integrator output passes through*/
+  delta = (spl_t)((uint32_t)x - (uint32_t)p_state->x_prev);
+  p_state->x_prev = x;
+  p_state->y_prev = Filter_scale((acc_t)p_state->y_prev + (acc_t)delta, p_stage->coeff, p_stage->shift);
+
+  return p_state->y_prev;
+}
+/* END OF FUNCTION*/
+
+/** @brief Pushes a sample into a delay line.
+ * @param[inout] p_stage - stage owning the delay line.
+ * @param[in] x - input.
+ * @return index of the sample one past the newest (the oldest sample held).
+ */
+static inline uint16_t Filter_push(LMA_FilterStage *const p_stage, const spl_t x)
+{
+  uint16_t index = p_stage->state.index + 1U;
+
+  if (index >= p_stage->length)
+  {
+    index = (uint16_t)0;
+  }
+
+  p_stage->p_buffer[index] = x;
+  p_stage->state.index = index;
+
+  ++index;
+  return (index >= p_stage->length) ? (uint16_t)0 : index;
+}
+/* END OF FUNCTION*/
+
+/** @brief Whole sample delay step.
+ * @param[inout] p_stage - stage to run.
+ * @param[in] x - input.
+ * @return input delay samples ago.
+ */
+static inline spl_t Filter_delay(LMA_FilterStage *const p_stage, const spl_t x)
+{
+  /* The line holds delay + 1 samples - the oldest is delay samples old*/
+  return p_stage->p_buffer[Filter_push(p_stage, x)];
+}
+/* END OF FUNCTION*/
+
+/** @brief Fractional delay step.
+ * @param[inout] p_stage - stage to run.
+ * @param[in] x - input.
+ * @return input interpolated delay + fraction samples ago.
+ */
+static inline spl_t Filter_frac_delay(LMA_FilterStage *const p_stage, const spl_t x)
+{
+  /* The line holds delay + 2 samples - the oldest is delay + 1 samples old, the next delay samples old*/
+  const uint16_t oldest = Filter_push(p_stage, x);
+  const uint16_t next = ((oldest + 1U) >= p_stage->length) ? (uint16_t)0 : (uint16_t)(oldest + 1U);
+  const spl_t tap = p_stage->p_buffer[next];
+
+  return tap + Filter_scale((acc_t)p_stage->p_buffer[oldest] - (acc_t)tap, p_stage->coeff, p_stage->shift);
+}
+/* END OF FUNCTION*/
+
+/** @brief Decimator step.
+ * @param[inout] p_stage - stage to run.
+ * @param[inout] p_x - input, replaced by the output when one is produced.
+ * @return true if an output was produced.
+ */
+static inline bool Filter_decimate(LMA_FilterStage *const p_stage, spl_t *const p_x)
+{
+  LMA_FilterState *const p_state = &(p_stage->state);
+
+  p_state->sum += (acc_t)*p_x;
+  ++p_state->index;
+
+  if ((int32_t)p_state->index < p_stage->coeff)
+  {
+    return false;
+  }
+
+  *p_x = Filter_scale(p_state->sum, 1, p_stage->shift);
+  p_state->sum = (acc_t)0;
+  p_state->index = (uint16_t)0;
+
+  return true;
+}
+/* END OF FUNCTION*/
+
+/** @brief Sets up the common fields of a stage.
+ * @param[out] p_stage - stage to set up.
+ * @param[in] type - operation.
+ */
+static void Filter_stage_init(LMA_FilterStage *const p_stage, const LMA_FilterType type)
+{
+  p_stage->type = type;
+  p_stage->coeff = (int32_t)0;
+  p_stage->shift = (uint8_t)0;
+  p_stage->delay = (uint16_t)0;
+  p_stage->length = (uint16_t)0;
+  p_stage->p_buffer = NULL;
+}
+/* END OF FUNCTION*/
+
+/** @brief Clears the state of a stage.
+ * @param[inout] p_stage - stage to reset.
+ */
+static void Filter_stage_reset(LMA_FilterStage *const p_stage)
+{
+  p_stage->state.x_prev = (spl_t)0;
+  p_stage->state.y_prev = (spl_t)0;
+  p_stage->state.sum = (acc_t)0;
+  p_stage->state.index = (uint16_t)0;
+  p_stage->state.primed = false;
+
+  if (NULL != p_stage->p_buffer)
+  {
+    memset(p_stage->p_buffer, 0, sizeof(spl_t) * p_stage->length);
+  }
+}
+/* END OF FUNCTION*/
+
+/* Externally Available Functions*/
+
+void LMA_FilterIntegratorInit(LMA_FilterStage *const p_stage)
+{
+  Filter_stage_init(p_stage, LMA_FILTER_INTEGRATOR);
+  Filter_stage_reset(p_stage);
+}
+
+void LMA_FilterDcBlockInit(LMA_FilterStage *const p_stage, const int32_t coeff, const uint8_t shift)
+{
+  Filter_stage_init(p_stage, LMA_FILTER_DC_BLOCK);
+  p_stage->coeff = coeff;
+  p_stage->shift = shift;
+  Filter_stage_reset(p_stage);
+}
+
+void LMA_FilterDelayInit(LMA_FilterStage *const p_stage, spl_t *const p_buffer, const uint16_t delay)
+{
+  Filter_stage_init(p_stage, LMA_FILTER_DELAY);
+  p_stage->delay = delay;
+  p_stage->length = delay + 1U;
+  p_stage->p_buffer = p_buffer;
+  Filter_stage_reset(p_stage);
+}
+
+void LMA_FilterFracDelayInit(LMA_FilterStage *const p_stage, spl_t *const p_buffer, const uint16_t delay,
+                             const int32_t fraction, const uint8_t shift)
+{
+  Filter_stage_init(p_stage, LMA_FILTER_FRAC_DELAY);
+  p_stage->coeff = fraction;
+  p_stage->shift = shift;
+  p_stage->delay = delay;
+  p_stage->length = delay + 2U;
+  p_stage->p_buffer = p_buffer;
+  Filter_stage_reset(p_stage);
+}
+
+void LMA_FilterDecimateInit(LMA_FilterStage *const p_stage, const uint16_t factor, const uint8_t shift)
+{
+  Filter_stage_init(p_stage, LMA_FILTER_DECIMATE);
+  p_stage->coeff = (int32_t)factor;
+  p_stage->shift = shift;
+  Filter_stage_reset(p_stage);
+}
+
+void LMA_FilterChainInit(LMA_FilterChain *const p_chain, LMA_FilterStage *const p_stages, const uint8_t stage_count)
+{
+  p_chain->p_stages = p_stages;
+  p_chain->stage_count = stage_count;
+  LMA_FilterReset(p_chain);
+}
+
+void LMA_FilterReset(LMA_FilterChain *const p_chain)
+{
+  uint8_t s = (uint8_t)0;
+
+  for (s = (uint8_t)0; s < p_chain->stage_count; ++s)
+  {
+    Filter_stage_reset(&(p_chain->p_stages[s]));
+  }
+}
+
+bool LMA_FilterSample(LMA_FilterChain *const p_chain, spl_t *const p_sample)
+{
+  spl_t x = *p_sample;
+  uint8_t s = (uint8_t)0;
+
+  for (s = (uint8_t)0; s < p_chain->stage_count; ++s)
+  {
+    LMA_FilterStage *const p_stage = &(p_chain->p_stages[s]);
+
+    switch (p_stage->type)
+    {
+      case LMA_FILTER_INTEGRATOR:
+        x = Filter_integrate(&(p_stage->state), x);
+        break;
+
+      case LMA_FILTER_DC_BLOCK:
+        x = Filter_dc_block(p_stage, x);
+        break;
+
+      case LMA_FILTER_DELAY:
+        x = Filter_delay(p_stage, x);
+        break;
+
+      case LMA_FILTER_FRAC_DELAY:
+        x = Filter_frac_delay(p_stage, x);
+        break;
+
+      case LMA_FILTER_DECIMATE:
+        if (!Filter_decimate(p_stage, &x))
+        {
+          return false;
+        }
+        break;
+
+      default:
+        /* Unknown stage - pass through*/
+        break;
+    }
+  }
+
+  *p_sample = x;
+  return true;
+}
+
+uint32_t LMA_FilterBlock(LMA_FilterChain *const p_chain, const spl_t *const p_in, spl_t *const p_out, const uint32_t count)
+{
+  const spl_t *p_src = p_in;
+  uint32_t n_in = count;
+  uint32_t n = (uint32_t)0;
+  uint8_t s = (uint8_t)0;
+
+  for (s = (uint8_t)0; s < p_chain->stage_count; ++s)
+  {
+    LMA_FilterStage *const p_stage = &(p_chain->p_stages[s]);
+    uint32_t n_out = (uint32_t)0;
+
+    /* One loop per stage type - outputs never overtake inputs, so running in place is safe*/
+    switch (p_stage->type)
+    {
+      case LMA_FILTER_INTEGRATOR:
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          p_out[n] = Filter_integrate(&(p_stage->state), p_src[n]);
+        }
+        n_out = n_in;
+        break;
+
+      case LMA_FILTER_DC_BLOCK:
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          p_out[n] = Filter_dc_block(p_stage, p_src[n]);
+        }
+        n_out = n_in;
+        break;
+
+      case LMA_FILTER_DELAY:
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          p_out[n] = Filter_delay(p_stage, p_src[n]);
+        }
+        n_out = n_in;
+        break;
+
+      case LMA_FILTER_FRAC_DELAY:
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          p_out[n] = Filter_frac_delay(p_stage, p_src[n]);
+        }
+        n_out = n_in;
+        break;
+
+      case LMA_FILTER_DECIMATE:
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          spl_t x = p_src[n];
+          if (Filter_decimate(p_stage, &x))
+          {
+            p_out[n_out++] = x;
+          }
+        }
+        break;
+
+      default:
+        /* Unknown stage - pass through*/
+        for (n = (uint32_t)0; n < n_in; ++n)
+        {
+          p_out[n] = p_src[n];
+        }
+        n_out = n_in;
+        break;
+    }
+
+    p_src = p_out;
+    n_in = n_out;
+  }
+
+  /* No stages - copy through*/
+  if ((uint8_t)0 == p_chain->stage_count && p_out != p_in)
+  {
+    memcpy(p_out, p_in, sizeof(spl_t) * count);
+  }
+
+  return n_in;
+}
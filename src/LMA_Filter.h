@@ -0,0 +1,111 @@
+/**
+ * @file LMA_Filter.h
+ * @brief Front end filter declarations for LMA.
+ *
+ * @details This file provides declarations of the fixed point filter stages which can be placed in front of the accumulation
+ * of each channel (see LMA_PhaseFilterRegister), or run on blocks of samples by the application.
+ */
+
+#ifndef _LMA_FILTER_H
+#define _LMA_FILTER_H
+
+#include "LMA_Types.h"
+
+/** @addtogroup API
+ *  @{
+ */
+
+/** @addtogroup Filter
+ * @brief LMA Filter API
+ * @details Fixed point filter stages for conditioning the ADC samples before they are accumulated - e.g. integrating a
+ * Rogowski coil, removing DC or aligning the phase of two channels. Coefficients are integers scaled by a power of two so
+ * every stage runs with multiplies and shifts only.<br>
+ * Stages are set up with the LMA_FilterxInit functions, grouped into a chain with LMA_FilterChainInit and run a sample at a
+ * time (LMA_FilterSample) or a block at a time (LMA_FilterBlock). A stage holds the state of the channel it filters, so each
+ * channel needs its own chain.
+ *  @{
+ */
+
+/** @brief Converts a real coefficient to the fixed point used by a stage (value * 2^shift, rounded).
+ * @details Intended for constants - e.g. LMA_FILTER_Q(0.96884f, 16) for a DC block.
+ */
+#define LMA_FILTER_Q(value, shift) ((int32_t)(((value) * (float)(1UL << (shift))) + 0.5f))
+
+/** @brief Sets up a trapezoidal integrator stage.
+ * @details y = y_prev + (x + x_prev) / 2, with the halved LSB carried to the next sample so no bias builds up. The output
+ * wraps rather than saturates - the DC block which must follow it works on differences, so the wrap cancels out.
+ * @param[out] p_stage - stage to set up.
+ */
+void LMA_FilterIntegratorInit(LMA_FilterStage *const p_stage);
+
+/** @brief Sets up a DC blocking (first order high pass) stage.
+ * @details y = a(y_prev + x - x_prev) with a = coeff / 2^shift. The corner is about fs(1 - a) / 2pi and a DC input of d
+ * after an integrator settles at a.d / (1 - a).
+ * @param[out] p_stage - stage to set up.
+ * @param[in] coeff - a scaled by 2^shift (less than 2^shift).
+ * @param[in] shift - scaling of coeff (at most 30).
+ */
+void LMA_FilterDcBlockInit(LMA_FilterStage *const p_stage, const int32_t coeff, const uint8_t shift);
+
+/** @brief Sets up a whole sample delay stage.
+ * @param[out] p_stage - stage to set up.
+ * @param[in] p_buffer - delay line of delay + 1 samples.
+ * @param[in] delay - delay in samples.
+ */
+void LMA_FilterDelayInit(LMA_FilterStage *const p_stage, spl_t *const p_buffer, const uint16_t delay);
+
+/** @brief Sets up a fractional delay stage.
+ * @details Delays by delay + fraction / 2^shift samples, interpolating linearly between the two neighbouring samples. The
+ * interpolation attenuates slightly (by cos(pi.f/fs) at worst, half way between samples) - calibrate with it in place.
+ * @param[out] p_stage - stage to set up.
+ * @param[in] p_buffer - delay line of delay + 2 samples.
+ * @param[in] delay - whole samples of delay.
+ * @param[in] fraction - fraction of a sample scaled by 2^shift (less than 2^shift).
+ * @param[in] shift - scaling of fraction (at most 30).
+ */
+void LMA_FilterFracDelayInit(LMA_FilterStage *const p_stage, spl_t *const p_buffer, const uint16_t delay,
+                             const int32_t fraction, const uint8_t shift);
+
+/** @brief Sets up a decimating stage.
+ * @details Sums factor samples and outputs the sum / 2^shift once per factor samples (a boxcar average when factor is
+ * 2^shift). Stages after it, and the accumulation, then run at fs / factor - configure LMA_Config.gcalib.fs accordingly.
+ * @param[out] p_stage - stage to set up.
+ * @param[in] factor - decimation factor (at least 1).
+ * @param[in] shift - scaling of the sum.
+ */
+void LMA_FilterDecimateInit(LMA_FilterStage *const p_stage, const uint16_t factor, const uint8_t shift);
+
+/** @brief Groups stages into a chain and resets their state.
+ * @param[out] p_chain - chain to set up.
+ * @param[in] p_stages - array of stages set up with the LMA_FilterxInit functions - run in order.
+ * @param[in] stage_count - number of stages.
+ */
+void LMA_FilterChainInit(LMA_FilterChain *const p_chain, LMA_FilterStage *const p_stages, const uint8_t stage_count);
+
+/** @brief Resets the state of every stage of a chain (e.g. after a gap in the samples).
+ * @param[inout] p_chain - chain to reset.
+ */
+void LMA_FilterReset(LMA_FilterChain *const p_chain);
+
+/** @brief Filters one sample in place.
+ * @param[inout] p_chain - chain to run.
+ * @param[inout] p_sample - sample to filter, replaced by the output.
+ * @return true if an output was produced - false while a decimating stage is still summing (p_sample is then undefined).
+ */
+bool LMA_FilterSample(LMA_FilterChain *const p_chain, spl_t *const p_sample);
+
+/** @brief Filters a block of samples.
+ * @details Each stage runs over the whole block before the next, which keeps the stage in registers on most cores.
+ * @param[inout] p_chain - chain to run.
+ * @param[in] p_in - input samples.
+ * @param[out] p_out - output samples (may be p_in) - room for count samples.
+ * @param[in] count - number of input samples.
+ * @return number of output samples (count unless the chain decimates).
+ */
+uint32_t LMA_FilterBlock(LMA_FilterChain *const p_chain, const spl_t *const p_in, spl_t *const p_out, const uint32_t count);
+
+/** @} */
+
+/** @} */
+
+#endif /* _LMA_FILTER_H */
@@ -0,0 +1,249 @@
+/**
+ * @file LMA_History.c
+ * @brief Measurement history definitions for LMA.
+ *
+ * @details This file provides definitions of the measurement history exposed in the LMA_History header.
+ */
+
+#include "LMA_History.h"
+#include <string.h>
+
+/* Static/Local functions*/
+
+/** @brief Rolls one measurement of a slot up into the same measurement of another.
+ * @param[inout] p_min - smallest so far.
+ * @param[inout] p_max - largest so far.
+ * @param[inout] p_mean - mean so far.
+ * @param[in] min - smallest of the slot rolled up.
+ * @param[in] max - largest of the slot rolled up.
+ * @param[in] mean - mean of the slot rolled up.
+ * @param[in] weight - windows of the slot rolled up over the windows of both.
+ */
+static void History_merge_value(float *const p_min, float *const p_max, float *const p_mean, const float min, const float max,
+                                const float mean, const float weight)
+{
+  *p_min = (min < *p_min) ? min : *p_min;
+  *p_max = (max > *p_max) ? max : *p_max;
+  *p_mean += (mean - *p_mean) * weight;
+}
+/* END OF FUNCTION*/
+
+/** @brief Rolls one slot up into another.
+ * @param[inout] p_into - slot to add to (its time is kept).
+ * @param[in] p_from - slot to add.
+ */
+static void History_merge(LMA_HistorySlot *const p_into, const LMA_HistorySlot *const p_from)
+{
+  float weight = 0.0f;
+
+  if ((uint32_t)0 == p_from->count)
+  {
+    return;
+  }
+
+  if ((uint32_t)0 == p_into->count)
+  {
+    p_into->count = p_from->count;
+    p_into->min = p_from->min;
+    p_into->max = p_from->max;
+    p_into->mean = p_from->mean;
+    return;
+  }
+
+  p_into->count += p_from->count;
+  weight = (float)p_from->count / (float)p_into->count;
+  History_merge_value(&(p_into->min.vrms), &(p_into->max.vrms), &(p_into->mean.vrms), p_from->min.vrms, p_from->max.vrms,
+                      p_from->mean.vrms, weight);
+  History_merge_value(&(p_into->min.irms), &(p_into->max.irms), &(p_into->mean.irms), p_from->min.irms, p_from->max.irms,
+                      p_from->mean.irms, weight);
+  History_merge_value(&(p_into->min.irms_neutral), &(p_into->max.irms_neutral), &(p_into->mean.irms_neutral),
+                      p_from->min.irms_neutral, p_from->max.irms_neutral, p_from->mean.irms_neutral, weight);
+  History_merge_value(&(p_into->min.fline), &(p_into->max.fline), &(p_into->mean.fline), p_from->min.fline,
+                      p_from->max.fline, p_from->mean.fline, weight);
+  History_merge_value(&(p_into->min.p), &(p_into->max.p), &(p_into->mean.p), p_from->min.p, p_from->max.p, p_from->mean.p,
+                      weight);
+  History_merge_value(&(p_into->min.q), &(p_into->max.q), &(p_into->mean.q), p_from->min.q, p_from->max.q, p_from->mean.q,
+                      weight);
+  History_merge_value(&(p_into->min.s), &(p_into->max.s), &(p_into->mean.s), p_from->min.s, p_from->max.s, p_from->mean.s,
+                      weight);
+}
+/* END OF FUNCTION*/
+
+/** @brief Moves the newest slot of a level on to a later period, emptying the slots of any periods skipped.
+ * @details A jump of more than the ring empties every slot once, so the cost is bounded by the ring.
+ * @param[inout] p_level - level to move on.
+ * @param[in] start - start of the new newest slot (later than the newest).
+ */
+static void History_advance(LMA_HistoryLevel *const p_level, const uint32_t start)
+{
+  const uint32_t steps = (start - p_level->p_slots[p_level->newest].time) / p_level->period;
+  uint32_t n = (steps < p_level->slots) ? steps : p_level->slots;
+
+  for (; n > (uint32_t)0; --n)
+  {
+    LMA_HistorySlot *p_slot = NULL;
+
+    p_level->newest = ((p_level->newest + 1U) < p_level->slots) ? (p_level->newest + 1U) : (uint32_t)0;
+    p_slot = &(p_level->p_slots[p_level->newest]);
+    p_slot->time = start - ((n - 1U) * p_level->period);
+    p_slot->count = (uint32_t)0;
+  }
+
+  p_level->filled = (steps < (p_level->slots - p_level->filled)) ? (p_level->filled + steps) : p_level->slots;
+}
+/* END OF FUNCTION*/
+
+/* Externally Available Functions*/
+
+bool LMA_HistoryInit(LMA_History *const p_history, LMA_HistoryLevel *const p_levels, const uint32_t level_count)
+{
+  uint32_t level = (uint32_t)0;
+
+  p_history->p_levels = NULL;
+  p_history->level_count = (uint32_t)0;
+
+  for (level = (uint32_t)0; level < level_count; ++level)
+  {
+    const LMA_HistoryLevel *const p_level = &(p_levels[level]);
+    const uint32_t before = ((uint32_t)0 != level) ? p_levels[level - 1U].period : (uint32_t)0;
+
+    if (((uint32_t)0 == p_level->period) || ((uint32_t)0 == p_level->slots) || (NULL == p_level->p_slots) ||
+        (p_level->period <= before) || (((uint32_t)0 != before) && ((uint32_t)0 != (p_level->period % before))))
+    {
+      return false;
+    }
+  }
+
+  for (level = (uint32_t)0; level < level_count; ++level)
+  {
+    p_levels[level].newest = (uint32_t)0;
+    p_levels[level].filled = (uint32_t)0;
+  }
+  p_history->p_levels = p_levels;
+  p_history->level_count = level_count;
+
+  return ((uint32_t)0 != level_count);
+}
+
+void LMA_HistoryUpdate(LMA_History *const p_history, const uint32_t time, const LMA_Measurements *const p_measurements)
+{
+  /* Alternate between two copies of the slot carried to the next level - the ring entry it came from may be reused*/
+  LMA_HistorySlot carry[2];
+  const LMA_HistorySlot *p_in = &(carry[0]);
+  uint32_t level = (uint32_t)0;
+  uint32_t t = time;
+
+  if ((uint32_t)0 == p_history->level_count)
+  {
+    return;
+  }
+
+  if (((uint32_t)0 != p_history->p_levels[0].filled) &&
+      (time < p_history->p_levels[0].p_slots[p_history->p_levels[0].newest].time))
+  {
+    /* The clock was set back - the history would no longer be in order*/
+    for (level = (uint32_t)0; level < p_history->level_count; ++level)
+    {
+      p_history->p_levels[level].filled = (uint32_t)0;
+    }
+  }
+
+  carry[0].count = 1U;
+  carry[0].min = *p_measurements;
+  carry[0].max = *p_measurements;
+  carry[0].mean = *p_measurements;
+
+  for (level = (uint32_t)0; (level < p_history->level_count) && (NULL != p_in); ++level)
+  {
+    LMA_HistoryLevel *const p_level = &(p_history->p_levels[level]);
+    const uint32_t start = t - (t % p_level->period);
+    LMA_HistorySlot *p_newest = &(p_level->p_slots[p_level->newest]);
+    const LMA_HistorySlot *p_out = NULL;
+
+    if ((uint32_t)0 == p_level->filled)
+    {
+      p_level->newest = (uint32_t)0;
+      p_level->filled = 1U;
+      p_newest = &(p_level->p_slots[0]);
+      p_newest->time = start;
+      p_newest->count = (uint32_t)0;
+    }
+    else if (start > p_newest->time)
+    {
+      /* The newest slot is complete - carry it to the next level*/
+      if ((uint32_t)0 != p_newest->count)
+      {
+        LMA_HistorySlot *const p_carry = &(carry[(p_in == &(carry[0])) ? 1U : 0U]);
+
+        *p_carry = *p_newest;
+        p_out = p_carry;
+      }
+      History_advance(p_level, start);
+      p_newest = &(p_level->p_slots[p_level->newest]);
+    }
+
+    History_merge(p_newest, p_in);
+    p_in = p_out;
+    t = (NULL != p_out) ? p_out->time : t;
+  }
+}
+
+uint32_t LMA_HistoryRead(const LMA_History *const p_history, const uint32_t level, const uint32_t from, const uint32_t to,
+                         LMA_HistoryRange *const p_range)
+{
+  const LMA_HistoryLevel *p_level = NULL;
+  uint32_t newest_time = (uint32_t)0;
+  uint32_t oldest_time = (uint32_t)0;
+  uint32_t first = (uint32_t)0;
+  uint32_t last = (uint32_t)0;
+  uint32_t count = (uint32_t)0;
+  uint32_t index = (uint32_t)0;
+
+  memset(p_range, 0, sizeof(LMA_HistoryRange));
+
+  if ((level >= p_history->level_count) || ((uint32_t)0 == p_history->p_levels[level].filled) || (from >= to))
+  {
+    return (uint32_t)0;
+  }
+
+  /* Slots are consecutive periods, so the range is found by arithmetic alone*/
+  p_level = &(p_history->p_levels[level]);
+  newest_time = p_level->p_slots[p_level->newest].time;
+  oldest_time = newest_time - ((p_level->filled - 1U) * p_level->period);
+  first = (from <= oldest_time) ? oldest_time : (from + ((p_level->period - (from % p_level->period)) % p_level->period));
+  last = ((to - 1U) >= newest_time) ? newest_time : ((to - 1U) - ((to - 1U) % p_level->period));
+  if ((first < from) || (first > last))
+  {
+    /* from rounded up past the end of time or the range holds no slot start*/
+    return (uint32_t)0;
+  }
+
+  count = ((last - first) / p_level->period) + 1U;
+  index = (p_level->newest + p_level->slots - ((newest_time - first) / p_level->period)) % p_level->slots;
+  p_range->p_slots[0] = &(p_level->p_slots[index]);
+  p_range->count[0] = ((p_level->slots - index) < count) ? (p_level->slots - index) : count;
+  if (count > p_range->count[0])
+  {
+    p_range->p_slots[1] = &(p_level->p_slots[0]);
+    p_range->count[1] = count - p_range->count[0];
+  }
+
+  return count;
+}
+
+void LMA_HistorySummary(const LMA_HistoryRange *const p_range, LMA_HistorySlot *const p_summary)
+{
+  uint32_t part = (uint32_t)0;
+  uint32_t n = (uint32_t)0;
+
+  memset(p_summary, 0, sizeof(LMA_HistorySlot));
+  p_summary->time = (NULL != p_range->p_slots[0]) ? p_range->p_slots[0]->time : (uint32_t)0;
+
+  for (part = (uint32_t)0; part < 2U; ++part)
+  {
+    for (n = (uint32_t)0; n < p_range->count[part]; ++n)
+    {
+      History_merge(p_summary, &(p_range->p_slots[part][n]));
+    }
+  }
+}
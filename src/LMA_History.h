@@ -0,0 +1,68 @@
+/**
+ * @file LMA_History.h
+ * @brief Measurement history declarations for LMA.
+ *
+ * @details This file provides declarations of the measurement history, which keeps the min, max and mean of each measurement
+ * at several resolutions in RAM.
+ */
+
+#ifndef _LMA_HISTORY_H
+#define _LMA_HISTORY_H
+
+#include "LMA_Types.h"
+
+/** @addtogroup API
+ *  @{
+ */
+
+/** @addtogroup History
+ * @brief LMA Measurement History API
+ * @details Keeps the min, max, mean and count of every measurement (see LMA_Measurements) over each period of several levels,
+ * e.g. an hour of seconds, a day of minutes and a month of hours, from the windows the application takes with
+ * LMA_MeasurementsGet, timed by the clock (see LMA_ClockGet).<br>
+ * Each level is a ring of slots held by the application, so the storage is fixed (a slot is 92 bytes). A window goes into
+ * the newest slot of the finest level only, and each slot rolls up into the level after it as it closes, so an update is
+ * O(1). LMA_HistoryRead returns a range of slots in place rather than copying them.
+ *  @{
+ */
+
+/** @brief Sets up a measurement history on the application's levels and empties it.
+ * @param[out] p_history - history to set up.
+ * @param[inout] p_levels - levels, finest first, with period, slots and p_slots set - keep in scope while in use.
+ * @param[in] level_count - number of levels.
+ * @return true if the levels are valid - each has a period, a slot and a period a multiple of the one before.
+ */
+bool LMA_HistoryInit(LMA_History *const p_history, LMA_HistoryLevel *const p_levels, const uint32_t level_count);
+
+/** @brief Adds a measurement window to the history.
+ * @details Call with each new set of measurements (e.g. when LMA_MeasurementsGet returns fresh data). Periods with no
+ * windows are kept as empty slots (count 0) and a clock set back empties the history.
+ * @param[inout] p_history - history set up with LMA_HistoryInit.
+ * @param[in] time - clock now (seconds since 2000-01-01 00:00:00).
+ * @param[in] p_measurements - measurements of the window.
+ */
+void LMA_HistoryUpdate(LMA_History *const p_history, const uint32_t time, const LMA_Measurements *const p_measurements);
+
+/** @brief Finds the slots of a level starting in a range of time.
+ * @details The newest slot is still open - it has the windows (or the slots of the level before) so far.
+ * @param[in] p_history - history set up with LMA_HistoryInit.
+ * @param[in] level - level to read (0 = finest).
+ * @param[in] from - first slot start to read (clock seconds).
+ * @param[in] to - slot start to stop before (clock seconds).
+ * @param[out] p_range - slots found, valid until the next LMA_HistoryUpdate.
+ * @return number of slots found.
+ */
+uint32_t LMA_HistoryRead(const LMA_History *const p_history, const uint32_t level, const uint32_t from, const uint32_t to,
+                         LMA_HistoryRange *const p_range);
+
+/** @brief Rolls a range of slots up into one.
+ * @param[in] p_range - slots read with LMA_HistoryRead.
+ * @param[out] p_summary - min, max, mean and count over the range, starting with its first slot.
+ */
+void LMA_HistorySummary(const LMA_HistoryRange *const p_range, LMA_HistorySlot *const p_summary);
+
+/** @} */
+
+/** @} */
+
+#endif /* _LMA_HISTORY_H */
@@ -0,0 +1,534 @@
+/**
+ * @file LMA_Profile.c
+ * @brief Load profile recorder definitions for LMA.
+ *
+ * @details This file provides definitions of the load profile recorder exposed in the LMA_Profile header.
+ */
+
+#include "LMA_Profile.h"
+#include <string.h>
+
+/* Sector header - magic, version, reserved, sequence number, then the values before the first record*/
+#define PROFILE_MAGIC (0x4C50U)   /**< 'LP' */
+#define PROFILE_VERSION (1U)      /**< Layout of the header and the records */
+#define PROFILE_ERASED (0xFFU)    /**< Value of an erased byte - the length of a record not yet written */
+#define PROFILE_MINUTE (60U)      /**< Record times are stored in minutes */
+#define PROFILE_V_SCALE (100.0f)  /**< Vrms in 10 mV */
+#define PROFILE_I_SCALE (1000.0f) /**< Irms in mA */
+#define PROFILE_P_SCALE (10.0f)   /**< P in 100 mW */
+
+/* Static/Local functions*/
+
+/** @brief Stores a 32 bit value little endian.
+ * @param[out] p_out - 4 bytes to populate.
+ * @param[in] value - value to store.
+ */
+static void Profile_put32(uint8_t *const p_out, const uint32_t value)
+{
+  p_out[0] = (uint8_t)value;
+  p_out[1] = (uint8_t)(value >> 8U);
+  p_out[2] = (uint8_t)(value >> 16U);
+  p_out[3] = (uint8_t)(value >> 24U);
+}
+/* END OF FUNCTION*/
+
+/** @brief Loads a 32 bit value stored little endian.
+ * @param[in] p_in - 4 bytes to load.
+ * @return value.
+ */
+static uint32_t Profile_get32(const uint8_t *const p_in)
+{
+  return (uint32_t)p_in[0] | ((uint32_t)p_in[1] << 8U) | ((uint32_t)p_in[2] << 16U) | ((uint32_t)p_in[3] << 24U);
+}
+/* END OF FUNCTION*/
+
+/** @brief Stores a variable length integer - 7 bits per byte, the top bit set on every byte but the last.
+ * @param[out] p_out - room for 5 bytes.
+ * @param[in] value - value to store.
+ * @return number of bytes stored.
+ */
+static uint32_t Profile_put_var(uint8_t *const p_out, uint32_t value)
+{
+  uint32_t size = (uint32_t)0;
+
+  while (value >= 0x80U)
+  {
+    p_out[size++] = (uint8_t)(value | 0x80U);
+    value >>= 7U;
+  }
+  p_out[size++] = (uint8_t)value;
+
+  return size;
+}
+/* END OF FUNCTION*/
+
+/** @brief Loads a variable length integer.
+ * @param[in] p_in - bytes to load from.
+ * @param[in] size - number of bytes in p_in.
+ * @param[inout] p_pos - position to load from, moved past the integer.
+ * @param[out] p_value - value loaded.
+ * @return true if the integer ends within size bytes.
+ */
+static bool Profile_get_var(const uint8_t *const p_in, const uint32_t size, uint32_t *const p_pos, uint32_t *const p_value)
+{
+  uint32_t value = (uint32_t)0;
+  uint32_t shift = (uint32_t)0;
+
+  while ((*p_pos < size) && (shift < 35U))
+  {
+    const uint8_t byte = p_in[(*p_pos)++];
+
+    value |= (uint32_t)(byte & 0x7FU) << shift;
+    if ((uint8_t)0 == (byte & 0x80U))
+    {
+      *p_value = value;
+      return true;
+    }
+    shift += 7U;
+  }
+
+  return false;
+}
+/* END OF FUNCTION*/
+
+/** @brief Rounds a value to an integer of its scale.
+ * @param[in] value - value to round.
+ * @param[in] scale - integer units per unit of value.
+ * @return value * scale rounded to nearest.
+ */
+static int32_t Profile_round(const float value, const float scale)
+{
+  const float scaled = value * scale;
+
+  return (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+}
+/* END OF FUNCTION*/
+
+/** @brief Takes the integer values of a record from a snapshot of the total energies.
+ * @param[in] p_consumption - total energies.
+ * @param[out] p_values - values to populate (energies only).
+ */
+static void Profile_energies(const LMA_ConsumptionData *const p_consumption, LMA_ProfileValues *const p_values)
+{
+  const float wh[LMA_PROFILE_ENERGIES] = {p_consumption->act_imp_energy_wh, p_consumption->act_exp_energy_wh,
+                                          p_consumption->l_imp_energy_wh + p_consumption->c_imp_energy_wh,
+                                          p_consumption->l_exp_energy_wh + p_consumption->c_exp_energy_wh};
+  uint32_t e = (uint32_t)0;
+
+  /* mWh wrap at 2^32 - only the differences between records are stored*/
+  for (e = (uint32_t)0; e < LMA_PROFILE_ENERGIES; ++e)
+  {
+    p_values->energy[e] = (uint32_t)(uint64_t)(((double)wh[e] * 1000.0) + 0.5);
+  }
+}
+/* END OF FUNCTION*/
+
+/** @brief Encodes a record as the difference of its values to the record before.
+ * @details Length, minutes since the record before, each energy difference, each average difference (zig-zag so small
+ * negative differences stay short), then a check byte.
+ * @param[in] p_prev - values of the record before.
+ * @param[in] p_next - values of the record.
+ * @param[out] p_record - room for LMA_PROFILE_RECORD_MAX bytes.
+ * @return size of the record.
+ */
+static uint32_t Profile_encode(const LMA_ProfileValues *const p_prev, const LMA_ProfileValues *const p_next,
+                               uint8_t *const p_record)
+{
+  uint32_t size = (uint32_t)1;
+  uint32_t n = (uint32_t)0;
+  uint8_t check = (uint8_t)0;
+
+  size += Profile_put_var(&(p_record[size]), (p_next->time - p_prev->time) / PROFILE_MINUTE);
+  for (n = (uint32_t)0; n < LMA_PROFILE_ENERGIES; ++n)
+  {
+    size += Profile_put_var(&(p_record[size]), p_next->energy[n] - p_prev->energy[n]);
+  }
+  for (n = (uint32_t)0; n < LMA_PROFILE_AVERAGES; ++n)
+  {
+    const uint32_t difference = (uint32_t)p_next->average[n] - (uint32_t)p_prev->average[n];
+    size += Profile_put_var(&(p_record[size]), (difference << 1U) ^ (((difference >> 31U) != 0U) ? 0xFFFFFFFFU : 0U));
+  }
+
+  p_record[0] = (uint8_t)(size - 1U);
+  for (n = (uint32_t)0; n < size; ++n)
+  {
+    check += p_record[n];
+  }
+  p_record[size++] = (uint8_t)~check;
+
+  return size;
+}
+/* END OF FUNCTION*/
+
+/** @brief Reads and decodes the record at an offset of a sector.
+ * @param[in] p_storage - storage holding the records.
+ * @param[in] sector - sector to read.
+ * @param[in] offset - offset of the record in the sector.
+ * @param[in] p_prev - values of the record before.
+ * @param[out] p_next - values of the record (unchanged if there is none).
+ * @return size of the record - 0 if there is no complete, valid record at the offset.
+ */
+static uint32_t Profile_decode(const LMA_ProfileStorage *const p_storage, const uint32_t sector, const uint32_t offset,
+                               const LMA_ProfileValues *const p_prev, LMA_ProfileValues *const p_next)
+{
+  uint8_t record[LMA_PROFILE_RECORD_MAX];
+  const uint32_t room = (offset < p_storage->sector_size) ? (p_storage->sector_size - offset) : (uint32_t)0;
+  const uint32_t size = (room < LMA_PROFILE_RECORD_MAX) ? room : LMA_PROFILE_RECORD_MAX;
+  LMA_ProfileValues values = *p_prev;
+  uint32_t pos = (uint32_t)1;
+  uint32_t value = (uint32_t)0;
+  uint32_t n = (uint32_t)0;
+  uint8_t check = (uint8_t)0;
+  bool valid = (size > 2U) && p_storage->read(p_storage->p_context, (sector * p_storage->sector_size) + offset, record, size);
+
+  /* Length, payload and check byte must fit and add up*/
+  valid = valid && ((uint8_t)PROFILE_ERASED != record[0]) && (((uint32_t)record[0] + 2U) <= size);
+  if (valid)
+  {
+    const uint32_t end = (uint32_t)record[0] + 1U;
+
+    for (n = (uint32_t)0; n <= end; ++n)
+    {
+      check += record[n];
+    }
+    valid = ((uint8_t)0xFFU == check) && Profile_get_var(record, end, &pos, &value);
+    values.time += value * PROFILE_MINUTE;
+    for (n = (uint32_t)0; valid && (n < LMA_PROFILE_ENERGIES); ++n)
+    {
+      valid = Profile_get_var(record, end, &pos, &value);
+      values.energy[n] += value;
+    }
+    for (n = (uint32_t)0; valid && (n < LMA_PROFILE_AVERAGES); ++n)
+    {
+      valid = Profile_get_var(record, end, &pos, &value);
+      values.average[n] = (int32_t)((uint32_t)values.average[n] + ((value >> 1U) ^ (uint32_t)(-(int32_t)(value & 1U))));
+    }
+    valid = valid && (end == pos) && (values.time > p_prev->time);
+  }
+
+  if (!valid)
+  {
+    return (uint32_t)0;
+  }
+
+  *p_next = values;
+  return pos + 1U;
+}
+/* END OF FUNCTION*/
+
+/** @brief Reads the header of a sector.
+ * @param[in] p_storage - storage holding the records.
+ * @param[in] sector - sector to read.
+ * @param[out] p_sequence - sequence number of the sector.
+ * @param[out] p_values - values before the first record of the sector.
+ * @return true if the sector holds a header.
+ */
+static bool Profile_header_read(const LMA_ProfileStorage *const p_storage, const uint32_t sector,
+                                uint32_t *const p_sequence, LMA_ProfileValues *const p_values)
+{
+  uint8_t header[LMA_PROFILE_HEADER_SIZE];
+  uint32_t n = (uint32_t)0;
+
+  if (!p_storage->read(p_storage->p_context, sector * p_storage->sector_size, header, LMA_PROFILE_HEADER_SIZE) ||
+      ((uint8_t)PROFILE_MAGIC != header[0]) || ((uint8_t)(PROFILE_MAGIC >> 8U) != header[1]) ||
+      ((uint8_t)PROFILE_VERSION != header[2]))
+  {
+    return false;
+  }
+
+  *p_sequence = Profile_get32(&(header[4]));
+  p_values->time = Profile_get32(&(header[8]));
+  for (n = (uint32_t)0; n < LMA_PROFILE_ENERGIES; ++n)
+  {
+    p_values->energy[n] = Profile_get32(&(header[12U + (4U * n)]));
+  }
+  for (n = (uint32_t)0; n < LMA_PROFILE_AVERAGES; ++n)
+  {
+    p_values->average[n] = (int32_t)Profile_get32(&(header[28U + (4U * n)]));
+  }
+
+  return ((uint32_t)0 != *p_sequence) && (0xFFFFFFFFU != *p_sequence);
+}
+/* END OF FUNCTION*/
+
+/** @brief Reads the header of the k-th oldest sector of a profile.
+ * @param[in] p_profile - recorder.
+ * @param[in] k - age of the sector - 0 is the oldest, sector_count - 1 the one being written.
+ * @param[out] p_values - values before the first record of the sector.
+ * @return true if the sector holds the records expected of its age (false if it has not been written yet).
+ */
+static bool Profile_oldest_read(const LMA_Profile *const p_profile, const uint32_t k, LMA_ProfileValues *const p_values)
+{
+  const uint32_t count = p_profile->p_storage->sector_count;
+  uint32_t sequence = (uint32_t)0;
+
+  return ((p_profile->sequence + k) >= count) &&
+         Profile_header_read(p_profile->p_storage, (p_profile->sector + 1U + k) % count, &sequence, p_values) &&
+         (sequence == (p_profile->sequence + k + 1U - count));
+}
+/* END OF FUNCTION*/
+
+/** @brief Writes a record, erasing the oldest sector to start the next when the record does not fit.
+ * @param[inout] p_profile - recorder.
+ * @param[in] p_next - values of the record.
+ * @return true if the record was written.
+ */
+static bool Profile_write(LMA_Profile *const p_profile, const LMA_ProfileValues *const p_next)
+{
+  const LMA_ProfileStorage *const p_storage = p_profile->p_storage;
+  uint8_t record[LMA_PROFILE_RECORD_MAX];
+  const uint32_t size = Profile_encode(&(p_profile->last), p_next, record);
+  bool written = true;
+  uint32_t n = (uint32_t)0;
+
+  if (((uint32_t)0 == p_profile->sequence) || ((p_profile->offset + size) > p_storage->sector_size))
+  {
+    /* The header holds the values before the first record, so the sector decodes on its own*/
+    uint8_t header[LMA_PROFILE_HEADER_SIZE];
+    const uint32_t sector = ((uint32_t)0 == p_profile->sequence) ? (uint32_t)0
+                                                                 : ((p_profile->sector + 1U) % p_storage->sector_count);
+
+    header[0] = (uint8_t)PROFILE_MAGIC;
+    header[1] = (uint8_t)(PROFILE_MAGIC >> 8U);
+    header[2] = (uint8_t)PROFILE_VERSION;
+    header[3] = (uint8_t)0;
+    Profile_put32(&(header[4]), p_profile->sequence + 1U);
+    Profile_put32(&(header[8]), p_profile->last.time);
+    for (n = (uint32_t)0; n < LMA_PROFILE_ENERGIES; ++n)
+    {
+      Profile_put32(&(header[12U + (4U * n)]), p_profile->last.energy[n]);
+    }
+    for (n = (uint32_t)0; n < LMA_PROFILE_AVERAGES; ++n)
+    {
+      Profile_put32(&(header[28U + (4U * n)]), (uint32_t)p_profile->last.average[n]);
+    }
+
+    written = p_storage->erase(p_storage->p_context, sector * p_storage->sector_size) &&
+              p_storage->write(p_storage->p_context, sector * p_storage->sector_size, header, LMA_PROFILE_HEADER_SIZE);
+    if (written)
+    {
+      p_profile->sector = sector;
+      p_profile->offset = LMA_PROFILE_HEADER_SIZE;
+      ++p_profile->sequence;
+    }
+  }
+
+  written = written && p_storage->write(p_storage->p_context,
+                                        (p_profile->sector * p_storage->sector_size) + p_profile->offset, record, size);
+  if (written)
+  {
+    p_profile->offset += size;
+    p_profile->last = *p_next;
+    ++p_profile->records;
+  }
+
+  return written;
+}
+/* END OF FUNCTION*/
+
+/* Externally Available Functions*/
+
+bool LMA_ProfileInit(LMA_Profile *const p_profile, const LMA_ProfileStorage *const p_storage, const uint32_t interval)
+{
+  LMA_ProfileValues values;
+  LMA_ProfileValues next;
+  uint32_t sequence = (uint32_t)0;
+  uint32_t sector = (uint32_t)0;
+  uint32_t size = (uint32_t)0;
+  uint8_t byte = (uint8_t)PROFILE_ERASED;
+  bool ok = true;
+
+  memset(p_profile, 0, sizeof(LMA_Profile));
+  p_profile->p_storage = p_storage;
+  p_profile->interval = interval;
+
+  if ((interval < PROFILE_MINUTE) || (interval > (60U * PROFILE_MINUTE)) || ((uint32_t)0 != (interval % PROFILE_MINUTE)) ||
+      (p_storage->sector_count < 2U) || (p_storage->sector_size <= (LMA_PROFILE_HEADER_SIZE + LMA_PROFILE_RECORD_MAX)))
+  {
+    p_profile->p_storage = NULL;
+    return false;
+  }
+
+  /* The newest sector has the highest sequence number*/
+  for (sector = (uint32_t)0; sector < p_storage->sector_count; ++sector)
+  {
+    if (Profile_header_read(p_storage, sector, &sequence, &values) && (sequence > p_profile->sequence))
+    {
+      p_profile->sequence = sequence;
+      p_profile->sector = sector;
+      p_profile->last = values;
+    }
+  }
+
+  if ((uint32_t)0 != p_profile->sequence)
+  {
+    /* Pick up after the newest record - a damaged record ends the sector, so the next record starts a new one*/
+    p_profile->offset = LMA_PROFILE_HEADER_SIZE;
+    size = Profile_decode(p_storage, p_profile->sector, p_profile->offset, &(p_profile->last), &next);
+    while ((uint32_t)0 != size)
+    {
+      p_profile->last = next;
+      p_profile->offset += size;
+      size = Profile_decode(p_storage, p_profile->sector, p_profile->offset, &(p_profile->last), &next);
+    }
+
+    if (p_profile->offset < p_storage->sector_size)
+    {
+      ok = p_storage->read(p_storage->p_context, (p_profile->sector * p_storage->sector_size) + p_profile->offset, &byte,
+                           (uint32_t)1);
+      p_profile->offset = ((uint8_t)PROFILE_ERASED == byte) ? p_profile->offset : p_storage->sector_size;
+    }
+  }
+
+  if (!ok)
+  {
+    p_profile->p_storage = NULL;
+  }
+  return ok;
+}
+
+bool LMA_ProfileUpdate(LMA_Profile *const p_profile, const uint32_t time, const LMA_Measurements *const p_measurements,
+                       const LMA_ConsumptionData *const p_consumption)
+{
+  const uint32_t interval = p_profile->interval;
+  const uint32_t boundary = (time / interval) * interval;
+  LMA_ProfileValues next;
+  bool written = true;
+
+  if (NULL == p_profile->p_storage)
+  {
+    return false;
+  }
+
+  if (((uint32_t)0 == p_profile->interval_end) || (time < (p_profile->interval_end - interval)))
+  {
+    /* Start (or the clock was set back) - the running interval is not whole*/
+    if ((uint32_t)0 == p_profile->sequence)
+    {
+      /* Nothing recorded yet - the first record counts the energy from here*/
+      Profile_energies(p_consumption, &(p_profile->last));
+    }
+    p_profile->interval_end = boundary + interval;
+    p_profile->whole = false;
+    p_profile->count = (uint32_t)0;
+  }
+  else if (time >= p_profile->interval_end)
+  {
+    if (p_profile->whole && ((uint32_t)0 != p_profile->count) && (p_profile->interval_end > p_profile->last.time))
+    {
+      next.time = p_profile->interval_end;
+      Profile_energies(p_consumption, &next);
+      next.average[0] = Profile_round(p_profile->sum[0] / (float)p_profile->count, PROFILE_V_SCALE);
+      next.average[1] = Profile_round(p_profile->sum[1] / (float)p_profile->count, PROFILE_I_SCALE);
+      next.average[2] = Profile_round(p_profile->sum[2] / (float)p_profile->count, PROFILE_P_SCALE);
+      written = Profile_write(p_profile, &next);
+    }
+
+    /* After a gap in the snapshots the interval running now did not start on its boundary*/
+    p_profile->whole = (boundary == p_profile->interval_end);
+    p_profile->interval_end = boundary + interval;
+    p_profile->count = (uint32_t)0;
+  }
+
+  if ((uint32_t)0 == p_profile->count)
+  {
+    p_profile->sum[0] = 0.0f;
+    p_profile->sum[1] = 0.0f;
+    p_profile->sum[2] = 0.0f;
+  }
+  p_profile->sum[0] += p_measurements->vrms;
+  p_profile->sum[1] += p_measurements->irms;
+  p_profile->sum[2] += p_measurements->p;
+  ++p_profile->count;
+
+  return written;
+}
+
+uint32_t LMA_ProfileRead(const LMA_Profile *const p_profile, const uint32_t from, const uint32_t to,
+                         LMA_ProfileEntry *const p_entries, const uint32_t max_count)
+{
+  const LMA_ProfileStorage *const p_storage = p_profile->p_storage;
+  LMA_ProfileValues values;
+  LMA_ProfileValues next;
+  uint32_t lo = (uint32_t)0;
+  uint32_t hi = (uint32_t)0;
+  uint32_t k = (uint32_t)0;
+  uint32_t n = (uint32_t)0;
+  uint32_t e = (uint32_t)0;
+
+  if ((NULL == p_storage) || ((uint32_t)0 == p_profile->sequence) || (from >= to) || ((uint32_t)0 == max_count))
+  {
+    return (uint32_t)0;
+  }
+
+  /* Sectors not yet written are the oldest - find the first that was*/
+  hi = p_storage->sector_count - 1U;
+  while (lo < hi)
+  {
+    const uint32_t mid = (lo + hi) / 2U;
+    if (Profile_oldest_read(p_profile, mid, &values))
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid + 1U;
+    }
+  }
+
+  /* Then the newest sector starting before from - every sector after it starts later still*/
+  hi = p_storage->sector_count - 1U;
+  while (lo < hi)
+  {
+    const uint32_t mid = (lo + hi + 1U) / 2U;
+    if (Profile_oldest_read(p_profile, mid, &values) && (values.time < from))
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1U;
+    }
+  }
+
+  for (k = lo; (k < p_storage->sector_count) && (n < max_count); ++k)
+  {
+    const uint32_t sector = (p_profile->sector + 1U + k) % p_storage->sector_count;
+    uint32_t offset = LMA_PROFILE_HEADER_SIZE;
+    uint32_t size = (uint32_t)0;
+
+    if (!Profile_oldest_read(p_profile, k, &values))
+    {
+      continue;
+    }
+
+    size = Profile_decode(p_storage, sector, offset, &values, &next);
+    while (((uint32_t)0 != size) && (n < max_count))
+    {
+      if (next.time >= to)
+      {
+        return n;
+      }
+
+      if (next.time >= from)
+      {
+        LMA_ProfileEntry *const p_entry = &(p_entries[n++]);
+
+        p_entry->time = next.time;
+        for (e = (uint32_t)0; e < LMA_PROFILE_ENERGIES; ++e)
+        {
+          p_entry->energy_wh[e] = (float)(next.energy[e] - values.energy[e]) / 1000.0f;
+        }
+        p_entry->average[0] = (float)next.average[0] / PROFILE_V_SCALE;
+        p_entry->average[1] = (float)next.average[1] / PROFILE_I_SCALE;
+        p_entry->average[2] = (float)next.average[2] / PROFILE_P_SCALE;
+      }
+
+      values = next;
+      offset += size;
+      size = Profile_decode(p_storage, sector, offset, &values, &next);
+    }
+  }
+
+  return n;
+}
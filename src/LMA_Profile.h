@@ -0,0 +1,76 @@
+/**
+ * @file LMA_Profile.h
+ * @brief Load profile recorder declarations for LMA.
+ *
+ * @details This file provides declarations of the load profile recorder, which keeps interval energy and average values in a
+ * circular region of non volatile storage.
+ */
+
+#ifndef _LMA_PROFILE_H
+#define _LMA_PROFILE_H
+
+#include "LMA_Types.h"
+
+/** @addtogroup API
+ *  @{
+ */
+
+/** @addtogroup Profile
+ * @brief LMA Load Profile API
+ * @details Records the energy and the mean Vrms, Irms and P of each interval (a whole number of minutes, 1 to 60) from the
+ * snapshots the application takes with LMA_MeasurementsGet and LMA_EnergyGet/LMA_ConsumptionDataGet, timed by the clock
+ * (see LMA_ClockGet).<br>
+ * Each record is stored as the difference to the one before, each value a variable length integer, so a steady interval
+ * takes about 13 bytes. Records fill a region of storage (LMA_ProfileStorage) a sector at a time - when it is full the oldest
+ * sector is erased. Each sector starts with the values before its first record, so LMA_ProfileRead finds a time by a binary
+ * search of the sectors and decodes from there, and LMA_ProfileInit picks up after the newest record following a reset.
+ *  @{
+ */
+
+/** @brief Header of each sector of a load profile in bytes*/
+#define LMA_PROFILE_HEADER_SIZE (40U)
+
+/** @brief Longest load profile record in bytes*/
+#define LMA_PROFILE_RECORD_MAX (42U)
+
+/** @brief Sets up a load profile recorder on a region of storage and picks up after its newest record.
+ * @details A region holding no profile is left as is until the first record. The interval running when recording starts is
+ * not whole, so it is not recorded - its energy counts in the first record.
+ * @param[out] p_profile - recorder to set up.
+ * @param[in] p_storage - region holding the records (at least 2 sectors of more than LMA_PROFILE_HEADER_SIZE +
+ * LMA_PROFILE_RECORD_MAX bytes) - keep in scope while recording.
+ * @param[in] interval - interval length in seconds - a whole number of minutes, 60 to 3600.
+ * @return true if the region was read - false if the storage failed (nothing is recorded then).
+ */
+bool LMA_ProfileInit(LMA_Profile *const p_profile, const LMA_ProfileStorage *const p_storage, const uint32_t interval);
+
+/** @brief Adds a snapshot to the running interval, recording the interval when the clock passes its end.
+ * @details Call with each new set of measurements (e.g. when LMA_MeasurementsGet returns fresh data). The energies of a
+ * record are those of the snapshot which ends the interval, so the snapshots bound the timing of the record. A clock set back
+ * waits for the next interval after the newest record.
+ * @param[inout] p_profile - recorder set up with LMA_ProfileInit.
+ * @param[in] time - clock now (seconds since 2000-01-01 00:00:00).
+ * @param[in] p_measurements - measurements averaged over the interval.
+ * @param[in] p_consumption - total energies.
+ * @return true unless writing a record failed.
+ */
+bool LMA_ProfileUpdate(LMA_Profile *const p_profile, const uint32_t time, const LMA_Measurements *const p_measurements,
+                       const LMA_ConsumptionData *const p_consumption);
+
+/** @brief Reads the recorded intervals ending in a range of time, oldest first.
+ * @details Continue a download from the time of the last entry read plus one.
+ * @param[in] p_profile - recorder set up with LMA_ProfileInit.
+ * @param[in] from - first interval end to read (clock seconds).
+ * @param[in] to - interval end to stop before (clock seconds).
+ * @param[out] p_entries - entries to populate.
+ * @param[in] max_count - number of entries p_entries holds.
+ * @return number of entries populated.
+ */
+uint32_t LMA_ProfileRead(const LMA_Profile *const p_profile, const uint32_t from, const uint32_t to,
+                         LMA_ProfileEntry *const p_entries, const uint32_t max_count);
+
+/** @} */
+
+/** @} */
+
+#endif /* _LMA_PROFILE_H */
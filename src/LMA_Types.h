@@ -32,6 +32,29 @@ typedef int32_t spl_t;
  */
 typedef int64_t acc_t;
 
+/** @brief Enables the hot path trace instrumentation.
+ * @details Define as 1 (e.g. on the compiler command line) to time the callbacks and accumulation port hooks into latency
+ * histograms using the port cycle counter (LMA_TRACE_CYCLES). When 0 the instrumentation and the trace API compile out
+ * completely.
+ */
+#ifndef LMA_TRACE_ENABLE
+  #define LMA_TRACE_ENABLE (0)
+#endif
+
+/** @brief Removes DC offsets from the accumulated signals.
+ * @details Define as 1 (e.g. on the compiler command line) to have the port also sum the samples of each channel - three adds
+ * per sample rather than a filter - so the offsets can be removed algebraically once per window: sum(x^2) - sum(x)^2 / n for
+ * the RMS and sum(xy) - sum(x)sum(y) / n for the powers. When 0 the sums compile out completely.
+ */
+#ifndef LMA_OFFSET_REMOVAL
+  #define LMA_OFFSET_REMOVAL (0)
+#endif
+
+/** @brief Number of log2 buckets in each trace histogram.*/
+#ifndef LMA_TRACE_BUCKETS
+  #define LMA_TRACE_BUCKETS (24U)
+#endif
+
 /** @}*/
 
 /** @addtogroup API
@@ -52,12 +75,16 @@ typedef int64_t acc_t;
  */
 typedef enum LMA_Status_e
 {
-  LMA_OK = 0,               /**< No Problems */
-  LMA_NO_ACTIVE_LOAD = 1,   /**< No Active Power (P < LMA_Config.no_load_p) */
-  LMA_NO_REACTIVE_LOAD = 2, /**< No Reactive Power (Q < LMA_Config.no_load_p) */
-  LMA_NO_APPARENT_LOAD = 4, /**< No Apparent Power (S < LMA_Config.no_load_p) */
-  LMA_VOLTAGE_SAG = 8,      /**< Vrms Sagged (Vrms < LMA_Config.v_sag) */
-  LMA_VOLTAGE_SWELL = 16    /**< Vrms Swelled (Vrms > LMA_Config.v_swell) */
+  LMA_OK = 0,                /**< No Problems */
+  LMA_NO_ACTIVE_LOAD = 1,    /**< No Active Power (P < LMA_Config.no_load_p) */
+  LMA_NO_REACTIVE_LOAD = 2,  /**< No Reactive Power (Q < LMA_Config.no_load_p) */
+  LMA_NO_APPARENT_LOAD = 4,  /**< No Apparent Power (S < LMA_Config.no_load_p) */
+  LMA_VOLTAGE_SAG = 8,       /**< Vrms Sagged (Vrms < LMA_Config.v_sag) */
+  LMA_VOLTAGE_SWELL = 16,    /**< Vrms Swelled (Vrms > LMA_Config.v_swell) */
+  LMA_RESIDUAL_CURRENT = 32, /**< Computed neutral above LMA_Config.residual_i (first phase only) */
+  LMA_NEUTRAL_MISMATCH = 64, /**< Measured and computed neutral differ by LMA_Config.neutral_mismatch (first phase only) */
+  LMA_OVERCURRENT = 128,     /**< Irms above LMA_Config.i_over */
+  LMA_FREQUENCY_ERROR = 256  /**< Line frequency outside LMA_Config.fline_tol_low to fline_tol_high (measurements zeroed) */
 } LMA_Status;
 
 /**
@@ -90,6 +117,11 @@ typedef struct LMA_Accs_str
   acc_t i_acc;           /**< Current accumulator*/
   acc_t p_acc;           /**< Active power accumulator*/
   acc_t q_acc;           /**< Reactive power accumulator*/
+#if LMA_OFFSET_REMOVAL
+  acc_t v_sum;           /**< Sum of the voltage samples*/
+  acc_t v90_sum;         /**< Sum of the 90 degree shifted voltage samples*/
+  acc_t i_sum;           /**< Sum of the current samples*/
+#endif
   uint32_t sample_count; /**< Sample counter, used to track number of samples during accumulation period.*/
 } LMA_Accs;
 
@@ -111,21 +143,92 @@ typedef struct LMA_NeutralAccs_str
 {
   acc_t i_acc_temp;     /**< Running current accumulator*/
   acc_t i_acc_snapshot; /**< Snapshot of current accumulator after computation window finished*/
+#if LMA_OFFSET_REMOVAL
+  acc_t i_sum_temp;     /**< Running sum of the current samples*/
+  acc_t i_sum_snapshot; /**< Snapshot of the sum of the current samples after computation window finished*/
+#endif
 } LMA_NeutralAccs;
 
+/**
+ * @brief Filter stage type
+ * @details Enumerated type selecting the operation of a front end filter stage (see LMA_Filter.h).
+ */
+typedef enum LMA_FilterType_e
+{
+  LMA_FILTER_INTEGRATOR = 0, /**< Trapezoidal integrator y += (x + x_prev) / 2 - follow with LMA_FILTER_DC_BLOCK */
+  LMA_FILTER_DC_BLOCK,       /**< DC blocking high pass y = a(y_prev + x - x_prev), a = coeff / 2^shift */
+  LMA_FILTER_DELAY,          /**< Whole sample delay */
+  LMA_FILTER_FRAC_DELAY,     /**< Fractional delay - linear interpolation between two whole sample delays */
+  LMA_FILTER_DECIMATE        /**< Sums coeff samples and outputs the sum / 2^shift once per coeff samples */
+} LMA_FilterType;
+
+/**
+ * @brief Filter stage state
+ * @details Running state of a filter stage - cleared by LMA_FilterChainInit and LMA_FilterReset.
+ */
+typedef struct LMA_FilterState_str
+{
+  spl_t x_prev;   /**< Previous input (INTEGRATOR, DC_BLOCK) */
+  spl_t y_prev;   /**< Previous output (INTEGRATOR, DC_BLOCK) */
+  acc_t sum;      /**< Running sum (DECIMATE) or LSB carried by the halving (INTEGRATOR) */
+  uint16_t index; /**< Newest entry of the delay line (DELAY, FRAC_DELAY) or samples summed (DECIMATE) */
+  bool primed;    /**< First sample seen - the integrator and DC block start from it rather than from zero */
+} LMA_FilterState;
+
+/**
+ * @brief Filter stage
+ * @details One operation of a front end filter chain, set up with the LMA_FilterxInit functions.
+ */
+typedef struct LMA_FilterStage_str
+{
+  LMA_FilterType type;   /**< Operation */
+  int32_t coeff;         /**< DC_BLOCK: a, FRAC_DELAY: fraction of a sample, both scaled by 2^shift. DECIMATE: factor */
+  uint8_t shift;         /**< Scaling of coeff (DC_BLOCK, FRAC_DELAY) or of the sum (DECIMATE) */
+  uint16_t delay;        /**< Whole samples of delay (DELAY, FRAC_DELAY) */
+  uint16_t length;       /**< Entries of p_buffer (DELAY: delay + 1, FRAC_DELAY: delay + 2) */
+  spl_t *p_buffer;       /**< Delay line (DELAY, FRAC_DELAY) - provided by the application */
+  LMA_FilterState state; /**< Running state */
+} LMA_FilterStage;
+
+/**
+ * @brief Filter chain
+ * @details Stages run in order on one channel - each channel needs its own chain and stages as they hold its state.
+ */
+typedef struct LMA_FilterChain_str
+{
+  LMA_FilterStage *p_stages; /**< Array of stages */
+  uint8_t stage_count;       /**< Number of stages */
+} LMA_FilterChain;
+
 /**
  * @brief Zero cross detection data
  * @details Data structure containing all parameters for use in zero-cross detection on AC voltage line.
  */
 typedef struct LMA_ZeroCross_str
 {
-  uint32_t count;    /**< running counter to count the number of zero cross */
-  spl_t last_sample; /**< Tracked/filtered voltage */
-  bool debounce;     /**< zerocross debounce flag*/
-  bool first_event;  /**< flag indicating we have already detected a zero cross (synch'd) */
-  bool already_run;  /**< flag indicating we need to prime the filter */
+  uint32_t count;      /**< running counter to count the number of zero cross */
+  uint32_t cross_tick; /**< ADC callback count at the last zero cross */
+  spl_t last_sample;   /**< Tracked/filtered voltage */
+  spl_t cross_below;   /**< Filtered voltage on the sample before the last zero cross */
+  spl_t cross_above;   /**< Filtered voltage on the sample of the last zero cross */
+  bool debounce;       /**< zerocross debounce flag*/
+  bool first_event;    /**< flag indicating we have already detected a zero cross (synch'd) */
+  bool already_run;    /**< flag indicating we need to prime the filter */
 } LMA_ZeroCross;
 
+/**
+ * @brief Computation window data
+ * @details Data structure tracking the length of the computation windows of a phase (see LMA_Config.update_interval_min).
+ */
+typedef struct LMA_Window_str
+{
+  uint32_t cycles;          /**< Line cycles the window being accumulated runs for */
+  uint32_t snapshot_cycles; /**< Line cycles accumulated in the snapshot */
+  float irms;               /**< Irms of the last window - reference for transient detection */
+  float p;                  /**< Active power of the last window - reference for transient detection */
+  bool joined;              /**< Coherent windows - the phase accumulates the window of the first phase */
+} LMA_Window;
+
 /**
  * @brief Measurement output
  * @details Convenience data structure to store snapshot of measurements.
@@ -141,6 +244,30 @@ typedef struct LMA_Measurements_str
   float s;            /**< Apparent Power */
 } LMA_Measurements;
 
+/**
+ * @brief Sequence components
+ * @details Symmetrical components of a three phase quantity.
+ */
+typedef struct LMA_SequenceComponents_str
+{
+  float positive;  /**< Positive sequence (RMS) */
+  float negative;  /**< Negative sequence (RMS) */
+  float zero;      /**< Zero sequence (RMS) */
+  float unbalance; /**< Unbalance factor - negative over positive sequence in % */
+} LMA_SequenceComponents;
+
+/**
+ * @brief System measurement output
+ * @details Measurements of a three phase system as a whole (see LMA_SystemMeasurementsRegister).
+ */
+typedef struct LMA_SystemMeasurements_str
+{
+  LMA_SequenceComponents v; /**< Voltage sequence components */
+  LMA_SequenceComponents i; /**< Current sequence components */
+  float v_angle[3];         /**< Voltage angle of each phase relative to the first phase voltage (degrees) */
+  float i_angle[3];         /**< Current angle of each phase relative to the first phase voltage (degrees) */
+} LMA_SystemMeasurements;
+
 /**
  * @brief Energy computation data
  * @details Data structure containing all parameters for use in computing/computed AC energy consumption parameters.
@@ -234,9 +361,9 @@ typedef struct LMA_PhaseAngleError_str
  */
 typedef struct LMA_Signals_str
 {
-  bool accumulators_ready; /**< Flag to indicate our accumulators are ready for update */
-  bool measurements_ready; /**< Flag to indicate a new measurement set is ready */
-  bool calibrating;        /**< Flag to indicate system is calibrating*/
+  volatile bool accumulators_ready; /**< Flag to indicate our accumulators are ready for update */
+  volatile bool measurements_ready; /**< Flag to indicate a new measurement set is ready */
+  volatile bool calibrating;        /**< Flag to indicate system is calibrating*/
 } LMA_Signals;
 
 /**
@@ -248,8 +375,113 @@ typedef struct LMA_Neutral_str
   LMA_NeutralInputs inputs;     /**< Area to load inputs (ADC Samples) for processing */
   LMA_NeutralAccs accs;         /**< Object holding accumulator data*/
   LMA_NeutralCalibration calib; /**< Instance of the neautrals calibration data block */
+  LMA_FilterChain *p_i_filter;  /**< Front end filter of the current channel (NULL = none) */
 } LMA_Neutral;
 
+/**
+ * @brief Computed neutral data
+ * @details Data structure for the neutral current computed as the vector sum of the phase current samples (see
+ * LMA_ComputedNeutralRegister) - no ADC channel is needed.
+ */
+typedef struct LMA_ComputedNeutral_str
+{
+  acc_t i_acc_temp;     /**< Running accumulator of the squared sum of the phase currents*/
+  acc_t i_acc_snapshot; /**< Snapshot of the accumulator after the window of the first phase finished*/
+#if LMA_OFFSET_REMOVAL
+  acc_t i_sum_temp;     /**< Running sum of the summed phase currents*/
+  acc_t i_sum_snapshot; /**< Snapshot of the sum after the window of the first phase finished*/
+#endif
+  float irms;           /**< RMS of the vector sum of the phase currents from the last window*/
+} LMA_ComputedNeutral;
+
+/**
+ * @brief Waveform capture event
+ * @details A frozen capture (see LMA_CaptureSet), read in place from the buffer holding it - oldest frame first, in two parts
+ * where its ring wrapped. Each frame holds the raw inputs of every phase in the order they were registered.
+ */
+typedef struct LMA_CaptureEvent_str
+{
+  uint32_t time;                      /**< Clock at the trigger (see LMA_ClockGet) */
+  LMA_Status status;                  /**< Status bits raised by the trigger (LMA_OK = LMA_CaptureTrigger) */
+  uint32_t phase_number;              /**< Phase raising them */
+  uint32_t trigger;                   /**< Frame of the trigger, counted from the oldest */
+  const LMA_PhaseInputs *p_frames[2]; /**< First frame of each part (NULL = part empty) */
+  uint32_t count[2];                  /**< Frames of each part */
+} LMA_CaptureEvent;
+
+/**
+ * @brief Waveform capture
+ * @details A ring of the raw inputs of every phase, frozen a number of frames after a trigger, in one of event_count
+ * buffers held by the application. p_buffers, frames, post_frames, p_events, event_count and trigger_mask are set by the
+ * application, the rest by LMA_CaptureSet.
+ */
+typedef struct LMA_Capture_str
+{
+  LMA_PhaseInputs *p_buffers;  /**< event_count buffers of frames frames of every phase */
+  uint32_t frames;             /**< Frames of each buffer - the frames before the trigger are frames - post_frames */
+  uint32_t post_frames;        /**< Frames recorded after the trigger (1 to frames) */
+  LMA_CaptureEvent *p_events;  /**< event_count events */
+  uint32_t event_count;        /**< Events held at most - recording stops while every buffer holds one */
+  uint32_t trigger_mask;       /**< Status bits (LMA_Status) which trigger a capture when raised */
+  uint32_t phase_count;        /**< Phases of each frame */
+  LMA_PhaseInputs *p_buffer;   /**< Buffer recording */
+  LMA_PhaseInputs *p_frame;    /**< Next frame to record (NULL = every buffer holds an event) */
+  uint32_t index;              /**< Frame of p_frame in the buffer recording */
+  bool wrapped;                /**< The buffer recording has been filled at least once */
+  volatile uint32_t remaining; /**< Frames still to record after the trigger (0 = not triggered) */
+  volatile uint32_t frozen;    /**< Events frozen (counted in LMA_CB_ADC) */
+  volatile uint32_t released;  /**< Events released (counted by LMA_CaptureRelease) */
+} LMA_Capture;
+
+#define LMA_EVENT_STATUS_BITS (9U) /**< Status bits an event log follows (LMA_NO_ACTIVE_LOAD to LMA_FREQUENCY_ERROR) */
+
+/**
+ * @brief Status event
+ * @details One edge of a status bit of a phase, logged by LMA_CB_TMR (see LMA_EventLogSet). The extreme is of the
+ * measurement the bit follows: the lowest Vrms of a sag, the highest Vrms of a swell, the highest Irms of an overcurrent or a
+ * no load, the highest computed neutral Irms of a residual current or a neutral mismatch, and the line frequency furthest
+ * out of a frequency error.
+ */
+typedef struct LMA_Event_str
+{
+  uint32_t time;         /**< Clock at the edge (see LMA_ClockGet) */
+  uint32_t start;        /**< Clock when the bit was raised (= time for the edge raising it) */
+  LMA_Status status;     /**< Status bit of the event */
+  uint32_t phase_number; /**< Phase of the event */
+  bool end;              /**< false = the bit was raised, true = the bit was cleared */
+  float duration;        /**< Seconds of windows with the bit raised (to the edge) */
+  float extreme;         /**< Extreme of the measurement the bit follows while raised (to the edge) */
+} LMA_Event;
+
+/**
+ * @brief Status events of a phase in progress
+ * @details Per status bit - kept by LMA_CB_TMR while the bit is raised.
+ */
+typedef struct LMA_EventTrack_str
+{
+  uint32_t start[LMA_EVENT_STATUS_BITS]; /**< Clock when each bit was raised */
+  float duration[LMA_EVENT_STATUS_BITS]; /**< Seconds of windows with each bit raised */
+  float extreme[LMA_EVENT_STATUS_BITS];  /**< Extreme of the measurement each bit follows */
+} LMA_EventTrack;
+
+/**
+ * @brief Status event log
+ * @details A ring of status events written by LMA_CB_TMR and read by the application (LMA_EventsRead) without locking - one
+ * writer and one reader, each moving its own count. p_events, size, event_mask, p_callback and p_tracks are set by the
+ * application, the rest by LMA_EventLogSet.
+ */
+typedef struct LMA_EventLog_str
+{
+  LMA_Event *p_events;                          /**< Ring of size events */
+  uint32_t size;                                /**< Events the ring holds */
+  uint32_t event_mask;                          /**< Status bits (LMA_Status) logged */
+  void (*p_callback)(const LMA_Event *p_event); /**< Called by LMA_CB_TMR with each event logged (NULL = none) */
+  LMA_EventTrack *p_tracks;                     /**< One per registered phase */
+  volatile uint32_t written;                    /**< Events written (counted in LMA_CB_TMR) */
+  volatile uint32_t read;                       /**< Events read (counted by LMA_EventsRead) */
+  volatile uint32_t dropped;                    /**< Events dropped while the ring was full */
+} LMA_EventLog;
+
 /**
  * @brief Phase data
  * @details Data structure containing phase (V & I pair) signal processing parameters.
@@ -260,12 +492,16 @@ typedef struct LMA_Phase_str
   LMA_PhaseInputs inputs;        /**< Area to load inputs (ADC Samples) for processing */
   LMA_PhaseAccs accs;            /**< Object holding accumulator data*/
   LMA_ZeroCross zero_cross_v;    /**< Zero cross tracking variables for voltage */
+  LMA_Window window;             /**< Computation window length tracking */
   LMA_PhaseCalibration calib;    /**< Instance of the phases calibration data block */
   LMA_Measurements measurements; /**< Object holding measurements from last computation window update*/
   LMA_EnergyUnit energy_units;   /**< Energy processing block */
   LMA_Status status;             /**< Phase status */
   LMA_Signals sigs;              /**< Phase signals */
   LMA_Neutral *p_neutral;        /**< Pointer to neutral channel (if present)*/
+  LMA_FilterChain *p_v_filter;   /**< Front end filter of the voltage channel (NULL = none) */
+  LMA_FilterChain *p_v90_filter; /**< Front end filter of the 90 degree shifted voltage channel (NULL = none) */
+  LMA_FilterChain *p_i_filter;   /**< Front end filter of the current channel (NULL = none) */
   float (*p_computation_hook)(float *i, float *v,
                               float *f); /**< Hook to enable applying a compensation factor to power based on i, v and f args*/
   uint32_t phase_number;                 /**< zero indexed phase number for identification*/
@@ -350,6 +586,231 @@ typedef struct LMA_SystemEnergy_str
   LMA_Impulse impulse;
 } LMA_SystemEnergy;
 
+/**
+ * @brief Energy register quantity
+ * @details Enumerated type selecting what an energy register counts - import and export follow the sign of P (and Q).
+ */
+typedef enum LMA_RegisterQuantity_e
+{
+  LMA_REGISTER_ACT_IMP = 0, /**< Active energy imported (P > 0) */
+  LMA_REGISTER_ACT_EXP,     /**< Active energy exported (P < 0) */
+  LMA_REGISTER_REACT_IMP,   /**< Reactive energy imported (Q > 0) */
+  LMA_REGISTER_REACT_EXP,   /**< Reactive energy exported (Q < 0) */
+  LMA_REGISTER_APP_IMP,     /**< Apparent energy while active energy is imported */
+  LMA_REGISTER_APP_EXP,     /**< Apparent energy while active energy is exported */
+  LMA_REGISTER_REACT_Q1,    /**< Inductive reactive energy imported - quadrant I (P >= 0, Q > 0) */
+  LMA_REGISTER_REACT_Q2,    /**< Capacitive reactive energy imported - quadrant II (P < 0, Q > 0) */
+  LMA_REGISTER_REACT_Q3,    /**< Inductive reactive energy exported - quadrant III (P < 0, Q < 0) */
+  LMA_REGISTER_REACT_Q4     /**< Capacitive reactive energy exported - quadrant IV (P >= 0, Q < 0) */
+} LMA_RegisterQuantity;
+
+/**
+ * @brief Energy register
+ * @details One entry of the energy register table (see LMA_RegistersSet) - counts a quantity of a phase or of the whole system
+ * in units of its own meter constant, with an optional impulse output. counter and accumulator_ws are the data to store.
+ */
+typedef struct LMA_Register_str
+{
+  LMA_Phase *p_phase;               /**< Phase to count (NULL = whole system) */
+  LMA_RegisterQuantity quantity;    /**< Quantity to count */
+  float meter_constant;             /**< Ws per count (and impulse) */
+  void (*p_impulse)(const bool on); /**< Impulse output - on at each count, off after LMA_Impulse.led_on_count ADC intervals
+                                       (NULL = none) */
+  float unit;                       /**< Ws per ADC interval - resolved from the energy units by LMA_CB_TMR */
+  float accumulator_ws;             /**< Energy since the last count in Ws */
+  uint64_t counter;                 /**< Counts over meter lifetime */
+  uint32_t impulse_counter;         /**< ADC intervals the impulse has been on */
+  bool impulse_on;                  /**< Flag indicating the impulse is on */
+} LMA_Register;
+
+#define LMA_TARIFF_COUNT (8U)         /**< Tariffs (time of use registers) */
+#define LMA_TARIFF_SEASONS (4U)       /**< Seasons of a tariff schedule */
+#define LMA_TARIFF_DAY_PROFILES (4U)  /**< Day profiles of a tariff schedule */
+#define LMA_TARIFF_SWITCHES (8U)      /**< Switch points of a day profile */
+#define LMA_TARIFF_SPECIAL_DAYS (16U) /**< Special days (holidays) of a tariff schedule */
+
+/** @brief Packs a date (month 1-12, day 1-31) for LMA_TariffSchedule - packed dates order as the calendar*/
+#define LMA_TARIFF_DATE(month, day) ((uint16_t)(((month) << 5U) | (day)))
+
+/** @brief Packs a switch point of a day profile - from hour:minute the tariff (0 to LMA_TARIFF_COUNT - 1) is active*/
+#define LMA_TARIFF_SWITCH(hour, minute, tariff) ((uint16_t)(((((hour) * 60U) + (minute)) << 3U) | (tariff)))
+
+/**
+ * @brief Time of use tariff schedule
+ * @details Compact, pointer free schedule (suitable for non volatile storage as is). The date selects a season, the season and
+ * weekday select a day profile (special days override it) and the time of day selects the tariff from the day profile.
+ * Seasons and switch points are in ascending order - before the first season of the year the last season applies, before
+ * the first switch point of the day the last switch point of that profile applies.
+ */
+typedef struct LMA_TariffSchedule_str
+{
+  uint16_t season_start[LMA_TARIFF_SEASONS];                          /**< First day of each season (LMA_TARIFF_DATE) */
+  uint8_t week_profile[LMA_TARIFF_SEASONS][7];                        /**< Day profile of each weekday (Monday first) */
+  uint16_t day_profile[LMA_TARIFF_DAY_PROFILES][LMA_TARIFF_SWITCHES]; /**< Switch points (LMA_TARIFF_SWITCH) */
+  uint8_t switch_count[LMA_TARIFF_DAY_PROFILES];                      /**< Switch points used in each day profile */
+  uint16_t special_day[LMA_TARIFF_SPECIAL_DAYS];                      /**< Special days (LMA_TARIFF_DATE) */
+  uint8_t special_count;                                              /**< Special days used */
+  uint8_t special_profile;                                            /**< Day profile of the special days */
+  uint8_t season_count;                                               /**< Seasons used (at least 1) */
+} LMA_TariffSchedule;
+
+/**
+ * @brief Time of use tariff
+ * @details Energy registers of each tariff (see LMA_TariffSet) - only the register of the active tariff counts.
+ * p_phase, quantity, meter_constant and p_impulse of each register are set by the application as in LMA_RegistersSet.
+ */
+typedef struct LMA_Tariff_str
+{
+  const LMA_TariffSchedule *p_schedule;     /**< Schedule to follow */
+  LMA_Register registers[LMA_TARIFF_COUNT]; /**< Register of each tariff */
+  uint8_t active;                           /**< Tariff counting now */
+} LMA_Tariff;
+
+#define LMA_DEMAND_SUBINTERVALS (15U) /**< Most sub-intervals of a sliding demand */
+
+/**
+ * @brief Demand reading
+ * @details Latest demand and maximum demand of a demand register - the data to store. Times are of the clock kept by
+ * LMA_CB_RTC (see LMA_ClockGet) at the end of the interval.
+ */
+typedef struct LMA_DemandReading_str
+{
+  float demand;       /**< Average of the quantity over the last complete demand interval (W, var or VA) */
+  uint32_t time;      /**< End of the last complete demand interval (0 = none yet) */
+  float peak;         /**< Maximum demand since cleared */
+  uint32_t peak_time; /**< End of the demand interval of the peak */
+} LMA_DemandReading;
+
+/**
+ * @brief Demand register
+ * @details One entry of the demand table (see LMA_DemandsSet). Each LMA_CB_TMR window adds its energy to the running
+ * sub-interval, each sub-interval boundary of the clock moves it into a ring whose running sum gives the demand. One
+ * sub-interval per demand interval is a block demand, more make a sliding demand updated every sub-interval.
+ */
+typedef struct LMA_Demand_str
+{
+  LMA_Phase *p_phase;                    /**< Phase to measure (NULL = whole system) */
+  LMA_RegisterQuantity quantity;         /**< Quantity to measure */
+  uint32_t subinterval;                  /**< Sub-interval length in clock seconds (e.g. 60 or 900) */
+  uint32_t subintervals;                 /**< Sub-intervals per demand interval (1 to LMA_DEMAND_SUBINTERVALS) */
+  LMA_DemandReading reading;             /**< Demand and maximum demand */
+  float energy[LMA_DEMAND_SUBINTERVALS]; /**< Energy of the latest sub-intervals in Ws (ring) */
+  float sum;                             /**< Running sum of the ring in Ws */
+  float accumulator;                     /**< Energy of the running sub-interval in Ws */
+  uint32_t index;                        /**< Ring entry of the next sub-interval */
+  uint32_t filled;                       /**< Complete sub-intervals in the ring */
+  bool synced;                           /**< The running sub-interval started on a boundary */
+} LMA_Demand;
+
+#define LMA_PROFILE_ENERGIES (4U) /**< Energies of a load profile record (active and reactive import and export) */
+#define LMA_PROFILE_AVERAGES (3U) /**< Averages of a load profile record (Vrms, Irms and P) */
+
+/**
+ * @brief Load profile storage
+ * @details Region of non volatile memory holding a load profile (see LMA_ProfileInit), made of sector_count sectors of
+ * sector_size bytes. It behaves as flash: erasing a sector sets it to 0xFF and bytes are written once between erases.
+ */
+typedef struct LMA_ProfileStorage_str
+{
+  bool (*read)(void *p_context, uint32_t address, uint8_t *p_data, uint32_t size);        /**< Reads bytes */
+  bool (*write)(void *p_context, uint32_t address, const uint8_t *p_data, uint32_t size); /**< Writes erased bytes */
+  bool (*erase)(void *p_context, uint32_t address);                                      /**< Erases the sector */
+  void *p_context;                                                                        /**< Passed to each function */
+  uint32_t sector_size;                                                                   /**< Bytes of each sector */
+  uint32_t sector_count;                                                                  /**< Sectors (at least 2) */
+} LMA_ProfileStorage;
+
+/**
+ * @brief Load profile entry
+ * @details One interval of a load profile as read back by LMA_ProfileRead.
+ */
+typedef struct LMA_ProfileEntry_str
+{
+  uint32_t time;                         /**< End of the interval (clock seconds, see LMA_ClockGet) */
+  float energy_wh[LMA_PROFILE_ENERGIES]; /**< Active import, active export, reactive import, reactive export (Wh) */
+  float average[LMA_PROFILE_AVERAGES];   /**< Mean Vrms, Irms and P over the interval */
+} LMA_ProfileEntry;
+
+/**
+ * @brief Load profile values
+ * @details The integer values of a load profile record - each record is stored as the difference to the one before.
+ */
+typedef struct LMA_ProfileValues_str
+{
+  uint32_t time;                         /**< End of the interval (clock seconds) */
+  uint32_t energy[LMA_PROFILE_ENERGIES]; /**< Total energies in mWh (wrapping) */
+  int32_t average[LMA_PROFILE_AVERAGES]; /**< Averages in 10 mV, mA and 100 mW */
+} LMA_ProfileValues;
+
+/**
+ * @brief Load profile recorder
+ * @details Records an interval of energy and average values from the snapshots given to LMA_ProfileUpdate, as variable length
+ * records in a circular region of storage. Each sector starts with the values before its first record, so it decodes on
+ * its own and the oldest sector can be erased to make room.
+ */
+typedef struct LMA_Profile_str
+{
+  const LMA_ProfileStorage *p_storage; /**< Storage holding the records */
+  uint32_t interval;                   /**< Interval length in clock seconds (e.g. 900) */
+  LMA_ProfileValues last;              /**< Values of the newest record */
+  uint32_t sector;                     /**< Sector being written */
+  uint32_t offset;                     /**< Next free byte of the sector being written */
+  uint32_t sequence;                   /**< Sequence number of the sector being written (0 = nothing written) */
+  uint32_t interval_end;               /**< End of the running interval (0 = not started) */
+  bool whole;                          /**< The running interval started on its boundary - only whole ones are recorded */
+  float sum[LMA_PROFILE_AVERAGES];     /**< Sums of Vrms, Irms and P over the running interval */
+  uint32_t count;                      /**< Snapshots summed over the running interval */
+  uint32_t records;                    /**< Records written since LMA_ProfileInit */
+} LMA_Profile;
+
+/**
+ * @brief Measurement history slot
+ * @details The measurement windows of one period of a history level (see LMA_HistoryInit) rolled up.
+ */
+typedef struct LMA_HistorySlot_str
+{
+  uint32_t time;         /**< Start of the period (clock seconds, see LMA_ClockGet) */
+  uint32_t count;        /**< Measurement windows in the period (0 = none) */
+  LMA_Measurements min;  /**< Smallest of each measurement */
+  LMA_Measurements max;  /**< Largest of each measurement */
+  LMA_Measurements mean; /**< Mean of each measurement */
+} LMA_HistorySlot;
+
+/**
+ * @brief Measurement history level
+ * @details One resolution of a measurement history - a ring of slots of one period each, held by the application. period,
+ * slots and p_slots are set by the application, the rest by LMA_HistoryInit.
+ */
+typedef struct LMA_HistoryLevel_str
+{
+  uint32_t period;          /**< Clock seconds per slot - a multiple of the period of the level before */
+  uint32_t slots;           /**< Slots in the ring */
+  LMA_HistorySlot *p_slots; /**< Ring of slots */
+  uint32_t newest;          /**< Ring entry of the newest slot */
+  uint32_t filled;          /**< Slots of the ring in use, the newest included (0 = empty) */
+} LMA_HistoryLevel;
+
+/**
+ * @brief Measurement history
+ * @details Cascaded rings of min, max and mean measurements at increasing periods (e.g. a second, a minute and an hour). Each
+ * window goes into the newest slot of the finest level, and each slot is rolled up into the next level as it closes.
+ */
+typedef struct LMA_History_str
+{
+  LMA_HistoryLevel *p_levels; /**< Levels, finest first */
+  uint32_t level_count;       /**< Number of levels */
+} LMA_History;
+
+/**
+ * @brief Measurement history range
+ * @details Slots of a level read by LMA_HistoryRead, oldest first, in place in the ring - in two parts where it wraps.
+ */
+typedef struct LMA_HistoryRange_str
+{
+  const LMA_HistorySlot *p_slots[2]; /**< First slot of each part (NULL = part empty) */
+  uint32_t count[2];                 /**< Slots of each part */
+} LMA_HistoryRange;
+
 /** @} */
 
 /** @} */
@@ -367,6 +828,31 @@ typedef struct LMA_PhaseCalibArgs_str
   uint32_t line_cycles_stability; /**< Line cycles to delay for allowing signal stability - typically about 5-10*/
 } LMA_PhaseCalibArgs;
 
+/**
+ * @brief Progress of a phase through an asynchronous calibration (see LMA_PhaseCalibrateStart)
+ */
+typedef enum LMA_CalibState_e
+{
+  LMA_CALIB_STABILISING = 0, /**< Discarding a window of line_cycles_stability while the signal settles */
+  LMA_CALIB_ACCUMULATING,    /**< Accumulating the window of line_cycles the coefficients are taken from */
+  LMA_CALIB_DONE             /**< Coefficients updated - the phase is metering again */
+} LMA_CalibState;
+
+/**
+ * @brief Asynchronous calibration of several phases
+ * @details Held by the application - the phases calibrate concurrently, each on its own windows, while the rest keep
+ * metering.
+ */
+typedef struct LMA_CalibJob_str
+{
+  LMA_PhaseCalibArgs *p_args; /**< Phases to calibrate and their targets (count entries) */
+  LMA_CalibState *p_states;   /**< State of each phase (count entries - set by LMA) */
+  uint32_t count;             /**< Number of phases */
+  void (*p_callback)(const struct LMA_CalibJob_str *p_job,
+                     uint32_t index); /**< Called by LMA_CB_TMR as phase index changes state (NULL = none) */
+  volatile uint32_t remaining;        /**< Phases not yet done (counted down in LMA_CB_TMR) */
+} LMA_CalibJob;
+
 /**
  * @brief Calibration arguments (global)
  * @details Data structure containing calibration invocation arguments/parameters for global calibration.
@@ -386,6 +872,11 @@ typedef struct LMA_Config_str
 {
   LMA_GlobalCalibration gcalib; /**< Global calibration data block */
   uint32_t update_interval;     /**< Number of V line cycles to between computation updates. */
+  uint32_t update_interval_min; /**< Shortest adaptive window in V line cycles (0 = every window is update_interval). */
+  float transient_threshold;    /**< Relative change of Irms or P between windows taken as a load transient */
+  uint8_t adc_bits;             /**< Significant bits of the samples - bounds the window length (0 = not bounded) */
+  bool coherent_windows;        /**< Every phase follows the zero cross and window of the first phase (one detector) */
+  uint8_t rtc_rate;             /**< LMA_CB_RTC calls per second - keeps the clock (0 = no clock) */
   float fline_tol_low;          /**< Lower tolerance of system frequency*/
   float fline_tol_high;         /**< Upper tolerance of system frequency*/
   float meter_constant;         /**< Ws/imp ... translated Ws/imp = 3,600,000 / [imp/kwh]*/
@@ -393,8 +884,40 @@ typedef struct LMA_Config_str
   float no_load_p;              /**< No active/reactive power load value */
   float v_sag;                  /**< Voltage sag value */
   float v_swell;                /**< Voltage swell value */
+  float i_over;                 /**< Irms raising LMA_OVERCURRENT (0 = not checked) */
+  float residual_i;             /**< Computed neutral current raising LMA_RESIDUAL_CURRENT (0 = not checked) */
+  float neutral_mismatch;       /**< Measured to computed neutral difference raising LMA_NEUTRAL_MISMATCH (0 = not checked) */
 } LMA_Config;
 
+/**
+ * @brief Trace points
+ * @details Enumerated type identifying the instrumented sections of the hot path (see LMA_TRACE_ENABLE).
+ */
+typedef enum LMA_TraceId_e
+{
+  LMA_TRACE_ADC = 0,  /**< LMA_CB_ADC */
+  LMA_TRACE_TMR,      /**< LMA_CB_TMR */
+  LMA_TRACE_RTC,      /**< LMA_CB_RTC */
+  LMA_TRACE_ACC_RUN,  /**< LMA_AccPhaseRun (each phase, each sample) */
+  LMA_TRACE_ACC_LOAD, /**< LMA_AccPhaseLoad (each phase, each computation window) */
+  LMA_TRACE_COUNT     /**< Number of trace points */
+} LMA_TraceId;
+
+/**
+ * @brief Trace statistics
+ * @details Latency distribution of a trace point, in cycles of the port cycle counter.
+ */
+typedef struct LMA_TraceStats_str
+{
+  uint32_t count;                      /**< Number of executions recorded */
+  uint32_t min;                        /**< Shortest execution */
+  uint32_t max;                        /**< Longest execution */
+  uint32_t budget;                     /**< Overrun threshold (0 = not checked) */
+  uint32_t overruns;                   /**< Number of executions longer than budget */
+  uint32_t buckets[LMA_TRACE_BUCKETS]; /**< log2 histogram - bucket 0 holds 0 cycles, bucket b holds [2^(b-1), 2^b) and the
+                                          last bucket also holds everything longer */
+} LMA_TraceStats;
+
 /** @} */
 
 /** @} */